@@ -2,16 +2,144 @@
 
 #include "MassArchetypeData.h"
 #include "MassEntityTypes.h"
+#include "MassEntitySettings.h"
 #include "Misc/StringBuilder.h"
+#include "UObject/StructOnScope.h"
 
 
-//////////////////////////////////////////////////////////////////////
-// FMassArchetypeData
 namespace UE::Mass::Core 
 {
 	constexpr static bool bBitwiseRelocateFragments = true;
+
+	static std::atomic<uint64> ChangeVersionCounter{0};
 }// UE::Mass::Core
 
+uint64 UE::Mass::GetNextChangeVersion()
+{
+	return ++UE::Mass::Core::ChangeVersionCounter;
+}
+
+uint64 UE::Mass::GetPendingChangeVersion()
+{
+	return UE::Mass::Core::ChangeVersionCounter.load(std::memory_order_relaxed) + 1;
+}
+
+//////////////////////////////////////////////////////////////////////
+// FMassArchetypeFragmentConfig
+void FMassArchetypeFragmentConfig::InitializeSplitLayout()
+{
+	check(FragmentType && FragmentType->IsChildOf(FMassSplitFragment::StaticStruct()));
+
+	// the members need to be of a single numeric type and cover the whole struct, so that member N lives at 
+	// N * SubColumnElementSize and the instances can be split and put back together with plain memory copies
+	const FProperty* FirstProperty = nullptr;
+	NumSubColumns = 0;
+	for (TFieldIterator<FProperty> It(FragmentType); It; ++It)
+	{
+		const FProperty* Property = *It;
+		FirstProperty = FirstProperty ? FirstProperty : Property;
+		checkf(Property->IsA<FNumericProperty>() && Property->ArrayDim == 1 && Property->SameType(FirstProperty) && Property->GetOffset_ForInternal() == NumSubColumns * FirstProperty->GetElementSize()
+			, TEXT("Split fragment %s needs to consist solely of members of a single numeric type, %s doesn't fit in"), *FragmentType->GetName(), *Property->GetName());
+		++NumSubColumns;
+	}
+	checkf(FirstProperty && NumSubColumns * FirstProperty->GetElementSize() == FragmentType->GetStructureSize()
+		, TEXT("Split fragment %s needs to consist solely of UPROPERTY members"), *FragmentType->GetName());
+	SubColumnElementSize = FirstProperty->GetElementSize();
+
+	FStructOnScope DefaultValue(FragmentType);
+	SplitDefaultValue.Reset();
+	SplitDefaultValue.Append(DefaultValue.GetStructMemory(), FragmentType->GetStructureSize());
+}
+
+void FMassArchetypeFragmentConfig::InitializeElements(uint8* ChunkBase, const int32 IndexWithinChunk, const int32 Num) const
+{
+	if (IsSplit() == false)
+	{
+		FragmentType->InitializeStruct(GetColumnData(ChunkBase, IndexWithinChunk), Num);
+		return;
+	}
+
+	uint8* SubColumn = GetColumnData(ChunkBase, IndexWithinChunk);
+	for (int32 Member = 0; Member < NumSubColumns; ++Member, SubColumn += SubColumnStride)
+	{
+		const uint8* MemberDefault = &SplitDefaultValue[Member * SubColumnElementSize];
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			FMemory::Memcpy(SubColumn + Index * SubColumnElementSize, MemberDefault, SubColumnElementSize);
+		}
+	}
+}
+
+void FMassArchetypeFragmentConfig::DestroyElements(uint8* ChunkBase, const int32 IndexWithinChunk, const int32 Num) const
+{
+	// split fragments only consist of numeric values, there's nothing to destroy
+	if (IsSplit() == false)
+	{
+		FragmentType->DestroyStruct(GetColumnData(ChunkBase, IndexWithinChunk), Num);
+	}
+}
+
+void FMassArchetypeFragmentConfig::RelocateElements(uint8* ChunkBase, const int32 IndexWithinChunk, const FMassArchetypeFragmentConfig& Source, uint8* SourceChunkBase, const int32 SourceIndexWithinChunk, const int32 Num) const
+{
+	check(FragmentType == Source.FragmentType);
+	uint8* Dst = GetColumnData(ChunkBase, IndexWithinChunk);
+	const uint8* Src = Source.GetColumnData(SourceChunkBase, SourceIndexWithinChunk);
+	if (IsSplit() == false)
+	{
+		FMemory::Memcpy(Dst, Src, Num * FragmentType->GetStructureSize());
+		return;
+	}
+
+	for (int32 Member = 0; Member < NumSubColumns; ++Member, Dst += SubColumnStride, Src += Source.SubColumnStride)
+	{
+		FMemory::Memcpy(Dst, Src, Num * SubColumnElementSize);
+	}
+}
+
+void FMassArchetypeFragmentConfig::CopyElementsFrom(uint8* ChunkBase, const int32 IndexWithinChunk, const void* Values, const int32 Num) const
+{
+	if (IsSplit() == false)
+	{
+		// No UE::Mass::Core::bBitwiseRelocateFragments, this isn't a move of a fragment
+		FragmentType->CopyScriptStruct(GetColumnData(ChunkBase, IndexWithinChunk), Values, Num);
+		return;
+	}
+
+	const int32 StructSize = FragmentType->GetStructureSize();
+	uint8* SubColumn = GetColumnData(ChunkBase, IndexWithinChunk);
+	for (int32 Member = 0; Member < NumSubColumns; ++Member, SubColumn += SubColumnStride)
+	{
+		const uint8* Src = static_cast<const uint8*>(Values) + Member * SubColumnElementSize;
+		for (int32 Index = 0; Index < Num; ++Index, Src += StructSize)
+		{
+			FMemory::Memcpy(SubColumn + Index * SubColumnElementSize, Src, SubColumnElementSize);
+		}
+	}
+}
+
+void FMassArchetypeFragmentConfig::CopyElementsTo(void* OutValues, uint8* ChunkBase, const int32 IndexWithinChunk, const int32 Num) const
+{
+	if (IsSplit() == false)
+	{
+		FragmentType->CopyScriptStruct(OutValues, GetColumnData(ChunkBase, IndexWithinChunk), Num);
+		return;
+	}
+
+	const int32 StructSize = FragmentType->GetStructureSize();
+	const uint8* SubColumn = GetColumnData(ChunkBase, IndexWithinChunk);
+	for (int32 Member = 0; Member < NumSubColumns; ++Member, SubColumn += SubColumnStride)
+	{
+		uint8* Dst = static_cast<uint8*>(OutValues) + Member * SubColumnElementSize;
+		for (int32 Index = 0; Index < Num; ++Index, Dst += StructSize)
+		{
+			FMemory::Memcpy(Dst, SubColumn + Index * SubColumnElementSize, SubColumnElementSize);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// FMassArchetypeData
+
 void FMassArchetypeData::ForEachFragmentType(TFunction< void(const UScriptStruct* /*Fragment*/)> Function) const
 {
 	for (const FMassArchetypeFragmentConfig& FragmentData : FragmentConfigs)
@@ -35,8 +163,13 @@ void FMassArchetypeData::Initialize(const FMassArchetypeCompositionDescriptor& I
 	// Figure out how many bytes all of the individual fragments (and metadata) will cost per entity
 	int32 FragmentSizeTallyBytes = 0;
 
-	// Alignment padding computation is currently very conservative and over-estimated.
-	int32 AlignmentPadding = 0;
+	ColumnAlignment = GET_MASS_CONFIG_VALUE(FragmentColumnAlignment);
+	if (ColumnAlignment > 0 && !ensureMsgf(FMath::IsPowerOfTwo(ColumnAlignment), TEXT("FragmentColumnAlignment needs to be a power of two, %d given"), ColumnAlignment))
+	{
+		ColumnAlignment = int32(FMath::RoundUpToPowerOfTwo(uint32(ColumnAlignment)));
+	}
+	ChunkAlignment = FMath::Max<int32>(alignof(FMassEntityHandle), ColumnAlignment);
+
 	{
 		// Save room for the 'metadata' (entity array)
 		FragmentSizeTallyBytes += sizeof(FMassEntityHandle);
@@ -50,8 +183,12 @@ void FMassArchetypeData::Initialize(const FMassArchetypeCompositionDescriptor& I
 			const UScriptStruct* FragmentType = SortedFragmentList[FragmentIndex];
 			checkSlow(FragmentType);
 			FragmentConfigs[FragmentIndex].FragmentType = FragmentType;
+			if (FragmentType->IsChildOf(FMassSplitFragment::StaticStruct()))
+			{
+				FragmentConfigs[FragmentIndex].InitializeSplitLayout();
+			}
 			
-			AlignmentPadding += FragmentType->GetMinAlignment();
+			ChunkAlignment = FMath::Max(ChunkAlignment, GetColumnAlignment(*FragmentType));
 			FragmentSizeTallyBytes += FragmentType->GetStructureSize();
 
 			FragmentIndexMap.Add(FragmentType, FragmentIndex);
@@ -78,21 +215,43 @@ void FMassArchetypeData::Initialize(const FMassArchetypeCompositionDescriptor& I
 	SharedFragmentValues = InSharedFragmentValues;
 
 	TotalBytesPerEntity = FragmentSizeTallyBytes;
-	int32 ChunkAvailableSize = GetChunkAllocSize() - AlignmentPadding;
-	check(TotalBytesPerEntity <= ChunkAvailableSize);
-
-	NumEntitiesPerChunk = ChunkAvailableSize / TotalBytesPerEntity;
+	// making sure at least one entity fits regardless of the settings
+	ChunkMemorySize = FMath::Max(GET_MASS_CONFIG_VALUE(GetChunkMemorySize(TotalBytesPerEntity))
+		, int32(FMath::RoundUpToPowerOfTwo(uint32(LayoutChunkColumns(1)))));
+
+	// Starting with the number of entities that would fit without any padding and backing off until the padded 
+	// layout fits. Every column adds less than its alignment worth of padding so this takes only a couple of steps.
+	NumEntitiesPerChunk = GetChunkAllocSize() / TotalBytesPerEntity;
+	while (LayoutChunkColumns(NumEntitiesPerChunk) > GetChunkAllocSize())
+	{
+		--NumEntitiesPerChunk;
+	}
+	check(NumEntitiesPerChunk > 0);
+}
 
-	// Set up the offsets for each fragment into the chunk data
+int32 FMassArchetypeData::LayoutChunkColumns(const int32 InNumEntitiesPerChunk)
+{
+	// the entity list goes first, at the very beginning of the chunk memory which is aligned to ChunkAlignment
 	EntityListOffsetWithinChunk = 0;
-	int32 CurrentOffset = NumEntitiesPerChunk * sizeof(FMassEntityHandle);
+	int32 CurrentOffset = InNumEntitiesPerChunk * sizeof(FMassEntityHandle);
 	for (FMassArchetypeFragmentConfig& FragmentData : FragmentConfigs)
 	{
-		CurrentOffset = Align(CurrentOffset, FragmentData.FragmentType->GetMinAlignment());
+		const int32 Alignment = GetColumnAlignment(*FragmentData.FragmentType);
+		CurrentOffset = Align(CurrentOffset, Alignment);
 		FragmentData.ArrayOffsetWithinChunk = CurrentOffset;
-		const int32 SizeOfThisFragmentArray = NumEntitiesPerChunk * FragmentData.FragmentType->GetStructureSize();
-		CurrentOffset += SizeOfThisFragmentArray;
+		if (FragmentData.IsSplit())
+		{
+			// every member's sub-column starts aligned the same way a regular column would
+			FragmentData.SubColumnStride = Align(InNumEntitiesPerChunk * FragmentData.SubColumnElementSize, Alignment);
+			CurrentOffset += FragmentData.SubColumnStride * (FragmentData.NumSubColumns - 1) + InNumEntitiesPerChunk * FragmentData.SubColumnElementSize;
+		}
+		else
+		{
+			const int32 SizeOfThisFragmentArray = InNumEntitiesPerChunk * FragmentData.FragmentType->GetStructureSize();
+			CurrentOffset += SizeOfThisFragmentArray;
+		}
 	}
+	return CurrentOffset;
 }
 
 void FMassArchetypeData::InitializeWithSibling(const FMassArchetypeData& SiblingArchetype, const FMassTagBitSet& OverrideTags)
@@ -109,6 +268,9 @@ void FMassArchetypeData::InitializeWithSibling(const FMassArchetypeData& Sibling
 	SharedFragmentValues = SiblingArchetype.GetSharedFragmentValues();
 
 	TotalBytesPerEntity = SiblingArchetype.TotalBytesPerEntity;
+	ChunkMemorySize = SiblingArchetype.ChunkMemorySize;
+	ColumnAlignment = SiblingArchetype.ColumnAlignment;
+	ChunkAlignment = SiblingArchetype.ChunkAlignment;
 	NumEntitiesPerChunk = SiblingArchetype.NumEntitiesPerChunk;
 
 	// Set up the offsets for each fragment into the chunk data
@@ -120,6 +282,78 @@ void FMassArchetypeData::AddEntity(FMassEntityHandle Entity)
 	AddEntityInternal(Entity, true/*bInitializeFragments*/);
 }
 
+void FMassArchetypeData::BatchAddEntities(TConstArrayView<FMassEntityHandle> InEntities, TConstArrayView<FMassFragmentInitialValues> InitialValues)
+{
+	if (InEntities.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<const FMassFragmentInitialValues*, TInlineAllocator<16>> FragmentInitialValues;
+	FragmentInitialValues.AddZeroed(FragmentConfigs.Num());
+	for (const FMassFragmentInitialValues& Values : InitialValues)
+	{
+		const int32* FragmentIndex = FragmentIndexMap.Find(Values.FragmentType);
+		checkf(FragmentIndex, TEXT("Initial values provided for %s which is not a part of the archetype"), *GetNameSafe(Values.FragmentType));
+		checkf(Values.Num == InEntities.Num(), TEXT("Expecting %d initial values of %s, got %d"), InEntities.Num(), *GetNameSafe(Values.FragmentType), Values.Num);
+		FragmentInitialValues[*FragmentIndex] = &Values;
+	}
+
+	// making sure the chunks array gets grown only once
+	Chunks.Reserve(Chunks.Num() + FMath::DivideAndRoundUp(InEntities.Num(), NumEntitiesPerChunk));
+
+	FChunkSearchCursor SearchCursor;
+	int32 NumAdded = 0;
+	while (NumAdded < InEntities.Num())
+	{
+		int32 AbsoluteIndex = INDEX_NONE;
+		const int32 NumAddedToChunk = AddEntitiesInternal(InEntities.Slice(NumAdded, InEntities.Num() - NumAdded), /*bInitializeFragments=*/false, SearchCursor, AbsoluteIndex);
+		uint8* ChunkMemory = Chunks[AbsoluteIndex / NumEntitiesPerChunk].GetRawMemory();
+		const int32 IndexWithinChunk = AbsoluteIndex % NumEntitiesPerChunk;
+
+		for (int32 FragmentIndex = 0; FragmentIndex < FragmentConfigs.Num(); ++FragmentIndex)
+		{
+			const FMassArchetypeFragmentConfig& FragmentConfig = FragmentConfigs[FragmentIndex];
+			const UScriptStruct* FragmentType = FragmentConfig.FragmentType;
+			const FMassFragmentInitialValues* Values = FragmentInitialValues[FragmentIndex];
+			if (Values == nullptr)
+			{
+				FragmentConfig.InitializeElements(ChunkMemory, IndexWithinChunk, NumAddedToChunk);
+				continue;
+			}
+
+			const uint8* SourceValues = static_cast<const uint8*>(Values->Values) + NumAdded * FragmentType->GetStructureSize();
+			if (FragmentConfig.IsSplit())
+			{
+				FragmentConfig.CopyElementsFrom(ChunkMemory, IndexWithinChunk, SourceValues, NumAddedToChunk);
+			}
+			else if (FragmentType->StructFlags & STRUCT_IsPlainOldData)
+			{
+				FMemory::Memcpy(FragmentConfig.GetFragmentData(ChunkMemory, IndexWithinChunk), SourceValues, NumAddedToChunk * FragmentType->GetStructureSize());
+			}
+			else
+			{
+				void* FragmentPtr = FragmentConfig.GetFragmentData(ChunkMemory, IndexWithinChunk);
+				FragmentType->InitializeStruct(FragmentPtr, NumAddedToChunk);
+				FragmentType->CopyScriptStruct(FragmentPtr, SourceValues, NumAddedToChunk);
+			}
+		}
+
+		NumAdded += NumAddedToChunk;
+	}
+}
+
+FMassArchetypeChunk& FMassArchetypeData::AddChunkInternal()
+{
+	FMassArchetypeChunk& NewChunk = Chunks.Emplace_GetRef(*ChunkMemoryPool, GetChunkAllocSize(), GetChunkAlignment(), ChunkFragmentsTemplate, FragmentConfigs.Num());
+	// trailing empty chunks get trimmed, so FullChunkList can already cover the new chunk
+	if (FullChunkList.Num() < Chunks.Num())
+	{
+		FullChunkList.Add(FArchetypeChunkCollection::FChunkInfo(Chunks.Num() - 1));
+	}
+	return NewChunk;
+}
+
 int32 FMassArchetypeData::AddEntityInternal(FMassEntityHandle Entity, const bool bInitializeFragments)
 {
 	int32 IndexWithinChunk = 0;
@@ -167,10 +401,13 @@ int32 FMassArchetypeData::AddEntityInternal(FMassEntityHandle Entity, const bool
 		}
 		else
 		{
-			DestinationChunk = &Chunks.Emplace_GetRef(GetChunkAllocSize(), ChunkFragmentsTemplate);
+			DestinationChunk = &AddChunkInternal();
 		}
 
 		check(DestinationChunk);
+#if WITH_MASSENTITY_DEBUG
+		DebugValidateColumnAlignment(*DestinationChunk);
+#endif // WITH_MASSENTITY_DEBUG
 		DestinationChunk->AddInstance();
 	}
 
@@ -179,21 +416,98 @@ int32 FMassArchetypeData::AddEntityInternal(FMassEntityHandle Entity, const bool
 	{
 		for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
 		{
-			void* FragmentPtr = FragmentConfig.GetFragmentData(DestinationChunk->GetRawMemory(), IndexWithinChunk);
-			FragmentConfig.FragmentType->InitializeStruct(FragmentPtr);
+			FragmentConfig.InitializeElements(DestinationChunk->GetRawMemory(), IndexWithinChunk, 1);
 		}
 	}
 
 	// Add to the table and map
-	EntityMap.Add(Entity.Index, AbsoluteIndex);
+	SetEntityAbsoluteIndex(Entity.Index, AbsoluteIndex);
+	++NumEntities;
 	DestinationChunk->GetEntityArrayElementRef(EntityListOffsetWithinChunk, IndexWithinChunk) = Entity;
 
 	return AbsoluteIndex;
 }
 
+int32 FMassArchetypeData::AddEntitiesInternal(TConstArrayView<FMassEntityHandle> InEntities, const bool bInitializeFragments, FChunkSearchCursor& SearchCursor, int32& OutAbsoluteIndex)
+{
+	check(InEntities.Num() > 0);
+
+	// Same chunk picking policy as AddEntityInternal - earlier partially filled chunks first, then the first empty one,
+	// and only then a brand new chunk. The search resumes at the chunk used by the previous call for the same batch,
+	// which might still have free slots left.
+	int32 ChunkIndex = INDEX_NONE;
+	for (int32 Index = SearchCursor.NextChunkToScan; Index < Chunks.Num(); ++Index)
+	{
+		const int32 NumInstances = Chunks[Index].GetNumInstances();
+		if (NumInstances == 0)
+		{
+			if (SearchCursor.FirstEmptyChunk == INDEX_NONE)
+			{
+				SearchCursor.FirstEmptyChunk = Index;
+				if (SearchCursor.bNoPartialChunksLeft)
+				{
+					break;
+				}
+			}
+		}
+		else if (NumInstances < NumEntitiesPerChunk)
+		{
+			ChunkIndex = Index;
+			break;
+		}
+	}
+
+	if (ChunkIndex == INDEX_NONE)
+	{
+		SearchCursor.bNoPartialChunksLeft = true;
+		if (SearchCursor.FirstEmptyChunk != INDEX_NONE)
+		{
+			ChunkIndex = SearchCursor.FirstEmptyChunk;
+			SearchCursor.FirstEmptyChunk = INDEX_NONE;
+			Chunks[ChunkIndex].Recycle(ChunkFragmentsTemplate);
+		}
+		else
+		{
+			ChunkIndex = Chunks.Num();
+			AddChunkInternal();
+		}
+#if WITH_MASSENTITY_DEBUG
+		DebugValidateColumnAlignment(Chunks[ChunkIndex]);
+#endif // WITH_MASSENTITY_DEBUG
+	}
+
+	SearchCursor.NextChunkToScan = ChunkIndex;
+
+	FMassArchetypeChunk& DestinationChunk = Chunks[ChunkIndex];
+	const int32 IndexWithinChunk = DestinationChunk.GetNumInstances();
+	const int32 NumAdded = FMath::Min(NumEntitiesPerChunk - IndexWithinChunk, InEntities.Num());
+	DestinationChunk.AddMultipleInstances(NumAdded);
+
+	// Initialize the fragment memory
+	if (bInitializeFragments)
+	{
+		for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
+		{
+			FragmentConfig.InitializeElements(DestinationChunk.GetRawMemory(), IndexWithinChunk, NumAdded);
+		}
+	}
+
+	// Add to the table and map
+	OutAbsoluteIndex = ChunkIndex * NumEntitiesPerChunk + IndexWithinChunk;
+	FMemory::Memcpy(&DestinationChunk.GetEntityArrayElementRef(EntityListOffsetWithinChunk, IndexWithinChunk), InEntities.GetData(), NumAdded * sizeof(FMassEntityHandle));
+	for (int32 i = 0; i < NumAdded; ++i)
+	{
+		SetEntityAbsoluteIndex(InEntities[i].Index, OutAbsoluteIndex + i);
+	}
+	NumEntities += NumAdded;
+
+	return NumAdded;
+}
+
 void FMassArchetypeData::RemoveEntity(FMassEntityHandle Entity)
 {
-	const int32 AbsoluteIndex = EntityMap.FindAndRemoveChecked(Entity.Index);
+	const int32 AbsoluteIndex = GetInternalIndexForEntity(Entity.Index);
+	SetEntityAbsoluteIndex(Entity.Index, INDEX_NONE);
 	RemoveEntityInternal(AbsoluteIndex, true/*bDestroyFragments*/);
 }
 
@@ -213,22 +527,23 @@ void FMassArchetypeData::RemoveEntityInternal(const int32 AbsoluteIndex, const b
 	{
 		for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
 		{
-			void* DyingFragmentPtr = FragmentConfig.GetFragmentData(Chunk.GetRawMemory(), IndexWithinChunk);
-			void* MovingFragmentPtr = FragmentConfig.GetFragmentData(Chunk.GetRawMemory(), IndexToSwapFrom);
-
-			if (UE::Mass::Core::bBitwiseRelocateFragments)
+			// split fragments consist solely of numeric values and get relocated bitwise regardless
+			if (UE::Mass::Core::bBitwiseRelocateFragments || FragmentConfig.IsSplit())
 			{
 				// Destroy fragment data
 				if (bDestroyFragments)
 				{
-					FragmentConfig.FragmentType->DestroyStruct(DyingFragmentPtr);
+					FragmentConfig.DestroyElements(Chunk.GetRawMemory(), IndexWithinChunk, 1);
 				}
 
 				// Move last entry
-				FMemory::Memcpy(DyingFragmentPtr, MovingFragmentPtr, FragmentConfig.FragmentType->GetStructureSize());
+				FragmentConfig.RelocateElements(Chunk.GetRawMemory(), IndexWithinChunk, FragmentConfig, Chunk.GetRawMemory(), IndexToSwapFrom, 1);
 			}
 			else
 			{
+				void* DyingFragmentPtr = FragmentConfig.GetFragmentData(Chunk.GetRawMemory(), IndexWithinChunk);
+				void* MovingFragmentPtr = FragmentConfig.GetFragmentData(Chunk.GetRawMemory(), IndexToSwapFrom);
+
 				// Destroy & initialize the fragment data
 				FragmentConfig.FragmentType->ClearScriptStruct(DyingFragmentPtr);
 
@@ -243,19 +558,19 @@ void FMassArchetypeData::RemoveEntityInternal(const int32 AbsoluteIndex, const b
 		// Update the entity table and map
 		const FMassEntityHandle EntityBeingSwapped = Chunk.GetEntityArrayElementRef(EntityListOffsetWithinChunk, IndexToSwapFrom);
 		Chunk.GetEntityArrayElementRef(EntityListOffsetWithinChunk, IndexWithinChunk) = EntityBeingSwapped;
-		EntityMap.FindChecked(EntityBeingSwapped.Index) = AbsoluteIndex;
+		SetEntityAbsoluteIndex(EntityBeingSwapped.Index, AbsoluteIndex);
 	}
 	else if (!UE::Mass::Core::bBitwiseRelocateFragments || bDestroyFragments)
 	{
 		for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
 		{
 			// Destroy the fragment data
-			void* DyingFragmentPtr = FragmentConfig.GetFragmentData(Chunk.GetRawMemory(), IndexWithinChunk);
-			FragmentConfig.FragmentType->DestroyStruct(DyingFragmentPtr);
+			FragmentConfig.DestroyElements(Chunk.GetRawMemory(), IndexWithinChunk, 1);
 		}
 	}
 	
 	Chunk.RemoveInstance();
+	--NumEntities;
 
 	// If the chunk itself is empty now, see if we can remove it entirely
 	// Note: This is only possible for trailing chunks, to avoid messing up the absolute indices in the entities map
@@ -285,79 +600,92 @@ void FMassArchetypeData::BatchDestroyEntityChunks(const FArchetypeChunkCollectio
 		FMassEntityHandle* DyingEntityPtr = &Chunk.GetEntityArrayElementRef(EntityListOffsetWithinChunk, SubchunkInfo.SubchunkStart);
 		OutEntitiesRemoved.Append(DyingEntityPtr, SubchunkInfo.Length);
 
-		const int32 NumberToMove = FMath::Min(Chunk.GetNumInstances() - (SubchunkInfo.SubchunkStart + SubchunkInfo.Length), SubchunkInfo.Length);
-		checkf(NumberToMove >= 0, TEXT("Trying to move a negative number of elements indicates a problem with SubchunkInfo, it's possibly out of date."));
-		const int32 NumberToCut = FMath::Max(SubchunkInfo.Length - NumberToMove, 0);
-		
-		if (NumberToMove > 0)
-		{
-			const int32 SwapStartIndex = Chunk.GetNumInstances() - NumberToMove;
-			checkf((SubchunkInfo.SubchunkStart + NumberToMove - 1) < SwapStartIndex, TEXT("Remove and Move ranges overlap"));
+		RemoveSubchunkInternal(SubchunkInfo.ChunkIndex, SubchunkInfo.SubchunkStart, SubchunkInfo.Length, /*bDestroyFragments=*/true);
+	}
 
-			for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
-			{
-				void* DyingFragmentPtr = FragmentConfig.GetFragmentData(Chunk.GetRawMemory(), SubchunkInfo.SubchunkStart);
-				void* MovingFragmentPtr = FragmentConfig.GetFragmentData(Chunk.GetRawMemory(), SwapStartIndex);
+	for (int i = InitialOutEntitiesCount; i < OutEntitiesRemoved.Num(); ++i)
+	{
+		SetEntityAbsoluteIndex(OutEntitiesRemoved[i].Index, INDEX_NONE);
+	}
 
-				if (UE::Mass::Core::bBitwiseRelocateFragments)
-				{
-					// Destroy the fragments we'll replace by the following copy
-					FragmentConfig.FragmentType->DestroyStruct(DyingFragmentPtr, NumberToMove);
+	// If the chunk itself is empty now, see if we can remove it entirely
+	// Note: This is only possible for trailing chunks, to avoid messing up the absolute indices in the entities map
+	while ((Chunks.Num() > 0) && (Chunks.Last().GetNumInstances() == 0))
+	{
+		Chunks.RemoveAt(Chunks.Num() - 1, 1, /*bAllowShrinking=*/ false);
+	}
+}
 
-					// Swap fragments to the empty space just created.
-					FMemory::Memcpy(DyingFragmentPtr, MovingFragmentPtr, FragmentConfig.FragmentType->GetStructureSize() * NumberToMove);
-				}
-				else
-				{
-					// Clear fragments that we will copy over. Clear destroys and initializes the fragments, which is needed for CopyScriptStruct().
-					FragmentConfig.FragmentType->ClearScriptStruct(DyingFragmentPtr, NumberToMove);
+void FMassArchetypeData::RemoveSubchunkInternal(const int32 ChunkIndex, const int32 SubchunkStart, const int32 Length, const bool bDestroyFragments)
+{
+	checkf(bDestroyFragments || UE::Mass::Core::bBitwiseRelocateFragments, TEXT("We allow not to destroy fragments only in bit wise relocation mode."));
+
+	FMassArchetypeChunk& Chunk = Chunks[ChunkIndex];
+	FMassEntityHandle* DyingEntityPtr = &Chunk.GetEntityArrayElementRef(EntityListOffsetWithinChunk, SubchunkStart);
 
-					// Swap fragments into the empty space just created.
-					FragmentConfig.FragmentType->CopyScriptStruct(DyingFragmentPtr, MovingFragmentPtr, NumberToMove);
+	const int32 NumberToMove = FMath::Min(Chunk.GetNumInstances() - (SubchunkStart + Length), Length);
+	checkf(NumberToMove >= 0, TEXT("Trying to move a negative number of elements indicates a problem with SubchunkInfo, it's possibly out of date."));
+	const int32 NumberToCut = FMath::Max(Length - NumberToMove, 0);
+	
+	if (NumberToMove > 0)
+	{
+		const int32 SwapStartIndex = Chunk.GetNumInstances() - NumberToMove;
+		checkf((SubchunkStart + NumberToMove - 1) < SwapStartIndex, TEXT("Remove and Move ranges overlap"));
 
-					// Destroy the fragments that were moved.
-					FragmentConfig.FragmentType->DestroyStruct(MovingFragmentPtr, NumberToMove);
+		for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
+		{
+			if (UE::Mass::Core::bBitwiseRelocateFragments || FragmentConfig.IsSplit())
+			{
+				// Destroy the fragments we'll replace by the following copy
+				if (bDestroyFragments)
+				{
+					FragmentConfig.DestroyElements(Chunk.GetRawMemory(), SubchunkStart, NumberToMove);
 				}
+
+				// Swap fragments to the empty space just created.
+				FragmentConfig.RelocateElements(Chunk.GetRawMemory(), SubchunkStart, FragmentConfig, Chunk.GetRawMemory(), SwapStartIndex, NumberToMove);
 			}
+			else
+			{
+				void* DyingFragmentPtr = FragmentConfig.GetFragmentData(Chunk.GetRawMemory(), SubchunkStart);
+				void* MovingFragmentPtr = FragmentConfig.GetFragmentData(Chunk.GetRawMemory(), SwapStartIndex);
 
-			// Update the entity table and map
-			const FMassEntityHandle* MovingEntityPtr = &Chunk.GetEntityArrayElementRef(EntityListOffsetWithinChunk, SwapStartIndex);
-			int32 AbsoluteIndex = SubchunkInfo.ChunkIndex * NumEntitiesPerChunk + SubchunkInfo.SubchunkStart;
+				// Clear fragments that we will copy over. Clear destroys and initializes the fragments, which is needed for CopyScriptStruct().
+				FragmentConfig.FragmentType->ClearScriptStruct(DyingFragmentPtr, NumberToMove);
 
-			for (int i = 0; i < NumberToMove; ++i)
-			{
-				DyingEntityPtr[i] = MovingEntityPtr[i];
-				EntityMap.FindChecked(MovingEntityPtr[i].Index) = AbsoluteIndex++;
+				// Swap fragments into the empty space just created.
+				FragmentConfig.FragmentType->CopyScriptStruct(DyingFragmentPtr, MovingFragmentPtr, NumberToMove);
+
+				// Destroy the fragments that were moved.
+				FragmentConfig.FragmentType->DestroyStruct(MovingFragmentPtr, NumberToMove);
 			}
 		}
 
-		if (NumberToCut > 0)
+		// Update the entity table and map
+		const FMassEntityHandle* MovingEntityPtr = &Chunk.GetEntityArrayElementRef(EntityListOffsetWithinChunk, SwapStartIndex);
+		int32 AbsoluteIndex = ChunkIndex * NumEntitiesPerChunk + SubchunkStart;
+
+		for (int i = 0; i < NumberToMove; ++i)
 		{
-			// just clean up the rest. Note that we explicitly do not clean the spots vacated by entities moved from 
-			// the back of the chunk - if we did the risk calling DestroyStruct on them multiple times
-			const int32 CutStartIndex = SubchunkInfo.SubchunkStart + NumberToMove;
-			for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
-			{
-				// Destroy the fragment data
-				void* DyingFragmentPtr = FragmentConfig.GetFragmentData(Chunk.GetRawMemory(), CutStartIndex);
-				FragmentConfig.FragmentType->DestroyStruct(DyingFragmentPtr, NumberToCut);
-			}
+			DyingEntityPtr[i] = MovingEntityPtr[i];
+			SetEntityAbsoluteIndex(MovingEntityPtr[i].Index, AbsoluteIndex++);
 		}
-
-		Chunk.RemoveMultipleInstances(SubchunkInfo.Length);
 	}
 
-	for (int i = InitialOutEntitiesCount; i < OutEntitiesRemoved.Num(); ++i)
+	if (NumberToCut > 0 && (!UE::Mass::Core::bBitwiseRelocateFragments || bDestroyFragments))
 	{
-		EntityMap.FindAndRemoveChecked(OutEntitiesRemoved[i].Index);
+		// just clean up the rest. Note that we explicitly do not clean the spots vacated by entities moved from 
+		// the back of the chunk - if we did the risk calling DestroyStruct on them multiple times
+		const int32 CutStartIndex = SubchunkStart + NumberToMove;
+		for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
+		{
+			// Destroy the fragment data
+			FragmentConfig.DestroyElements(Chunk.GetRawMemory(), CutStartIndex, NumberToCut);
+		}
 	}
 
-	// If the chunk itself is empty now, see if we can remove it entirely
-	// Note: This is only possible for trailing chunks, to avoid messing up the absolute indices in the entities map
-	while ((Chunks.Num() > 0) && (Chunks.Last().GetNumInstances() == 0))
-	{
-		Chunks.RemoveAt(Chunks.Num() - 1, 1, /*bAllowShrinking=*/ false);
-	}
+	Chunk.RemoveMultipleInstances(Length);
+	NumEntities -= Length;
 }
 
 bool FMassArchetypeData::HasFragmentDataForEntity(const UScriptStruct* FragmentType, int32 EntityIndex) const
@@ -385,18 +713,27 @@ void* FMassArchetypeData::GetFragmentDataForEntity(const UScriptStruct* Fragment
 	return nullptr;
 }
 
+void FMassArchetypeData::CopyFragmentValueForEntity(const UScriptStruct* FragmentType, int32 EntityIndex, void* OutValue) const
+{
+	const FInternalEntityHandle InternalIndex = MakeEntityHandle(EntityIndex);
+	const int32 FragmentIndex = FragmentIndexMap.FindChecked(FragmentType);
+	FragmentConfigs[FragmentIndex].CopyElementsTo(OutValue, InternalIndex.ChunkRawMemory, InternalIndex.IndexWithinChunk, 1);
+}
+
 void FMassArchetypeData::SetFragmentsData(const FMassEntityHandle Entity, TArrayView<const FInstancedStruct> FragmentInstances)
 {
 	FInternalEntityHandle InternalIndex = MakeEntityHandle(Entity);
+	FMassArchetypeChunk& Chunk = Chunks[GetInternalIndexForEntity(Entity.Index) / NumEntitiesPerChunk];
+	const uint64 ChangeVersion = UE::Mass::GetPendingChangeVersion();
 
 	for (const FInstancedStruct& Instance : FragmentInstances)
 	{
 		const UScriptStruct* FragmentType = Instance.GetScriptStruct();
 		check(FragmentType);
 		const int32 FragmentIndex = FragmentIndexMap.FindChecked(FragmentType);
-		void* FragmentMemory = GetFragmentData(FragmentIndex, InternalIndex);
 		// No UE::Mass::Core::bBitwiseRelocateFragments, this isn't a move fragment
-		FragmentType->CopyScriptStruct(FragmentMemory, Instance.GetMemory());
+		FragmentConfigs[FragmentIndex].CopyElementsFrom(InternalIndex.ChunkRawMemory, InternalIndex.IndexWithinChunk, Instance.GetMemory(), 1);
+		Chunk.MarkFragmentChanged(FragmentIndex, ChangeVersion);
 	}
 }
 
@@ -409,9 +746,20 @@ void FMassArchetypeData::SetFragmentData(const FArchetypeChunkCollection& ChunkC
 	const int32 FragmentTypeSize = FragmentType->GetStructureSize();
 	const uint8* FragmentSourceMemory = FragmentSource.GetMemory();
 	check(FragmentSourceMemory);
+	const uint64 ChangeVersion = UE::Mass::GetPendingChangeVersion();
 	
 	for (FMassArchetypeChunkIterator ChunkIterator(ChunkCollection); ChunkIterator; ++ChunkIterator)
 	{
+		Chunks[ChunkIterator->ChunkIndex].MarkFragmentChanged(FragmentIndex, ChangeVersion);
+		if (FragmentConfigs[FragmentIndex].IsSplit())
+		{
+			for (int32 i = 0; i < ChunkIterator->Length; ++i)
+			{
+				FragmentConfigs[FragmentIndex].CopyElementsFrom(Chunks[ChunkIterator->ChunkIndex].GetRawMemory(), ChunkIterator->SubchunkStart + i, FragmentSourceMemory, 1);
+			}
+			continue;
+		}
+
 		uint8* FragmentMemory = (uint8*)FragmentConfigs[FragmentIndex].GetFragmentData(Chunks[ChunkIterator->ChunkIndex].GetRawMemory(), ChunkIterator->SubchunkStart);
 		for (int i = ChunkIterator->Length; i; --i, FragmentMemory += FragmentTypeSize)
 		{
@@ -425,7 +773,8 @@ void FMassArchetypeData::MoveEntityToAnotherArchetype(const FMassEntityHandle En
 {
 	check(&NewArchetype != this);
 
-	const int32 AbsoluteIndex = EntityMap.FindAndRemoveChecked(Entity.Index);
+	// note that AddEntityInternal below will override the entity's AbsoluteIndex with the one in NewArchetype
+	const int32 AbsoluteIndex = GetInternalIndexForEntity(Entity.Index);
 	const int32 ChunkIndex = AbsoluteIndex / NumEntitiesPerChunk;
 	const int32 IndexWithinChunk = AbsoluteIndex % NumEntitiesPerChunk;
 	FMassArchetypeChunk& Chunk = Chunks[ChunkIndex];
@@ -442,19 +791,18 @@ void FMassArchetypeData::MoveEntityToAnotherArchetype(const FMassEntityHandle En
 	for (const FMassArchetypeFragmentConfig& NewFragmentConfig : NewArchetype.FragmentConfigs)
 	{
 		const int32* OldFragmentIndex = FragmentIndexMap.Find(NewFragmentConfig.FragmentType);
-		void* Dst = NewFragmentConfig.GetFragmentData(NewChunk.GetRawMemory(), NewIndexWithinChunk);
 
 		// Only copy if the fragment type exists in both archetypes
 		if (OldFragmentIndex)
 		{
-			const void* Src = FragmentConfigs[*OldFragmentIndex].GetFragmentData(Chunk.GetRawMemory(), IndexWithinChunk);
-			if (UE::Mass::Core::bBitwiseRelocateFragments)
+			if (UE::Mass::Core::bBitwiseRelocateFragments || NewFragmentConfig.IsSplit())
 			{
-				FMemory::Memcpy(Dst, Src, NewFragmentConfig.FragmentType->GetStructureSize());
+				NewFragmentConfig.RelocateElements(NewChunk.GetRawMemory(), NewIndexWithinChunk, FragmentConfigs[*OldFragmentIndex], Chunk.GetRawMemory(), IndexWithinChunk, 1);
 			}
 			else
 			{
-				NewFragmentConfig.FragmentType->CopyScriptStruct(Dst, Src);
+				const void* Src = FragmentConfigs[*OldFragmentIndex].GetFragmentData(Chunk.GetRawMemory(), IndexWithinChunk);
+				NewFragmentConfig.FragmentType->CopyScriptStruct(NewFragmentConfig.GetFragmentData(NewChunk.GetRawMemory(), NewIndexWithinChunk), Src);
 			}
 		}
 		else if (bInitializeFragmentsDuringCreation == false)
@@ -462,7 +810,7 @@ void FMassArchetypeData::MoveEntityToAnotherArchetype(const FMassEntityHandle En
 			// the fragment's unique to the NewArchetype need to be initialized
 			// @todo we're doing it for tags here as well. A tiny bit of perf lost. Probably not worth adding a check
 			// but something to keep in mind. Will go away once tags are more of an archetype fragment than entity's
-			NewFragmentConfig.FragmentType->InitializeStruct(Dst);
+			NewFragmentConfig.InitializeElements(NewChunk.GetRawMemory(), NewIndexWithinChunk, 1);
 		}
 	}
 
@@ -470,6 +818,107 @@ void FMassArchetypeData::MoveEntityToAnotherArchetype(const FMassEntityHandle En
 	RemoveEntityInternal(AbsoluteIndex, bDestroyFragments);
 }
 
+void FMassArchetypeData::BatchMoveEntitiesToAnotherArchetype(const FArchetypeChunkCollection& ChunkCollection, FMassArchetypeData& NewArchetype, TArray<FMassEntityHandle>& OutEntitiesMoved)
+{
+	check(&NewArchetype != this);
+	check(ChunkCollection.GetArchetype() == this);
+
+	// For every NewArchetype's fragment find the matching fragment index in this archetype, INDEX_NONE if it's unique to NewArchetype
+	TArray<int32, TInlineAllocator<16>> OldFragmentIndices;
+	OldFragmentIndices.Reserve(NewArchetype.FragmentConfigs.Num());
+	for (const FMassArchetypeFragmentConfig& NewFragmentConfig : NewArchetype.FragmentConfigs)
+	{
+		const int32* OldFragmentIndex = FragmentIndexMap.Find(NewFragmentConfig.FragmentType);
+		OldFragmentIndices.Add(OldFragmentIndex ? *OldFragmentIndex : INDEX_NONE);
+	}
+
+	// Same as in BatchDestroyEntityChunks - subchunks of a given chunk need to be processed "from the back"
+	TArray<FArchetypeChunkCollection::FChunkInfo> Subchunks(ChunkCollection.GetChunks());
+	Subchunks.Sort([](const FArchetypeChunkCollection::FChunkInfo& A, const FArchetypeChunkCollection::FChunkInfo& B)
+		{
+			return A.ChunkIndex < B.ChunkIndex || (A.ChunkIndex == B.ChunkIndex && A.SubchunkStart > B.SubchunkStart);
+		});
+
+	constexpr bool bInitializeFragmentsDuringCreation = !UE::Mass::Core::bBitwiseRelocateFragments;
+	// NewArchetype only gets entities added until we're done, so a single search cursor covers all the subchunks
+	FChunkSearchCursor NewChunkSearchCursor;
+
+	for (const FArchetypeChunkCollection::FChunkInfo SubchunkInfo : Subchunks)
+	{
+		FMassArchetypeChunk& Chunk = Chunks[SubchunkInfo.ChunkIndex];
+		const int32 Length = SubchunkInfo.Length > 0 ? SubchunkInfo.Length : (Chunk.GetNumInstances() - SubchunkInfo.SubchunkStart);
+		if (Length <= 0)
+		{
+			continue;
+		}
+		checkf((SubchunkInfo.SubchunkStart + Length) <= Chunk.GetNumInstances(), TEXT("Invalid subchunk, it is going over the number of instances in the chunk."));
+
+		const int32 FirstMovedIndex = OutEntitiesMoved.Num();
+		OutEntitiesMoved.Append(&Chunk.GetEntityArrayElementRef(EntityListOffsetWithinChunk, SubchunkInfo.SubchunkStart), Length);
+		const TConstArrayView<FMassEntityHandle> EntitiesToMove(&OutEntitiesMoved[FirstMovedIndex], Length);
+
+		// The subchunk might not fit into a single NewArchetype's chunk, so we copy it over in as many runs as needed
+		int32 NumMoved = 0;
+		while (NumMoved < Length)
+		{
+			int32 NewAbsoluteIndex = INDEX_NONE;
+			const int32 NumAdded = NewArchetype.AddEntitiesInternal(EntitiesToMove.Slice(NumMoved, Length - NumMoved), bInitializeFragmentsDuringCreation, NewChunkSearchCursor, NewAbsoluteIndex);
+			FMassArchetypeChunk& NewChunk = NewArchetype.Chunks[NewAbsoluteIndex / NewArchetype.NumEntitiesPerChunk];
+			const int32 NewIndexWithinChunk = NewAbsoluteIndex % NewArchetype.NumEntitiesPerChunk;
+
+			for (int32 NewFragmentIndex = 0; NewFragmentIndex < NewArchetype.FragmentConfigs.Num(); ++NewFragmentIndex)
+			{
+				const FMassArchetypeFragmentConfig& NewFragmentConfig = NewArchetype.FragmentConfigs[NewFragmentIndex];
+				const int32 OldFragmentIndex = OldFragmentIndices[NewFragmentIndex];
+
+				// Only copy if the fragment type exists in both archetypes
+				if (OldFragmentIndex != INDEX_NONE)
+				{
+					if (UE::Mass::Core::bBitwiseRelocateFragments || NewFragmentConfig.IsSplit())
+					{
+						NewFragmentConfig.RelocateElements(NewChunk.GetRawMemory(), NewIndexWithinChunk, FragmentConfigs[OldFragmentIndex], Chunk.GetRawMemory(), SubchunkInfo.SubchunkStart + NumMoved, NumAdded);
+					}
+					else
+					{
+						const void* Src = FragmentConfigs[OldFragmentIndex].GetFragmentData(Chunk.GetRawMemory(), SubchunkInfo.SubchunkStart + NumMoved);
+						NewFragmentConfig.FragmentType->CopyScriptStruct(NewFragmentConfig.GetFragmentData(NewChunk.GetRawMemory(), NewIndexWithinChunk), Src, NumAdded);
+					}
+				}
+				else if (bInitializeFragmentsDuringCreation == false)
+				{
+					NewFragmentConfig.InitializeElements(NewChunk.GetRawMemory(), NewIndexWithinChunk, NumAdded);
+				}
+			}
+
+			NumMoved += NumAdded;
+		}
+
+		if (UE::Mass::Core::bBitwiseRelocateFragments)
+		{
+			// The fragments that have been relocated to NewArchetype must not be destroyed, but the ones NewArchetype
+			// doesn't have do need to be cleaned up since nothing else will do it.
+			for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
+			{
+				if (NewArchetype.FragmentIndexMap.Contains(FragmentConfig.FragmentType) == false)
+				{
+					FragmentConfig.DestroyElements(Chunk.GetRawMemory(), SubchunkInfo.SubchunkStart, Length);
+				}
+			}
+		}
+
+		constexpr bool bDestroyFragments = !UE::Mass::Core::bBitwiseRelocateFragments;
+		RemoveSubchunkInternal(SubchunkInfo.ChunkIndex, SubchunkInfo.SubchunkStart, Length, bDestroyFragments);
+	}
+
+	// no need to update the moved entities' AbsoluteIndex, NewArchetype.AddEntitiesInternal already did that
+	// If the chunk itself is empty now, see if we can remove it entirely
+	// Note: This is only possible for trailing chunks, to avoid messing up the absolute indices in the entities map
+	while ((Chunks.Num() > 0) && (Chunks.Last().GetNumInstances() == 0))
+	{
+		Chunks.RemoveAt(Chunks.Num() - 1, 1, /*bAllowShrinking=*/ false);
+	}
+}
+
 void FMassArchetypeData::ExecuteFunction(FMassExecutionContext& RunContext, const FMassExecuteFunction& Function, const FMassQueryRequirementIndicesMapping& RequirementMapping, const FArchetypeChunkCollection& ChunkCollection)
 {
 	check(ChunkCollection.GetArchetype() == this);
@@ -489,11 +938,16 @@ void FMassArchetypeData::ExecuteFunction(FMassExecutionContext& RunContext, cons
 		{
 			checkf((ChunkIterator->SubchunkStart + ChunkLength) <= Chunk.GetNumInstances() && ChunkLength > 0, TEXT("Invalid subchunk, it is going over the number of instances in the chunk or it is empty."));
 
-			RunContext.SetCurrentChunkSerialModificationNumber(Chunk.GetSerialModificationNumber());
-			BindChunkFragmentRequirements(RunContext, RequirementMapping.ChunkFragments, Chunk);
-			BindEntityRequirements(RunContext, RequirementMapping.EntityFragments, Chunk, ChunkIterator->SubchunkStart, ChunkLength);
+			if (RequirementMapping.ChangedFilterFragments.Num() == 0 
+				|| Chunk.HasAnyFragmentChangedSince(RequirementMapping.ChangedFilterFragments, RunContext.GetChangedSinceVersion()))
+			{
+				RunContext.SetCurrentChunkSerialModificationNumber(Chunk.GetSerialModificationNumber());
+				BindChunkFragmentRequirements(RunContext, RequirementMapping.ChunkFragments, Chunk);
+				BindEntityRequirements(RunContext, RequirementMapping.EntityFragments, Chunk, ChunkIterator->SubchunkStart, ChunkLength);
+				RunContext.RecordChunkProcessed();
 
-			Function(RunContext);
+				Function(RunContext);
+			}
 		}
 	}
 }
@@ -510,7 +964,8 @@ void FMassArchetypeData::ExecuteFunction(FMassExecutionContext& RunContext, cons
 	{
 		for (FMassArchetypeChunk& Chunk : Chunks)
 		{
-			if (Chunk.GetNumInstances())
+			if (Chunk.GetNumInstances() && (RequirementMapping.ChangedFilterFragments.Num() == 0
+				|| Chunk.HasAnyFragmentChangedSince(RequirementMapping.ChangedFilterFragments, RunContext.GetChangedSinceVersion())))
 			{
 				RunContext.SetCurrentChunkSerialModificationNumber(Chunk.GetSerialModificationNumber());
 				BindChunkFragmentRequirements(RunContext, RequirementMapping.ChunkFragments, Chunk);
@@ -518,6 +973,7 @@ void FMassArchetypeData::ExecuteFunction(FMassExecutionContext& RunContext, cons
 				if (!ChunkCondition || ChunkCondition(RunContext))
 				{
 					BindEntityRequirements(RunContext, RequirementMapping.EntityFragments, Chunk, 0, Chunk.GetNumInstances());
+					RunContext.RecordChunkProcessed();
 					Function(RunContext);
 				}
 			}
@@ -530,7 +986,8 @@ void FMassArchetypeData::ExecutionFunctionForChunk(FMassExecutionContext RunCont
 	FMassArchetypeChunk& Chunk = Chunks[ChunkInfo.ChunkIndex];
 	const int32 ChunkLength = ChunkInfo.Length > 0 ? ChunkInfo.Length : (Chunk.GetNumInstances() - ChunkInfo.SubchunkStart);
 
-	if (ChunkLength)
+	if (ChunkLength && (RequirementMapping.ChangedFilterFragments.Num() == 0
+		|| Chunk.HasAnyFragmentChangedSince(RequirementMapping.ChangedFilterFragments, RunContext.GetChangedSinceVersion())))
 	{
 		BindConstSharedFragmentRequirements(RunContext, RequirementMapping.ChunkFragments);
 		BindSharedFragmentRequirements(RunContext, RequirementMapping.ChunkFragments);
@@ -542,99 +999,132 @@ void FMassArchetypeData::ExecutionFunctionForChunk(FMassExecutionContext RunCont
 		if (!ChunkCondition || ChunkCondition(RunContext))
 		{
 			BindEntityRequirements(RunContext, RequirementMapping.EntityFragments, Chunk, ChunkInfo.SubchunkStart, ChunkLength);
+			RunContext.RecordChunkProcessed();
 			Function(RunContext);
 		}
 	}
 }
 
-void FMassArchetypeData::CompactEntities(const double TimeAllowed)
+bool FMassArchetypeData::CompactEntities(const double TimeAllowed)
 {
 	const double TimeAllowedEnd = FPlatformTime::Seconds() + TimeAllowed;
 
-	TArray<FMassArchetypeChunk*> SortedChunks;
-	for (FMassArchetypeChunk& Chunk : Chunks)
+	TArray<int32> SortedChunkIndices;
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ++ChunkIndex)
 	{
-		// Skip already full chunks
-		const int32 NumInstances = Chunk.GetNumInstances();
-		if(NumInstances > 0 && NumInstances < NumEntitiesPerChunk)
+		// Skip empty and already full chunks
+		const int32 NumInstances = Chunks[ChunkIndex].GetNumInstances();
+		if (NumInstances > 0 && NumInstances < NumEntitiesPerChunk)
 		{
-			SortedChunks.Add(&Chunk);
+			SortedChunkIndices.Add(ChunkIndex);
 		}
 	}
 
+	bool bCompleted = true;
+	
 	// Check if there is anything to compact at all
-	if (SortedChunks.Num() <= 1)
-	{
-		return;
-	}
-
-	SortedChunks.Sort([](const FMassArchetypeChunk& LHS, const FMassArchetypeChunk& RHS)
+	if (SortedChunkIndices.Num() > 1)
 	{
-		return LHS.GetNumInstances() < RHS.GetNumInstances();
-	});
-
-	int32 ChunkToFillSortedIdx = 0;
-	int32 ChunkToEmptySortedIdx = SortedChunks.Num() -1;
-	while (ChunkToFillSortedIdx < ChunkToEmptySortedIdx && FPlatformTime::Seconds() < TimeAllowedEnd)
-	{
-		while (ChunkToFillSortedIdx < SortedChunks.Num() && SortedChunks[ChunkToFillSortedIdx]->GetNumInstances() == NumEntitiesPerChunk)
-		{
-			ChunkToFillSortedIdx++;
-		}
-		while (ChunkToEmptySortedIdx >= 0 && SortedChunks[ChunkToEmptySortedIdx]->GetNumInstances() == 0)
-		{
-			ChunkToEmptySortedIdx--;
-		}
-		if (ChunkToFillSortedIdx >= ChunkToEmptySortedIdx)
+		// Filling up the most populated chunks with the entities of the least populated ones minimizes the number of 
+		// entities moved. On ties the chunks closer to the front get filled, so that the emptied ones tend to end up 
+		// trailing and can be released.
+		SortedChunkIndices.Sort([this](const int32 A, const int32 B)
 		{
-			break;
-		}
-
-		FMassArchetypeChunk* ChunkToFill = SortedChunks[ChunkToFillSortedIdx];
-		FMassArchetypeChunk* ChunkToEmpty = SortedChunks[ChunkToEmptySortedIdx];
-		const int32 NumberOfEntitiesToMove =  FMath::Min(NumEntitiesPerChunk-ChunkToFill->GetNumInstances(), ChunkToEmpty->GetNumInstances());
-		const int32 FromIndex = ChunkToEmpty->GetNumInstances() - NumberOfEntitiesToMove;
-		const int32 ToIndex = ChunkToFill->GetNumInstances();
-		check(NumberOfEntitiesToMove > 0);
+			const int32 NumInstancesA = Chunks[A].GetNumInstances();
+			const int32 NumInstancesB = Chunks[B].GetNumInstances();
+			return NumInstancesA > NumInstancesB || (NumInstancesA == NumInstancesB && A < B);
+		});
 
-		for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
+		int32 ChunkToFillSortedIdx = 0;
+		int32 ChunkToEmptySortedIdx = SortedChunkIndices.Num() - 1;
+		while (true)
 		{
-			void* FromFragmentPtr = FragmentConfig.GetFragmentData(ChunkToEmpty->GetRawMemory(), FromIndex);
-			void* ToFragmentPtr = FragmentConfig.GetFragmentData(ChunkToFill->GetRawMemory(), ToIndex);
-
-			if (UE::Mass::Core::bBitwiseRelocateFragments)
+			while (ChunkToFillSortedIdx < SortedChunkIndices.Num() && Chunks[SortedChunkIndices[ChunkToFillSortedIdx]].GetNumInstances() == NumEntitiesPerChunk)
 			{
-				// Move all entries
-				FMemory::Memcpy(ToFragmentPtr, FromFragmentPtr, FragmentConfig.FragmentType->GetStructureSize() * NumberOfEntitiesToMove);
+				ChunkToFillSortedIdx++;
 			}
-			else
+			while (ChunkToEmptySortedIdx >= 0 && Chunks[SortedChunkIndices[ChunkToEmptySortedIdx]].GetNumInstances() == 0)
 			{
-				// Destroy & initialize the fragment data
-				FragmentConfig.FragmentType->ClearScriptStruct(ToFragmentPtr, NumberOfEntitiesToMove);
+				ChunkToEmptySortedIdx--;
+			}
+			if (ChunkToFillSortedIdx >= ChunkToEmptySortedIdx)
+			{
+				break;
+			}
+			if (FPlatformTime::Seconds() >= TimeAllowedEnd)
+			{
+				bCompleted = false;
+				break;
+			}
+
+			const int32 ChunkToFillIdx = SortedChunkIndices[ChunkToFillSortedIdx];
+			FMassArchetypeChunk& ChunkToFill = Chunks[ChunkToFillIdx];
+			FMassArchetypeChunk& ChunkToEmpty = Chunks[SortedChunkIndices[ChunkToEmptySortedIdx]];
+			const int32 NumberOfEntitiesToMove = FMath::Min(NumEntitiesPerChunk - ChunkToFill.GetNumInstances(), ChunkToEmpty.GetNumInstances());
+			const int32 FromIndex = ChunkToEmpty.GetNumInstances() - NumberOfEntitiesToMove;
+			const int32 ToIndex = ChunkToFill.GetNumInstances();
+			check(NumberOfEntitiesToMove > 0);
+
+			for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
+			{
+				if (UE::Mass::Core::bBitwiseRelocateFragments || FragmentConfig.IsSplit())
+				{
+					// Move all entries
+					FragmentConfig.RelocateElements(ChunkToFill.GetRawMemory(), ToIndex, FragmentConfig, ChunkToEmpty.GetRawMemory(), FromIndex, NumberOfEntitiesToMove);
+				}
+				else
+				{
+					void* FromFragmentPtr = FragmentConfig.GetFragmentData(ChunkToEmpty.GetRawMemory(), FromIndex);
+					void* ToFragmentPtr = FragmentConfig.GetFragmentData(ChunkToFill.GetRawMemory(), ToIndex);
+
+					// Destroy & initialize the fragment data
+					FragmentConfig.FragmentType->ClearScriptStruct(ToFragmentPtr, NumberOfEntitiesToMove);
 
-				// Copy all entries
-				FragmentConfig.FragmentType->CopyScriptStruct(ToFragmentPtr, FromFragmentPtr, NumberOfEntitiesToMove);
+					// Copy all entries
+					FragmentConfig.FragmentType->CopyScriptStruct(ToFragmentPtr, FromFragmentPtr, NumberOfEntitiesToMove);
 
-				// Destroy all entries
-				FragmentConfig.FragmentType->DestroyStruct(FromFragmentPtr, NumberOfEntitiesToMove);
+					// Destroy all entries
+					FragmentConfig.FragmentType->DestroyStruct(FromFragmentPtr, NumberOfEntitiesToMove);
+				}
+			}
+
+			FMassEntityHandle* FromEntity = &ChunkToEmpty.GetEntityArrayElementRef(EntityListOffsetWithinChunk, FromIndex);
+			FMassEntityHandle* ToEntity = &ChunkToFill.GetEntityArrayElementRef(EntityListOffsetWithinChunk, ToIndex);
+			FMemory::Memcpy(ToEntity, FromEntity, NumberOfEntitiesToMove * sizeof(FMassEntityHandle));
+			ChunkToFill.AddMultipleInstances(NumberOfEntitiesToMove);
+			ChunkToEmpty.RemoveMultipleInstances(NumberOfEntitiesToMove);
+
+			const int32 AbsoluteIndex = ChunkToFillIdx * NumEntitiesPerChunk + ToIndex;
+			for (int32 i = 0; i < NumberOfEntitiesToMove; i++, ++ToEntity)
+			{
+				SetEntityAbsoluteIndex(ToEntity->Index, AbsoluteIndex + i);
 			}
 		}
+	}
 
-		FMassEntityHandle* FromEntity = &ChunkToEmpty->GetEntityArrayElementRef(EntityListOffsetWithinChunk, FromIndex);
-		FMassEntityHandle* ToEntity = &ChunkToFill->GetEntityArrayElementRef(EntityListOffsetWithinChunk, ToIndex);
-		FMemory::Memcpy(ToEntity, FromEntity, NumberOfEntitiesToMove * sizeof(FMassEntityHandle));
-		ChunkToFill->AddMultipleInstances(NumberOfEntitiesToMove);
-		ChunkToEmpty->RemoveMultipleInstances(NumberOfEntitiesToMove);
+	// Releasing the trailing chunks compaction has emptied. Note that this is only possible for trailing chunks, 
+	// to avoid messing up the absolute indices of the remaining entities.
+	while ((Chunks.Num() > 0) && (Chunks.Last().GetNumInstances() == 0))
+	{
+		Chunks.RemoveAt(Chunks.Num() - 1, 1, /*bAllowShrinking=*/ false);
+	}
 
-		const int32 ChunkToFillIdx = UE_PTRDIFF_TO_INT32(ChunkToFill - &Chunks[0]);
-		check(ChunkToFillIdx >=0 && ChunkToFillIdx < Chunks.Num());
-		const int32 AbsoluteIndex = ChunkToFillIdx * NumEntitiesPerChunk + ToIndex;
+	return bCompleted;
+}
 
-		for (int32 i =0; i < NumberOfEntitiesToMove; i++, ++ToEntity)
-		{
-			EntityMap.FindChecked(ToEntity->Index) = AbsoluteIndex+i;
-		}
+FMassArchetypeFragmentationInfo FMassArchetypeData::GetFragmentationInfo() const
+{
+	FMassArchetypeFragmentationInfo Info;
+	Info.NumEntities = NumEntities;
+	Info.NumChunks = Chunks.Num();
+	Info.EntityCapacity = Chunks.Num() * NumEntitiesPerChunk;
+	for (const FMassArchetypeChunk& Chunk : Chunks)
+	{
+		const int32 NumInstances = Chunk.GetNumInstances();
+		Info.NumEmptyChunks += (NumInstances == 0) ? 1 : 0;
+		Info.NumPartialChunks += (NumInstances > 0 && NumInstances < NumEntitiesPerChunk) ? 1 : 0;
 	}
+	return Info;
 }
 
 void FMassArchetypeData::GetRequirementsFragmentMapping(TConstArrayView<FMassFragmentRequirement> Requirements, FMassFragmentIndicesMapping& OutFragmentIndices)
@@ -651,6 +1141,16 @@ void FMassArchetypeData::GetRequirementsFragmentMapping(TConstArrayView<FMassFra
 	}
 }
 
+void FMassArchetypeData::GetFragmentTypesMapping(TConstArrayView<const UScriptStruct*> FragmentTypes, FMassFragmentIndicesMapping& OutFragmentIndices) const
+{
+	OutFragmentIndices.Reset(FragmentTypes.Num());
+	for (const UScriptStruct* FragmentType : FragmentTypes)
+	{
+		const int32* FragmentIndex = FragmentIndexMap.Find(FragmentType);
+		OutFragmentIndices.Add(FragmentIndex ? *FragmentIndex : INDEX_NONE);
+	}
+}
+
 void FMassArchetypeData::GetRequirementsChunkFragmentMapping(TConstArrayView<FMassFragmentRequirement> ChunkRequirements, FMassFragmentIndicesMapping& OutFragmentIndices)
 {
 	int32 LastFoundFragmentIndex = -1;
@@ -723,12 +1223,18 @@ void FMassArchetypeData::BindEntityRequirements(FMassExecutionContext& RunContex
 			check(FragmentIndex != INDEX_NONE || Requirement.Requirement.IsOptional());
 			if (FragmentIndex != INDEX_NONE)
 			{
-				Requirement.FragmentView = TArrayView<FMassFragment>((FMassFragment*)GetFragmentData(FragmentIndex, Chunk.GetRawMemory(), SubchunkStart), NumEntities);
+				Requirement.FragmentView = TArrayView<FMassFragment>((FMassFragment*)FragmentConfigs[FragmentIndex].GetColumnData(Chunk.GetRawMemory(), SubchunkStart), NumEntities);
+				Requirement.SubColumnStride = FragmentConfigs[FragmentIndex].SubColumnStride;
+				if (Requirement.Requirement.AccessMode == EMassFragmentAccess::ReadWrite)
+				{
+					Chunk.MarkFragmentChanged(FragmentIndex, RunContext.GetChangeVersion());
+				}
 			}
 			else
 			{
 				// @todo this might not be needed
 				Requirement.FragmentView = TArrayView<FMassFragment>();
+				Requirement.SubColumnStride = 0;
 			}
 		}
 	}
@@ -741,11 +1247,17 @@ void FMassArchetypeData::BindEntityRequirements(FMassExecutionContext& RunContex
 			check(FragmentIndex != nullptr || Requirement.Requirement.IsOptional());
 			if (FragmentIndex)
 			{
-				Requirement.FragmentView = TArrayView<FMassFragment>((FMassFragment*)GetFragmentData(*FragmentIndex, Chunk.GetRawMemory(), SubchunkStart), NumEntities);
+				Requirement.FragmentView = TArrayView<FMassFragment>((FMassFragment*)FragmentConfigs[*FragmentIndex].GetColumnData(Chunk.GetRawMemory(), SubchunkStart), NumEntities);
+				Requirement.SubColumnStride = FragmentConfigs[*FragmentIndex].SubColumnStride;
+				if (Requirement.Requirement.AccessMode == EMassFragmentAccess::ReadWrite)
+				{
+					Chunk.MarkFragmentChanged(*FragmentIndex, RunContext.GetChangeVersion());
+				}
 			}
 			else
 			{
 				Requirement.FragmentView = TArrayView<FMassFragment>();
+				Requirement.SubColumnStride = 0;
 			}
 		}
 	}
@@ -848,8 +1360,9 @@ SIZE_T FMassArchetypeData::GetAllocatedSize() const
 		FragmentConfigs.GetAllocatedSize() +
 		Chunks.GetAllocatedSize() +
 		(NumAllocatedChunkBuffers * GetChunkAllocSize()) +
-		EntityMap.GetAllocatedSize() +
-		FragmentIndexMap.GetAllocatedSize();
+		FullChunkList.GetAllocatedSize() +
+		FragmentIndexMap.GetAllocatedSize() +
+		TransitionCache.GetAllocatedSize();
 }
 
 FString FMassArchetypeData::DebugGetDescription() const
@@ -890,7 +1403,7 @@ void FMassArchetypeData::DebugPrintArchetype(FOutputDevice& Ar)
 	}
 
 	const int32 CurrentEntityCapacity = Chunks.Num() * NumEntitiesPerChunk;
-	Ar.Logf(ELogVerbosity::Log, TEXT("\tEntity Count    : %d"), EntityMap.Num());
+	Ar.Logf(ELogVerbosity::Log, TEXT("\tEntity Count    : %d"), NumEntities);
 	Ar.Logf(ELogVerbosity::Log, TEXT("\tEntity Capacity : %d"), CurrentEntityCapacity);
 	if (Chunks.Num() > 1)
 	{
@@ -904,21 +1417,32 @@ void FMassArchetypeData::DebugPrintArchetype(FOutputDevice& Ar)
 			EntitiesPerChunkMin = FMath::Min(Population, EntitiesPerChunkMin);
 			EntitiesPerChunkMax = FMath::Max(Population, EntitiesPerChunkMax);
 		}
-		Ar.Logf(ELogVerbosity::Log, TEXT("\tEntity Occupancy: %.1f%% (min: %.1f%%, max: %.1f%%)"), Scaler * EntityMap.Num(), Scaler * EntitiesPerChunkMin, Scaler * EntitiesPerChunkMax);
+		Ar.Logf(ELogVerbosity::Log, TEXT("\tEntity Occupancy: %.1f%% (min: %.1f%%, max: %.1f%%)"), Scaler * NumEntities, Scaler * EntitiesPerChunkMin, Scaler * EntitiesPerChunkMax);
 	}
 	else 
 	{
-		Ar.Logf(ELogVerbosity::Log, TEXT("\tEntity Occupancy: %.1f%%"), CurrentEntityCapacity > 0 ? ((EntityMap.Num() * 100.0f) / (float)CurrentEntityCapacity) : 0.f);
+		Ar.Logf(ELogVerbosity::Log, TEXT("\tEntity Occupancy: %.1f%%"), CurrentEntityCapacity > 0 ? ((NumEntities * 100.0f) / (float)CurrentEntityCapacity) : 0.f);
 	}
+	const FMassArchetypeFragmentationInfo FragmentationInfo = GetFragmentationInfo();
+	Ar.Logf(ELogVerbosity::Log, TEXT("\tPartial Chunks  : %d (empty: %d)"), FragmentationInfo.NumPartialChunks, FragmentationInfo.NumEmptyChunks);
 	Ar.Logf(ELogVerbosity::Log, TEXT("\tBytes / Entity  : %d"), TotalBytesPerEntity);
 	Ar.Logf(ELogVerbosity::Log, TEXT("\tEntities / Chunk: %d"), NumEntitiesPerChunk);
+	Ar.Logf(ELogVerbosity::Log, TEXT("\tChunk alignment : %d (column alignment: %d)"), ChunkAlignment, ColumnAlignment);
 
 	Ar.Logf(ELogVerbosity::Log, TEXT("\tOffset 0x%04X: Entity[] (%d bytes each)"), EntityListOffsetWithinChunk, sizeof(FMassEntityHandle));
 	int32 TotalBytesOfValidData = sizeof(FMassEntityHandle) * NumEntitiesPerChunk;
 	for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
 	{
 		TotalBytesOfValidData += FragmentConfig.FragmentType->GetStructureSize() * NumEntitiesPerChunk;
-		Ar.Logf(ELogVerbosity::Log, TEXT("\tOffset 0x%04X: %s[] (%d bytes each)"), FragmentConfig.ArrayOffsetWithinChunk, *FragmentConfig.FragmentType->GetName(), FragmentConfig.FragmentType->GetStructureSize());
+		if (FragmentConfig.IsSplit())
+		{
+			Ar.Logf(ELogVerbosity::Log, TEXT("\tOffset 0x%04X: %s[] split into %d sub-columns, 0x%04X bytes apart (%d bytes each)"), FragmentConfig.ArrayOffsetWithinChunk, *FragmentConfig.FragmentType->GetName()
+				, FragmentConfig.NumSubColumns, FragmentConfig.SubColumnStride, FragmentConfig.SubColumnElementSize);
+		}
+		else
+		{
+			Ar.Logf(ELogVerbosity::Log, TEXT("\tOffset 0x%04X: %s[] (%d bytes each)"), FragmentConfig.ArrayOffsetWithinChunk, *FragmentConfig.FragmentType->GetName(), FragmentConfig.FragmentType->GetStructureSize());
+		}
 	}
 
 	//@TODO: Print out padding in between things?
@@ -936,17 +1460,32 @@ void FMassArchetypeData::DebugPrintArchetype(FOutputDevice& Ar)
 	}
 }
 
+void FMassArchetypeData::DebugValidateColumnAlignment(const FMassArchetypeChunk& Chunk) const
+{
+	uint8* ChunkMemory = Chunk.GetRawMemory();
+	checkf(IsAligned(ChunkMemory + EntityListOffsetWithinChunk, alignof(FMassEntityHandle)) && IsAligned(ChunkMemory, ChunkAlignment)
+		, TEXT("Chunk memory is expected to be aligned to %d bytes"), ChunkAlignment);
+
+	for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
+	{
+		const int32 RequiredAlignment = GetColumnAlignment(*FragmentConfig.FragmentType);
+		checkf(IsAligned(FragmentConfig.GetColumnData(ChunkMemory, 0), RequiredAlignment) && IsAligned(FragmentConfig.SubColumnStride, RequiredAlignment)
+			, TEXT("%s column expected to be aligned to %d bytes"), *GetNameSafe(FragmentConfig.FragmentType), RequiredAlignment);
+	}
+}
+
 void FMassArchetypeData::DebugPrintEntity(FMassEntityHandle Entity, FOutputDevice& Ar, const TCHAR* InPrefix) const
 {
 	for (const FMassArchetypeFragmentConfig& FragmentConfig : FragmentConfigs)
 	{
-		void* Data = GetFragmentDataForEntityChecked(FragmentConfig.FragmentType, Entity.Index);
+		FInstancedStruct Value(FragmentConfig.FragmentType);
+		CopyFragmentValueForEntity(FragmentConfig.FragmentType, Entity.Index, Value.GetMutableMemory());
 		
 		FString FragmentName = FragmentConfig.FragmentType->GetName();
 		FragmentName.RemoveFromStart(InPrefix);
 
 		FString ValueStr;
-		FragmentConfig.FragmentType->ExportText(ValueStr, Data, /*Default*/nullptr, /*OwnerObject*/nullptr, EPropertyPortFlags::PPF_IncludeTransient, /*ExportRootScope*/nullptr);
+		FragmentConfig.FragmentType->ExportText(ValueStr, Value.GetMemory(), /*Default*/nullptr, /*OwnerObject*/nullptr, EPropertyPortFlags::PPF_IncludeTransient, /*ExportRootScope*/nullptr);
 
 		Ar.Logf(TEXT("%s: %s"), *FragmentName, *ValueStr);
 	}
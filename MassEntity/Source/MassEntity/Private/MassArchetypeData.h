@@ -4,6 +4,7 @@
 
 #include "MassEntitySubsystem.h"
 #include "MassArchetypeTypes.h"
+#include "MassChunkMemoryPool.h"
 
 struct FMassEntityQuery;
 struct FMassExecutionContext;
@@ -15,17 +16,25 @@ struct FMassArchetypeChunk
 {
 private:
 	uint8* RawMemory = nullptr;
+	/** The pool RawMemory is borrowed from. Owned by the entity subsystem and kept alive by the chunk's archetype. */
+	FMassChunkMemoryPool* MemoryPool = nullptr;
 	int32 AllocSize = 0;
+	int32 AllocAlignment = 0;
 	int32 NumInstances = 0;
 	int32 SerialModificationNumber = 0;
 	TArray<FInstancedStruct> ChunkFragmentData;
+	/** Per fragment column, the change version (see UE::Mass::GetNextChangeVersion) of the last write to the column */
+	TArray<uint64, TInlineAllocator<8>> FragmentChangeVersions;
 
 public:
-	explicit FMassArchetypeChunk(int32 InAllocSize, TConstArrayView<FInstancedStruct> InChunkFragmentTemplates)
-		: AllocSize(InAllocSize)
+	explicit FMassArchetypeChunk(FMassChunkMemoryPool& InMemoryPool, int32 InAllocSize, int32 InAllocAlignment, TConstArrayView<FInstancedStruct> InChunkFragmentTemplates, const int32 InNumFragments)
+		: MemoryPool(&InMemoryPool)
+		, AllocSize(InAllocSize)
+		, AllocAlignment(InAllocAlignment)
 		, ChunkFragmentData(InChunkFragmentTemplates)
 	{
-		RawMemory = (uint8*)FMemory::Malloc(AllocSize);
+		RawMemory = MemoryPool->Allocate(AllocSize, AllocAlignment);
+		FragmentChangeVersions.AddZeroed(InNumFragments);
 	}
 
 	~FMassArchetypeChunk()
@@ -33,7 +42,7 @@ public:
 		// Only release memory if it was not done already.
 		if (RawMemory != nullptr)
 		{
-			FMemory::Free(RawMemory);
+			MemoryPool->Free(RawMemory, AllocSize, AllocAlignment);
 			RawMemory = nullptr;
 		}
 	}
@@ -58,6 +67,7 @@ public:
 	{
 		NumInstances += Count;
 		SerialModificationNumber++;
+		MarkAllFragmentsChanged(UE::Mass::GetPendingChangeVersion());
 	}
 
 	void RemoveMultipleInstances(uint32 Count)
@@ -65,12 +75,14 @@ public:
 		NumInstances -= Count;
 		check(NumInstances >= 0);
 		SerialModificationNumber++;
+		// removal moves the trailing entities' data into the freed slots
+		MarkAllFragmentsChanged(UE::Mass::GetPendingChangeVersion());
 
 		// Because we only remove trailing chunks to avoid messing up the absolute indices in the entities map,
-		// We are freeing the memory here to save memory
+		// We are freeing the memory here to save memory (or rather returning it to the pool for other chunks to use)
 		if (NumInstances == 0)
 		{
-			FMemory::Free(RawMemory);
+			MemoryPool->Free(RawMemory, AllocSize, AllocAlignment);
 			RawMemory = nullptr;
 		}
 	}
@@ -90,6 +102,39 @@ public:
 		return SerialModificationNumber;
 	}
 
+	uint64 GetFragmentChangeVersion(const int32 FragmentIndex) const
+	{
+		return FragmentChangeVersions[FragmentIndex];
+	}
+
+	void MarkFragmentChanged(const int32 FragmentIndex, const uint64 ChangeVersion)
+	{
+		// using max since with processors running in parallel a query that started earlier (i.e. got a lower 
+		// version) can bind the column after a query that started later
+		FragmentChangeVersions[FragmentIndex] = FMath::Max(FragmentChangeVersions[FragmentIndex], ChangeVersion);
+	}
+
+	void MarkAllFragmentsChanged(const uint64 ChangeVersion)
+	{
+		for (uint64& Version : FragmentChangeVersions)
+		{
+			Version = FMath::Max(Version, ChangeVersion);
+		}
+	}
+
+	/** @return whether any of the fragments indicated by FragmentIndices has changed after Version. INDEX_NONE entries are ignored. */
+	bool HasAnyFragmentChangedSince(FMassFragmentIndicesMappingView FragmentIndices, const uint64 Version) const
+	{
+		for (const int32 FragmentIndex : FragmentIndices)
+		{
+			if (FragmentIndex != INDEX_NONE && FragmentChangeVersions[FragmentIndex] > Version)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	FStructView GetMutableChunkFragmentViewChecked(const int32 Index) { return FStructView(ChunkFragmentData[Index]); }
 
 	FInstancedStruct* FindMutableChunkFragment(const UScriptStruct* Type)
@@ -104,12 +149,13 @@ public:
 	{
 		checkf(NumInstances == 0, TEXT("Recycling a chunk that is not empty."));
 		SerialModificationNumber++;
+		MarkAllFragmentsChanged(UE::Mass::GetPendingChangeVersion());
 		ChunkFragmentData = InChunkFragmentsTemplate;
 		
 		// If this chunk previously had entity and it does not anymore, we might have to reallocate the memory as it was freed to save memory
 		if (RawMemory == nullptr)
 		{
-			RawMemory = (uint8*)FMemory::Malloc(AllocSize);
+			RawMemory = MemoryPool->Allocate(AllocSize, AllocAlignment);
 		}
 	}
 
@@ -124,10 +170,75 @@ struct FMassArchetypeFragmentConfig
 	const UScriptStruct* FragmentType = nullptr;
 	int32 ArrayOffsetWithinChunk = 0;
 
+	// Split fragments only (see FMassSplitFragment). Every member is stored in its own sub-column, SubColumnStride 
+	// bytes after the previous member's one. NumSubColumns is 0 for regular fragments.
+	int32 NumSubColumns = 0;
+	int32 SubColumnElementSize = 0;
+	int32 SubColumnStride = 0;
+	// The default-initialized instance the split fragment's sub-columns get filled with on initialization
+	TArray<uint8, TInlineAllocator<16>> SplitDefaultValue;
+
+	bool IsSplit() const { return NumSubColumns > 0; }
+
+	/** @return the size of a single element of the column, or of a single member sub-column for split fragments */
+	int32 GetColumnElementSize() const { return IsSplit() ? SubColumnElementSize : FragmentType->GetStructureSize(); }
+
+	/** @return the address of the given element of the column, or of the first member sub-column for split fragments */
+	uint8* GetColumnData(uint8* ChunkBase, int32 IndexWithinChunk) const
+	{
+		return ChunkBase + ArrayOffsetWithinChunk + (IndexWithinChunk * GetColumnElementSize());
+	}
+
 	void* GetFragmentData(uint8* ChunkBase, int32 IndexWithinChunk) const
 	{
+		checkf(!IsSplit(), TEXT("%s is a split fragment, its instances can't be accessed by pointer"), *FragmentType->GetName());
 		return ChunkBase + ArrayOffsetWithinChunk + (IndexWithinChunk * FragmentType->GetStructureSize());
 	}
+
+	/** Sets up the split fragment related members, given FragmentType is a FMassSplitFragment */
+	void InitializeSplitLayout();
+
+	// Element range operations working with both the regular and the split layouts
+	void InitializeElements(uint8* ChunkBase, const int32 IndexWithinChunk, const int32 Num) const;
+	void DestroyElements(uint8* ChunkBase, const int32 IndexWithinChunk, const int32 Num) const;
+	/** Bitwise copies Num elements from Source's column, Source needs to be describing the same fragment type */
+	void RelocateElements(uint8* ChunkBase, const int32 IndexWithinChunk, const FMassArchetypeFragmentConfig& Source, uint8* SourceChunkBase, const int32 SourceIndexWithinChunk, const int32 Num) const;
+	/** Copies Num consecutive fragment instances from Values into the column */
+	void CopyElementsFrom(uint8* ChunkBase, const int32 IndexWithinChunk, const void* Values, const int32 Num) const;
+	/** Copies Num elements of the column to OutValues as consecutive fragment instances. OutValues needs to be initialized. */
+	void CopyElementsTo(void* OutValues, uint8* ChunkBase, const int32 IndexWithinChunk, const int32 Num) const;
+};
+
+// Single-type composition changes an archetype can cache the result of
+enum class EMassArchetypeTransition : uint8
+{
+	AddTag,
+	RemoveTag,
+	AddFragment,
+	RemoveFragment,
+};
+
+// Key of an edge in the archetype transition graph, i.e. "this archetype + Operation(StructType)"
+struct FMassArchetypeTransitionKey
+{
+	const UScriptStruct* StructType = nullptr;
+	EMassArchetypeTransition Operation = EMassArchetypeTransition::AddTag;
+
+	FMassArchetypeTransitionKey() = default;
+	FMassArchetypeTransitionKey(const EMassArchetypeTransition InOperation, const UScriptStruct* InStructType)
+		: StructType(InStructType)
+		, Operation(InOperation)
+	{}
+
+	bool operator==(const FMassArchetypeTransitionKey& Other) const
+	{
+		return StructType == Other.StructType && Operation == Other.Operation;
+	}
+
+	friend uint32 GetTypeHash(const FMassArchetypeTransitionKey& Key)
+	{
+		return HashCombine(PointerHash(Key.StructType), static_cast<uint32>(Key.Operation));
+	}
 };
 
 // An archetype is defined by a collection of unique fragment types (no duplicates).
@@ -143,16 +254,34 @@ private:
 	TArray<FInstancedStruct> ChunkFragmentsTemplate;
 
 	TArray<FMassArchetypeFragmentConfig, TInlineAllocator<16>> FragmentConfigs;
+
+	// The pool chunks get their memory from. Needs to be declared before Chunks so that it outlives them.
+	TSharedRef<FMassChunkMemoryPool> ChunkMemoryPool;
 	
 	TArray<FMassArchetypeChunk> Chunks;
 
-	// Entity ID to index within archetype
-	//@TODO: Could be folded into FEntityData in the entity manager at the expense of a bit
-	// of loss of encapsulation and extra complexity during archetype changes
-	TMap<int32, int32> EntityMap;
+	// FChunkInfo for every chunk index the archetype ever had, i.e. the chunk list of an FArchetypeChunkCollection 
+	// covering the whole archetype. Extended when chunks get added, see GetFullChunkList.
+	TArray<FArchetypeChunkCollection::FChunkInfo> FullChunkList;
+
+	// The entity subsystem's per-entity data, where the archetype stores every hosted entity's absolute index
+	// within the archetype (see FEntityData::AbsoluteIndex). Indexed with FMassEntityHandle.Index.
+	TChunkedArray<UMassEntitySubsystem::FEntityData>& EntityDataTable;
+
+	int32 NumEntities = 0;
 	
 	TMap<const UScriptStruct*, int32> FragmentIndexMap;
 
+	// Archetypes reachable from this one by adding or removing a single tag or fragment. Weak references so that
+	// an archetype going away doesn't get kept alive by its neighbours - an expired entry is treated as a cache miss.
+	TMap<FMassArchetypeTransitionKey, TWeakPtr<FMassArchetypeData>> TransitionCache;
+
+	int32 ChunkMemorySize = 0;
+	// The alignment of every fragment column, on top of the fragment type's own alignment. 0 means only the type's 
+	// alignment is respected. See UMassEntitySettings::FragmentColumnAlignment
+	int32 ColumnAlignment = 0;
+	// The alignment of the chunks' memory, i.e. the biggest of the columns' alignments
+	int32 ChunkAlignment = 0;
 	int32 NumEntitiesPerChunk;
 	int32 TotalBytesPerEntity;
 	int32 EntityListOffsetWithinChunk;
@@ -161,6 +290,11 @@ private:
 	friend FArchetypeChunkCollection;
 
 public:
+	FMassArchetypeData(TChunkedArray<UMassEntitySubsystem::FEntityData>& InEntityDataTable, const TSharedRef<FMassChunkMemoryPool>& InChunkMemoryPool)
+		: ChunkMemoryPool(InChunkMemoryPool)
+		, EntityDataTable(InEntityDataTable)
+	{}
+
 	TConstArrayView<FMassArchetypeFragmentConfig> GetFragmentConfigs() const { return FragmentConfigs; }
 	const FMassFragmentBitSet& GetFragmentBitSet() const { return CompositionDescriptor.Fragments; }
 	const FMassTagBitSet& GetTagBitSet() const { return CompositionDescriptor.Tags; }
@@ -180,6 +314,22 @@ public:
 		return CompositionDescriptor.IsEquivalent(OtherCompositionDescriptor) && SharedFragmentValues.IsEquivalent(OtherSharedFragmentValues);
 	}
 
+	/**
+	 * Fetches the archetype previously registered with CacheTransition for given Operation and StructType.
+	 * @return null if there's no such transition cached or the target archetype is no longer around
+	 */
+	TSharedPtr<FMassArchetypeData> FindTransition(const EMassArchetypeTransition Operation, const UScriptStruct* StructType) const
+	{
+		const TWeakPtr<FMassArchetypeData>* Target = TransitionCache.Find(FMassArchetypeTransitionKey(Operation, StructType));
+		return Target ? Target->Pin() : TSharedPtr<FMassArchetypeData>();
+	}
+
+	void CacheTransition(const EMassArchetypeTransition Operation, const UScriptStruct* StructType, const TSharedPtr<FMassArchetypeData>& Target)
+	{
+		check(StructType && Target.IsValid());
+		TransitionCache.Add(FMassArchetypeTransitionKey(Operation, StructType), Target);
+	}
+
 	void Initialize(const FMassArchetypeCompositionDescriptor& InCompositionDescriptor, const FMassArchetypeSharedFragmentValues& InSharedFragmentValues);
 
 	/** 
@@ -189,31 +339,76 @@ public:
 	void InitializeWithSibling(const FMassArchetypeData& SiblingArchetype, const FMassTagBitSet& OverrideTags);
 
 	void AddEntity(FMassEntityHandle Entity);
+
+	/** 
+	 * Adds all of InEntities at one go, filling up the chunks block by block and initializing every fragment column
+	 * once per chunk range. 
+	 * @param InitialValues optional per-fragment initial values, InEntities.Num() values each, copied straight into 
+	 *	the fragment columns. The fragments with no initial values provided get default-initialized.
+	 */
+	void BatchAddEntities(TConstArrayView<FMassEntityHandle> InEntities, TConstArrayView<FMassFragmentInitialValues> InitialValues = {});
 	void RemoveEntity(FMassEntityHandle Entity);
 	void BatchDestroyEntityChunks(const FArchetypeChunkCollection& ChunkCollection, TArray<FMassEntityHandle>& OutEntitiesRemoved);
 
 	bool HasFragmentDataForEntity(const UScriptStruct* FragmentType, int32 EntityIndex) const;
 	void* GetFragmentDataForEntityChecked(const UScriptStruct* FragmentType, int32 EntityIndex) const;
 	void* GetFragmentDataForEntity(const UScriptStruct* FragmentType, int32 EntityIndex) const;
-
-	FORCEINLINE int32 GetInternalIndexForEntity(const int32 EntityIndex) const { return EntityMap.FindChecked(EntityIndex); }
+	/** Copies the entity's FragmentType fragment to OutValue, works for split fragments as well */
+	void CopyFragmentValueForEntity(const UScriptStruct* FragmentType, int32 EntityIndex, void* OutValue) const;
+
+	FORCEINLINE int32 GetInternalIndexForEntity(const int32 EntityIndex) const 
+	{ 
+		const int32 AbsoluteIndex = EntityDataTable[EntityIndex].AbsoluteIndex;
+		check(AbsoluteIndex != INDEX_NONE);
+		return AbsoluteIndex;
+	}
 	int32 GetNumEntitiesPerChunk() const { return NumEntitiesPerChunk; }
 
-	int32 GetNumEntities() const { return EntityMap.Num(); }
+	int32 GetNumEntities() const { return NumEntities; }
+
+	int32 GetChunkAllocSize() const { return ChunkMemorySize; }
 
-	int32 GetChunkAllocSize() const { return 64*1024; }
+	int32 GetChunkAlignment() const { return ChunkAlignment; }
+
+	/** @return the alignment of the column storing FragmentType instances */
+	int32 GetColumnAlignment(const UScriptStruct& FragmentType) const { return FMath::Max(FragmentType.GetMinAlignment(), ColumnAlignment); }
 
 	int32 GetChunkCount() const { return Chunks.Num(); }
 
+	/** 
+	 * @return the chunks of a collection covering the whole archetype, without the cost of building an 
+	 * FArchetypeChunkCollection. The view is only valid until the archetype's chunk count changes.
+	 */
+	TConstArrayView<FArchetypeChunkCollection::FChunkInfo> GetFullChunkList() const { return MakeArrayView(FullChunkList.GetData(), Chunks.Num()); }
+
+	int32 GetNumEntitiesInChunk(const int32 ChunkIndex) const { return Chunks[ChunkIndex].GetNumInstances(); }
+
+	/** @return the raw memory of given chunk, null if the chunk is empty. The columns' layout is described by GetFragmentConfigs */
+	const uint8* GetChunkRawMemory(const int32 ChunkIndex) const { return Chunks[ChunkIndex].GetRawMemory(); }
+
+	/** @return the handles of the entities hosted by given chunk, in the order their fragments are stored in the columns */
+	TConstArrayView<FMassEntityHandle> GetChunkEntities(const int32 ChunkIndex) const
+	{
+		const FMassArchetypeChunk& Chunk = Chunks[ChunkIndex];
+		return Chunk.GetNumInstances() > 0
+			? MakeArrayView(reinterpret_cast<const FMassEntityHandle*>(Chunk.GetRawMemory() + EntityListOffsetWithinChunk), Chunk.GetNumInstances())
+			: TConstArrayView<FMassEntityHandle>();
+	}
+
 	void ExecuteFunction(FMassExecutionContext& RunContext, const FMassExecuteFunction& Function, const FMassQueryRequirementIndicesMapping& RequirementMapping, const FArchetypeChunkCollection& ChunkCollection);
 	void ExecuteFunction(FMassExecutionContext& RunContext, const FMassExecuteFunction& Function, const FMassQueryRequirementIndicesMapping& RequirementMapping, const FMassArchetypeConditionFunction& ArchetypeCondition, const FMassChunkConditionFunction& ChunkCondition);
 
 	void ExecutionFunctionForChunk(FMassExecutionContext RunContext, const FMassExecuteFunction& Function, const FMassQueryRequirementIndicesMapping& RequirementMapping, const FArchetypeChunkCollection::FChunkInfo& ChunkInfo, const FMassChunkConditionFunction& ChunkCondition = FMassChunkConditionFunction());
 
 	/**
-	 * Compacts entities to fill up chunks as much as possible
+	 * Compacts entities to fill up chunks as much as possible. The entities of the least populated chunks are moved 
+	 * to the most populated ones. Can be called repeatedly with a limited time budget, every call picks up from the 
+	 * chunks' current state. Does not touch other archetypes' data, so different archetypes can be compacted in parallel.
+	 * @return whether the archetype is fully compacted, i.e. false if TimeAllowed ran out first
 	 */
-	void CompactEntities(const double TimeAllowed);
+	bool CompactEntities(const double TimeAllowed);
+
+	FMassArchetypeFragmentationInfo GetFragmentationInfo() const;
 
 	/**
 	 * Moves the entity from this archetype to another, will only copy all matching fragment types
@@ -222,6 +417,15 @@ public:
 	 */
 	void MoveEntityToAnotherArchetype(const FMassEntityHandle Entity, FMassArchetypeData& NewArchetype);
 
+	/**
+	 * Moves all the entities indicated by ChunkCollection from this archetype to NewArchetype. Works like 
+	 * MoveEntityToAnotherArchetype but copies fragments a whole subchunk range at a time.
+	 * @param ChunkCollection the entities to move, needs to be pointing at this archetype. Is no longer valid once the function is done.
+	 * @param NewArchetype the archetype to move to
+	 * @param OutEntitiesMoved the moved entities get appended to this array
+	 */
+	void BatchMoveEntitiesToAnotherArchetype(const FArchetypeChunkCollection& ChunkCollection, FMassArchetypeData& NewArchetype, TArray<FMassEntityHandle>& OutEntitiesMoved);
+
 	/**
 	 * Set all fragment sources data on specified entity, will check if there are fragment sources type that does not exist in the archetype
 	 * @param Entity is the entity to set the data of all fragments
@@ -236,6 +440,9 @@ public:
 	/** Returns conversion from given Requirements to archetype's fragment indices */
 	void GetRequirementsFragmentMapping(TConstArrayView<FMassFragmentRequirement> Requirements, FMassFragmentIndicesMapping& OutFragmentIndices);
 
+	/** Returns conversion from given fragment types to archetype's fragment indices, INDEX_NONE for the types not present */
+	void GetFragmentTypesMapping(TConstArrayView<const UScriptStruct*> FragmentTypes, FMassFragmentIndicesMapping& OutFragmentIndices) const;
+
 	/** Returns conversion from given ChunkRequirements to archetype's chunk fragment indices */
 	void GetRequirementsChunkFragmentMapping(TConstArrayView<FMassFragmentRequirement> ChunkRequirements, FMassFragmentIndicesMapping& OutFragmentIndices);
 
@@ -263,6 +470,9 @@ public:
 	 * @param InPrefix Optional prefix to remove from fragment names
 	 */
 	void DebugPrintEntity(FMassEntityHandle Entity, FOutputDevice& Ar, const TCHAR* InPrefix = TEXT("")) const;
+
+	/** Fails a check if any of Chunk's columns doesn't start at an address aligned as required by the archetype's layout */
+	void DebugValidateColumnAlignment(const FMassArchetypeChunk& Chunk) const;
 #endif // WITH_MASSENTITY_DEBUG
 
 	void REMOVEME_GetArrayViewForFragmentInChunk(int32 ChunkIndex, const UScriptStruct* FragmentType, void*& OutChunkBase, int32& OutNumEntities);
@@ -279,7 +489,7 @@ public:
 
 	FORCEINLINE FInternalEntityHandle MakeEntityHandle(int32 EntityIndex) const
 	{
-		const int32 AbsoluteIndex = EntityMap.FindChecked(EntityIndex);
+		const int32 AbsoluteIndex = GetInternalIndexForEntity(EntityIndex);
 		const int32 ChunkIndex = AbsoluteIndex / NumEntitiesPerChunk;
 	
 		return FInternalEntityHandle(Chunks[ChunkIndex].GetRawMemory(), AbsoluteIndex % NumEntitiesPerChunk); 
@@ -294,6 +504,11 @@ public:
 	bool IsInitialized() const { return TotalBytesPerEntity > 0 && FragmentConfigs.Num() > 0; }
 
 protected:
+	FORCEINLINE void SetEntityAbsoluteIndex(const int32 EntityIndex, const int32 AbsoluteIndex)
+	{
+		EntityDataTable[EntityIndex].AbsoluteIndex = AbsoluteIndex;
+	}
+
 	FORCEINLINE void* GetFragmentData(const int32 FragmentIndex, uint8* ChunkRawMemory, const int32 IndexWithinChunk) const
 	{
 		return FragmentConfigs[FragmentIndex].GetFragmentData(ChunkRawMemory, IndexWithinChunk);
@@ -305,6 +520,44 @@ protected:
 	void BindSharedFragmentRequirements(FMassExecutionContext& RunContext, const FMassFragmentIndicesMapping& ChunkFragmentsMapping);
 
 private:
+	/** 
+	 * Sets up the entity list and fragment columns' offsets for InNumEntitiesPerChunk entities per chunk, respecting
+	 * every column's alignment.
+	 * @return the number of bytes the resulting chunk layout requires
+	 */
+	int32 LayoutChunkColumns(const int32 InNumEntitiesPerChunk);
+
+	/** Appends a new chunk to Chunks, keeping FullChunkList up to date */
+	FMassArchetypeChunk& AddChunkInternal();
+
 	int32 AddEntityInternal(FMassEntityHandle Entity, const bool bInitializeFragments);
 	void RemoveEntityInternal(const int32 AbsoluteIndex, const bool bDestroyFragments);
+
+	/** 
+	 * Chunk search state carried over between the AddEntitiesInternal calls adding a single batch of entities, so that
+	 * every call resumes the search where the previous one stopped instead of rescanning all the chunks.
+	 */
+	struct FChunkSearchCursor
+	{
+		/** The chunk the previous call added entities to, the chunks before it hold no free slots apart from the empty ones */
+		int32 NextChunkToScan = 0;
+		/** The first empty chunk found before NextChunkToScan */
+		int32 FirstEmptyChunk = INDEX_NONE;
+		/** Set once there are no partially filled chunks left past NextChunkToScan */
+		bool bNoPartialChunksLeft = false;
+	};
+
+	/** 
+	 * Adds as many of InEntities as fit in a single chunk, in order, and returns the number of entities added. 
+	 * OutAbsoluteIndex is set to the absolute index of the first added entity.
+	 * @param SearchCursor needs to be shared by all the calls adding a single batch of entities, with no entities 
+	 *	getting removed from the archetype in between.
+	 */
+	int32 AddEntitiesInternal(TConstArrayView<FMassEntityHandle> InEntities, const bool bInitializeFragments, FChunkSearchCursor& SearchCursor, int32& OutAbsoluteIndex);
+
+	/** 
+	 * Removes Length entities starting at SubchunkStart from given chunk by moving the chunk's trailing entities in 
+	 * their place. Note that the removed entities' AbsoluteIndex is not reset, that's the caller's responsibility.
+	 */
+	void RemoveSubchunkInternal(const int32 ChunkIndex, const int32 SubchunkStart, const int32 Length, const bool bDestroyFragments);
 };
@@ -127,12 +127,9 @@ void FArchetypeChunkCollection::GatherChunksFromArchetype(TSharedPtr<FMassArchet
 	check(InArchetype.IsValid());
 	Archetype.DataPtr = InArchetype;
 
-	const int32 ChunkCount = InArchetype->GetChunkCount();
-	Chunks.Reset(ChunkCount);
-	for (int32 i = 0; i < ChunkCount; ++i)
-	{
-		Chunks.Add(FChunkInfo(i));
-	}
+	const TConstArrayView<FChunkInfo> FullChunkList = InArchetype->GetFullChunkList();
+	Chunks.Reset(FullChunkList.Num());
+	Chunks.Append(FullChunkList.GetData(), FullChunkList.Num());
 }
 
 bool FArchetypeChunkCollection::IsSame(const FArchetypeChunkCollection& Other) const
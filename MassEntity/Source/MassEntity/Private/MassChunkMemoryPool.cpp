@@ -0,0 +1,113 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "MassChunkMemoryPool.h"
+
+//////////////////////////////////////////////////////////////////////
+// FMassChunkMemoryPool
+
+FMassChunkMemoryPool::~FMassChunkMemoryPool()
+{
+	ensureMsgf(Stats.InUseBytes == 0, TEXT("Destroying chunk memory pool while %lld bytes are still in use"), Stats.InUseBytes);
+	Empty();
+}
+
+FMassChunkMemoryPool::FSizeClass* FMassChunkMemoryPool::FindSizeClass(const int32 Size, const int32 Alignment)
+{
+	return SizeClasses.FindByPredicate([Size, Alignment](const FSizeClass& SizeClass) { return SizeClass.Size == Size && SizeClass.Alignment == Alignment; });
+}
+
+uint8* FMassChunkMemoryPool::Allocate(const int32 Size, const int32 Alignment)
+{
+	check(Size > 0);
+	FScopeLock Lock(&CriticalSection);
+
+	uint8* Memory = nullptr;
+	FSizeClass* SizeClass = FindSizeClass(Size, Alignment);
+	if (SizeClass && SizeClass->FreePages.Num())
+	{
+		Memory = SizeClass->FreePages.Pop(/*bAllowShrinking=*/false);
+		Stats.PooledBytes -= Size;
+		++Stats.NumHits;
+	}
+	else
+	{
+		Memory = (uint8*)FMemory::Malloc(Size, Alignment);
+		++Stats.NumMisses;
+	}
+
+	Stats.InUseBytes += Size;
+	InUseHighWaterMark = FMath::Max(InUseHighWaterMark, Stats.InUseBytes);
+	UpdatePeakResidentBytes();
+
+	return Memory;
+}
+
+void FMassChunkMemoryPool::Free(uint8* Memory, const int32 Size, const int32 Alignment)
+{
+	check(Memory);
+	FScopeLock Lock(&CriticalSection);
+
+	Stats.InUseBytes -= Size;
+	check(Stats.InUseBytes >= 0);
+
+	if (bPoolingEnabled && Stats.PooledBytes + Size <= MaxPooledBytes)
+	{
+		FSizeClass* SizeClass = FindSizeClass(Size, Alignment);
+		if (SizeClass == nullptr)
+		{
+			SizeClass = &SizeClasses.Emplace_GetRef(Size, Alignment);
+		}
+		SizeClass->FreePages.Add(Memory);
+		Stats.PooledBytes += Size;
+	}
+	else
+	{
+		FMemory::Free(Memory);
+		++Stats.NumReleased;
+	}
+}
+
+void FMassChunkMemoryPool::Trim()
+{
+	FScopeLock Lock(&CriticalSection);
+
+	ReleasePooledPages(InUseHighWaterMark - Stats.InUseBytes);
+	InUseHighWaterMark = Stats.InUseBytes;
+}
+
+void FMassChunkMemoryPool::Empty()
+{
+	FScopeLock Lock(&CriticalSection);
+
+	ReleasePooledPages(0);
+	SizeClasses.Reset();
+}
+
+void FMassChunkMemoryPool::ReleasePooledPages(const int64 BytesToRetain)
+{
+	// releasing the biggest pages first, those are the most costly to hold on to
+	SizeClasses.Sort([](const FSizeClass& A, const FSizeClass& B) { return A.Size > B.Size; });
+
+	for (FSizeClass& SizeClass : SizeClasses)
+	{
+		while (Stats.PooledBytes > BytesToRetain && SizeClass.FreePages.Num())
+		{
+			FMemory::Free(SizeClass.FreePages.Pop(/*bAllowShrinking=*/false));
+			Stats.PooledBytes -= SizeClass.Size;
+			++Stats.NumReleased;
+		}
+		SizeClass.FreePages.Shrink();
+	}
+}
+
+SIZE_T FMassChunkMemoryPool::GetAllocatedSize() const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	SIZE_T Size = SizeClasses.GetAllocatedSize() + Stats.PooledBytes;
+	for (const FSizeClass& SizeClass : SizeClasses)
+	{
+		Size += SizeClass.FreePages.GetAllocatedSize();
+	}
+	return Size;
+}
@@ -0,0 +1,79 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassArchetypeTypes.h"
+#include "Misc/ScopeLock.h"
+
+/**
+ * Entity subsystem-wide pool of archetype chunk memory. Chunks borrow their raw memory from the pool and return it
+ * once emptied or destroyed. Returned pages are kept in per-size free lists (chunk sizes depend on archetypes'
+ * configuration, see UMassEntitySettings::GetChunkMemorySize) and handed out to subsequently created chunks of the same
+ * size and alignment, which saves the general-purpose allocator from churning big blocks during entity spawn/despawn waves.
+ */
+class FMassChunkMemoryPool
+{
+public:
+	FMassChunkMemoryPool(const bool bInPoolingEnabled, const int64 InMaxPooledBytes)
+		: bPoolingEnabled(bInPoolingEnabled)
+		, MaxPooledBytes(InMaxPooledBytes)
+	{}
+
+	~FMassChunkMemoryPool();
+
+	FMassChunkMemoryPool(const FMassChunkMemoryPool&) = delete;
+	FMassChunkMemoryPool& operator=(const FMassChunkMemoryPool&) = delete;
+
+	uint8* Allocate(const int32 Size, const int32 Alignment);
+	/** Returns Memory to the pool. Size and Alignment need to match the ones used when allocating. */
+	void Free(uint8* Memory, const int32 Size, const int32 Alignment);
+
+	/**
+	 * Releases the pooled pages that were not needed to get back to the in-use high-water mark observed since the
+	 * previous Trim call. This way the pool keeps enough memory for a repeating spawn wave, while memory that was
+	 * used once and has been idle for a whole trim period gets released.
+	 */
+	void Trim();
+
+	/** Releases all the pooled pages */
+	void Empty();
+
+	FMassChunkMemoryStats GetStats() const
+	{
+		FScopeLock Lock(&CriticalSection);
+		return Stats;
+	}
+
+	/** @return the memory held by the pool, i.e. the pooled pages and the bookkeeping. */
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	struct FSizeClass
+	{
+		FSizeClass(const int32 InSize, const int32 InAlignment) : Size(InSize), Alignment(InAlignment) {}
+
+		int32 Size = 0;
+		int32 Alignment = 0;
+		TArray<uint8*> FreePages;
+	};
+
+	FSizeClass* FindSizeClass(const int32 Size, const int32 Alignment);
+
+	/** Releases pooled pages until Stats.PooledBytes drops to BytesToRetain. Expects CriticalSection to be locked. */
+	void ReleasePooledPages(const int64 BytesToRetain);
+
+	void UpdatePeakResidentBytes()
+	{
+		Stats.PeakResidentBytes = FMath::Max(Stats.PeakResidentBytes, Stats.InUseBytes + Stats.PooledBytes);
+	}
+
+	mutable FCriticalSection CriticalSection;
+	/** There's only a handful of distinct chunk sizes and alignments in practice, so a linear search is good enough */
+	TArray<FSizeClass, TInlineAllocator<4>> SizeClasses;
+	FMassChunkMemoryStats Stats;
+	/** The highest Stats.InUseBytes observed since the previous Trim call */
+	int64 InUseHighWaterMark = 0;
+	const bool bPoolingEnabled = true;
+	const int64 MaxPooledBytes = 0;
+};
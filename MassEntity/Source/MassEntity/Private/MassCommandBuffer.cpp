@@ -3,6 +3,7 @@
 #include "MassCommandBuffer.h"
 #include "MassObserverManager.h"
 #include "MassEntityUtils.h"
+#include "MassArchetypeData.h"
 #include "HAL/IConsoleManager.h"
 #include "ProfilingDebugging/CsvProfiler.h"
 #include "VisualLogger/VisualLogger.h"
@@ -69,6 +70,285 @@ void GetCommandStatNames(FStructView Entry, FString& OutName, ANSIName*& OutANSI
 }
 
 #endif
+
+bool bCoalesceCommands = false;
+
+FAutoConsoleVariableRef CVarCoalesceCommands(TEXT("massentities.CoalesceCommands"), bCoalesceCommands,
+	TEXT("Set to true to have single-entity tag and fragment add/remove commands bucketed by type and applied as batched archetype moves."), ECVF_Default);
+
+void ExecuteCommand(FStructView Entry, UMassEntitySubsystem& EntitySystem)
+{
+	const FCommandBufferEntryBase* Command = Entry.GetPtr<FCommandBufferEntryBase>();
+	checkf(Command, TEXT("Either the entry is null or the command does not derive from FCommandBufferEntryBase"));
+
+#if CSV_PROFILER
+	// Extract name (default or detailed)
+	ANSIName* ANSIName = &DefaultANSIName;
+	FString Name = DefaultName;
+	GetCommandStatNames(Entry, Name, ANSIName);
+
+	// Push stats
+	FScopedCsvStat ScopedCsvStat(*ANSIName, CSV_CATEGORY_INDEX(MassEntities));
+	FCsvProfiler::RecordCustomStat(*Name, CSV_CATEGORY_INDEX(MassEntitiesCounters), 1, ECsvCustomStatOp::Accumulate);
+#endif // CSV_PROFILER
+
+	Command->Execute(EntitySystem);
+}
+
+/**
+ * Gathers consecutive single-entity tag and fragment commands into buckets keyed by the operation and the struct type
+ * and applies every bucket as a batched archetype move per source archetype. Commands operating on different entities
+ * are independent, so to keep the results identical to executing commands one by one it's enough to preserve the 
+ * per-entity order. That's achieved by putting the N-th command affecting a given entity into the N-th layer of buckets,
+ * and applying the layers in order. All the gathered commands need to be flushed before executing any command that 
+ * cannot be coalesced.
+ */
+struct FCommandCoalescer
+{
+	using FBuckets = TMap<FMassArchetypeTransitionKey, TArray<FMassEntityHandle>>;
+
+	explicit FCommandCoalescer(UMassEntitySubsystem& InEntitySystem)
+		: EntitySystem(InEntitySystem)
+	{}
+
+	/** @return whether the command has been consumed. If not the caller is expected to Flush before executing it. */
+	bool Add(FStructView Entry)
+	{
+		const UScriptStruct* CommandType = Entry.GetScriptStruct();
+		EMassArchetypeTransition Operation = EMassArchetypeTransition::AddTag;
+		const UScriptStruct* StructParam = nullptr;
+		if (CommandType == FCommandAddTag::StaticStruct())
+		{
+			Operation = EMassArchetypeTransition::AddTag;
+			StructParam = Entry.Get<FCommandAddTag>().GetStructParam();
+		}
+		else if (CommandType == FCommandRemoveTag::StaticStruct())
+		{
+			Operation = EMassArchetypeTransition::RemoveTag;
+			StructParam = Entry.Get<FCommandRemoveTag>().GetStructParam();
+		}
+		else if (CommandType == FCommandAddFragment::StaticStruct())
+		{
+			Operation = EMassArchetypeTransition::AddFragment;
+			StructParam = Entry.Get<FCommandAddFragment>().GetStructParam();
+		}
+		else if (CommandType == FCommandRemoveFragment::StaticStruct())
+		{
+			Operation = EMassArchetypeTransition::RemoveFragment;
+			StructParam = Entry.Get<FCommandRemoveFragment>().GetStructParam();
+		}
+		else
+		{
+			return false;
+		}
+
+		const FMassEntityHandle Entity = Entry.Get<FCommandBufferEntryBase>().TargetEntity;
+		const int32 LayerIndex = EntityCommandCount.FindOrAdd(Entity.Index)++;
+		if (LayerIndex >= Layers.Num())
+		{
+			Layers.AddDefaulted(LayerIndex - Layers.Num() + 1);
+		}
+
+		Layers[LayerIndex].FindOrAdd(FMassArchetypeTransitionKey(Operation, StructParam)).Add(Entity);
+		return true;
+	}
+
+	void Flush()
+	{
+		if (Layers.Num() == 0)
+		{
+			return;
+		}
+
+		TRACE_CPUPROFILER_EVENT_SCOPE_STR("ECS Deferred Commands Coalesced Flush");
+
+		for (const FBuckets& Buckets : Layers)
+		{
+			for (const TPair<FMassArchetypeTransitionKey, TArray<FMassEntityHandle>>& It : Buckets)
+			{
+#if CSV_PROFILER
+				FCsvProfiler::RecordCustomStat(TEXT("CoalescedCommand"), CSV_CATEGORY_INDEX(MassEntitiesCounters), It.Value.Num(), ECsvCustomStatOp::Accumulate);
+#endif // CSV_PROFILER
+
+				// entities that are no longer valid, or have not been built yet, will get filtered out here
+				ChunkCollections.Reset();
+				UE::Mass::Utils::CreateSparseChunks(EntitySystem, It.Value, FArchetypeChunkCollection::NoDuplicates, ChunkCollections);
+
+				for (const FArchetypeChunkCollection& Collection : ChunkCollections)
+				{
+					switch (It.Key.Operation)
+					{
+					case EMassArchetypeTransition::AddTag:
+						EntitySystem.BatchAddTagToEntities(Collection, It.Key.StructType);
+						break;
+					case EMassArchetypeTransition::RemoveTag:
+						EntitySystem.BatchRemoveTagFromEntities(Collection, It.Key.StructType);
+						break;
+					case EMassArchetypeTransition::AddFragment:
+						EntitySystem.BatchAddFragmentToEntities(Collection, It.Key.StructType);
+						break;
+					case EMassArchetypeTransition::RemoveFragment:
+						EntitySystem.BatchRemoveFragmentFromEntities(Collection, It.Key.StructType);
+						break;
+					default:
+						checkNoEntry();
+					}
+				}
+			}
+		}
+
+		Layers.Reset();
+		EntityCommandCount.Reset();
+	}
+
+private:
+	UMassEntitySubsystem& EntitySystem;
+	/** Layer N contains the N-th coalesced command of every entity, bucketed by operation and type */
+	TArray<FBuckets> Layers;
+	/** Number of coalesced, not yet flushed commands per entity index */
+	TMap<int32, int32> EntityCommandCount;
+	TArray<FArchetypeChunkCollection> ChunkCollections;
+};
+
+/**
+ * Groups the entities recorded per type into chunk collections and calls Notify for every observed type and
+ * resulting collection. Only the entities ShouldNotify approves of get included.
+ */
+template<typename TBitSet>
+void NotifyObservers(UMassEntitySubsystem& EntitySystem, const TMap<const UScriptStruct*, TArray<FMassEntityHandle>>& EntitiesPerType
+	, const TBitSet& ObservedTypesBitSet, TFunctionRef<bool(const UScriptStruct&, const FMassEntityHandle)> ShouldNotify
+	, TFunctionRef<void(const UScriptStruct&, const FArchetypeChunkCollection&)> Notify)
+{
+	if (ObservedTypesBitSet.IsEmpty())
+	{
+		return;
+	}
+
+	TArray<FMassEntityHandle> EntitiesToNotify;
+	TArray<FArchetypeChunkCollection> ChunkCollections;
+	for (const TPair<const UScriptStruct*, TArray<FMassEntityHandle>>& It : EntitiesPerType)
+	{
+		check(It.Key);
+		if (ObservedTypesBitSet.Contains(*It.Key))
+		{
+			EntitiesToNotify.Reset();
+			for (const FMassEntityHandle& Entity : It.Value)
+			{
+				if (ShouldNotify(*It.Key, Entity))
+				{
+					EntitiesToNotify.Add(Entity);
+				}
+			}
+
+			ChunkCollections.Reset();
+			UE::Mass::Utils::CreateSparseChunks(EntitySystem, EntitiesToNotify, FArchetypeChunkCollection::FoldDuplicates, ChunkCollections);
+			for (const FArchetypeChunkCollection& Collection : ChunkCollections)
+			{
+				Notify(*It.Key, Collection);
+			}
+		}
+	}
+}
+
+/** @return whether Entity is built and the CompositionMember part of its archetype's composition contains Type */
+template<typename TBitSet>
+bool HasCompositionElement(const UMassEntitySubsystem& EntitySystem, const FMassEntityHandle Entity, const UScriptStruct& Type
+	, TBitSet FMassArchetypeCompositionDescriptor::* CompositionMember)
+{
+	const FArchetypeHandle Archetype = EntitySystem.GetArchetypeForEntity(Entity);
+	return Archetype.IsValid() && (EntitySystem.GetArchetypeComposition(Archetype).*CompositionMember).Contains(Type);
+}
+
+/**
+ * Collects the entities recorded for getting an observed type added which can actually get it added, i.e. the ones
+ * that don't have it yet, or have it but are recorded for getting it removed as well.
+ */
+template<typename TBitSet>
+void CollectEntitiesMissingTypes(const UMassEntitySubsystem& EntitySystem, const TMap<const UScriptStruct*, TArray<FMassEntityHandle>>& EntitiesToAdd
+	, const TMap<const UScriptStruct*, TArray<FMassEntityHandle>>& EntitiesToRemove, const TBitSet& ObservedTypesBitSet
+	, TBitSet FMassArchetypeCompositionDescriptor::* CompositionMember, TMap<const UScriptStruct*, TArray<FMassEntityHandle>>& OutEntities)
+{
+	if (ObservedTypesBitSet.IsEmpty())
+	{
+		return;
+	}
+
+	TSet<FMassEntityHandle> RemovedEntities;
+	for (const TPair<const UScriptStruct*, TArray<FMassEntityHandle>>& It : EntitiesToAdd)
+	{
+		check(It.Key);
+		if (ObservedTypesBitSet.Contains(*It.Key) == false)
+		{
+			continue;
+		}
+
+		RemovedEntities.Reset();
+		if (const TArray<FMassEntityHandle>* Removed = EntitiesToRemove.Find(It.Key))
+		{
+			RemovedEntities.Append(*Removed);
+		}
+
+		TArray<FMassEntityHandle>& MissingTypeEntities = OutEntities.Add(It.Key);
+		for (const FMassEntityHandle& Entity : It.Value)
+		{
+			if (HasCompositionElement(EntitySystem, Entity, *It.Key, CompositionMember) == false || RemovedEntities.Contains(Entity))
+			{
+				MissingTypeEntities.Add(Entity);
+			}
+		}
+	}
+}
+
+/** @return the memory of Entity's value of the, const or not, shared fragment of SharedFragmentType. Nullptr if it has none. */
+const void* GetSharedFragmentValueMemory(const UMassEntitySubsystem& EntitySystem, const FMassEntityHandle Entity, const UScriptStruct& SharedFragmentType)
+{
+	const FArchetypeHandle Archetype = EntitySystem.GetArchetypeForEntity(Entity);
+	if (Archetype.IsValid() == false)
+	{
+		return nullptr;
+	}
+
+	const FMassArchetypeSharedFragmentValues& SharedFragmentValues = EntitySystem.GetArchetypeSharedFragmentValues(Archetype);
+	for (const FConstSharedStruct& Fragment : SharedFragmentValues.GetConstSharedFragments())
+	{
+		if (Fragment.GetScriptStruct() == &SharedFragmentType)
+		{
+			return Fragment.GetMemory();
+		}
+	}
+	for (const FSharedStruct& Fragment : SharedFragmentValues.GetSharedFragments())
+	{
+		if (Fragment.GetScriptStruct() == &SharedFragmentType)
+		{
+			return Fragment.GetMemory();
+		}
+	}
+	return nullptr;
+}
+
+/** Stores the shared fragment values the entities recorded for getting an observed shared fragment changed use at the moment */
+void CollectSharedFragmentValues(const UMassEntitySubsystem& EntitySystem, const TMap<const UScriptStruct*, TArray<FMassEntityHandle>>& EntitiesPerType
+	, const FMassSharedFragmentBitSet& ObservedTypesBitSet, TMap<const UScriptStruct*, TMap<FMassEntityHandle, const void*>>& OutValues)
+{
+	if (ObservedTypesBitSet.IsEmpty())
+	{
+		return;
+	}
+
+	for (const TPair<const UScriptStruct*, TArray<FMassEntityHandle>>& It : EntitiesPerType)
+	{
+		check(It.Key);
+		if (ObservedTypesBitSet.Contains(*It.Key))
+		{
+			TMap<FMassEntityHandle, const void*>& Values = OutValues.Add(It.Key);
+			for (const FMassEntityHandle& Entity : It.Value)
+			{
+				Values.Add(Entity, GetSharedFragmentValueMemory(EntitySystem, Entity, *It.Key));
+			}
+		}
+	}
+}
+
 } // UE::FLWCCommand
 
 //////////////////////////////////////////////////////////////////////
@@ -78,6 +358,18 @@ void FMassCommandsObservedTypes::Reset()
 {
 	FragmentsToAdd.Reset();
 	FragmentsToRemove.Reset();
+	TagsToAdd.Reset();
+	TagsToRemove.Reset();
+	SharedFragmentsToChange.Reset();
+}
+
+void FMassCommandsObservedTypes::Append(FMassCommandsObservedTypes&& Other)
+{
+	FragmentsToAdd.Append(MoveTemp(Other.FragmentsToAdd));
+	FragmentsToRemove.Append(MoveTemp(Other.FragmentsToRemove));
+	TagsToAdd.Append(MoveTemp(Other.TagsToAdd));
+	TagsToRemove.Append(MoveTemp(Other.TagsToRemove));
+	SharedFragmentsToChange.Append(MoveTemp(Other.SharedFragmentsToChange));
 }
 
 
@@ -99,22 +391,37 @@ void FMassCommandBuffer::ReplayBufferAgainstSystem(UMassEntitySubsystem* EntityS
 	const FMassFragmentBitSet& ObservedAddFragments = ObserverManager.GetObservedAddFragmentsBitSet();
 	const FMassFragmentBitSet& ObservedRemoveFragments = ObserverManager.GetObservedRemoveFragmentsBitSet();
 
+	// only the entities actually having the types (at the time of notification) get reported to the observers
+	auto HasTag = [EntitySystem](const UScriptStruct& Type, const FMassEntityHandle Entity)
+	{
+		return UE::FLWCCommand::HasCompositionElement(*EntitySystem, Entity, Type, &FMassArchetypeCompositionDescriptor::Tags);
+	};
+	auto HasFragment = [EntitySystem](const UScriptStruct& Type, const FMassEntityHandle Entity)
+	{
+		return UE::FLWCCommand::HasCompositionElement(*EntitySystem, Entity, Type, &FMassArchetypeCompositionDescriptor::Fragments);
+	};
+
+	// the observers get notified once per type and chunk collection, rather than once per command
+	UE::FLWCCommand::NotifyObservers(*EntitySystem, ObservedTypes.GetTagsToRemove(), ObserverManager.GetObservedRemoveTagsBitSet(), HasTag
+		, [&ObserverManager](const UScriptStruct& Type, const FArchetypeChunkCollection& Collection) { ObserverManager.OnPreTagRemoved(Type, Collection); });
+
+	// the removals notified here get skipped when the commands actually remove the fragments, the ones done some other
+	// way (like by deferred command lambdas) still notify the observers when executed
+	FMassObserverManager::FEntitySetPerType FragmentRemovalsNotified;
 	if (ObservedRemoveFragments.IsEmpty() == false)
 	{
-		for (auto It : ObservedTypes.GetFragmentsToRemove())
-		{
-			check(It.Key);
-			if (ObservedRemoveFragments.Contains(*It.Key))
+		UE::FLWCCommand::NotifyObservers(*EntitySystem, ObservedTypes.GetFragmentsToRemove(), ObservedRemoveFragments
+			, [&HasFragment, &FragmentRemovalsNotified](const UScriptStruct& Type, const FMassEntityHandle Entity)
 			{
-				TArray<FArchetypeChunkCollection> ChunkCollections;
-				UE::Mass::Utils::CreateSparseChunks(*EntitySystem, It.Value, FArchetypeChunkCollection::FoldDuplicates, ChunkCollections);
-				for (FArchetypeChunkCollection& Collection : ChunkCollections)
+				if (HasFragment(Type, Entity))
 				{
-					check(It.Key);
-					ObserverManager.OnPreFragmentRemoved(*It.Key, Collection);
+					bool bAlreadyNotified = false;
+					FragmentRemovalsNotified.FindOrAdd(&Type).Add(Entity, &bAlreadyNotified);
+					return bAlreadyNotified == false;
 				}
+				return false;
 			}
-		}
+			, [&ObserverManager](const UScriptStruct& Type, const FArchetypeChunkCollection& Collection) { ObserverManager.OnPreFragmentRemoved(Type, Collection); });
 	
 		TArray<FArchetypeChunkCollection> EntityChunksToDestroy;
 		if (EntitiesToDestroy.Num())
@@ -134,46 +441,60 @@ void FMassCommandBuffer::ReplayBufferAgainstSystem(UMassEntitySubsystem* EntityS
 	EntitiesToDestroy.Reset();
 
 
-	UE_MT_SCOPED_WRITE_ACCESS(PendingCommandsDetector);
-	PendingCommands.ForEach([EntitySystem](FStructView Entry)
-	{
-		const FCommandBufferEntryBase* Command = Entry.GetPtr<FCommandBufferEntryBase>();
-		checkf(Command, TEXT("Either the entry is null or the command does not derive from FCommandBufferEntryBase"));
+	// what the entities look like before the commands get executed, so that the observers only get notified
+	// of the entities the commands actually changed
+	const FMassSharedFragmentBitSet& ObservedSharedFragments = ObserverManager.GetObservedSharedFragmentsBitSet();
+	TMap<const UScriptStruct*, TArray<FMassEntityHandle>> FragmentsToAdd;
+	UE::FLWCCommand::CollectEntitiesMissingTypes(*EntitySystem, ObservedTypes.GetFragmentsToAdd(), ObservedTypes.GetFragmentsToRemove()
+		, ObservedAddFragments, &FMassArchetypeCompositionDescriptor::Fragments, FragmentsToAdd);
+	TMap<const UScriptStruct*, TArray<FMassEntityHandle>> TagsToAdd;
+	UE::FLWCCommand::CollectEntitiesMissingTypes(*EntitySystem, ObservedTypes.GetTagsToAdd(), ObservedTypes.GetTagsToRemove()
+		, ObserverManager.GetObservedAddTagsBitSet(), &FMassArchetypeCompositionDescriptor::Tags, TagsToAdd);
+	TMap<const UScriptStruct*, TMap<FMassEntityHandle, const void*>> SharedFragmentValuesBefore;
+	UE::FLWCCommand::CollectSharedFragmentValues(*EntitySystem, ObservedTypes.GetSharedFragmentsToChange(), ObservedSharedFragments, SharedFragmentValuesBefore);
 
-#if CSV_PROFILER
-		using namespace UE::FLWCCommand;
-
-		// Extract name (default or detailed)
-		ANSIName* ANSIName = &DefaultANSIName;
-		FString Name = DefaultName;
-		GetCommandStatNames(Entry, Name, ANSIName);
-
-		// Push stats
-		FScopedCsvStat ScopedCsvStat(*ANSIName, CSV_CATEGORY_INDEX(MassEntities));
-		FCsvProfiler::RecordCustomStat(*Name, CSV_CATEGORY_INDEX(MassEntitiesCounters), 1, ECsvCustomStatOp::Accumulate);
-#endif // CSV_PROFILER
-
-		Command->Execute(*EntitySystem);
-	});
-
-	// Using Clear() instead of Reset(), as otherwise the chunks moved into the PendingCommands in MoveAppend() can accumulate.
-	PendingCommands.Clear();
-
-	for (auto It : ObservedTypes.GetFragmentsToAdd())
+	UE_MT_SCOPED_WRITE_ACCESS(PendingCommandsDetector);
 	{
-		check(It.Key);
-		if (ObservedAddFragments.Contains(*It.Key))
+		// the fragment addition observers get run once per archetype when the scope ends, while the removal observers
+		// of the recorded removals have already been notified above, per archetype as well
+		FMassObserverManager::FScopedCompositionChangeBatching CompositionChangeBatching(ObserverManager, &FragmentRemovalsNotified);
+		if (UE::FLWCCommand::bCoalesceCommands)
 		{
-			TArray<FArchetypeChunkCollection> ChunkCollections;
-			UE::Mass::Utils::CreateSparseChunks(*EntitySystem, It.Value, FArchetypeChunkCollection::FoldDuplicates, ChunkCollections);
-			for (FArchetypeChunkCollection& Collection : ChunkCollections)
+			UE::FLWCCommand::FCommandCoalescer Coalescer(*EntitySystem);
+			PendingCommands.ForEach([EntitySystem, &Coalescer](FStructView Entry)
 			{
-				check(It.Key);
-				ObserverManager.OnPostFragmentAdded(*It.Key, Collection);
-			}
+				if (Coalescer.Add(Entry) == false)
+				{
+					Coalescer.Flush();
+					UE::FLWCCommand::ExecuteCommand(Entry, *EntitySystem);
+				}
+			});
+			Coalescer.Flush();
 		}
+		else
+		{
+			PendingCommands.ForEach([EntitySystem](FStructView Entry)
+			{
+				UE::FLWCCommand::ExecuteCommand(Entry, *EntitySystem);
+			});
+		}
+
+		// Using Clear() instead of Reset(), as otherwise the chunks moved into the PendingCommands in MoveAppend() can accumulate.
+		PendingCommands.Clear();
 	}
 
+	UE::FLWCCommand::NotifyObservers(*EntitySystem, FragmentsToAdd, ObservedAddFragments, HasFragment
+		, [&ObserverManager](const UScriptStruct& Type, const FArchetypeChunkCollection& Collection) { ObserverManager.OnPostFragmentAdded(Type, Collection); });
+	UE::FLWCCommand::NotifyObservers(*EntitySystem, TagsToAdd, ObserverManager.GetObservedAddTagsBitSet(), HasTag
+		, [&ObserverManager](const UScriptStruct& Type, const FArchetypeChunkCollection& Collection) { ObserverManager.OnPostTagAdded(Type, Collection); });
+	UE::FLWCCommand::NotifyObservers(*EntitySystem, ObservedTypes.GetSharedFragmentsToChange(), ObservedSharedFragments
+		, [EntitySystem, &SharedFragmentValuesBefore](const UScriptStruct& Type, const FMassEntityHandle Entity)
+		{
+			const void* const* ValueBefore = SharedFragmentValuesBefore.FindChecked(&Type).Find(Entity);
+			return ValueBefore && UE::FLWCCommand::GetSharedFragmentValueMemory(*EntitySystem, Entity, Type) != *ValueBefore;
+		}
+		, [&ObserverManager](const UScriptStruct& Type, const FArchetypeChunkCollection& Collection) { ObserverManager.OnPostSharedFragmentChanged(Type, Collection); });
+
 	ObservedTypes.Reset();
 }
 
@@ -184,12 +505,32 @@ void FMassCommandBuffer::MoveAppend(FMassCommandBuffer& Other)
 	if (Other.HasPendingCommands() || Other.EntitiesToDestroy.Num())
 	{
 		FScopeLock Lock(&AppendingCommandsCS);
-		UE_MT_SCOPED_WRITE_ACCESS(PendingCommandsDetector);
-		PendingCommands.Append(MoveTemp(Other.PendingCommands));
-		EntitiesToDestroy.Append(MoveTemp(Other.EntitiesToDestroy));
+		MoveAppendInternal(Other);
 	}
 }
 
+void FMassCommandBuffer::MoveAppendOrdered(TConstArrayView<TSharedPtr<FMassCommandBuffer>> Others)
+{
+	for (const TSharedPtr<FMassCommandBuffer>& Other : Others)
+	{
+		check(Other.IsValid() && Other.Get() != this);
+		UE_MT_SCOPED_READ_ACCESS(Other->PendingCommandsDetector);
+		if (Other->HasPendingCommands())
+		{
+			MoveAppendInternal(*Other.Get());
+		}
+	}
+}
+
+void FMassCommandBuffer::MoveAppendInternal(FMassCommandBuffer& Other)
+{
+	UE_MT_SCOPED_WRITE_ACCESS(PendingCommandsDetector);
+	NumCommandsIssued += Other.NumCommandsIssued;
+	PendingCommands.Append(MoveTemp(Other.PendingCommands));
+	EntitiesToDestroy.Append(MoveTemp(Other.EntitiesToDestroy));
+	ObservedTypes.Append(MoveTemp(Other.ObservedTypes));
+}
+
 //////////////////////////////////////////////////////////////////////
 // Command implementations
 
@@ -269,6 +610,26 @@ void FCommandRemoveTag::Execute(UMassEntitySubsystem& System) const
 	System.RemoveTagFromEntity(TargetEntity, StructParam);
 }
 
+void FCommandSetSharedFragment::Execute(UMassEntitySubsystem& System) const
+{
+	if (System.IsEntityValid(TargetEntity) == false)
+	{
+		return;
+	}
+
+	System.SetEntitySharedFragment(TargetEntity, Fragment);
+}
+
+void FCommandSetConstSharedFragment::Execute(UMassEntitySubsystem& System) const
+{
+	if (System.IsEntityValid(TargetEntity) == false)
+	{
+		return;
+	}
+
+	System.SetEntityConstSharedFragment(TargetEntity, Fragment);
+}
+
 void FCommandRemoveComposition::Execute(UMassEntitySubsystem& System) const
 {
 	if (System.IsEntityValid(TargetEntity) == false)
@@ -5,10 +5,85 @@
 #include "MassEntitySubsystem.h"
 #include "MassArchetypeData.h"
 #include "MassCommandBuffer.h"
+#include "MassProcessor.h"
 #include "VisualLogger/VisualLogger.h"
 #include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/IConsoleManager.h"
 #include "Containers/UnrealString.h"
 
+namespace UE::Mass::Private
+{
+	int32 ParallelJobBatchesPerWorker = 4;
+	int32 ParallelMinBatchSize = 256;
+	FAutoConsoleVariableRef CVarsParallelQueries[] = {
+		{TEXT("mass.ParallelJobBatchesPerWorker"), ParallelJobBatchesPerWorker
+			, TEXT("Number of job batches, per worker thread, ParallelForEachEntityChunk aims to split its chunks into. Every batch uses a dedicated command buffer. ")
+			TEXT("Values <= 0 remove the limit, resulting in batches only as big as mass.ParallelMinBatchSize requires."), ECVF_Default},
+		{TEXT("mass.ParallelMinBatchSize"), ParallelMinBatchSize
+			, TEXT("Minimal number of entities (scaled by the query's cost hint) ParallelForEachEntityChunk packs into a single batch. ")
+			TEXT("Setting it to 0 along with mass.ParallelJobBatchesPerWorker 0 results in one job per chunk."), ECVF_Default},
+	};
+
+	/**
+	 * Packs consecutive jobs into batches of similar total cost. Batches are kept contiguous so that the results can be 
+	 * merged in a deterministic order.
+	 * @param JobCosts the cost of every job
+	 * @param TotalCost sum of JobCosts
+	 * @param MinBatchCost a batch won't be closed before reaching this cost, unless it's the last one
+	 * @param MaxBatches the number of batches to aim for. 0 means no limit
+	 * @param OutBatchEnds will be filled with the exclusive end job index of every batch
+	 */
+	void BuildCostBalancedBatches(TConstArrayView<float> JobCosts, const float TotalCost, const float MinBatchCost, const int32 MaxBatches, TArray<int32>& OutBatchEnds)
+	{
+		OutBatchEnds.Reset();
+		const float TargetBatchCost = FMath::Max(MinBatchCost, MaxBatches > 0 ? TotalCost / MaxBatches : 0.f);
+
+		float BatchCost = 0.f;
+		for (int32 JobIndex = 0; JobIndex < JobCosts.Num(); ++JobIndex)
+		{
+			BatchCost += JobCosts[JobIndex];
+			if (BatchCost >= TargetBatchCost)
+			{
+				OutBatchEnds.Add(JobIndex + 1);
+				BatchCost = 0.f;
+			}
+		}
+
+		if (OutBatchEnds.Num() == 0 ? JobCosts.Num() > 0 : OutBatchEnds.Last() != JobCosts.Num())
+		{
+			OutBatchEnds.Add(JobCosts.Num());
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// FMassExecutionRequirements
+
+void FMassExecutionRequirements::Append(const FMassExecutionRequirements& Other)
+{
+	FragmentsRead += Other.FragmentsRead;
+	FragmentsWritten += Other.FragmentsWritten;
+	ChunkFragmentsRead += Other.ChunkFragmentsRead;
+	ChunkFragmentsWritten += Other.ChunkFragmentsWritten;
+	SharedFragmentsRead += Other.SharedFragmentsRead;
+	SharedFragmentsWritten += Other.SharedFragmentsWritten;
+}
+
+bool FMassExecutionRequirements::IsEmpty() const
+{
+	return FragmentsRead.IsEmpty() && FragmentsWritten.IsEmpty()
+		&& ChunkFragmentsRead.IsEmpty() && ChunkFragmentsWritten.IsEmpty()
+		&& SharedFragmentsRead.IsEmpty() && SharedFragmentsWritten.IsEmpty();
+}
+
+bool FMassExecutionRequirements::ConflictsWith(const FMassExecutionRequirements& Other) const
+{
+	return FragmentsWritten.HasAny(Other.FragmentsWritten) || FragmentsWritten.HasAny(Other.FragmentsRead) || Other.FragmentsWritten.HasAny(FragmentsRead)
+		|| ChunkFragmentsWritten.HasAny(Other.ChunkFragmentsWritten) || ChunkFragmentsWritten.HasAny(Other.ChunkFragmentsRead) || Other.ChunkFragmentsWritten.HasAny(ChunkFragmentsRead)
+		|| SharedFragmentsWritten.HasAny(Other.SharedFragmentsWritten) || SharedFragmentsWritten.HasAny(Other.SharedFragmentsRead) || Other.SharedFragmentsWritten.HasAny(SharedFragmentsRead);
+}
+
 //////////////////////////////////////////////////////////////////////
 // FMassEntityQuery
 
@@ -36,6 +111,12 @@ FMassEntityQuery::FMassEntityQuery(TConstArrayView<const UScriptStruct*> InitLis
 	}
 }
 
+FMassEntityQuery::FMassEntityQuery(UMassProcessor& Owner)
+	: FMassEntityQuery()
+{
+	Owner.RegisterQuery(*this);
+}
+
 void FMassEntityQuery::ReadCommandlineParams()
 {
 	int AllowParallelQueries = -1;
@@ -64,18 +145,30 @@ void FMassEntityQuery::CacheArchetypes(UMassEntitySubsystem& InEntitySubsystem)
 	{
 		if (CheckValidity())
 		{
-			SortRequirements();
+			// If the cached data is up to date apart from some archetypes having been created since, only the new 
+			// archetypes need testing. Every archetype created bumps the archetype data version by one, so any other 
+			// version change (like the one forced with mass.RecacheQueries) results in a full rebuild.
+			const bool bIncremental = EntitySubsystemHash == InEntitySubsystemHash
+				&& InEntitySubsystem.GetArchetypeDataVersion() - ArchetypeDataVersion == uint32(InEntitySubsystem.GetNumArchetypes() - NumArchetypesCached);
+
+			if (bIncremental == false)
+			{
+				SortRequirements();
+				ValidArchetypes.Reset();
+				ArchetypeFragmentMapping.Reset();
+			}
 
 			EntitySubsystemHash = InEntitySubsystemHash;
-			ValidArchetypes.Reset();
-			InEntitySubsystem.GetValidArchetypes(*this, ValidArchetypes);
+			const int32 FirstNewArchetypeIndex = ValidArchetypes.Num();
+			InEntitySubsystem.GetValidArchetypes(*this, ValidArchetypes, bIncremental ? NumArchetypesCached : 0);
 			ArchetypeDataVersion = InEntitySubsystem.GetArchetypeDataVersion();
+			NumArchetypesCached = InEntitySubsystem.GetNumArchetypes();
 
 			TRACE_CPUPROFILER_EVENT_SCOPE_STR("Mass RequirementsBinding")
 			const TConstArrayView<FMassFragmentRequirement> LocalRequirements = GetRequirements();
-			ArchetypeFragmentMapping.Reset(ValidArchetypes.Num());
-			ArchetypeFragmentMapping.AddDefaulted(ValidArchetypes.Num());
-			for (int i = 0; i < ValidArchetypes.Num(); ++i)
+			check(ArchetypeFragmentMapping.Num() == FirstNewArchetypeIndex);
+			ArchetypeFragmentMapping.AddDefaulted(ValidArchetypes.Num() - FirstNewArchetypeIndex);
+			for (int i = FirstNewArchetypeIndex; i < ValidArchetypes.Num(); ++i)
 			{
 				ValidArchetypes[i].DataPtr->GetRequirementsFragmentMapping(LocalRequirements, ArchetypeFragmentMapping[i].EntityFragments);
 				if (ChunkRequirements.Num())
@@ -90,6 +183,10 @@ void FMassEntityQuery::CacheArchetypes(UMassEntitySubsystem& InEntitySubsystem)
 				{
 					ValidArchetypes[i].DataPtr->GetRequirementsSharedFragmentMapping(SharedRequirements, ArchetypeFragmentMapping[i].SharedFragments);
 				}
+				if (ChangedFilterFragments.Num())
+				{
+					ValidArchetypes[i].DataPtr->GetFragmentTypesMapping(ChangedFilterFragments, ArchetypeFragmentMapping[i].ChangedFilterFragments);
+				}
 			}
 		}
 		else
@@ -124,7 +221,7 @@ bool FMassEntityQuery::DoesArchetypeMatchRequirements(const FArchetypeHandle& Ar
 
 void FMassEntityQuery::ForEachEntityChunk(const FArchetypeChunkCollection& Chunks, UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& ExecutionContext, const FMassExecuteFunction& ExecuteFunction)
 {
-	// mz@todo I don't like that we're copying data here.
+	// the context only refers to Chunks, which outlives the call
 	ExecutionContext.SetChunkCollection(Chunks);
 	ForEachEntityChunk(EntitySubsystem, ExecutionContext, ExecuteFunction);
 	ExecutionContext.ClearChunkCollection();
@@ -147,8 +244,15 @@ void FMassEntityQuery::ForEachEntityChunk(UMassEntitySubsystem& EntitySubsystem,
 				, *DebugGetArchetypeCompatibilityDescription(ExecutionContext.GetChunkCollection().GetArchetype()));
 			return;
 		}
+		BeginChangeTracking(ExecutionContext);
 		ExecutionContext.SetRequirements(Requirements, ChunkRequirements, ConstSharedRequirements, SharedRequirements);
-		ExecutionContext.GetChunkCollection().GetArchetype().DataPtr->ExecuteFunction(ExecutionContext, ExecuteFunction, {}, ExecutionContext.GetChunkCollection());
+		FMassArchetypeData& ArchetypeData = *ExecutionContext.GetChunkCollection().GetArchetype().DataPtr.Get();
+		FMassQueryRequirementIndicesMapping RequirementMapping;
+		if (ChangedFilterFragments.Num())
+		{
+			ArchetypeData.GetFragmentTypesMapping(ChangedFilterFragments, RequirementMapping.ChangedFilterFragments);
+		}
+		ArchetypeData.ExecuteFunction(ExecutionContext, ExecuteFunction, RequirementMapping, ExecutionContext.GetChunkCollection());
 #if WITH_MASSENTITY_DEBUG
 		NumEntitiesToProcess = ExecutionContext.GetNumEntities();
 #endif
@@ -156,6 +260,7 @@ void FMassEntityQuery::ForEachEntityChunk(UMassEntitySubsystem& EntitySubsystem,
 	else
 	{
 		CacheArchetypes(EntitySubsystem);
+		BeginChangeTracking(ExecutionContext);
 		// it's important to set requirements after caching archetypes due to that call potentially sorting the requirements and the order is relevant here.
 		ExecutionContext.SetRequirements(Requirements, ChunkRequirements, ConstSharedRequirements, SharedRequirements);
 
@@ -196,6 +301,8 @@ void FMassEntityQuery::ParallelForEachEntityChunk(UMassEntitySubsystem& EntitySu
 		const FArchetypeChunkCollection::FChunkInfo ChunkInfo;
 	};
 	TArray<FChunkJob> Jobs;
+	// used for the jobs created from the externally provided chunk collection
+	FMassQueryRequirementIndicesMapping ChunkCollectionMapping;
 
 	// if there's a chunk collection set by the external code - use that
 	if (ExecutionContext.GetChunkCollection().IsSet())
@@ -210,11 +317,17 @@ void FMassEntityQuery::ParallelForEachEntityChunk(UMassEntitySubsystem& EntitySu
 			return;
 		}
 
+		BeginChangeTracking(ExecutionContext);
 		ExecutionContext.SetRequirements(Requirements, ChunkRequirements, ConstSharedRequirements, SharedRequirements);
 		check(ArchetypeHandle.IsValid());
 		FMassArchetypeData& ArchetypeRef = *ArchetypeHandle.DataPtr.Get();
-		const FArchetypeChunkCollection AsChunkCollection(ArchetypeHandle.DataPtr);
-		for (const FArchetypeChunkCollection::FChunkInfo& ChunkInfo : AsChunkCollection.GetChunks())
+		if (ChangedFilterFragments.Num())
+		{
+			ArchetypeRef.GetFragmentTypesMapping(ChangedFilterFragments, ChunkCollectionMapping.ChangedFilterFragments);
+		}
+		const TConstArrayView<FArchetypeChunkCollection::FChunkInfo> CollectionChunks = ExecutionContext.GetChunkCollection().GetChunks();
+		Jobs.Reserve(CollectionChunks.Num());
+		for (const FArchetypeChunkCollection::FChunkInfo& ChunkInfo : CollectionChunks)
 		{
 			Jobs.Add({ ArchetypeRef, INDEX_NONE, ChunkInfo });
 		}
@@ -222,32 +335,145 @@ void FMassEntityQuery::ParallelForEachEntityChunk(UMassEntitySubsystem& EntitySu
 	else
 	{
 		CacheArchetypes(EntitySubsystem);
+		BeginChangeTracking(ExecutionContext);
 		ExecutionContext.SetRequirements(Requirements, ChunkRequirements, ConstSharedRequirements, SharedRequirements);
-		for (int ArchetypeIndex = 0; ArchetypeIndex < ValidArchetypes.Num(); ++ArchetypeIndex)
+		int32 NumJobs = 0;
+		for (const FArchetypeHandle& Archetype : ValidArchetypes)
 		{
-			FArchetypeHandle& Archetype = ValidArchetypes[ArchetypeIndex];
 			check(Archetype.IsValid());
-			FMassArchetypeData& ArchetypeRef = *Archetype.DataPtr.Get();
-			const FArchetypeChunkCollection AsChunkCollection(Archetype.DataPtr);
-			for (const FArchetypeChunkCollection::FChunkInfo& ChunkInfo : AsChunkCollection.GetChunks())
+			NumJobs += Archetype.DataPtr->GetChunkCount();
+		}
+		Jobs.Reserve(NumJobs);
+
+		for (int ArchetypeIndex = 0; ArchetypeIndex < ValidArchetypes.Num(); ++ArchetypeIndex)
+		{
+			FMassArchetypeData& ArchetypeRef = *ValidArchetypes[ArchetypeIndex].DataPtr.Get();
+			// using the archetype's prebuilt chunk list rather than building an FArchetypeChunkCollection every time
+			for (const FArchetypeChunkCollection::FChunkInfo& ChunkInfo : ArchetypeRef.GetFullChunkList())
 			{
 				Jobs.Add({ArchetypeRef, ArchetypeIndex, ChunkInfo});
 			}
 		}
 	}
-	// ExecutionContext passed by copy on purpose
-	ParallelFor(Jobs.Num(), [this, ExecutionContext, &ExecuteFunction, Jobs](const int32 JobIndex)
+	// Jobs are packed into contiguous, cost-balanced batches and every batch gets a dedicated command buffer so that 
+	// the parallel jobs don't contend on the shared one. The batch buffers are merged in batch order once all the jobs
+	// are done, which results in the same commands order as the sequential execution would produce.
+	TArray<int32> BatchEnds;
+	{
+		TArray<float> JobCosts;
+		JobCosts.AddUninitialized(Jobs.Num());
+		float TotalCost = 0.f;
+		for (int32 JobIndex = 0; JobIndex < Jobs.Num(); ++JobIndex)
+		{
+			const FArchetypeChunkCollection::FChunkInfo& ChunkInfo = Jobs[JobIndex].ChunkInfo;
+			const int32 NumEntities = ChunkInfo.Length > 0 
+				? ChunkInfo.Length 
+				: (Jobs[JobIndex].Archetype.GetNumEntitiesInChunk(ChunkInfo.ChunkIndex) - ChunkInfo.SubchunkStart);
+			JobCosts[JobIndex] = float(NumEntities) * ParallelExecutionCostHint;
+			TotalCost += JobCosts[JobIndex];
+		}
+
+		const int32 MaxBatches = UE::Mass::Private::ParallelJobBatchesPerWorker > 0
+			? (FTaskGraphInterface::Get().GetNumWorkerThreads() + 1) * UE::Mass::Private::ParallelJobBatchesPerWorker
+			: 0;
+		UE::Mass::Private::BuildCostBalancedBatches(JobCosts, TotalCost, float(UE::Mass::Private::ParallelMinBatchSize), MaxBatches, BatchEnds);
+	}
+	const int32 NumBatches = BatchEnds.Num();
+
+	TArray<TSharedPtr<FMassCommandBuffer>> BatchCommandBuffers;
+	if (ExecutionContext.GetSharedDeferredCommandBuffer().IsValid())
+	{
+		BatchCommandBuffers.Reserve(NumBatches);
+		for (int32 BatchIndex = 0; BatchIndex < NumBatches; ++BatchIndex)
+		{
+			BatchCommandBuffers.Add(MakeShared<FMassCommandBuffer>());
+		}
+	}
+
+	// Note that ParallelFor hands out the batches to the workers dynamically, so idle workers pick up the remaining 
+	// batches, while the batches themselves being cost-balanced keeps the tail short.
+	ParallelFor(NumBatches, [this, &ExecutionContext, &ExecuteFunction, &Jobs, &BatchCommandBuffers, &BatchEnds, &ChunkCollectionMapping](const int32 BatchIndex)
 	{
-		Jobs[JobIndex].Archetype.ExecutionFunctionForChunk(ExecutionContext, ExecuteFunction
-			, Jobs[JobIndex].ArchetypeIndex != INDEX_NONE ? ArchetypeFragmentMapping[Jobs[JobIndex].ArchetypeIndex] : FMassQueryRequirementIndicesMapping()
-			, Jobs[JobIndex].ChunkInfo
-			, ChunkCondition);
+		// ExecutionContext copied on purpose
+		FMassExecutionContext BatchExecutionContext = ExecutionContext;
+		if (BatchCommandBuffers.Num())
+		{
+			BatchExecutionContext.SetDeferredCommandBuffer(BatchCommandBuffers[BatchIndex]);
+		}
+
+		const int32 JobsEnd = BatchEnds[BatchIndex];
+		for (int32 JobIndex = BatchIndex > 0 ? BatchEnds[BatchIndex - 1] : 0; JobIndex < JobsEnd; ++JobIndex)
+		{
+			Jobs[JobIndex].Archetype.ExecutionFunctionForChunk(BatchExecutionContext, ExecuteFunction
+				, Jobs[JobIndex].ArchetypeIndex != INDEX_NONE ? ArchetypeFragmentMapping[Jobs[JobIndex].ArchetypeIndex] : ChunkCollectionMapping
+				, Jobs[JobIndex].ChunkInfo
+				, ChunkCondition);
+		}
 	});
 
+	if (BatchCommandBuffers.Num())
+	{
+		ExecutionContext.Defer().MoveAppendOrdered(BatchCommandBuffers);
+	}
+
 	ExecutionContext.ClearExecutionData();
 	ExecutionContext.FlushDeferred(EntitySubsystem);
 }
 
+void FMassEntityQuery::BeginChangeTracking(FMassExecutionContext& ExecutionContext)
+{
+	// executions done for the same processor execution keep filtering against the version preceding it, otherwise 
+	// the later ones would miss the changes done before the processor's execution
+	const uint64 ExecutionChangeVersion = ExecutionContext.GetExecutionChangeVersion();
+	if (ExecutionChangeVersion == 0 || ExecutionChangeVersion != RunChangeVersion)
+	{
+		ChangedSinceVersion = RunChangeVersion;
+		RunChangeVersion = ExecutionChangeVersion ? ExecutionChangeVersion : UE::Mass::GetNextChangeVersion();
+	}
+	ExecutionContext.SetChangeVersions(RunChangeVersion, ChangedSinceVersion);
+}
+
+void FMassEntityQuery::ExportRequirements(FMassExecutionRequirements& OutRequirements) const
+{
+	for (const FMassFragmentRequirement& Requirement : Requirements)
+	{
+		if (Requirement.AccessMode == EMassFragmentAccess::ReadOnly)
+		{
+			OutRequirements.FragmentsRead.Add(*Requirement.StructType);
+		}
+		else if (Requirement.AccessMode == EMassFragmentAccess::ReadWrite)
+		{
+			OutRequirements.FragmentsWritten.Add(*Requirement.StructType);
+		}
+	}
+	for (const FMassFragmentRequirement& Requirement : ChunkRequirements)
+	{
+		if (Requirement.AccessMode == EMassFragmentAccess::ReadOnly)
+		{
+			OutRequirements.ChunkFragmentsRead.Add(*Requirement.StructType);
+		}
+		else if (Requirement.AccessMode == EMassFragmentAccess::ReadWrite)
+		{
+			OutRequirements.ChunkFragmentsWritten.Add(*Requirement.StructType);
+		}
+	}
+	for (const FMassFragmentRequirement& Requirement : ConstSharedRequirements)
+	{
+		OutRequirements.SharedFragmentsRead.Add(*Requirement.StructType);
+	}
+	for (const FMassFragmentRequirement& Requirement : SharedRequirements)
+	{
+		if (Requirement.AccessMode == EMassFragmentAccess::ReadOnly)
+		{
+			OutRequirements.SharedFragmentsRead.Add(*Requirement.StructType);
+		}
+		else if (Requirement.AccessMode == EMassFragmentAccess::ReadWrite)
+		{
+			OutRequirements.SharedFragmentsWritten.Add(*Requirement.StructType);
+		}
+	}
+}
+
 int32 FMassEntityQuery::GetNumMatchingEntities(UMassEntitySubsystem& InEntitySubsystem)
 {
 	CacheArchetypes(InEntitySubsystem);
@@ -0,0 +1,111 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include <atomic>
+
+/**
+ * Fixed-capacity ring of entity handles that have already been reserved with the entity subsystem (i.e. have their
+ * index and serial number assigned) and are waiting to be handed out to code running off the game thread.
+ * The game thread is the only producer (see Publish), while any number of threads can consume (see TryAcquire)
+ * concurrently, without locking. Both ends are tracked with monotonically increasing counters, so there's no ABA issue
+ * with the consumers' compare-and-swap.
+ */
+class FMassEntityReservationPool
+{
+public:
+	explicit FMassEntityReservationPool(const int32 InCapacity)
+		: Slots(InCapacity > 0 ? new std::atomic<uint64>[InCapacity] : nullptr)
+		, Capacity(FMath::Max(InCapacity, 0))
+	{}
+
+	FMassEntityReservationPool(const FMassEntityReservationPool&) = delete;
+	FMassEntityReservationPool& operator=(const FMassEntityReservationPool&) = delete;
+
+	int32 GetCapacity() const { return Capacity; }
+
+	/** @return the number of handles that can be acquired at the moment of calling. Safe to call from any thread. */
+	int32 GetNumAvailable() const
+	{
+		const uint64 Taken = NumTaken.load(std::memory_order_acquire);
+		const uint64 Published = NumPublished.load(std::memory_order_acquire);
+		return int32(Published - Taken);
+	}
+
+	/** @return the number of handles that can be published at the moment of calling. Producer-side only. */
+	int32 GetNumFreeSlots() const
+	{
+		return Capacity - GetNumAvailable();
+	}
+
+	/**
+	 * Appends Count handles to OutHandles. Lock-free and safe to call from any thread.
+	 * @return false if there are not enough handles available, in which case OutHandles is left unchanged.
+	 */
+	bool TryAcquire(const int32 Count, TArray<FMassEntityHandle>& OutHandles)
+	{
+		check(Count > 0);
+		const int32 FirstIndex = OutHandles.Num();
+		uint64 Taken = NumTaken.load(std::memory_order_acquire);
+		for (;;)
+		{
+			const uint64 Published = NumPublished.load(std::memory_order_acquire);
+			if (Published - Taken < uint64(Count))
+			{
+				OutHandles.SetNum(FirstIndex, /*bAllowShrinking=*/false);
+				return false;
+			}
+
+			// reading before claiming, the producer only overwrites slots that have already been claimed so if the
+			// compare-and-swap below succeeds nobody touched these in the meantime
+			OutHandles.SetNumUninitialized(FirstIndex + Count, /*bAllowShrinking=*/false);
+			for (int32 i = 0; i < Count; ++i)
+			{
+				OutHandles[FirstIndex + i] = Unpack(Slots[(Taken + i) % Capacity].load(std::memory_order_relaxed));
+			}
+
+			if (NumTaken.compare_exchange_weak(Taken, Taken + Count, std::memory_order_acq_rel, std::memory_order_acquire))
+			{
+				return true;
+			}
+			// Taken has been updated with the current value, try again
+		}
+	}
+
+	/** Makes Handles available to the consumers. Producer-side only, Handles.Num() can't exceed GetNumFreeSlots(). */
+	void Publish(TConstArrayView<FMassEntityHandle> Handles)
+	{
+		const uint64 Published = NumPublished.load(std::memory_order_relaxed);
+		check(Handles.Num() <= int32(Capacity - (Published - NumTaken.load(std::memory_order_acquire))));
+
+		for (int32 i = 0; i < Handles.Num(); ++i)
+		{
+			Slots[(Published + i) % Capacity].store(Pack(Handles[i]), std::memory_order_relaxed);
+		}
+		NumPublished.store(Published + Handles.Num(), std::memory_order_release);
+	}
+
+private:
+	static uint64 Pack(const FMassEntityHandle Handle)
+	{
+		return (uint64(uint32(Handle.SerialNumber)) << 32) | uint64(uint32(Handle.Index));
+	}
+
+	static FMassEntityHandle Unpack(const uint64 Packed)
+	{
+		FMassEntityHandle Handle;
+		Handle.Index = int32(uint32(Packed));
+		Handle.SerialNumber = int32(uint32(Packed >> 32));
+		return Handle;
+	}
+
+	TUniquePtr<std::atomic<uint64>[]> Slots;
+	const int32 Capacity = 0;
+
+	/** Total number of handles ever published. Written by the producer only. */
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> NumPublished{0};
+	/** Total number of handles ever acquired. Kept on a separate cache line since that's where consumers contend. */
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> NumTaken{0};
+};
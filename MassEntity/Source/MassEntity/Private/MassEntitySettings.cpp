@@ -24,6 +24,18 @@ UMassEntitySettings::UMassEntitySettings(const FObjectInitializer& ObjectInitial
 	FCoreDelegates::OnPostEngineInit.AddUObject(this, &UMassEntitySettings::BuildProcessorListAndPhases);
 }
 
+int32 UMassEntitySettings::GetChunkMemorySize(const int32 BytesPerEntity) const
+{
+	if (TargetEntitiesPerChunk <= 0)
+	{
+		return ChunkMemorySize;
+	}
+
+	const int64 DesiredSize = int64(TargetEntitiesPerChunk) * BytesPerEntity;
+	const int32 MaxSize = FMath::Max(MinChunkMemorySize, MaxChunkMemorySize);
+	return FMath::Clamp(int32(FMath::RoundUpToPowerOfTwo64(uint64(FMath::Min<int64>(DesiredSize, MaxSize)))), MinChunkMemorySize, MaxSize);
+}
+
 void UMassEntitySettings::BeginDestroy()
 {
 	FCoreDelegates::OnPostEngineInit.RemoveAll(this);
@@ -0,0 +1,809 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "MassEntitySubsystem.h"
+#include "MassArchetypeData.h"
+#include "Algo/AllOf.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "UObject/UnrealType.h"
+
+//----------------------------------------------------------------------//
+// Snapshot layout:
+//	header: magic, version
+//	types: path, size and storage mode of every struct type referenced
+//	shared fragment values: type, hash and the serialized value
+//	archetypes: composition (type and shared value indices) and the handles of the hosted entities
+//	columns: for every archetype, for every fragment type, the values of all the archetype's entities
+//----------------------------------------------------------------------//
+namespace UE::Mass::Snapshot
+{
+	constexpr uint32 Magic = 0x4D534E50; // "MSNP"
+
+	enum class EVersion : int32
+	{
+		Initial = 1,
+		Latest = Initial
+	};
+
+	/** Raw columns are padded to this alignment within the snapshot, so that they can be copied from memory-mapped files efficiently */
+	constexpr int64 RawColumnAlignment = 16;
+
+	using FEntityMapping = TMap<FMassEntityHandle, FMassEntityHandle>;
+
+	/** 
+	 * @return whether some of Struct's memory is not covered by its properties, i.e. it has native members that are not
+	 *	UPROPERTYs. Native members small enough to fit in the alignment padding between the properties go unnoticed.
+	 */
+	bool HasNonPropertyMembers(const UScriptStruct& Struct)
+	{
+		TArray<const FProperty*, TInlineAllocator<16>> Properties;
+		for (TFieldIterator<FProperty> It(&Struct); It; ++It)
+		{
+			Properties.Add(*It);
+		}
+		if (Properties.Num() == 0)
+		{
+			// empty structs still take a byte
+			return Struct.GetStructureSize() > 1;
+		}
+		Properties.Sort([](const FProperty& A, const FProperty& B) { return A.GetOffset_ForInternal() < B.GetOffset_ForInternal(); });
+
+		// anything past the alignment padding between the properties has to be a native member
+		int32 PropertiesEnd = 0;
+		for (const FProperty* Property : Properties)
+		{
+			if (Property->GetOffset_ForInternal() > Align(PropertiesEnd, Property->GetMinAlignment()))
+			{
+				return true;
+			}
+			PropertiesEnd = FMath::Max(PropertiesEnd, Property->GetOffset_ForInternal() + Property->GetSize());
+		}
+		return Align(PropertiesEnd, Struct.GetMinAlignment()) < Struct.GetStructureSize();
+	}
+
+	/**
+	 * Whether Struct's instances can be stored as raw memory. All its properties need to be numbers, bools, enums or 
+	 * raw-serializable structs, and the type needs to be either plain-old-data or have all of its members reflected, since
+	 * native members (like TArrays or TSharedPtrs that are not UPROPERTYs) would end up referring to memory the loaded
+	 * instances don't own. Types with properties only valid within the current session (like object pointers and names)
+	 * or owning memory elsewhere (like strings and containers) get serialized property by property instead.
+	 */
+	bool IsRawSerializable(const UScriptStruct& Struct)
+	{
+		if ((Struct.StructFlags & STRUCT_IsPlainOldData) == 0 && HasNonPropertyMembers(Struct))
+		{
+			return false;
+		}
+
+		for (TFieldIterator<FProperty> It(&Struct); It; ++It)
+		{
+			if (const FStructProperty* StructProperty = CastField<FStructProperty>(*It))
+			{
+				if (IsRawSerializable(*StructProperty->Struct) == false)
+				{
+					return false;
+				}
+			}
+			else if (It->IsA<FNumericProperty>() == false && It->IsA<FBoolProperty>() == false && It->IsA<FEnumProperty>() == false)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ContainsEntityHandles(const UStruct& Struct, TSet<const UStruct*>& VisitedStructs);
+
+	bool ContainsEntityHandles(const FProperty& Property, TSet<const UStruct*>& VisitedStructs)
+	{
+		if (const FStructProperty* StructProperty = CastField<FStructProperty>(&Property))
+		{
+			return StructProperty->Struct == FMassEntityHandle::StaticStruct() || ContainsEntityHandles(*StructProperty->Struct, VisitedStructs);
+		}
+		if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(&Property))
+		{
+			return ContainsEntityHandles(*ArrayProperty->Inner, VisitedStructs);
+		}
+		if (const FSetProperty* SetProperty = CastField<FSetProperty>(&Property))
+		{
+			return ContainsEntityHandles(*SetProperty->ElementProp, VisitedStructs);
+		}
+		if (const FMapProperty* MapProperty = CastField<FMapProperty>(&Property))
+		{
+			return ContainsEntityHandles(*MapProperty->KeyProp, VisitedStructs) || ContainsEntityHandles(*MapProperty->ValueProp, VisitedStructs);
+		}
+		return false;
+	}
+
+	bool ContainsEntityHandles(const UStruct& Struct, TSet<const UStruct*>& VisitedStructs)
+	{
+		bool bAlreadyVisited = false;
+		VisitedStructs.Add(&Struct, &bAlreadyVisited);
+		if (bAlreadyVisited)
+		{
+			return false;
+		}
+
+		for (TFieldIterator<FProperty> It(&Struct); It; ++It)
+		{
+			if (ContainsEntityHandles(**It, VisitedStructs))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void RemapEntityHandles(const UStruct& Struct, void* Data, const FEntityMapping& Mapping);
+
+	void RemapEntityHandles(const FProperty& Property, void* Value, const FEntityMapping& Mapping)
+	{
+		if (const FStructProperty* StructProperty = CastField<FStructProperty>(&Property))
+		{
+			if (StructProperty->Struct == FMassEntityHandle::StaticStruct())
+			{
+				FMassEntityHandle& Entity = *static_cast<FMassEntityHandle*>(Value);
+				if (Entity.IsSet())
+				{
+					const FMassEntityHandle* NewEntity = Mapping.Find(Entity);
+					Entity = NewEntity ? *NewEntity : FMassEntityHandle();
+				}
+			}
+			else
+			{
+				RemapEntityHandles(*StructProperty->Struct, Value, Mapping);
+			}
+		}
+		else if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(&Property))
+		{
+			FScriptArrayHelper ArrayHelper(ArrayProperty, Value);
+			for (int32 Index = 0; Index < ArrayHelper.Num(); ++Index)
+			{
+				RemapEntityHandles(*ArrayProperty->Inner, ArrayHelper.GetRawPtr(Index), Mapping);
+			}
+		}
+		else if (const FSetProperty* SetProperty = CastField<FSetProperty>(&Property))
+		{
+			// the remapped elements hash differently. Note that handles reset due to pointing outside of the snapshot 
+			// can end up as duplicates
+			FScriptSetHelper SetHelper(SetProperty, Value);
+			for (int32 Index = 0; Index < SetHelper.GetMaxIndex(); ++Index)
+			{
+				if (SetHelper.IsValidIndex(Index))
+				{
+					RemapEntityHandles(*SetProperty->ElementProp, SetHelper.GetElementPtr(Index), Mapping);
+				}
+			}
+			SetHelper.Rehash();
+		}
+		else if (const FMapProperty* MapProperty = CastField<FMapProperty>(&Property))
+		{
+			FScriptMapHelper MapHelper(MapProperty, Value);
+			for (int32 Index = 0; Index < MapHelper.GetMaxIndex(); ++Index)
+			{
+				if (MapHelper.IsValidIndex(Index))
+				{
+					RemapEntityHandles(*MapProperty->KeyProp, MapHelper.GetKeyPtr(Index), Mapping);
+					RemapEntityHandles(*MapProperty->ValueProp, MapHelper.GetValuePtr(Index), Mapping);
+				}
+			}
+			MapHelper.Rehash();
+		}
+	}
+
+	void RemapEntityHandles(const UStruct& Struct, void* Data, const FEntityMapping& Mapping)
+	{
+		for (TFieldIterator<FProperty> It(&Struct); It; ++It)
+		{
+			for (int32 ArrayIndex = 0; ArrayIndex < It->ArrayDim; ++ArrayIndex)
+			{
+				RemapEntityHandles(**It, It->ContainerPtrToValuePtr<void>(Data, ArrayIndex), Mapping);
+			}
+		}
+	}
+
+	/** Writes out a column header, followed by the padding required for the column data to be aligned when bAligned is set */
+	void WriteColumnHeader(FArchive& Ar, int64 NumBytes, const bool bAligned)
+	{
+		Ar << NumBytes;
+		const int64 DataOffset = Ar.Tell() + int64(sizeof(int32));
+		int32 Padding = (bAligned && Ar.Tell() != INDEX_NONE) ? int32(Align(DataOffset, RawColumnAlignment) - DataOffset) : 0;
+		Ar << Padding;
+		uint8 Zeros[RawColumnAlignment] = {};
+		Ar.Serialize(Zeros, Padding);
+	}
+
+	/**
+	 * Serializes the structs into a separate, non-persistent archive, so that transient properties (like FMassEntityHandle's)
+	 * get stored as well, with object references and names stored as strings.
+	 */
+	void WriteSerializedColumn(FArchive& Ar, const UScriptStruct& Struct, TFunctionRef<void(TFunctionRef<void(const void*)>)> ForEachValue)
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter Writer(Bytes);
+		FObjectAndNameAsStringProxyArchive Proxy(Writer, /*bInLoadIfFindFails=*/false);
+		ForEachValue([&Struct, &Proxy](const void* Value)
+			{
+				Struct.SerializeItem(Proxy, const_cast<void*>(Value), /*Defaults=*/nullptr);
+			});
+
+		WriteColumnHeader(Ar, Bytes.Num(), /*bAligned=*/false);
+		Ar.Serialize(Bytes.GetData(), Bytes.Num());
+	}
+
+	/** @return a view of the column data Reader is at, moving Reader past it. Sets the error flag on Reader if the column doesn't fit the data. */
+	TConstArrayView<uint8> ReadColumn(FMemoryReaderView& Reader, TConstArrayView<uint8> SnapshotData)
+	{
+		int64 NumBytes = 0;
+		int32 Padding = 0;
+		Reader << NumBytes << Padding;
+		const int64 DataOffset = Reader.Tell() + Padding;
+		if (Reader.IsError() || Padding < 0 || NumBytes < 0 || DataOffset + NumBytes > SnapshotData.Num())
+		{
+			Reader.SetError();
+			return {};
+		}
+		Reader.Seek(DataOffset + NumBytes);
+		return MakeArrayView(SnapshotData.GetData() + DataOffset, int32(NumBytes));
+	}
+
+	bool AreIndicesValid(TConstArrayView<int32> Indices, const int32 Num)
+	{
+		return Algo::AllOf(Indices, [Num](const int32 Index) { return Index >= 0 && Index < Num; });
+	}
+} // UE::Mass::Snapshot
+
+void UMassEntitySubsystem::SaveSnapshot(FArchive& Ar) const
+{
+	using namespace UE::Mass::Snapshot;
+	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
+	check(Ar.IsSaving());
+
+	// gathering all the types and shared fragment values referenced by the archetypes
+	TArray<const UScriptStruct*> Types;
+	TMap<const UScriptStruct*, int32> TypeIndices;
+	auto GetTypeIndex = [&Types, &TypeIndices](const UScriptStruct* Type)
+	{
+		int32& Index = TypeIndices.FindOrAdd(Type, INDEX_NONE);
+		if (Index == INDEX_NONE)
+		{
+			Index = Types.Add(Type);
+		}
+		return Index;
+	};
+
+	// the hashes the shared fragment values have been registered with, see GetOrCreateSharedFragment
+	TMap<const uint8*, uint32> SharedValueHashes;
+	for (const TPair<uint32, int32>& HashAndIndex : ConstSharedFragmentsMap)
+	{
+		SharedValueHashes.Add(ConstSharedFragments[HashAndIndex.Value].GetMemory(), HashAndIndex.Key);
+	}
+	for (const TPair<uint32, int32>& HashAndIndex : SharedFragmentsMap)
+	{
+		SharedValueHashes.Add(SharedFragments[HashAndIndex.Value].GetMemory(), HashAndIndex.Key);
+	}
+
+	struct FSharedValue
+	{
+		FConstSharedStruct Value;
+		bool bConst = true;
+	};
+	TArray<FSharedValue> SharedValues;
+	TMap<const uint8*, int32> SharedValueIndices;
+	auto GetSharedValueIndex = [&SharedValues, &SharedValueIndices](const FConstSharedStruct& Value, const bool bConst)
+	{
+		int32& Index = SharedValueIndices.FindOrAdd(Value.GetMemory(), INDEX_NONE);
+		if (Index == INDEX_NONE)
+		{
+			Index = SharedValues.Add({Value, bConst});
+		}
+		return Index;
+	};
+
+	struct FArchetypeRecord
+	{
+		TArray<int32> FragmentTypes;
+		TArray<int32> TagTypes;
+		TArray<int32> ChunkFragmentTypes;
+		TArray<int32> ConstSharedValues;
+		TArray<int32> SharedValues;
+	};
+	TArray<FArchetypeRecord> ArchetypeRecords;
+	ArchetypeRecords.Reserve(AllArchetypes.Num());
+	for (const TSharedPtr<FMassArchetypeData>& Archetype : AllArchetypes)
+	{
+		FArchetypeRecord& Record = ArchetypeRecords.AddDefaulted_GetRef();
+		for (const FMassArchetypeFragmentConfig& FragmentConfig : Archetype->GetFragmentConfigs())
+		{
+			Record.FragmentTypes.Add(GetTypeIndex(FragmentConfig.FragmentType));
+		}
+
+		TArray<const UScriptStruct*, TInlineAllocator<16>> StructTypes;
+		Archetype->GetTagBitSet().ExportTypes(StructTypes);
+		for (const UScriptStruct* Type : StructTypes)
+		{
+			Record.TagTypes.Add(GetTypeIndex(Type));
+		}
+		StructTypes.Reset();
+		Archetype->GetChunkFragmentBitSet().ExportTypes(StructTypes);
+		for (const UScriptStruct* Type : StructTypes)
+		{
+			Record.ChunkFragmentTypes.Add(GetTypeIndex(Type));
+		}
+
+		for (const FConstSharedStruct& Value : Archetype->GetSharedFragmentValues().GetConstSharedFragments())
+		{
+			GetTypeIndex(Value.GetScriptStruct());
+			Record.ConstSharedValues.Add(GetSharedValueIndex(Value, /*bConst=*/true));
+		}
+		for (const FSharedStruct& Value : Archetype->GetSharedFragmentValues().GetSharedFragments())
+		{
+			GetTypeIndex(Value.GetScriptStruct());
+			Record.SharedValues.Add(GetSharedValueIndex(Value, /*bConst=*/false));
+		}
+	}
+
+	// header
+	uint32 SnapshotMagic = Magic;
+	int32 Version = int32(EVersion::Latest);
+	Ar << SnapshotMagic << Version;
+
+	// types
+	int32 NumTypes = Types.Num();
+	Ar << NumTypes;
+	for (const UScriptStruct* Type : Types)
+	{
+		FString Path = Type->GetPathName();
+		int32 Size = Type->GetStructureSize();
+		uint8 bRaw = IsRawSerializable(*Type);
+		Ar << Path << Size << bRaw;
+
+		if (bRaw == false && HasNonPropertyMembers(*Type))
+		{
+			UE_LOG(LogMass, Warning, TEXT("%s: %s has members that are not UPROPERTYs, their values won't be stored in the snapshot"), ANSI_TO_TCHAR(__FUNCTION__), *Path);
+		}
+	}
+
+	// shared fragment values
+	int32 NumSharedValues = SharedValues.Num();
+	Ar << NumSharedValues;
+	for (const FSharedValue& SharedValue : SharedValues)
+	{
+		const uint32* FoundHash = SharedValueHashes.Find(SharedValue.Value.GetMemory());
+		int32 TypeIndex = TypeIndices.FindChecked(SharedValue.Value.GetScriptStruct());
+		uint8 bConst = SharedValue.bConst;
+		uint8 bHashed = FoundHash != nullptr;
+		uint32 Hash = FoundHash ? *FoundHash : 0;
+		Ar << TypeIndex << bConst << bHashed << Hash;
+		const UScriptStruct& Type = *SharedValue.Value.GetScriptStruct();
+		if (IsRawSerializable(Type))
+		{
+			WriteColumnHeader(Ar, Type.GetStructureSize(), /*bAligned=*/false);
+			Ar.Serialize(const_cast<uint8*>(SharedValue.Value.GetMemory()), Type.GetStructureSize());
+		}
+		else
+		{
+			WriteSerializedColumn(Ar, Type, [&SharedValue](TFunctionRef<void(const void*)> Function)
+				{
+					Function(SharedValue.Value.GetMemory());
+				});
+		}
+	}
+
+	// archetypes
+	int32 NumArchetypes = AllArchetypes.Num();
+	Ar << NumArchetypes;
+	for (int32 ArchetypeIndex = 0; ArchetypeIndex < AllArchetypes.Num(); ++ArchetypeIndex)
+	{
+		const FMassArchetypeData& Archetype = *AllArchetypes[ArchetypeIndex];
+		FArchetypeRecord& Record = ArchetypeRecords[ArchetypeIndex];
+		Ar << Record.FragmentTypes << Record.TagTypes << Record.ChunkFragmentTypes << Record.ConstSharedValues << Record.SharedValues;
+
+		int32 NumArchetypeEntities = Archetype.GetNumEntities();
+		Ar << NumArchetypeEntities;
+		for (int32 ChunkIndex = 0; ChunkIndex < Archetype.GetChunkCount(); ++ChunkIndex)
+		{
+			TConstArrayView<FMassEntityHandle> ChunkEntities = Archetype.GetChunkEntities(ChunkIndex);
+			Ar.Serialize(const_cast<FMassEntityHandle*>(ChunkEntities.GetData()), ChunkEntities.Num() * sizeof(FMassEntityHandle));
+		}
+	}
+
+	// columns
+	TArray<uint8> SplitFragmentBuffer;
+	for (const TSharedPtr<FMassArchetypeData>& ArchetypePtr : AllArchetypes)
+	{
+		const FMassArchetypeData& Archetype = *ArchetypePtr;
+		for (const FMassArchetypeFragmentConfig& FragmentConfig : Archetype.GetFragmentConfigs())
+		{
+			const UScriptStruct& Type = *FragmentConfig.FragmentType;
+			if (IsRawSerializable(Type))
+			{
+				WriteColumnHeader(Ar, int64(Archetype.GetNumEntities()) * Type.GetStructureSize(), /*bAligned=*/true);
+				for (int32 ChunkIndex = 0; ChunkIndex < Archetype.GetChunkCount(); ++ChunkIndex)
+				{
+					if (const int32 NumChunkEntities = Archetype.GetNumEntitiesInChunk(ChunkIndex))
+					{
+						uint8* ChunkMemory = const_cast<uint8*>(Archetype.GetChunkRawMemory(ChunkIndex));
+						if (FragmentConfig.IsSplit())
+						{
+							// split fragments get stored as whole instances, so that loading doesn't depend on the chunk layout
+							SplitFragmentBuffer.SetNumUninitialized(NumChunkEntities * Type.GetStructureSize(), /*bAllowShrinking=*/false);
+							FragmentConfig.CopyElementsTo(SplitFragmentBuffer.GetData(), ChunkMemory, 0, NumChunkEntities);
+							Ar.Serialize(SplitFragmentBuffer.GetData(), SplitFragmentBuffer.Num());
+						}
+						else
+						{
+							Ar.Serialize(FragmentConfig.GetFragmentData(ChunkMemory, 0), NumChunkEntities * Type.GetStructureSize());
+						}
+					}
+				}
+			}
+			else
+			{
+				WriteSerializedColumn(Ar, Type, [&Archetype, &FragmentConfig, &Type](TFunctionRef<void(const void*)> Function)
+					{
+						for (int32 ChunkIndex = 0; ChunkIndex < Archetype.GetChunkCount(); ++ChunkIndex)
+						{
+							uint8* ChunkMemory = const_cast<uint8*>(Archetype.GetChunkRawMemory(ChunkIndex));
+							for (int32 IndexWithinChunk = 0; IndexWithinChunk < Archetype.GetNumEntitiesInChunk(ChunkIndex); ++IndexWithinChunk)
+							{
+								Function(FragmentConfig.GetFragmentData(ChunkMemory, IndexWithinChunk));
+							}
+						}
+					});
+			}
+		}
+	}
+}
+
+bool UMassEntitySubsystem::SaveSnapshotToFile(const FString& Filename) const
+{
+	TUniquePtr<FArchive> FileWriter(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!FileWriter)
+	{
+		UE_LOG(LogMass, Error, TEXT("Failed to open %s for writing the entity snapshot"), *Filename);
+		return false;
+	}
+	SaveSnapshot(*FileWriter);
+	return FileWriter->Close();
+}
+
+bool UMassEntitySubsystem::LoadSnapshot(TConstArrayView<uint8> SnapshotData, TMap<FMassEntityHandle, FMassEntityHandle>* OutEntityMapping)
+{
+	using namespace UE::Mass::Snapshot;
+	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
+
+	FMemoryReaderView Reader(SnapshotData);
+
+	// header
+	uint32 SnapshotMagic = 0;
+	int32 Version = 0;
+	Reader << SnapshotMagic << Version;
+	if (Reader.IsError() || SnapshotMagic != Magic || Version <= 0 || Version > int32(EVersion::Latest))
+	{
+		UE_LOG(LogMass, Error, TEXT("%s: not an entity snapshot or a version that is not supported (%d)"), ANSI_TO_TCHAR(__FUNCTION__), Version);
+		return false;
+	}
+
+	// types
+	struct FTypeRecord
+	{
+		const UScriptStruct* Type = nullptr;
+		bool bRaw = false;
+		bool bContainsEntityHandles = false;
+	};
+	TArray<FTypeRecord> Types;
+	int32 NumTypes = 0;
+	Reader << NumTypes;
+	for (int32 TypeIndex = 0; TypeIndex < NumTypes && Reader.IsError() == false; ++TypeIndex)
+	{
+		FString Path;
+		int32 Size = 0;
+		uint8 bRaw = 0;
+		Reader << Path << Size << bRaw;
+		if (Reader.IsError())
+		{
+			break;
+		}
+
+		const UScriptStruct* Type = FindObject<UScriptStruct>(nullptr, *Path);
+		if (Type == nullptr)
+		{
+			Type = LoadObject<UScriptStruct>(nullptr, *Path, nullptr, LOAD_NoWarn);
+		}
+		if (Type == nullptr)
+		{
+			UE_LOG(LogMass, Error, TEXT("%s: failed to find type %s"), ANSI_TO_TCHAR(__FUNCTION__), *Path);
+			return false;
+		}
+		if (bRaw && (Type->GetStructureSize() != Size || IsRawSerializable(*Type) == false))
+		{
+			UE_LOG(LogMass, Error, TEXT("%s: the layout of %s has changed since the snapshot has been saved"), ANSI_TO_TCHAR(__FUNCTION__), *Path);
+			return false;
+		}
+
+		TSet<const UStruct*> VisitedStructs;
+		Types.Add({Type, bRaw != 0, ContainsEntityHandles(*Type, VisitedStructs)});
+	}
+
+	auto AreTypesValid = [&Types](TConstArrayView<int32> TypeIndices, const UScriptStruct* BaseType)
+	{
+		return AreIndicesValid(TypeIndices, Types.Num())
+			&& Algo::AllOf(TypeIndices, [&Types, BaseType](const int32 TypeIndex) { return Types[TypeIndex].Type->IsChildOf(BaseType); });
+	};
+
+	// shared fragment values
+	struct FSharedValueRecord
+	{
+		FSharedStruct Value;
+		/** The already registered value to use in place of Value, for the const shared values */
+		FConstSharedStruct ConstValue;
+		uint32 Hash = 0;
+		bool bConst = true;
+		bool bHashed = false;
+	};
+	TArray<FSharedValueRecord> SharedValues;
+	int32 NumSharedValues = 0;
+	Reader << NumSharedValues;
+	for (int32 ValueIndex = 0; ValueIndex < NumSharedValues && Reader.IsError() == false; ++ValueIndex)
+	{
+		int32 TypeIndex = INDEX_NONE;
+		uint8 bConst = 0;
+		uint8 bHashed = 0;
+		uint32 Hash = 0;
+		Reader << TypeIndex << bConst << bHashed << Hash;
+		const TConstArrayView<uint8> ValueData = ReadColumn(Reader, SnapshotData);
+		if (Reader.IsError() || AreTypesValid(MakeArrayView(&TypeIndex, 1), FMassSharedFragment::StaticStruct()) == false
+			|| (Types[TypeIndex].bRaw && ValueData.Num() != Types[TypeIndex].Type->GetStructureSize()))
+		{
+			Reader.SetError();
+			break;
+		}
+
+		FSharedValueRecord& Record = SharedValues.AddDefaulted_GetRef();
+		Record.Value = FSharedStruct(Types[TypeIndex].Type);
+		Record.Hash = Hash;
+		Record.bConst = bConst != 0;
+		Record.bHashed = bHashed != 0;
+
+		if (Types[TypeIndex].bRaw)
+		{
+			FMemory::Memcpy(Record.Value.GetMutableMemory(), ValueData.GetData(), ValueData.Num());
+		}
+		else
+		{
+			FMemoryReaderView ValueReader(ValueData);
+			FObjectAndNameAsStringProxyArchive Proxy(ValueReader, /*bInLoadIfFindFails=*/true);
+			Types[TypeIndex].Type->SerializeItem(Proxy, Record.Value.GetMutableMemory(), /*Defaults=*/nullptr);
+		}
+	}
+
+	// archetypes
+	struct FArchetypeRecord
+	{
+		TArray<int32> FragmentTypes;
+		TArray<int32> TagTypes;
+		TArray<int32> ChunkFragmentTypes;
+		TArray<int32> ConstSharedValues;
+		TArray<int32> SharedValues;
+		TArray<FMassEntityHandle> Entities;
+		TArray<TConstArrayView<uint8>> Columns;
+	};
+	TArray<FArchetypeRecord> Archetypes;
+	int32 NumArchetypes = 0;
+	int32 NumEntitiesTotal = 0;
+	Reader << NumArchetypes;
+	for (int32 ArchetypeIndex = 0; ArchetypeIndex < NumArchetypes && Reader.IsError() == false; ++ArchetypeIndex)
+	{
+		FArchetypeRecord& Record = Archetypes.AddDefaulted_GetRef();
+		Reader << Record.FragmentTypes << Record.TagTypes << Record.ChunkFragmentTypes << Record.ConstSharedValues << Record.SharedValues;
+
+		int32 NumArchetypeEntities = 0;
+		Reader << NumArchetypeEntities;
+		if (Reader.IsError() || NumArchetypeEntities < 0 || Reader.Tell() + int64(NumArchetypeEntities) * sizeof(FMassEntityHandle) > SnapshotData.Num()
+			|| AreTypesValid(Record.FragmentTypes, FMassFragment::StaticStruct()) == false
+			|| AreTypesValid(Record.TagTypes, FMassTag::StaticStruct()) == false
+			|| AreTypesValid(Record.ChunkFragmentTypes, FMassChunkFragment::StaticStruct()) == false
+			|| AreIndicesValid(Record.ConstSharedValues, SharedValues.Num()) == false
+			|| AreIndicesValid(Record.SharedValues, SharedValues.Num()) == false)
+		{
+			Reader.SetError();
+			break;
+		}
+		Record.Entities.AddUninitialized(NumArchetypeEntities);
+		Reader.Serialize(Record.Entities.GetData(), NumArchetypeEntities * sizeof(FMassEntityHandle));
+		NumEntitiesTotal += NumArchetypeEntities;
+	}
+
+	// columns, only validated at this point so that nothing gets created if the snapshot is not complete
+	for (int32 ArchetypeIndex = 0; ArchetypeIndex < Archetypes.Num() && Reader.IsError() == false; ++ArchetypeIndex)
+	{
+		FArchetypeRecord& Record = Archetypes[ArchetypeIndex];
+		for (const int32 TypeIndex : Record.FragmentTypes)
+		{
+			const TConstArrayView<uint8> Column = ReadColumn(Reader, SnapshotData);
+			if (Reader.IsError() || (Types[TypeIndex].bRaw && Column.Num() != Record.Entities.Num() * Types[TypeIndex].Type->GetStructureSize()))
+			{
+				Reader.SetError();
+				break;
+			}
+			Record.Columns.Add(Column);
+		}
+	}
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogMass, Error, TEXT("%s: the snapshot data is corrupted or incomplete"), ANSI_TO_TCHAR(__FUNCTION__));
+		return false;
+	}
+
+	// registering the shared fragment values, reusing the already existing ones
+	for (FSharedValueRecord& Record : SharedValues)
+	{
+		if (Record.bHashed == false)
+		{
+			continue;
+		}
+		if (Record.bConst)
+		{
+			int32& Index = ConstSharedFragmentsMap.FindOrAddByHash(Record.Hash, Record.Hash, INDEX_NONE);
+			if (Index == INDEX_NONE)
+			{
+				Index = ConstSharedFragments.Add(Record.Value);
+			}
+			Record.ConstValue = ConstSharedFragments[Index];
+		}
+		else
+		{
+			int32& Index = SharedFragmentsMap.FindOrAddByHash(Record.Hash, Record.Hash, INDEX_NONE);
+			if (Index == INDEX_NONE)
+			{
+				Index = SharedFragments.Add(Record.Value);
+			}
+			Record.Value = SharedFragments[Index];
+		}
+	}
+
+	// reserving all the entities up front, for the mapping to be complete before any fragments get remapped
+	TArray<FMassEntityHandle> NewEntities;
+	NewEntities.AddUninitialized(NumEntitiesTotal);
+	InternalReserveEntities(NewEntities);
+
+	FEntityMapping EntityMapping;
+	EntityMapping.Reserve(NumEntitiesTotal);
+	{
+		int32 NewEntityIndex = 0;
+		for (const FArchetypeRecord& Record : Archetypes)
+		{
+			for (const FMassEntityHandle& Entity : Record.Entities)
+			{
+				EntityMapping.Add(Entity, NewEntities[NewEntityIndex++]);
+			}
+		}
+	}
+
+	int32 FirstNewEntity = 0;
+	for (const FArchetypeRecord& Record : Archetypes)
+	{
+		FMassArchetypeCompositionDescriptor Composition;
+		for (const int32 TypeIndex : Record.FragmentTypes)
+		{
+			Composition.Fragments.Add(*Types[TypeIndex].Type);
+		}
+		for (const int32 TypeIndex : Record.TagTypes)
+		{
+			Composition.Tags.Add(*Types[TypeIndex].Type);
+		}
+		for (const int32 TypeIndex : Record.ChunkFragmentTypes)
+		{
+			Composition.ChunkFragments.Add(*Types[TypeIndex].Type);
+		}
+
+		FMassArchetypeSharedFragmentValues SharedFragmentValues;
+		for (const int32 ValueIndex : Record.ConstSharedValues)
+		{
+			const FSharedValueRecord& SharedValue = SharedValues[ValueIndex];
+			const FConstSharedStruct& Value = SharedValue.ConstValue.IsValid() ? SharedValue.ConstValue : FConstSharedStruct(SharedValue.Value);
+			Composition.SharedFragments.Add(*Value.GetScriptStruct());
+			SharedFragmentValues.AddConstSharedFragment(Value);
+		}
+		for (const int32 ValueIndex : Record.SharedValues)
+		{
+			Composition.SharedFragments.Add(*SharedValues[ValueIndex].Value.GetScriptStruct());
+			SharedFragmentValues.AddSharedFragment(SharedValues[ValueIndex].Value);
+		}
+		SharedFragmentValues.Sort();
+
+		const FArchetypeHandle ArchetypeHandle = CreateArchetype(Composition, SharedFragmentValues);
+		FMassArchetypeData& Archetype = *ArchetypeHandle.DataPtr;
+		if (Record.Entities.Num() == 0)
+		{
+			continue;
+		}
+
+		const TArrayView<FMassEntityHandle> ArchetypeEntities = MakeArrayView(&NewEntities[FirstNewEntity], Record.Entities.Num());
+		FirstNewEntity += Record.Entities.Num();
+		for (const FMassEntityHandle& Entity : ArchetypeEntities)
+		{
+			Entities[Entity.Index].CurrentArchetype = ArchetypeHandle.DataPtr;
+		}
+
+		// raw columns get copied straight from the snapshot data into the chunks, the rest get default-initialized first
+		TArray<FMassFragmentInitialValues, TInlineAllocator<16>> InitialValues;
+		for (int32 FragmentIndex = 0; FragmentIndex < Record.FragmentTypes.Num(); ++FragmentIndex)
+		{
+			const FTypeRecord& TypeRecord = Types[Record.FragmentTypes[FragmentIndex]];
+			if (TypeRecord.bRaw)
+			{
+				InitialValues.Add(FMassFragmentInitialValues(TypeRecord.Type, Record.Columns[FragmentIndex].GetData(), ArchetypeEntities.Num()));
+			}
+		}
+		Archetype.BatchAddEntities(ArchetypeEntities, InitialValues);
+
+		for (int32 FragmentIndex = 0; FragmentIndex < Record.FragmentTypes.Num(); ++FragmentIndex)
+		{
+			const FTypeRecord& TypeRecord = Types[Record.FragmentTypes[FragmentIndex]];
+			if (TypeRecord.bRaw && TypeRecord.bContainsEntityHandles == false)
+			{
+				continue;
+			}
+
+			TOptional<FMemoryReaderView> ColumnReader;
+			TOptional<FObjectAndNameAsStringProxyArchive> Proxy;
+			if (TypeRecord.bRaw == false)
+			{
+				ColumnReader.Emplace(Record.Columns[FragmentIndex]);
+				Proxy.Emplace(*ColumnReader, /*bInLoadIfFindFails=*/true);
+			}
+
+			for (const FMassEntityHandle& Entity : ArchetypeEntities)
+			{
+				void* FragmentData = Archetype.GetFragmentDataForEntityChecked(TypeRecord.Type, Entity.Index);
+				if (Proxy)
+				{
+					TypeRecord.Type->SerializeItem(*Proxy, FragmentData, /*Defaults=*/nullptr);
+				}
+				if (TypeRecord.bContainsEntityHandles)
+				{
+					RemapEntityHandles(*TypeRecord.Type, FragmentData, EntityMapping);
+				}
+			}
+		}
+	}
+
+	if (OutEntityMapping)
+	{
+		*OutEntityMapping = MoveTemp(EntityMapping);
+	}
+
+	return true;
+}
+
+bool UMassEntitySubsystem::LoadSnapshotFromFile(const FString& Filename, TMap<FMassEntityHandle, FMassEntityHandle>* OutEntityMapping)
+{
+	// note that the region needs to be released before the file handle, hence the declaration order
+	TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+	TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile ? MappedFile->MapRegion() : nullptr);
+	if (MappedRegion)
+	{
+		if (MappedRegion->GetMappedSize() > MAX_int32)
+		{
+			UE_LOG(LogMass, Error, TEXT("%s: %s is too big to be an entity snapshot"), ANSI_TO_TCHAR(__FUNCTION__), *Filename);
+			return false;
+		}
+		return LoadSnapshot(MakeArrayView(MappedRegion->GetMappedPtr(), int32(MappedRegion->GetMappedSize())), OutEntityMapping);
+	}
+
+	TArray<uint8> SnapshotData;
+	if (FFileHelper::LoadFileToArray(SnapshotData, *Filename) == false)
+	{
+		UE_LOG(LogMass, Error, TEXT("%s: failed to read %s"), ANSI_TO_TCHAR(__FUNCTION__), *Filename);
+		return false;
+	}
+	return LoadSnapshot(SnapshotData, OutEntityMapping);
+}
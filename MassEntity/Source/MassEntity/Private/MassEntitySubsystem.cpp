@@ -3,7 +3,11 @@
 #include "MassEntitySubsystem.h"
 #include "MassArchetypeData.h"
 #include "MassCommandBuffer.h"
+#include "MassChunkMemoryPool.h"
+#include "MassEntityReservationPool.h"
+#include "MassEntitySettings.h"
 #include "HAL/IConsoleManager.h"
+#include "Async/ParallelFor.h"
 #include "Engine/World.h"
 #include "UObject/UObjectIterator.h"
 
@@ -30,7 +34,9 @@ void UMassEntitySubsystem::GetResourceSizeEx(FResourceSizeEx& CumulativeResource
 		EntityFreeIndexList.GetAllocatedSize() +
 		DeferredCommandBuffer->GetAllocatedSize() +
 		FragmentHashToArchetypeMap.GetAllocatedSize() +
-		FragmentTypeToArchetypeMap.GetAllocatedSize();
+		AllArchetypes.GetAllocatedSize() +
+		FragmentTypeToArchetypeMap.GetAllocatedSize() +
+		ChunkMemoryPool->GetAllocatedSize();
 	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(MyExtraSize);
 
 	for (const auto& KVP : FragmentHashToArchetypeMap)
@@ -49,6 +55,8 @@ void UMassEntitySubsystem::Initialize(FSubsystemCollectionBase& Collection)
 	SerialNumberGenerator.fetch_add(FMath::Max(1,NumReservedEntities));
 
 	DeferredCommandBuffer = MakeShareable(new FMassCommandBuffer());
+	ChunkMemoryPool = MakeShareable(new FMassChunkMemoryPool(GET_MASS_CONFIG_VALUE(bPoolChunkMemory), GET_MASS_CONFIG_VALUE(MaxPooledChunkMemory)));
+	ReservationPool = MakeShareable(new FMassEntityReservationPool(GET_MASS_CONFIG_VALUE(ConcurrentEntityReservationPoolSize)));
 
 	// initialize the bitsets
 
@@ -147,9 +155,10 @@ FArchetypeHandle UMassEntitySubsystem::CreateArchetype(const FMassArchetypeCompo
 	if (!Result.DataPtr.IsValid())
 	{
 		// Create a new archetype
-		const TSharedPtr<FMassArchetypeData> NewArchetype = MakeShareable(new FMassArchetypeData);
+		const TSharedPtr<FMassArchetypeData> NewArchetype = MakeShareable(new FMassArchetypeData(Entities, ChunkMemoryPool.ToSharedRef()));
 		NewArchetype->Initialize(Composition, SharedFragmentValues);
 		HashRow.Add(NewArchetype);
+		AllArchetypes.Add(NewArchetype);
 
 		for (const FMassArchetypeFragmentConfig& FragmentConfig : NewArchetype->GetFragmentConfigs())
 		{
@@ -187,9 +196,10 @@ FArchetypeHandle UMassEntitySubsystem::InternalCreateSiblingArchetype(const TSha
 	if (!Result.DataPtr.IsValid())
 	{
 		// Create a new archetype
-		const TSharedPtr<FMassArchetypeData> NewArchetype = MakeShareable(new FMassArchetypeData);
+		const TSharedPtr<FMassArchetypeData> NewArchetype = MakeShareable(new FMassArchetypeData(Entities, ChunkMemoryPool.ToSharedRef()));
 		NewArchetype->InitializeWithSibling(SourceArchetypeRef, OverrideTags);
 		HashRow.Add(NewArchetype);
+		AllArchetypes.Add(NewArchetype);
 
 		for (const FMassArchetypeFragmentConfig& FragmentConfig : NewArchetype->GetFragmentConfigs())
 		{
@@ -205,6 +215,54 @@ FArchetypeHandle UMassEntitySubsystem::InternalCreateSiblingArchetype(const TSha
 	return MoveTemp(Result);
 }
 
+TSharedPtr<FMassArchetypeData> UMassEntitySubsystem::InternalGetTransitionArchetype(const TSharedPtr<FMassArchetypeData>& SourceArchetype, const EMassArchetypeTransition Operation, const UScriptStruct* StructType)
+{
+	check(SourceArchetype.IsValid());
+	check(StructType);
+
+	if (TSharedPtr<FMassArchetypeData> CachedArchetype = SourceArchetype->FindTransition(Operation, StructType))
+	{
+		return CachedArchetype;
+	}
+
+	const FMassArchetypeData& SourceArchetypeRef = *SourceArchetype.Get();
+	FArchetypeHandle Result;
+	switch (Operation)
+	{
+	case EMassArchetypeTransition::AddTag:
+		{
+			FMassTagBitSet NewTags = SourceArchetypeRef.GetTagBitSet();
+			NewTags.Add(*StructType);
+			Result = InternalCreateSiblingArchetype(SourceArchetype, NewTags);
+		}
+		break;
+	case EMassArchetypeTransition::RemoveTag:
+		{
+			FMassTagBitSet NewTags = SourceArchetypeRef.GetTagBitSet();
+			NewTags.Remove(*StructType);
+			Result = InternalCreateSiblingArchetype(SourceArchetype, NewTags);
+		}
+		break;
+	case EMassArchetypeTransition::AddFragment:
+		Result = CreateArchetype(SourceArchetype, FMassFragmentBitSet(*StructType));
+		break;
+	case EMassArchetypeTransition::RemoveFragment:
+		{
+			const FMassArchetypeCompositionDescriptor NewComposition(SourceArchetypeRef.GetFragmentBitSet() - FMassFragmentBitSet(*StructType), SourceArchetypeRef.GetTagBitSet(), SourceArchetypeRef.GetChunkFragmentBitSet(), SourceArchetypeRef.GetSharedFragmentBitSet());
+			Result = CreateArchetype(NewComposition, SourceArchetypeRef.GetSharedFragmentValues());
+		}
+		break;
+	default:
+		checkNoEntry();
+		break;
+	}
+
+	checkSlow(Result.IsValid());
+	SourceArchetype->CacheTransition(Operation, StructType, Result.DataPtr);
+
+	return Result.DataPtr;
+}
+
 FArchetypeHandle UMassEntitySubsystem::GetArchetypeForEntity(FMassEntityHandle Entity) const
 {
 	FArchetypeHandle Result;
@@ -222,28 +280,66 @@ void UMassEntitySubsystem::ForEachArchetypeFragmentType(const FArchetypeHandle A
 	ArchetypeData.ForEachFragmentType(Function);
 }
 
-void UMassEntitySubsystem::DoEntityCompaction(const double TimeAllowed)
+bool UMassEntitySubsystem::DoEntityCompaction(const double TimeAllowed)
 {
-	const double TimeAllowedEnd = FPlatformTime::Seconds() + TimeAllowed;
+	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
 
-	bool bReachedTimeLimit = false;
-	for (const auto& KVP : FragmentHashToArchetypeMap)
+	const double TimeAllowedEnd = FPlatformTime::Seconds() + TimeAllowed;
+	const float OccupancyThreshold = GET_MASS_CONFIG_VALUE(CompactionOccupancyThreshold);
+	const int32 MinPartialChunks = GET_MASS_CONFIG_VALUE(CompactionMinPartialChunks);
+
+	// Starting with the archetype the previous call ran out of time on, so that with a tight time budget all the 
+	// archetypes get their turn.
+	TArray<FMassArchetypeData*> ArchetypesToCompact;
+	TArray<int32> ArchetypeIndices;
+	for (int32 i = 0; i < AllArchetypes.Num(); ++i)
 	{
-		for (const TSharedPtr<FMassArchetypeData>& ArchetypePtr : KVP.Value)
-		{
-			const double TimeAllowedLeft = TimeAllowedEnd - FPlatformTime::Seconds();
-			bReachedTimeLimit = TimeAllowedLeft <= 0.0;
-			if (bReachedTimeLimit)
-			{
-				break;
-			}
-			ArchetypePtr->CompactEntities(TimeAllowedLeft);
-		}
-		if (bReachedTimeLimit)
+		const int32 ArchetypeIndex = (CompactionArchetypeCursor + i) % AllArchetypes.Num();
+		const FMassArchetypeFragmentationInfo FragmentationInfo = AllArchetypes[ArchetypeIndex]->GetFragmentationInfo();
+		if (FragmentationInfo.NumPartialChunks >= MinPartialChunks && FragmentationInfo.GetOccupancy() < OccupancyThreshold)
 		{
-			break;
+			ArchetypesToCompact.Add(AllArchetypes[ArchetypeIndex].Get());
+			ArchetypeIndices.Add(ArchetypeIndex);
 		}
 	}
+
+	// Archetypes don't share any data besides the entity data table (every entity in it belonging to just one archetype)
+	// and the thread-safe chunk memory pool, so they can be safely compacted in parallel.
+	TArray<bool> Completed;
+	Completed.SetNumZeroed(ArchetypesToCompact.Num());
+	ParallelFor(ArchetypesToCompact.Num(), [&ArchetypesToCompact, &Completed, TimeAllowedEnd](const int32 Index)
+	{
+		const double TimeAllowedLeft = TimeAllowedEnd - FPlatformTime::Seconds();
+		Completed[Index] = TimeAllowedLeft > 0.0 && ArchetypesToCompact[Index]->CompactEntities(TimeAllowedLeft);
+	}, GET_MASS_CONFIG_VALUE(bParallelEntityCompaction) ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+	const int32 FirstIncompleteIndex = Completed.Find(false);
+	if (FirstIncompleteIndex != INDEX_NONE)
+	{
+		CompactionArchetypeCursor = ArchetypeIndices[FirstIncompleteIndex];
+	}
+
+	TrimChunkMemory();
+
+	return FirstIncompleteIndex == INDEX_NONE;
+}
+
+FMassArchetypeFragmentationInfo UMassEntitySubsystem::GetArchetypeFragmentationInfo(const FArchetypeHandle& Archetype) const
+{
+	check(Archetype.DataPtr.IsValid());
+	return Archetype.DataPtr->GetFragmentationInfo();
+}
+
+void UMassEntitySubsystem::TrimChunkMemory()
+{
+	check(ChunkMemoryPool);
+	ChunkMemoryPool->Trim();
+}
+
+FMassChunkMemoryStats UMassEntitySubsystem::GetChunkMemoryStats() const
+{
+	check(ChunkMemoryPool);
+	return ChunkMemoryPool->GetStats();
 }
 
 FMassEntityHandle UMassEntitySubsystem::CreateEntity(const FArchetypeHandle Archetype)
@@ -273,7 +369,7 @@ FMassEntityHandle UMassEntitySubsystem::CreateEntity(TConstArrayView<FInstancedS
 
 FMassEntityHandle UMassEntitySubsystem::ReserveEntity()
 {
-	// @todo: Need to add thread safety to the reservation of an entity
+	// not thread-safe, see ConcurrentReserveEntity
 	FMassEntityHandle Result;
 	Result.Index = (EntityFreeIndexList.Num() > 0) ? EntityFreeIndexList.Pop(/*bAllowShrinking=*/ false) : Entities.Add();
 	Result.SerialNumber = SerialNumberGenerator.fetch_add(1);
@@ -282,6 +378,43 @@ FMassEntityHandle UMassEntitySubsystem::ReserveEntity()
 	return Result;
 }
 
+FMassEntityHandle UMassEntitySubsystem::ConcurrentReserveEntity()
+{
+	TArray<FMassEntityHandle, TInlineAllocator<1>> Result;
+	return ConcurrentReserveEntities(1, Result) ? Result[0] : FMassEntityHandle();
+}
+
+bool UMassEntitySubsystem::ConcurrentReserveEntities(const int32 Count, TArray<FMassEntityHandle>& OutEntities)
+{
+	check(ReservationPool);
+	return ReservationPool->TryAcquire(Count, OutEntities);
+}
+
+int32 UMassEntitySubsystem::GetNumConcurrentReservationsAvailable() const
+{
+	check(ReservationPool);
+	return ReservationPool->GetNumAvailable();
+}
+
+int32 UMassEntitySubsystem::ReplenishConcurrentReservations()
+{
+	check(IsInGameThread());
+	check(ReservationPool);
+
+	const int32 NumToReserve = ReservationPool->GetNumFreeSlots();
+	if (NumToReserve <= 0)
+	{
+		return 0;
+	}
+
+	TArray<FMassEntityHandle> NewEntities;
+	NewEntities.AddUninitialized(NumToReserve);
+	InternalReserveEntities(NewEntities);
+	ReservationPool->Publish(NewEntities);
+
+	return NumToReserve;
+}
+
 void UMassEntitySubsystem::ReleaseReservedEntity(FMassEntityHandle Entity)
 {
 	checkf(!IsEntityBuilt(Entity), TEXT("Entity is already built, use DestroyEntity() instead"));
@@ -323,28 +456,24 @@ void UMassEntitySubsystem::BuildEntity(FMassEntityHandle Entity, TConstArrayView
 	EntityData.CurrentArchetype->SetFragmentsData(Entity, FragmentInstanceList);
 }
 
-TSharedRef<UMassEntitySubsystem::FEntityCreationContext> UMassEntitySubsystem::BatchCreateEntities(const FArchetypeHandle Archetype, const int32 Count, TArray<FMassEntityHandle>& OutEntities)
+TSharedRef<UMassEntitySubsystem::FEntityCreationContext> UMassEntitySubsystem::BatchCreateEntities(const FArchetypeHandle Archetype, const int32 Count, TArray<FMassEntityHandle>& OutEntities, TConstArrayView<FMassFragmentInitialValues> InitialValues)
 {
 	FMassArchetypeData* ArchetypePtr = Archetype.DataPtr.Get();
 	check(ArchetypePtr);
 	check(Count > 0);
 	
-	int32 Index = OutEntities.Num();
-	OutEntities.AddDefaulted(Count);
+	const int32 FirstIndex = OutEntities.Num();
+	OutEntities.AddUninitialized(Count);
+	TArrayView<FMassEntityHandle> NewEntities = MakeArrayView(&OutEntities[FirstIndex], Count);
 
-	// @todo optimize
-	for (; Index < OutEntities.Num(); ++Index)
+	// reserving all the indices at one go
+	InternalReserveEntities(NewEntities);
+	for (const FMassEntityHandle& Entity : NewEntities)
 	{
-		FMassEntityHandle& Result = OutEntities[Index];
-		Result.Index = (EntityFreeIndexList.Num() > 0) ? EntityFreeIndexList.Pop(/*bAllowShrinking=*/ false) : Entities.Add();
-		Result.SerialNumber = SerialNumberGenerator++;
-
-		FEntityData& EntityData = Entities[Result.Index];
-		EntityData.CurrentArchetype = Archetype.DataPtr;
-		EntityData.SerialNumber = Result.SerialNumber;
-		
-		ArchetypePtr->AddEntity(Result);
+		Entities[Entity.Index].CurrentArchetype = Archetype.DataPtr;
 	}
+
+	ArchetypePtr->BatchAddEntities(NewEntities, InitialValues);
 		
 	FEntityCreationContext* CreationContext = new FEntityCreationContext(Count);
 	// @todo this could probably be optimized since one would assume we're adding elements to OutEntities in order.
@@ -385,9 +514,8 @@ void UMassEntitySubsystem::BatchDestroyEntities(TConstArrayView<FMassEntityHandl
 
 	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
 	
-	EntityFreeIndexList.Reserve(EntityFreeIndexList.Num() + InEntities.Num());
-
-	// @todo optimize, we can make savings by implementing Archetype->RemoveEntities()
+	// grouping the valid entities per archetype so that every archetype can remove all of its entities at one go
+	TMap<FArchetypeHandle, TArray<FMassEntityHandle>> ArchetypeToEntities;
 	for (const FMassEntityHandle Entity : InEntities)
 	{
 		if (Entities.IsValidIndex(Entity.Index) == false)
@@ -395,17 +523,30 @@ void UMassEntitySubsystem::BatchDestroyEntities(TConstArrayView<FMassEntityHandl
 			continue;
 		}
 
-		FEntityData& EntityData = Entities[Entity.Index];
+		const FEntityData& EntityData = Entities[Entity.Index];
 		if (EntityData.SerialNumber != Entity.SerialNumber)
 		{
 			continue;
 		}
 
-		FMassArchetypeData* Archetype = EntityData.CurrentArchetype.Get();
-		check(Archetype);
-		Archetype->RemoveEntity(Entity);
+		check(EntityData.CurrentArchetype.IsValid());
+		ArchetypeToEntities.FindOrAdd(FArchetypeHandle(EntityData.CurrentArchetype)).Add(Entity);
+	}
 
-		EntityData.Reset();
+	TArray<FMassEntityHandle> EntitiesRemoved;
+	EntitiesRemoved.Reserve(InEntities.Num());
+	for (const TPair<FArchetypeHandle, TArray<FMassEntityHandle>>& Pair : ArchetypeToEntities)
+	{
+		// the chunk collection sorts the entities by their absolute index and folds the duplicates, which lets the
+		// archetype remove the entities subchunk by subchunk, filling the holes with entities from the chunks' tails
+		const FArchetypeChunkCollection ChunkCollection(Pair.Key, Pair.Value, FArchetypeChunkCollection::FoldDuplicates);
+		Pair.Key.DataPtr->BatchDestroyEntityChunks(ChunkCollection, EntitiesRemoved);
+	}
+
+	EntityFreeIndexList.Reserve(EntityFreeIndexList.Num() + EntitiesRemoved.Num());
+	for (const FMassEntityHandle& Entity : EntitiesRemoved)
+	{
+		Entities[Entity.Index].Reset();
 		EntityFreeIndexList.Add(Entity.Index);
 	}
 }
@@ -449,7 +590,22 @@ void UMassEntitySubsystem::AddFragmentToEntity(FMassEntityHandle Entity, const U
 
 	CheckIfEntityIsActive(Entity);
 
-	InternalAddFragmentListToEntityChecked(Entity, FMassFragmentBitSet(*FragmentType));
+	FEntityData& EntityData = Entities[Entity.Index];
+	check(EntityData.CurrentArchetype.IsValid());
+
+	if (EntityData.CurrentArchetype->HasFragmentType(FragmentType))
+	{
+		UE_LOG(LogMass, Log, TEXT("Trying to add a new fragment type to an entity, but it already has it. (%s)")
+			, *FragmentType->GetName());
+		return;
+	}
+
+	const TSharedPtr<FMassArchetypeData> NewArchetype = InternalGetTransitionArchetype(EntityData.CurrentArchetype, EMassArchetypeTransition::AddFragment, FragmentType);
+	check(NewArchetype.IsValid());
+
+	// Move the entity over
+	EntityData.CurrentArchetype->MoveEntityToAnotherArchetype(Entity, *NewArchetype.Get());
+	EntityData.CurrentArchetype = NewArchetype;
 }
 
 void UMassEntitySubsystem::AddFragmentListToEntity(FMassEntityHandle Entity, TConstArrayView<const UScriptStruct*> FragmentList)
@@ -534,6 +690,11 @@ const FMassArchetypeCompositionDescriptor& UMassEntitySubsystem::GetArchetypeCom
 	return ArchetypeHandle.DataPtr->GetCompositionDescriptor();
 }
 
+const FMassArchetypeSharedFragmentValues& UMassEntitySubsystem::GetArchetypeSharedFragmentValues(const FArchetypeHandle& ArchetypeHandle) const
+{
+	return ArchetypeHandle.DataPtr->GetSharedFragmentValues();
+}
+
 void UMassEntitySubsystem::InternalBuildEntity(FMassEntityHandle Entity, const FArchetypeHandle Archetype)
 {
 	FEntityData& EntityData = Entities[Entity.Index];
@@ -541,6 +702,34 @@ void UMassEntitySubsystem::InternalBuildEntity(FMassEntityHandle Entity, const F
 	EntityData.CurrentArchetype->AddEntity(Entity);
 }
 
+void UMassEntitySubsystem::InternalReserveEntities(TArrayView<FMassEntityHandle> OutEntities)
+{
+	const int32 Count = OutEntities.Num();
+	const int32 NumReused = FMath::Min(Count, EntityFreeIndexList.Num());
+	for (int32 i = 0; i < NumReused; ++i)
+	{
+		OutEntities[i].Index = EntityFreeIndexList[EntityFreeIndexList.Num() - 1 - i];
+	}
+	EntityFreeIndexList.RemoveAt(EntityFreeIndexList.Num() - NumReused, NumReused, /*bAllowShrinking=*/false);
+
+	const int32 NumAdded = Count - NumReused;
+	if (NumAdded > 0)
+	{
+		const int32 FirstAddedIndex = Entities.Add(NumAdded);
+		for (int32 i = 0; i < NumAdded; ++i)
+		{
+			OutEntities[NumReused + i].Index = FirstAddedIndex + i;
+		}
+	}
+
+	const int32 FirstSerialNumber = SerialNumberGenerator.fetch_add(Count);
+	for (int32 i = 0; i < Count; ++i)
+	{
+		OutEntities[i].SerialNumber = FirstSerialNumber + i;
+		Entities[OutEntities[i].Index].SerialNumber = OutEntities[i].SerialNumber;
+	}
+}
+
 void UMassEntitySubsystem::InternalReleaseEntity(FMassEntityHandle Entity)
 {
 	FEntityData& EntityData = Entities[Entity.Index];
@@ -585,6 +774,29 @@ void UMassEntitySubsystem::InternalAddFragmentListToEntity(FMassEntityHandle Ent
 	}
 }
 
+void UMassEntitySubsystem::InternalBatchMoveEntities(const FArchetypeChunkCollection& EntityCollection, const TSharedPtr<FMassArchetypeData>& NewArchetype)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("BatchMoveEntities");
+
+	FMassArchetypeData* OldArchetype = EntityCollection.GetArchetype().DataPtr.Get();
+	check(OldArchetype);
+	check(NewArchetype.IsValid());
+
+	if (OldArchetype == NewArchetype.Get())
+	{
+		return;
+	}
+
+	TArray<FMassEntityHandle> EntitiesMoved;
+	OldArchetype->BatchMoveEntitiesToAnotherArchetype(EntityCollection, *NewArchetype.Get(), EntitiesMoved);
+
+	for (const FMassEntityHandle& Entity : EntitiesMoved)
+	{
+		check(Entities.IsValidIndex(Entity.Index));
+		Entities[Entity.Index].CurrentArchetype = NewArchetype;
+	}
+}
+
 void UMassEntitySubsystem::AddFragmentInstanceListToEntity(FMassEntityHandle Entity, TConstArrayView<FInstancedStruct> FragmentInstanceList)
 {
 	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
@@ -600,7 +812,24 @@ void UMassEntitySubsystem::AddFragmentInstanceListToEntity(FMassEntityHandle Ent
 
 void UMassEntitySubsystem::RemoveFragmentFromEntity(FMassEntityHandle Entity, const UScriptStruct* FragmentType)
 {
-	RemoveFragmentListFromEntity(Entity, MakeArrayView(&FragmentType, 1));
+	checkf(FragmentType, TEXT("Null fragment type passed in to %s"), ANSI_TO_TCHAR(__FUNCTION__));
+	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
+
+	CheckIfEntityIsActive(Entity);
+
+	FEntityData& EntityData = Entities[Entity.Index];
+	check(EntityData.CurrentArchetype.IsValid());
+
+	if (ensureMsgf(EntityData.CurrentArchetype->HasFragmentType(FragmentType), TEXT("Trying to remove fragment %s from an entity that doesn't have it."), *FragmentType->GetName()))
+	{
+		// If the last fragment got removed this will result in fetching of the empty archetype
+		const TSharedPtr<FMassArchetypeData> NewArchetype = InternalGetTransitionArchetype(EntityData.CurrentArchetype, EMassArchetypeTransition::RemoveFragment, FragmentType);
+		check(NewArchetype.IsValid());
+
+		// Move the entity over
+		EntityData.CurrentArchetype->MoveEntityToAnotherArchetype(Entity, *NewArchetype.Get());
+		EntityData.CurrentArchetype = NewArchetype;
+	}
 }
 
 void UMassEntitySubsystem::RemoveFragmentListFromEntity(FMassEntityHandle Entity, TConstArrayView<const UScriptStruct*> FragmentList)
@@ -657,6 +886,60 @@ void UMassEntitySubsystem::SwapTagsForEntity(FMassEntityHandle Entity, const USc
 	}
 }
 
+bool UMassEntitySubsystem::SetEntitySharedFragment(FMassEntityHandle Entity, const FSharedStruct& Fragment)
+{
+	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
+
+	CheckIfEntityIsActive(Entity);
+
+	FMassArchetypeSharedFragmentValues NewSharedFragmentValues = Entities[Entity.Index].CurrentArchetype->GetSharedFragmentValues();
+	if (NewSharedFragmentValues.ReplaceSharedFragment(Fragment) == false)
+	{
+		ensureMsgf(false, TEXT("%s: entity %s doesn't have a shared fragment of type %s"), ANSI_TO_TCHAR(__FUNCTION__), *Entity.DebugGetDescription(), *GetPathNameSafe(Fragment.GetScriptStruct()));
+		return false;
+	}
+
+	return InternalSetEntitySharedFragmentValues(Entity, NewSharedFragmentValues);
+}
+
+bool UMassEntitySubsystem::SetEntityConstSharedFragment(FMassEntityHandle Entity, const FConstSharedStruct& Fragment)
+{
+	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
+
+	CheckIfEntityIsActive(Entity);
+
+	FMassArchetypeSharedFragmentValues NewSharedFragmentValues = Entities[Entity.Index].CurrentArchetype->GetSharedFragmentValues();
+	if (NewSharedFragmentValues.ReplaceConstSharedFragment(Fragment) == false)
+	{
+		ensureMsgf(false, TEXT("%s: entity %s doesn't have a const shared fragment of type %s"), ANSI_TO_TCHAR(__FUNCTION__), *Entity.DebugGetDescription(), *GetPathNameSafe(Fragment.GetScriptStruct()));
+		return false;
+	}
+
+	return InternalSetEntitySharedFragmentValues(Entity, NewSharedFragmentValues);
+}
+
+bool UMassEntitySubsystem::InternalSetEntitySharedFragmentValues(FMassEntityHandle Entity, FMassArchetypeSharedFragmentValues& NewSharedFragmentValues)
+{
+	FEntityData& EntityData = Entities[Entity.Index];
+	FMassArchetypeData* CurrentArchetype = EntityData.CurrentArchetype.Get();
+	check(CurrentArchetype);
+
+	NewSharedFragmentValues.CacheHash();
+	if (NewSharedFragmentValues.IsEquivalent(CurrentArchetype->GetSharedFragmentValues()))
+	{
+		return false;
+	}
+
+	const FArchetypeHandle NewArchetypeHandle = CreateArchetype(CurrentArchetype->GetCompositionDescriptor(), NewSharedFragmentValues);
+	checkSlow(NewArchetypeHandle.IsValid());
+
+	// Move the entity over
+	CurrentArchetype->MoveEntityToAnotherArchetype(Entity, *NewArchetypeHandle.DataPtr.Get());
+	EntityData.CurrentArchetype = NewArchetypeHandle.DataPtr;
+
+	return true;
+}
+
 void UMassEntitySubsystem::AddTagToEntity(FMassEntityHandle Entity, const UScriptStruct* TagType)
 {
 	checkf((TagType != nullptr) && TagType->IsChildOf(FMassTag::StaticStruct()), TEXT("%s works only with tags while '%s' is not one."), ANSI_TO_TCHAR(__FUNCTION__), *GetPathNameSafe(TagType));
@@ -669,15 +952,12 @@ void UMassEntitySubsystem::AddTagToEntity(FMassEntityHandle Entity, const UScrip
 
 	if (CurrentArchetype->HasTagType(TagType) == false)
 	{
-		//FMassTagBitSet NewTags = CurrentArchetype->GetTagBitSet() - *TagType;
-		FMassTagBitSet NewTags = CurrentArchetype->GetTagBitSet();
-		NewTags.Add(*TagType);
-		const FArchetypeHandle NewArchetypeHandle = InternalCreateSiblingArchetype(EntityData.CurrentArchetype, NewTags);
-		checkSlow(NewArchetypeHandle.IsValid());
+		const TSharedPtr<FMassArchetypeData> NewArchetype = InternalGetTransitionArchetype(EntityData.CurrentArchetype, EMassArchetypeTransition::AddTag, TagType);
+		checkSlow(NewArchetype.IsValid());
 
 		// Move the entity over
-		EntityData.CurrentArchetype->MoveEntityToAnotherArchetype(Entity, *NewArchetypeHandle.DataPtr.Get());
-		EntityData.CurrentArchetype = NewArchetypeHandle.DataPtr;
+		CurrentArchetype->MoveEntityToAnotherArchetype(Entity, *NewArchetype.Get());
+		EntityData.CurrentArchetype = NewArchetype;
 	}
 }
 	
@@ -693,15 +973,12 @@ void UMassEntitySubsystem::RemoveTagFromEntity(FMassEntityHandle Entity, const U
 
 	if (CurrentArchetype->HasTagType(TagType))
 	{
-		// CurrentArchetype->GetTagBitSet() -  *TagType
-		FMassTagBitSet NewTags = CurrentArchetype->GetTagBitSet();
-		NewTags.Remove(*TagType);
-		const FArchetypeHandle NewArchetypeHandle = InternalCreateSiblingArchetype(EntityData.CurrentArchetype, NewTags);
-		checkSlow(NewArchetypeHandle.IsValid());
+		const TSharedPtr<FMassArchetypeData> NewArchetype = InternalGetTransitionArchetype(EntityData.CurrentArchetype, EMassArchetypeTransition::RemoveTag, TagType);
+		checkSlow(NewArchetype.IsValid());
 
 		// Move the entity over
-		EntityData.CurrentArchetype->MoveEntityToAnotherArchetype(Entity, *NewArchetypeHandle.DataPtr.Get());
-		EntityData.CurrentArchetype = NewArchetypeHandle.DataPtr;
+		CurrentArchetype->MoveEntityToAnotherArchetype(Entity, *NewArchetype.Get());
+		EntityData.CurrentArchetype = NewArchetype;
 	}
 }
 
@@ -719,6 +996,74 @@ void UMassEntitySubsystem::MoveEntityToAnotherArchetype(FMassEntityHandle Entity
 	EntityData.CurrentArchetype = NewArchetypeHandle.DataPtr;
 }
 
+void UMassEntitySubsystem::BatchMoveEntitiesToAnotherArchetype(const FArchetypeChunkCollection& EntityCollection, FArchetypeHandle NewArchetypeHandle)
+{
+	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
+	check(NewArchetypeHandle.IsValid());
+
+	InternalBatchMoveEntities(EntityCollection, NewArchetypeHandle.DataPtr);
+}
+
+void UMassEntitySubsystem::BatchAddTagToEntities(const FArchetypeChunkCollection& EntityCollection, const UScriptStruct* TagType)
+{
+	checkf((TagType != nullptr) && TagType->IsChildOf(FMassTag::StaticStruct()), TEXT("%s works only with tags while '%s' is not one."), ANSI_TO_TCHAR(__FUNCTION__), *GetPathNameSafe(TagType));
+	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
+
+	const TSharedPtr<FMassArchetypeData>& CurrentArchetype = EntityCollection.GetArchetype().DataPtr;
+	check(CurrentArchetype.IsValid());
+
+	if (CurrentArchetype->HasTagType(TagType) == false)
+	{
+		InternalBatchMoveEntities(EntityCollection, InternalGetTransitionArchetype(CurrentArchetype, EMassArchetypeTransition::AddTag, TagType));
+	}
+}
+
+void UMassEntitySubsystem::BatchRemoveTagFromEntities(const FArchetypeChunkCollection& EntityCollection, const UScriptStruct* TagType)
+{
+	checkf((TagType != nullptr) && TagType->IsChildOf(FMassTag::StaticStruct()), TEXT("%s works only with tags while '%s' is not one."), ANSI_TO_TCHAR(__FUNCTION__), *GetPathNameSafe(TagType));
+	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
+
+	const TSharedPtr<FMassArchetypeData>& CurrentArchetype = EntityCollection.GetArchetype().DataPtr;
+	check(CurrentArchetype.IsValid());
+
+	if (CurrentArchetype->HasTagType(TagType))
+	{
+		InternalBatchMoveEntities(EntityCollection, InternalGetTransitionArchetype(CurrentArchetype, EMassArchetypeTransition::RemoveTag, TagType));
+	}
+}
+
+void UMassEntitySubsystem::BatchAddFragmentToEntities(const FArchetypeChunkCollection& EntityCollection, const UScriptStruct* FragmentType)
+{
+	checkf((FragmentType != nullptr) && FragmentType->IsChildOf(FMassFragment::StaticStruct()), TEXT("%s works only with fragments while '%s' is not one."), ANSI_TO_TCHAR(__FUNCTION__), *GetPathNameSafe(FragmentType));
+	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
+
+	const TSharedPtr<FMassArchetypeData>& CurrentArchetype = EntityCollection.GetArchetype().DataPtr;
+	check(CurrentArchetype.IsValid());
+
+	if (CurrentArchetype->HasFragmentType(FragmentType))
+	{
+		UE_LOG(LogMass, Log, TEXT("Trying to add a new fragment type to entities, but they already have it. (%s)")
+			, *FragmentType->GetName());
+		return;
+	}
+
+	InternalBatchMoveEntities(EntityCollection, InternalGetTransitionArchetype(CurrentArchetype, EMassArchetypeTransition::AddFragment, FragmentType));
+}
+
+void UMassEntitySubsystem::BatchRemoveFragmentFromEntities(const FArchetypeChunkCollection& EntityCollection, const UScriptStruct* FragmentType)
+{
+	checkf((FragmentType != nullptr) && FragmentType->IsChildOf(FMassFragment::StaticStruct()), TEXT("%s works only with fragments while '%s' is not one."), ANSI_TO_TCHAR(__FUNCTION__), *GetPathNameSafe(FragmentType));
+	checkf(IsProcessing() == false, TEXT("Synchronous API function %s called during mass processing. Use asynchronous API instead."), ANSI_TO_TCHAR(__FUNCTION__));
+
+	const TSharedPtr<FMassArchetypeData>& CurrentArchetype = EntityCollection.GetArchetype().DataPtr;
+	check(CurrentArchetype.IsValid());
+
+	if (ensureMsgf(CurrentArchetype->HasFragmentType(FragmentType), TEXT("Trying to remove fragment %s from an entity that doesn't have it."), *FragmentType->GetName()))
+	{
+		InternalBatchMoveEntities(EntityCollection, InternalGetTransitionArchetype(CurrentArchetype, EMassArchetypeTransition::RemoveFragment, FragmentType));
+	}
+}
+
 void UMassEntitySubsystem::SetEntityFragmentsValues(FMassEntityHandle Entity, TArrayView<const FInstancedStruct> FragmentInstanceList)
 {
 	CheckIfEntityIsActive(Entity);
@@ -755,6 +1100,14 @@ void* UMassEntitySubsystem::InternalGetFragmentDataPtr(FMassEntityHandle Entity,
 	return EntityData.CurrentArchetype->GetFragmentDataForEntity(FragmentType, Entity.Index);
 }
 
+void UMassEntitySubsystem::InternalGetFragmentValueChecked(FMassEntityHandle Entity, const UScriptStruct* FragmentType, void* OutValue) const
+{
+	CheckIfEntityIsActive(Entity);
+	checkf((FragmentType != nullptr) && FragmentType->IsChildOf(FMassFragment::StaticStruct()), TEXT("InternalGetFragmentValueChecked called with an invalid fragment type '%s'"), *GetPathNameSafe(FragmentType));
+	const FEntityData& EntityData = Entities[Entity.Index];
+	EntityData.CurrentArchetype->CopyFragmentValueForEntity(FragmentType, Entity.Index, OutValue);
+}
+
 bool UMassEntitySubsystem::IsEntityValid(FMassEntityHandle Entity) const
 {
 	return (Entity.Index > 0) && Entities.IsValidIndex(Entity.Index) && (Entities[Entity.Index].SerialNumber == Entity.SerialNumber);
@@ -777,29 +1130,14 @@ void UMassEntitySubsystem::CheckIfEntityIsActive(FMassEntityHandle Entity) const
 	checkf(IsEntityBuilt(Entity), TEXT("Entity not yet created(ID: %d, SN:%d)"));
 }
 
-void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TArray<FArchetypeHandle>& OutValidArchetypes)
+namespace UE::Mass::Private
 {
-	//@TODO: Not optimized yet, but we call this rarely now, so not a big deal.
-
-	// First get set of all archetypes that contain *any* fragment
-	TSet<TSharedPtr<FMassArchetypeData>> AnyArchetypes;
-	for (const FMassFragmentRequirement& Requirement : Query.GetRequirements())
+	/** 
+	 * Tests Archetype against Query's tag, fragment, chunk and shared fragment bitsets. Note that it doesn't verify that
+	 * Archetype has any of Query's fragments, that's expected to be done by the caller.
+	 */
+	bool DoesArchetypeMatchQuery(const FMassArchetypeData& Archetype, const FMassEntityQuery& Query)
 	{
-		check(Requirement.StructType);
-		if (Requirement.Presence != EMassFragmentPresence::None)
-		{
-			if (TArray<TSharedPtr<FMassArchetypeData>>* pData = FragmentTypeToArchetypeMap.Find(Requirement.StructType))
-			{
-				AnyArchetypes.Append(*pData);
-			}
-		}
-	}
-
-	// Then verify that they contain *all* required fragments
-	for (TSharedPtr<FMassArchetypeData>& ArchetypePtr : AnyArchetypes)
-	{
-		FMassArchetypeData& Archetype = *(ArchetypePtr.Get());
-
 		if (Archetype.GetTagBitSet().HasAll(Query.GetRequiredAllTags()) == false)
 		{
 			// missing some required tags, skip.
@@ -810,7 +1148,7 @@ void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TAr
 			UE_LOG(LogMass, VeryVerbose, TEXT("Archetype did not match due to missing tags: %s")
 				, *Description);
 #endif // WITH_MASSENTITY_DEBUG
-			continue;
+			return false;
 		}
 
 		if (Archetype.GetTagBitSet().HasNone(Query.GetRequiredNoneTags()) == false)
@@ -823,7 +1161,7 @@ void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TAr
 			UE_LOG(LogMass, VeryVerbose, TEXT("Archetype has tags required absent: %s")
 				, *Description);
 #endif // WITH_MASSENTITY_DEBUG
-			continue;
+			return false;
 		}
 
 		if (Query.GetRequiredAnyTags().IsEmpty() == false 
@@ -835,9 +1173,9 @@ void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TAr
 			UE_LOG(LogMass, VeryVerbose, TEXT("Archetype did not match due to missing \'any\' tags: %s")
 				, *Description);
 #endif // WITH_MASSENTITY_DEBUG
-			continue;
+			return false;
 		}
-		
+	
 		if (Archetype.GetFragmentBitSet().HasAll(Query.GetRequiredAllFragments()) == false)
 		{
 			// missing some required fragments, skip.
@@ -848,7 +1186,7 @@ void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TAr
 			UE_LOG(LogMass, VeryVerbose, TEXT("Archetype did not match due to missing Fragments: %s")
 				, *Description);
 #endif // WITH_MASSENTITY_DEBUG
-			continue;
+			return false;
 		}
 
 		if (Archetype.GetFragmentBitSet().HasNone(Query.GetRequiredNoneFragments()) == false)
@@ -861,7 +1199,7 @@ void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TAr
 			UE_LOG(LogMass, VeryVerbose, TEXT("Archetype has Fragments required absent: %s")
 				, *Description);
 #endif // WITH_MASSENTITY_DEBUG
-			continue;
+			return false;
 		}
 
 		if (Query.GetRequiredAnyFragments().IsEmpty() == false 
@@ -873,7 +1211,7 @@ void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TAr
 			UE_LOG(LogMass, VeryVerbose, TEXT("Archetype did not match due to missing \'any\' fragments: %s")
 				, *Description);
 #endif // WITH_MASSENTITY_DEBUG
-			continue;
+			return false;
 		}
 
 		if (Archetype.GetChunkFragmentBitSet().HasAll(Query.GetRequiredAllChunkFragments()) == false)
@@ -886,7 +1224,7 @@ void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TAr
 			UE_LOG(LogMass, VeryVerbose, TEXT("Archetype did not match due to missing Chunk Fragments: %s")
 				, *Description);
 #endif // WITH_MASSENTITY_DEBUG
-			continue;
+			return false;
 		}
 
 		if (Archetype.GetChunkFragmentBitSet().HasNone(Query.GetRequiredNoneChunkFragments()) == false)
@@ -899,7 +1237,7 @@ void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TAr
 			UE_LOG(LogMass, VeryVerbose, TEXT("Archetype has Chunk Fragments required absent: %s")
 				, *Description);
 #endif // WITH_MASSENTITY_DEBUG
-			continue;
+			return false;
 		}
 
 		if (Archetype.GetSharedFragmentBitSet().HasAll(Query.GetRequiredAllSharedFragments()) == false)
@@ -912,7 +1250,7 @@ void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TAr
 			UE_LOG(LogMass, VeryVerbose, TEXT("Archetype did not match due to missing Shared Fragments: %s")
 				, *Description);
 #endif // WITH_MASSENTITY_DEBUG
-			continue;
+			return false;
 		}
 
 		if (Archetype.GetSharedFragmentBitSet().HasNone(Query.GetRequiredNoneSharedFragments()) == false)
@@ -925,11 +1263,52 @@ void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TAr
 			UE_LOG(LogMass, VeryVerbose, TEXT("Archetype has Shared Fragments required absent: %s")
 				, *Description);
 #endif // WITH_MASSENTITY_DEBUG
-			continue;
+			return false;
 		}
 
+		return true;
+	}
+}
 
-		OutValidArchetypes.Add(ArchetypePtr);
+void UMassEntitySubsystem::GetValidArchetypes(const FMassEntityQuery& Query, TArray<FArchetypeHandle>& OutValidArchetypes, const int32 FirstArchetypeIndex)
+{
+	if (FirstArchetypeIndex > 0)
+	{
+		// Only the archetypes created since the query's cache was built need testing. That's usually just a handful 
+		// of them, so testing them directly is cheaper than gathering candidates via FragmentTypeToArchetypeMap.
+		const FMassFragmentBitSet QueryFragments = Query.GetRequiredAllFragments() + Query.GetRequiredAnyFragments() + Query.GetRequiredOptionalFragments();
+		for (int32 ArchetypeIndex = FirstArchetypeIndex; ArchetypeIndex < AllArchetypes.Num(); ++ArchetypeIndex)
+		{
+			const TSharedPtr<FMassArchetypeData>& ArchetypePtr = AllArchetypes[ArchetypeIndex];
+			if (ArchetypePtr->GetFragmentBitSet().HasAny(QueryFragments) && UE::Mass::Private::DoesArchetypeMatchQuery(*ArchetypePtr, Query))
+			{
+				OutValidArchetypes.Add(ArchetypePtr);
+			}
+		}
+		return;
+	}
+
+	// First get set of all archetypes that contain *any* fragment
+	TSet<TSharedPtr<FMassArchetypeData>> AnyArchetypes;
+	for (const FMassFragmentRequirement& Requirement : Query.GetRequirements())
+	{
+		check(Requirement.StructType);
+		if (Requirement.Presence != EMassFragmentPresence::None)
+		{
+			if (TArray<TSharedPtr<FMassArchetypeData>>* pData = FragmentTypeToArchetypeMap.Find(Requirement.StructType))
+			{
+				AnyArchetypes.Append(*pData);
+			}
+		}
+	}
+
+	// Then verify that they contain *all* required fragments
+	for (TSharedPtr<FMassArchetypeData>& ArchetypePtr : AnyArchetypes)
+	{
+		if (UE::Mass::Private::DoesArchetypeMatchQuery(*ArchetypePtr, Query))
+		{
+			OutValidArchetypes.Add(ArchetypePtr);
+		}
 	}
 }
 
@@ -966,6 +1345,11 @@ void UMassEntitySubsystem::DebugPrintArchetypes(FOutputDevice& Ar, const bool bI
 
 	Ar.Logf(ELogVerbosity::Log, TEXT("FragmentHashToArchetypeMap: %d archetypes across %d buckets, longest bucket is %d"),
 		NumArchetypes, NumBuckets, LongestArchetypeBucket);
+
+	const FMassChunkMemoryStats ChunkMemoryStats = GetChunkMemoryStats();
+	Ar.Logf(ELogVerbosity::Log, TEXT("Chunk memory: %lld KB in use, %lld KB pooled, %lld KB peak resident. Pool hits: %lld, misses: %lld, pages released: %lld"),
+		ChunkMemoryStats.InUseBytes / 1024, ChunkMemoryStats.PooledBytes / 1024, ChunkMemoryStats.PeakResidentBytes / 1024,
+		ChunkMemoryStats.NumHits, ChunkMemoryStats.NumMisses, ChunkMemoryStats.NumReleased);
 }
 
 void UMassEntitySubsystem::DebugPrintEntity(int32 Index, FOutputDevice& Ar, const TCHAR* InPrefix) const
@@ -1136,14 +1520,8 @@ void FMassExecutionContext::SetCurrentArchetypeData(FMassArchetypeData& Archetyp
 
 void FMassExecutionContext::SetChunkCollection(const FArchetypeChunkCollection& InChunkCollection)
 {
-	check(ChunkCollection.IsEmpty());
-	ChunkCollection = InChunkCollection;
-}
-
-void FMassExecutionContext::SetChunkCollection(FArchetypeChunkCollection&& InChunkCollection)
-{
-	check(ChunkCollection.IsEmpty());
-	ChunkCollection = MoveTemp(InChunkCollection);
+	check(ChunkCollection == nullptr);
+	ChunkCollection = &InChunkCollection;
 }
 
 void FMassExecutionContext::SetRequirements(TConstArrayView<FMassFragmentRequirement> InRequirements, 
@@ -5,6 +5,8 @@
 #include "MassExecutor.h"
 #include "MassProcessingTypes.h"
 #include "MassObserverRegistry.h"
+#include "MassEntityUtils.h"
+#include "MassCommandBuffer.h"
 
 //----------------------------------------------------------------------//
 // FMassObserverManager
@@ -28,8 +30,25 @@ void FMassObserverManager::Initialize()
 
 	ObservedAddFragments.Reset();
 	ObservedRemoveFragments.Reset();
+	ObservedAddTags.Reset();
+	ObservedRemoveTags.Reset();
+	ObservedSharedFragments.Reset();
 	OnFragmentAddedObservers.Reset();
 	OnFragmentRemovedObservers.Reset();
+	OnTagAddedObservers.Reset();
+	OnTagRemovedObservers.Reset();
+	OnSharedFragmentChangedObservers.Reset();
+
+	auto CreatePipeline = [this](TMap<const UScriptStruct*, FMassRuntimePipeline>& HandlersContainer, const UScriptStruct* Type, const FMassProcessorClassCollection& Classes)
+	{
+		FMassRuntimePipeline& Pipeline = HandlersContainer.FindOrAdd(Type);
+
+		for (const TSubclassOf<UMassProcessor>& ProcessorClass : Classes.ClassCollection)
+		{
+			Pipeline.AppendProcessor(ProcessorClass, EntitySubsystem);
+		}
+		Pipeline.Initialize(EntitySubsystem);
+	};
 
 	for (auto It : Registry.FragmentInitializersMap)
 	{
@@ -38,14 +57,22 @@ void FMassObserverManager::Initialize()
 			continue;
 		}
 
-		ObservedAddFragments.Add(*It.Key);
-		FMassRuntimePipeline& Pipeline = OnFragmentAddedObservers.FindOrAdd(It.Key);
-
-		for (const TSubclassOf<UMassProcessor>& ProcessorClass : It.Value.ClassCollection)
+		check(It.Key);
+		if (It.Key->IsChildOf(FMassTag::StaticStruct()))
 		{
-			Pipeline.AppendProcessor(ProcessorClass, EntitySubsystem);
+			ObservedAddTags.Add(*It.Key);
+			CreatePipeline(OnTagAddedObservers, It.Key, It.Value);
+		}
+		else if (It.Key->IsChildOf(FMassSharedFragment::StaticStruct()))
+		{
+			ObservedSharedFragments.Add(*It.Key);
+			CreatePipeline(OnSharedFragmentChangedObservers, It.Key, It.Value);
+		}
+		else
+		{
+			ObservedAddFragments.Add(*It.Key);
+			CreatePipeline(OnFragmentAddedObservers, It.Key, It.Value);
 		}
-		Pipeline.Initialize(EntitySubsystem);
 	}
 
 	for (auto It : Registry.FragmentDeinitializersMap)
@@ -55,14 +82,21 @@ void FMassObserverManager::Initialize()
 			continue;
 		}
 
-		ObservedRemoveFragments.Add(*It.Key);
-		FMassRuntimePipeline& Pipeline = OnFragmentRemovedObservers.FindOrAdd(It.Key);
-
-		for (const TSubclassOf<UMassProcessor>& ProcessorClass : It.Value.ClassCollection)
+		check(It.Key);
+		if (It.Key->IsChildOf(FMassTag::StaticStruct()))
 		{
-			Pipeline.AppendProcessor(ProcessorClass, EntitySubsystem);
+			ObservedRemoveTags.Add(*It.Key);
+			CreatePipeline(OnTagRemovedObservers, It.Key, It.Value);
+		}
+		else if (It.Key->IsChildOf(FMassSharedFragment::StaticStruct()))
+		{
+			UE_LOG(LogMass, Warning, TEXT("Observing shared fragment removal is not supported, ignoring deinitializers registered for %s"), *It.Key->GetName());
+		}
+		else
+		{
+			ObservedRemoveFragments.Add(*It.Key);
+			CreatePipeline(OnFragmentRemovedObservers, It.Key, It.Value);
 		}
-		Pipeline.Initialize(EntitySubsystem);
 	}
 }
 
@@ -132,35 +166,133 @@ bool FMassObserverManager::OnPreEntitiesDestroyed(FMassProcessingContext& Proces
 }
 
 bool FMassObserverManager::OnPostCompositionAdded(const FMassEntityHandle Entity, const FMassArchetypeCompositionDescriptor& Composition)
+{
+	const FMassFragmentBitSet Overlap = ObservedAddFragments.GetOverlap(Composition.Fragments);
+	if (Overlap.IsEmpty())
+	{
+		return false;
+	}
+
+	if (IsBatchingCompositionChanges())
+	{
+		TArray<const UScriptStruct*> Fragments;
+		Overlap.ExportTypes(Fragments);
+		for (const UScriptStruct* FragmentType : Fragments)
+		{
+			PendingAddedFragments.FindOrAdd(FragmentType).Add(Entity);
+		}
+		return true;
+	}
+
+	const FArchetypeHandle ArchetypeHandle = EntitySubsystem.GetArchetypeForEntity(Entity);
+	return OnPostCompositionAdded(FArchetypeChunkCollection(ArchetypeHandle, MakeArrayView(&Entity, 1), FArchetypeChunkCollection::NoDuplicates), Composition);
+}
+
+bool FMassObserverManager::OnPreCompositionRemoved(const FMassEntityHandle Entity, const FMassArchetypeCompositionDescriptor& Composition)
+{
+	FMassFragmentBitSet Overlap = ObservedRemoveFragments.GetOverlap(Composition.Fragments);
+	if (Overlap.IsEmpty())
+	{
+		return false;
+	}
+
+	if (RemovalsNotifiedUpFront)
+	{
+		TArray<const UScriptStruct*> Fragments;
+		Overlap.ExportTypes(Fragments);
+		for (const UScriptStruct* FragmentType : Fragments)
+		{
+			TSet<FMassEntityHandle>* NotifiedEntities = RemovalsNotifiedUpFront->Find(FragmentType);
+			if (NotifiedEntities && NotifiedEntities->Remove(Entity) > 0)
+			{
+				Overlap.Remove(*FragmentType);
+			}
+		}
+		if (Overlap.IsEmpty())
+		{
+			return false;
+		}
+	}
+
+	// the observers of the fragments added so far need to run before the ones handling the removal
+	FlushPendingCompositionChanges();
+
+	const FArchetypeHandle ArchetypeHandle = EntitySubsystem.GetArchetypeForEntity(Entity);
+	FMassProcessingContext ProcessingContext(EntitySubsystem, /*DeltaSeconds=*/0.f);
+	HandleFragmentsImpl(ProcessingContext, FArchetypeChunkCollection(ArchetypeHandle, MakeArrayView(&Entity, 1), FArchetypeChunkCollection::NoDuplicates)
+		, Overlap, OnFragmentRemovedObservers);
+	return true;
+}
+
+bool FMassObserverManager::OnPostCompositionAdded(const FArchetypeChunkCollection& ChunkCollection, const FMassArchetypeCompositionDescriptor& Composition)
 {
 	const FMassFragmentBitSet Overlap = ObservedAddFragments.GetOverlap(Composition.Fragments);
 	if (Overlap.IsEmpty() == false)
 	{
 		FMassProcessingContext ProcessingContext(EntitySubsystem, /*DeltaSeconds=*/0.f);
-		const FArchetypeHandle ArchetypeHandle = EntitySubsystem.GetArchetypeForEntity(Entity);
-		HandleFragmentsImpl(ProcessingContext, FArchetypeChunkCollection(ArchetypeHandle, MakeArrayView(&Entity, 1)
-			, FArchetypeChunkCollection::NoDuplicates), Overlap, OnFragmentAddedObservers);
+		HandleFragmentsImpl(ProcessingContext, ChunkCollection, Overlap, OnFragmentAddedObservers);
 		return true;
 	}
 
 	return false;
 }
 
-bool FMassObserverManager::OnPreCompositionRemoved(const FMassEntityHandle Entity, const FMassArchetypeCompositionDescriptor& Composition)
+bool FMassObserverManager::OnPreCompositionRemoved(const FArchetypeChunkCollection& ChunkCollection, const FMassArchetypeCompositionDescriptor& Composition)
 {
 	const FMassFragmentBitSet Overlap = ObservedRemoveFragments.GetOverlap(Composition.Fragments);
 	if (Overlap.IsEmpty() == false)
 	{
 		FMassProcessingContext ProcessingContext(EntitySubsystem, /*DeltaSeconds=*/0.f);
-		const FArchetypeHandle ArchetypeHandle = EntitySubsystem.GetArchetypeForEntity(Entity);
-		HandleFragmentsImpl(ProcessingContext, FArchetypeChunkCollection(ArchetypeHandle, MakeArrayView(&Entity, 1)
-			, FArchetypeChunkCollection::NoDuplicates), Overlap, OnFragmentRemovedObservers);
+		HandleFragmentsImpl(ProcessingContext, ChunkCollection, Overlap, OnFragmentRemovedObservers);
 		return true;
 	}
 
 	return false;
 }
 
+void FMassObserverManager::FlushPendingCompositionChanges()
+{
+	if (PendingAddedFragments.Num() == 0)
+	{
+		return;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("FlushPendingCompositionChanges")
+
+	// the observers can change entities' composition as well, so working on a local copy
+	TMap<const UScriptStruct*, TArray<FMassEntityHandle>> AddedFragments = MoveTemp(PendingAddedFragments);
+	PendingAddedFragments.Reset();
+
+	// not flushing the commands issued by the observers until all are done, otherwise entities could get moved to 
+	// other archetypes, invalidating the chunk collections created up front
+	FMassProcessingContext ProcessingContext(EntitySubsystem, /*DeltaSeconds=*/0.f);
+	ProcessingContext.bFlushCommandBuffer = false;
+	ProcessingContext.CommandBuffer = MakeShareable(new FMassCommandBuffer());
+
+	for (TPair<const UScriptStruct*, TArray<FMassEntityHandle>>& It : AddedFragments)
+	{
+		const UScriptStruct* FragmentType = It.Key;
+		// entities could have been destroyed, or could have lost the fragment, since getting recorded
+		It.Value.RemoveAllSwap([this, FragmentType](const FMassEntityHandle Entity)
+			{
+				return EntitySubsystem.IsEntityBuilt(Entity) == false
+					|| EntitySubsystem.GetArchetypeComposition(EntitySubsystem.GetArchetypeForEntity(Entity)).Fragments.Contains(*FragmentType) == false;
+			}, /*bAllowShrinking=*/false);
+
+		TArray<FArchetypeChunkCollection> ChunkCollections;
+		UE::Mass::Utils::CreateSparseChunks(EntitySubsystem, It.Value, FArchetypeChunkCollection::FoldDuplicates, ChunkCollections);
+
+		FMassFragmentBitSet FragmentBitSet;
+		FragmentBitSet.Add(*FragmentType);
+		for (const FArchetypeChunkCollection& Collection : ChunkCollections)
+		{
+			HandleFragmentsImpl(ProcessingContext, Collection, FragmentBitSet, OnFragmentAddedObservers);
+		}
+	}
+
+	ProcessingContext.CommandBuffer->ReplayBufferAgainstSystem(&EntitySubsystem);
+}
+
 void FMassObserverManager::HandleFragmentsImpl(FMassProcessingContext& ProcessingContext, const FArchetypeChunkCollection& ChunkCollection, const FMassFragmentBitSet& FragmentsBitSet, TMap<const UScriptStruct*, FMassRuntimePipeline>& HandlersContainer)
 {
 	TArray<const UScriptStruct*> Fragments;
@@ -175,6 +307,17 @@ void FMassObserverManager::HandleFragmentsImpl(FMassProcessingContext& Processin
 	}
 }
 
+void FMassObserverManager::HandleSingleTypeImpl(const UScriptStruct& Type, const FArchetypeChunkCollection& ChunkCollection, TMap<const UScriptStruct*, FMassRuntimePipeline>& HandlersContainer)
+{
+	if (FMassRuntimePipeline* Pipeline = HandlersContainer.Find(&Type))
+	{
+		FMassProcessingContext ProcessingContext(EntitySubsystem, /*DeltaSeconds=*/0.f);
+		ProcessingContext.AuxData.InitializeAs(&Type);
+
+		UE::Mass::Executor::RunProcessorsView(Pipeline->Processors, ProcessingContext, &ChunkCollection);
+	}
+}
+
 void FMassObserverManager::HandleSingleFragmentImpl(const UScriptStruct& FragmentType, const FArchetypeChunkCollection& ChunkCollection, const FMassFragmentBitSet& FragmentFilterBitSet, TMap<const UScriptStruct*, FMassRuntimePipeline>& HandlersContainer)
 {
 	if (FragmentFilterBitSet.Contains(FragmentType))
@@ -186,3 +329,27 @@ void FMassObserverManager::HandleSingleFragmentImpl(const UScriptStruct& Fragmen
 		UE::Mass::Executor::RunProcessorsView(Pipeline.Processors, ProcessingContext, &ChunkCollection);
 	}
 }
+
+//----------------------------------------------------------------------//
+// FMassObserverManager::FScopedCompositionChangeBatching
+//----------------------------------------------------------------------//
+FMassObserverManager::FScopedCompositionChangeBatching::FScopedCompositionChangeBatching(FMassObserverManager& InObserverManager, FEntitySetPerType* InRemovalsNotifiedUpFront)
+	: ObserverManager(InObserverManager)
+	, PreviousRemovalsNotifiedUpFront(InObserverManager.RemovalsNotifiedUpFront)
+{
+	++ObserverManager.CompositionChangeBatchingDepth;
+	if (InRemovalsNotifiedUpFront)
+	{
+		ObserverManager.RemovalsNotifiedUpFront = InRemovalsNotifiedUpFront;
+	}
+}
+
+FMassObserverManager::FScopedCompositionChangeBatching::~FScopedCompositionChangeBatching()
+{
+	check(ObserverManager.CompositionChangeBatchingDepth > 0);
+	ObserverManager.RemovalsNotifiedUpFront = PreviousRemovalsNotifiedUpFront;
+	if (--ObserverManager.CompositionChangeBatchingDepth == 0)
+	{
+		ObserverManager.FlushPendingCompositionChanges();
+	}
+}
@@ -10,6 +10,7 @@
 #include "VisualLogger/VisualLogger.h"
 #include "Engine/World.h"
 #include "MassCommandBuffer.h"
+#include "UObject/UObjectIterator.h"
 
 #define LOCTEXT_NAMESPACE "Mass"
 
@@ -304,6 +305,12 @@ void UMassProcessingPhaseManager::OnPhaseStart(const FMassProcessingPhase& Phase
 {
 	ensure(CurrentPhase == EMassProcessingPhase::MAX);
 	CurrentPhase = Phase.Phase;
+
+	// topping up the entities reserved for the other threads once per frame, while we know we're on the game thread
+	if (Phase.Phase == EMassProcessingPhase::PrePhysics && EntitySubsystem)
+	{
+		EntitySubsystem->ReplenishConcurrentReservations();
+	}
 }
 
 void UMassProcessingPhaseManager::OnPhaseEnd(FMassProcessingPhase& Phase)
@@ -325,6 +332,115 @@ void UMassProcessingPhaseManager::OnPhaseEnd(FMassProcessingPhase& Phase)
 	}
 }
 
+void UMassProcessingPhaseManager::GetProcessorStats(const EMassProcessingPhase Phase, TArray<FProcessorStatsEntry>& OutStats) const
+{
+	if (Phase == EMassProcessingPhase::MAX)
+	{
+		UE_VLOG_UELOG(this, LogMass, Error, TEXT("MassProcessingPhaseManager::GetProcessorStats called with Phase == MAX"));
+		return;
+	}
+
+	TFunction<void(const UMassProcessor&, const int32)> AddStats = [&OutStats, &AddStats](const UMassProcessor& Processor, const int32 Depth)
+	{
+		OutStats.Add({&Processor, Processor.GetExecutionStats(), Depth});
+		if (const UMassCompositeProcessor* Composite = Cast<const UMassCompositeProcessor>(&Processor))
+		{
+			for (const UMassProcessor* Child : Composite->GetChildProcessorsView())
+			{
+				if (Child)
+				{
+					AddStats(*Child, Depth + 1);
+				}
+			}
+		}
+	};
+
+	if (const UMassCompositeProcessor* PhaseProcessor = ProcessingPhases[int32(Phase)].PhaseProcessor)
+	{
+		AddStats(*PhaseProcessor, 0);
+	}
+}
+
+void UMassProcessingPhaseManager::ResetProcessorStats()
+{
+	TFunction<void(UMassProcessor&)> Reset = [&Reset](UMassProcessor& Processor)
+	{
+		Processor.ResetExecutionStats();
+		if (const UMassCompositeProcessor* Composite = Cast<const UMassCompositeProcessor>(&Processor))
+		{
+			for (UMassProcessor* Child : Composite->GetChildProcessorsView())
+			{
+				if (Child)
+				{
+					Reset(*Child);
+				}
+			}
+		}
+	};
+
+	for (FMassProcessingPhase& Phase : ProcessingPhases)
+	{
+		if (Phase.PhaseProcessor)
+		{
+			Reset(*Phase.PhaseProcessor);
+		}
+	}
+}
+
+void UMassProcessingPhaseManager::DebugDumpProcessorStats(FOutputDevice& Ar) const
+{
+	if (UE::Mass::ProcessorStats::bEnabled == false)
+	{
+		Ar.Logf(ELogVerbosity::Warning, TEXT("Processor stats gathering is disabled, set mass.ProcessorStats.Enable to 1 to enable it"));
+	}
+
+	TArray<FProcessorStatsEntry> Stats;
+	for (int32 PhaseIndex = 0; PhaseIndex < int32(EMassProcessingPhase::MAX); ++PhaseIndex)
+	{
+		Stats.Reset();
+		GetProcessorStats(EMassProcessingPhase(PhaseIndex), Stats);
+		if (Stats.Num() == 0)
+		{
+			continue;
+		}
+
+		Ar.Logf(TEXT("Phase %s:"), *EnumToString(EMassProcessingPhase(PhaseIndex)));
+		for (const FProcessorStatsEntry& Entry : Stats)
+		{
+			const FMassProcessorExecutionStats& ProcessorStats = Entry.Stats;
+			Ar.Logf(TEXT("%*s%s: %.3fms (max %.3fms), waited %.3fms, entities %.1f, chunks %.1f, commands %.1f, executions %d")
+				, Entry.Depth * 2, TEXT(""), *Entry.Processor->GetProcessorName()
+				, ProcessorStats.AverageWallTimeMs, ProcessorStats.MaxWallTimeMs, ProcessorStats.AverageWaitTimeMs
+				, ProcessorStats.AverageEntities, ProcessorStats.AverageChunks, ProcessorStats.AverageCommands, ProcessorStats.NumExecutions);
+		}
+	}
+}
+
+FAutoConsoleCommandWithWorldArgsAndOutputDevice DumpProcessorStatsCmd(
+	TEXT("mass.ProcessorStats.Dump"),
+	TEXT("Prints out the per-processor execution stats gathered while mass.ProcessorStats.Enable is set. Pass 'reset' to reset the stats afterwards."),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda(
+		[](const TArray<FString>& Params, UWorld* World, FOutputDevice& Ar)
+		{
+			const bool bReset = Params.Num() > 0 && Params[0].Equals(TEXT("reset"), ESearchCase::IgnoreCase);
+			for (TObjectIterator<UMassProcessingPhaseManager> It; It; ++It)
+			{
+				UMassProcessingPhaseManager* Manager = *It;
+				if (Manager->IsRunning() == false || Manager->GetEntitySubsystemRef().GetWorld() != World)
+				{
+					continue;
+				}
+
+				Ar.Logf(TEXT("%s:"), *GetPathNameSafe(Manager));
+				Manager->DebugDumpProcessorStats(Ar);
+				if (bReset)
+				{
+					Manager->ResetProcessorStats();
+				}
+			}
+		})
+);
+
 #if WITH_EDITOR
 void UMassProcessingPhaseManager::OnMassEntitySettingsChange(const FPropertyChangedEvent& PropertyChangedEvent)
 {
@@ -6,19 +6,12 @@
 #include "VisualLogger/VisualLogger.h"
 #include "Engine/World.h"
 #include "MassCommandBuffer.h"
+#include "MassProcessorStats.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeExit.h"
 
 DECLARE_CYCLE_STAT(TEXT("MassProcessor Group Completed"), Mass_GroupCompletedTask, STATGROUP_TaskGraphTasks);
 
-#define PARALLELIZED_TRAFFIC_HACK 1
-
-#if PARALLELIZED_TRAFFIC_HACK
-namespace UE::MassTraffic
-{
-	int32 bParallelizeTraffic = 1;
-	FAutoConsoleVariableRef CVarParallelizeTraffic(TEXT("ai.traffic.parallelize"), bParallelizeTraffic, TEXT("Whether to parallelize traffic or not"), ECVF_Cheat);
-}
-#endif // PARALLELIZED_TRAFFIC_HACK
-
 #if WITH_MASSENTITY_DEBUG
 namespace UE::Mass::Debug
 {
@@ -37,15 +30,26 @@ namespace UE::Mass::Debug
 
 namespace FMassTweakables
 {
-	bool bParallelGroups = false;
+	bool bParallelGroups = true;
 	float PostponedTaskWaitTimeWarningLevel = 0.002f;
 
 	FAutoConsoleVariableRef CVarsMassProcessor[] = {
-		{TEXT("mass.ParallelGroups"), bParallelGroups, TEXT("Enables mass processing groups distribution to all available threads (via the task graph)")},
+		{TEXT("mass.ParallelGroups"), bParallelGroups, TEXT("Enables running the groups listed in given processing phase's OffGameThreadGroupNames (see UMassEntitySettings) on other threads (via the task graph)")},
 		{TEXT("mass.PostponedTaskWaitTimeWarningLevel"), PostponedTaskWaitTimeWarningLevel, TEXT("if waiting for postponed task\'s dependencies exceeds this number an error will be logged")},
 	};
 }
 
+namespace UE::Mass::ProcessorStats
+{
+	bool bEnabled = false;
+	int32 AveragingWindow = 60;
+
+	FAutoConsoleVariableRef CVarsProcessorStats[] = {
+		{TEXT("mass.ProcessorStats.Enable"), bEnabled, TEXT("Enables gathering per-processor execution stats (time, entities and chunks processed, commands issued), see mass.ProcessorStats.Dump")},
+		{TEXT("mass.ProcessorStats.AveragingWindow"), AveragingWindow, TEXT("Number of most recent executions the processor stats' rolling averages are computed over")},
+	};
+}
+
 class FMassProcessorTask
 {
 public:
@@ -54,6 +58,7 @@ public:
 		, ExecutionContext(InExecutionContext)
 		, Processor(&InProc)
 		, bManageCommandBuffer(bInManageCommandBuffer)
+		, DispatchCycles(UE::Mass::ProcessorStats::bEnabled ? FPlatformTime::Cycles64() : 0)
 	{}
 
 	static TStatId GetStatId()
@@ -78,17 +83,20 @@ public:
 		UMassEntitySubsystem::FScopedProcessing ProcessingScope = EntitySubsystem->NewProcessingScope();
 
 		TRACE_CPUPROFILER_EVENT_SCOPE_STR("Mass Processor Task");
+
+		// the task gets created when its prerequisites get dispatched, so the time since creation is spent waiting on them (and on a free worker)
+		const double WaitTimeMs = DispatchCycles ? FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - DispatchCycles) : 0.;
 		
 		if (bManageCommandBuffer)
 		{
 			TSharedPtr<FMassCommandBuffer> MainSharedPtr = ExecutionContext.GetSharedDeferredCommandBuffer();
 			ExecutionContext.SetDeferredCommandBuffer(MakeShareable(new FMassCommandBuffer()));
-			Processor->CallExecute(*EntitySubsystem, ExecutionContext);
+			Processor->CallExecute(*EntitySubsystem, ExecutionContext, WaitTimeMs);
 			MainSharedPtr->MoveAppend(ExecutionContext.Defer());
 		}
 		else
 		{
-			Processor->CallExecute(*EntitySubsystem, ExecutionContext);
+			Processor->CallExecute(*EntitySubsystem, ExecutionContext, WaitTimeMs);
 		}
 		PROCESSOR_LOG(TEXT("+--+ Task %s finished"), *Processor->GetProcessorName());
 	}
@@ -102,6 +110,8 @@ private:
 	 * commands after processor's execution;
 	 */
 	bool bManageCommandBuffer = true;
+	/** When the task has been created, set only while gathering processor stats */
+	uint64 DispatchCycles = 0;
 };
 
 class FMassProcessorsTask_GameThread : public FMassProcessorTask
@@ -148,13 +158,76 @@ void UMassProcessor::PostInitProperties()
 #endif
 }
 
-void UMassProcessor::CallExecute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context)
+void UMassProcessor::CallExecute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context, const double PrerequisitesWaitTimeMs)
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT(*StatId);
 #if WITH_MASSENTITY_DEBUG
 	Context.DebugSetExecutionDesc(FString::Printf(TEXT("%s (%s)"), *GetProcessorName(), *ToString(EntitySubsystem.GetWorld()->GetNetMode())));
 #endif
+
+	// all the queries run by this execution share the change version, see FMassEntityQuery::BeginChangeTracking
+	const uint64 ParentChangeVersion = Context.GetExecutionChangeVersion();
+	Context.SetExecutionChangeVersion(UE::Mass::GetNextChangeVersion());
+	ON_SCOPE_EXIT
+	{
+		Context.SetExecutionChangeVersion(ParentChangeVersion);
+	};
+
+	if (UE::Mass::ProcessorStats::bEnabled == false)
+	{
+		Execute(EntitySubsystem, Context);
+		return;
+	}
+
+	// the counters are shared with all the copies of Context made while executing, so these need to outlive Execute
+	FMassExecutionStatsCounters Counters;
+	FMassExecutionStatsCounters* ParentCounters = Context.GetStatsCounters();
+	Context.SetStatsCounters(&Counters);
+	const TSharedPtr<FMassCommandBuffer> CommandBuffer = Context.GetSharedDeferredCommandBuffer();
+	const int32 NumCommandsBefore = CommandBuffer ? CommandBuffer->GetNumCommandsIssued() : 0;
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
 	Execute(EntitySubsystem, Context);
+
+	const double WallTimeMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	const int32 NumCommands = CommandBuffer ? CommandBuffer->GetNumCommandsIssued() - NumCommandsBefore : 0;
+	const int32 NumChunks = Counters.NumChunks.load(std::memory_order_relaxed);
+	const int32 NumEntities = Counters.NumEntities.load(std::memory_order_relaxed);
+	Context.SetStatsCounters(ParentCounters);
+
+	// composite processors running their children on the same context get the children's totals
+	if (ParentCounters)
+	{
+		ParentCounters->NumChunks.fetch_add(NumChunks, std::memory_order_relaxed);
+		ParentCounters->NumEntities.fetch_add(NumEntities, std::memory_order_relaxed);
+	}
+
+	ExecutionStats.AddSample(WallTimeMs, PrerequisitesWaitTimeMs, NumEntities, NumChunks, NumCommands);
+}
+
+void UMassProcessor::RegisterQuery(FMassEntityQuery& Query)
+{
+	// the query needs to be a member of this processor, otherwise the pointer stored could outlive it
+	const UPTRINT ThisStart = (UPTRINT)this;
+	const UPTRINT ThisEnd = ThisStart + GetClass()->GetStructureSize();
+	const UPTRINT QueryStart = (UPTRINT)&Query;
+	const UPTRINT QueryEnd = QueryStart + sizeof(FMassEntityQuery);
+
+	if (ensureMsgf(QueryStart >= ThisStart && QueryEnd <= ThisEnd
+		, TEXT("Only the queries being members of %s can be registered with it. The query's requirements won't be used to infer its dependencies."), *GetName()))
+	{
+		checkf(OwnedQueries.Find(&Query) == INDEX_NONE, TEXT("Query already registered with %s"), *GetName());
+		OwnedQueries.Add(&Query);
+	}
+}
+
+void UMassProcessor::ExportRequirements(FMassExecutionRequirements& OutRequirements) const
+{
+	for (const FMassEntityQuery* Query : OwnedQueries)
+	{
+		check(Query);
+		Query->ExportRequirements(OutRequirements);
+	}
 }
 
 FGraphEventRef UMassProcessor::DispatchProcessorTasks(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& ExecutionContext, const FGraphEventArray& Prerequisites)
@@ -275,53 +348,23 @@ FGraphEventRef UMassCompositeProcessor::DispatchProcessorTasks(UMassEntitySubsys
 
 void UMassCompositeProcessor::Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context)
 {
-#if PARALLELIZED_TRAFFIC_HACK
-	if (FMassTweakables::bParallelGroups == false
-		&& UE::MassTraffic::bParallelizeTraffic && GetProcessingPhase() == EMassProcessingPhase::PrePhysics)
-	{
-		static FName TrafficGroup(TEXT("Traffic"));
-		FMassExecutionContext TrafficExecutionContext;
-		FGraphEventRef TrafficCompletionEvent;
-
-		for (UMassProcessor* Proc : ChildPipeline.Processors)
-		{
-			check(Proc);
-				if (GetProcessingPhase() == EMassProcessingPhase::PrePhysics)
-			{
-				if (const UMassCompositeProcessor* CompProcessor = Cast<UMassCompositeProcessor>(Proc))
-				{
-					if (CompProcessor->GetGroupName() == TrafficGroup)
-					{
-						TrafficExecutionContext = Context;
-						// Needs its own command buffer as it will be in it own thread, will be merged after this loop
-						TrafficExecutionContext.SetDeferredCommandBuffer(MakeShareable(new FMassCommandBuffer()));
-						TrafficCompletionEvent = TGraphTask<FMassProcessorTask>::CreateTask().ConstructAndDispatchWhenReady(EntitySubsystem, TrafficExecutionContext, *Proc, /*bManageCommandBuffer=*/false);
-						continue;
-					}
-				}
-			}
-			Proc->CallExecute(EntitySubsystem, Context);
-		}
-
-		if (TrafficCompletionEvent)
-		{
-			// synchronize with the traffic "thread"
-			TrafficCompletionEvent->Wait();
-			Context.Defer().MoveAppend(TrafficExecutionContext.Defer());
-		}
-
-		return;
-	}
-#endif // PARALLELIZED_TRAFFIC_HACK
-
 	if (FMassTweakables::bParallelGroups && bHasOffThreadSubGroups)
 	{
 		CompletionStatus.Reset();
 		CompletionStatus.AddDefaulted(ChildPipeline.Processors.Num());
 		TArray<int32> PostponedProcessors;
 
-		FMassExecutionContext SingleThreadContext = Context;
-		SingleThreadContext.SetDeferredCommandBuffer(MakeShareable(new FMassCommandBuffer()));
+		// every child node gets its own command buffer and context, regardless of the thread it runs on. Once all 
+		// the nodes are done the buffers are merged in pipeline order, which results in the same commands order 
+		// as sequential execution would produce.
+		TArray<TSharedPtr<FMassCommandBuffer>> NodeCommandBuffers;
+		TArray<FMassExecutionContext> NodeContexts;
+		NodeCommandBuffers.Reserve(ChildPipeline.Processors.Num());
+		NodeContexts.Reserve(ChildPipeline.Processors.Num());
+		for (int32 NodeIndex = 0; NodeIndex < ChildPipeline.Processors.Num(); ++NodeIndex)
+		{
+			NodeContexts.Add(Context).SetDeferredCommandBuffer(NodeCommandBuffers.Add_GetRef(MakeShareable(new FMassCommandBuffer())));
+		}
 
 		for (int32 NodeIndex = 0; NodeIndex < ChildPipeline.Processors.Num(); ++NodeIndex)
 		{
@@ -347,7 +390,7 @@ void UMassCompositeProcessor::Execute(UMassEntitySubsystem& EntitySubsystem, FMa
 						, CompositeProc ? *CompositeProc->GetGroupName().ToString() : *Proc->GetProcessorName()
 						, FPlatformTLS::GetCurrentThreadId());
 
-					Proc->CallExecute(EntitySubsystem, SingleThreadContext);
+					Proc->CallExecute(EntitySubsystem, NodeContexts[NodeIndex]);
 					CompletionStatus[NodeIndex].Status = EProcessorCompletionStatus::Done;
 				}
 				else
@@ -381,8 +424,8 @@ void UMassCompositeProcessor::Execute(UMassEntitySubsystem& EntitySubsystem, FMa
 				PROCESSOR_LOG(TEXT("+--+ Task %s created. %s%s"), *Proc->GetProcessorName()
 					, DependenciesDesc.Len() > 0 ? TEXT(" Dependencies: ") : TEXT(""), *DependenciesDesc);
 
-				// send off to another thread
-				CompletionStatus[NodeIndex].CompletionEvent = TGraphTask<FMassProcessorTask>::CreateTask(&Prerequisites).ConstructAndDispatchWhenReady(EntitySubsystem, Context, *Proc);
+				// send off to another thread. The task writes directly to the node's dedicated command buffer, no locking required.
+				CompletionStatus[NodeIndex].CompletionEvent = TGraphTask<FMassProcessorTask>::CreateTask(&Prerequisites).ConstructAndDispatchWhenReady(EntitySubsystem, NodeContexts[NodeIndex], *Proc, /*bManageCommandBuffer=*/false);
 				CompletionStatus[NodeIndex].Status = EProcessorCompletionStatus::Threaded;
 			}
 		}
@@ -406,7 +449,7 @@ void UMassCompositeProcessor::Execute(UMassEntitySubsystem& EntitySubsystem, FMa
 
 				if (Proc->TransientDependencyIndices.Num() == 0)
 				{
-					Proc->CallExecute(EntitySubsystem, SingleThreadContext);
+					Proc->CallExecute(EntitySubsystem, NodeContexts[PostponedIndex]);
 					CompletionStatus[PostponedIndex].Status = EProcessorCompletionStatus::Done;
 					CompletionStatus[PostponedIndex].CompletionEvent->DispatchSubsequents();
 					PostponedProcessors.RemoveAt(i--, 1, /*bAllowShrinking=*/false);
@@ -424,7 +467,8 @@ void UMassCompositeProcessor::Execute(UMassEntitySubsystem& EntitySubsystem, FMa
 				Event.CompletionEvent->Wait();
 			}
 		}
-		Context.Defer().MoveAppend(SingleThreadContext.Defer());
+		// merge in the pipeline order so that the resulting commands sequence doesn't depend on threads' timing
+		Context.Defer().MoveAppendOrdered(NodeCommandBuffers);
 	}
 	else
 	{
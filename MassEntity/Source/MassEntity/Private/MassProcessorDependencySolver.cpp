@@ -6,10 +6,18 @@
 #include "Logging/MessageLog.h"
 #include "HAL/FileManager.h"
 #include "Misc/Paths.h"
+#include "HAL/IConsoleManager.h"
 #include "Engine/World.h"
 
 #define LOCTEXT_NAMESPACE "Mass"
 
+namespace UE::Mass::Private
+{
+	bool bInferProcessorDependencies = true;
+	FAutoConsoleVariableRef CVarInferProcessorDependencies(TEXT("mass.InferProcessorDependencies"), bInferProcessorDependencies
+		, TEXT("When enabled processors with conflicting fragment access (as declared by their registered queries) will get dependencies added, unless already ordered explicitly."), ECVF_Default);
+}
+
 //----------------------------------------------------------------------//
 //  FProcessorDependencySolver::FNode
 //----------------------------------------------------------------------//
@@ -261,6 +269,75 @@ void FProcessorDependencySolver::BuildDependencies(FNode& RootNode)
 	}
 }
 
+void FProcessorDependencySolver::GatherRequirements(FNode& RootNode)
+{
+	if (RootNode.Processor)
+	{
+		RootNode.Processor->ExportRequirements(RootNode.Requirements);
+		RootNode.bHasRequirements = RootNode.Processor->HasRegisteredQueries();
+		return;
+	}
+
+	for (FNode& SubNode : RootNode.SubNodes)
+	{
+		GatherRequirements(SubNode);
+		if (SubNode.bHasRequirements)
+		{
+			RootNode.Requirements.Append(SubNode.Requirements);
+			RootNode.bHasRequirements = true;
+		}
+	}
+}
+
+void FProcessorDependencySolver::InferDependencies(FNode& RootNode, TConstArrayView<int32> SortedNodeIndices)
+{
+	// for every node we track all the nodes it transitively depends on, so that we add only the dependencies that
+	// actually change the execution graph
+	TArray<TBitArray<>> Ancestors;
+	Ancestors.SetNum(RootNode.SubNodes.Num());
+	for (TBitArray<>& NodeAncestors : Ancestors)
+	{
+		NodeAncestors.Init(false, RootNode.SubNodes.Num());
+	}
+
+	for (int32 SortedIndex = 0; SortedIndex < SortedNodeIndices.Num(); ++SortedIndex)
+	{
+		const int32 NodeIndex = SortedNodeIndices[SortedIndex];
+		FNode& Node = RootNode.SubNodes[NodeIndex];
+		TBitArray<>& NodeAncestors = Ancestors[NodeIndex];
+
+		for (const int32 DependencyIndex : Node.OriginalDependencies)
+		{
+			NodeAncestors[DependencyIndex] = true;
+			NodeAncestors.CombineWithBitwiseOR(Ancestors[DependencyIndex], EBitwiseOperatorFlags::MaintainSize);
+		}
+
+		if (Node.bHasRequirements == false)
+		{
+			continue;
+		}
+
+		// going from the closest preceding nodes so that the dependencies added make the further ones redundant
+		for (int32 PrecedingSortedIndex = SortedIndex - 1; PrecedingSortedIndex >= 0; --PrecedingSortedIndex)
+		{
+			const int32 PrecedingIndex = SortedNodeIndices[PrecedingSortedIndex];
+			const FNode& PrecedingNode = RootNode.SubNodes[PrecedingIndex];
+			if (NodeAncestors[PrecedingIndex] == false
+				&& PrecedingNode.bHasRequirements
+				&& Node.Requirements.ConflictsWith(PrecedingNode.Requirements))
+			{
+				UE_LOG(LogMass, Log, TEXT("%s inferred dependency: %s after %s due to conflicting data access")
+					, *RootNode.Name.ToString(), *Node.Name.ToString(), *PrecedingNode.Name.ToString());
+
+				Node.OriginalDependencies.Add(PrecedingIndex);
+				NodeAncestors[PrecedingIndex] = true;
+				NodeAncestors.CombineWithBitwiseOR(Ancestors[PrecedingIndex], EBitwiseOperatorFlags::MaintainSize);
+				InferredDependencies.Add({ &PrecedingNode, &Node });
+			}
+		}
+	}
+}
+
 void FProcessorDependencySolver::LogNode(const FNode& RootNode, const FNode* ParentNode, int Indent)
 {
 	FString Dependencies;
@@ -651,12 +728,56 @@ struct FDumpGraphDependencyUtils
 		}
 	}
 
-	static void DumpAllGraphDependencies(FArchive& LogFile, const FProcessorDependencySolver::FNode& GroupRootNode, const TSet<const FProcessorDependencySolver::FNode*>& AllNodes)
+	static void DumpInferredDependencies(FArchive& LogFile, TConstArrayView<TPair<const FProcessorDependencySolver::FNode*, const FProcessorDependencySolver::FNode*>> InferredDependencies)
+	{
+		TSet<TPair<const FProcessorDependencySolver::FNode*, const FProcessorDependencySolver::FNode*>> DependenciesOutputted;
+		for (const TPair<const FProcessorDependencySolver::FNode*, const FProcessorDependencySolver::FNode*>& Dependency : InferredDependencies)
+		{
+			bool bAlreadyOutputted = false;
+			DependenciesOutputted.Add(Dependency, &bAlreadyOutputted);
+			if (bAlreadyOutputted)
+			{
+				continue;
+			}
+
+			const FProcessorDependencySolver::FNode& Before = *Dependency.Key;
+			const FProcessorDependencySolver::FNode& After = *Dependency.Value;
+			const FString BeforeName = Before.Name.ToString();
+			const FString AfterName = After.Name.ToString();
+
+			// groups are linked via their End and Start nodes respectively 
+			const FString From = Before.Processor ? FString::Printf(TEXT("\"%s\""), *BeforeName) : FString::Printf(TEXT("\"%s End\""), *BeforeName.Replace(TEXT("."), TEXT(" ")));
+			const FString To = After.Processor ? FString::Printf(TEXT("\"%s\""), *AfterName) : FString::Printf(TEXT("\"%s Start\""), *AfterName.Replace(TEXT("."), TEXT(" ")));
+			FString Attributes = TEXT("style=dashed, color=blue, label=\"inferred\"");
+			if (!Before.Processor)
+			{
+				Attributes += FString::Printf(TEXT(", ltail=cluster_%s"), *BeforeName.Replace(TEXT("."), TEXT("_")));
+			}
+			if (!After.Processor)
+			{
+				Attributes += FString::Printf(TEXT(", lhead=cluster_%s"), *AfterName.Replace(TEXT("."), TEXT("_")));
+			}
+			LogFile.Logf(TEXT("    %s -> %s[%s];"), *From, *To, *Attributes);
+		}
+	}
+
+	static void DumpAllGraphDependencies(FArchive& LogFile, const FProcessorDependencySolver::FNode& GroupRootNode, const TSet<const FProcessorDependencySolver::FNode*>& AllNodes
+		, TConstArrayView<TPair<const FProcessorDependencySolver::FNode*, const FProcessorDependencySolver::FNode*>> InferredDependencies)
 	{
 		TSet<const FProcessorDependencySolver::FNode*> DependsOnStart = AllNodes;
 		TSet<const FProcessorDependencySolver::FNode*> LinkToEnd = AllNodes;
 		const FString GraphName = GroupRootNode.Name.ToString();
 		FDumpGraphDependencyUtils::DumpGraphDependencies(LogFile, GroupRootNode, TArray<const FProcessorDependencySolver::FNode*>(), TArray<const FProcessorDependencySolver::FNode*>(), TArray<const FProcessorDependencySolver::FNode*>(), DependsOnStart, LinkToEnd);
+
+		// the inferred dependencies are not part of the processors' execution order, so they get drawn separately, in 
+		// their own style, and only once. The nodes they link no longer need the links to graph's start and end.
+		for (const TPair<const FProcessorDependencySolver::FNode*, const FProcessorDependencySolver::FNode*>& Dependency : InferredDependencies)
+		{
+			RemoveAllProcessorFromSet(*Dependency.Key, LinkToEnd);
+			RemoveAllProcessorFromSet(*Dependency.Value, DependsOnStart);
+		}
+		FDumpGraphDependencyUtils::DumpInferredDependencies(LogFile, InferredDependencies);
+
 		FDumpGraphDependencyUtils::PromoteStartAndEndDependency(LogFile, GraphName, GroupRootNode, DependsOnStart, LinkToEnd);
 		for (const FProcessorDependencySolver::FNode* Node : DependsOnStart)
 		{
@@ -677,7 +798,7 @@ void FProcessorDependencySolver::DumpGraph(FArchive& LogFile) const
 	LogFile.Logf(TEXT("    compound = true;"));
 	LogFile.Logf(TEXT("    newrank = true;"));
 	FDumpGraphDependencyUtils::DumpGraphNode(LogFile, GroupRootNode, 4/* Indent */, AllNodes, true/* bRoot */);
-	FDumpGraphDependencyUtils::DumpAllGraphDependencies(LogFile, GroupRootNode, AllNodes);
+	FDumpGraphDependencyUtils::DumpAllGraphDependencies(LogFile, GroupRootNode, AllNodes, InferredDependencies);
 	LogFile.Logf(TEXT("}"));
 }
 
@@ -784,6 +905,11 @@ void FProcessorDependencySolver::Solve(FNode& RootNode, TConstArrayView<const FN
 		}
 	}
 
+	if (UE::Mass::Private::bInferProcessorDependencies)
+	{
+		InferDependencies(RootNode, SortedNodeIndices);
+	}
+
 	// now we have the desired order in SortedNodeIndices. We have to traverse it recursively to add to OutResult
 	for (int i = 0; i < SortedNodeIndices.Num(); ++i)
 	{
@@ -833,6 +959,7 @@ void FProcessorDependencySolver::ResolveDependencies(TArray<FProcessorDependency
 	}
 
 	BuildDependencies(GroupRootNode);
+	GatherRequirements(GroupRootNode);
 	// @todo anything in GroupRootNode.Dependencies is an undefined symbol
 
 	// Any dependencies that are promoted to the root node means they are unresolved.
@@ -855,6 +982,11 @@ void FProcessorDependencySolver::ResolveDependencies(TArray<FProcessorDependency
 
 	LogNode(GroupRootNode);
 	
+	GroupRootNode.TransientDependencies = GroupRootNode.OriginalDependencies;
+	InferredDependencies.Reset();
+	Solve(GroupRootNode, PriorityNodes, OutResult);
+
+	// dumping after solving so that the inferred dependencies are included
 	if (!DependencyGraphFileName.IsEmpty())
 	{
 		const FString FileName = FString::Printf(TEXT("%s%s-%s.dot"), *FPaths::ProjectLogDir(), *DependencyGraphFileName, *FDateTime::Now().ToString());
@@ -871,9 +1003,6 @@ void FProcessorDependencySolver::ResolveDependencies(TArray<FProcessorDependency
 		}
 	}
 
-	GroupRootNode.TransientDependencies = GroupRootNode.OriginalDependencies;
-	Solve(GroupRootNode, PriorityNodes, OutResult);
-
 #if WITH_UNREAL_DEVELOPER_TOOLS
 	if (bAnyCyclesDetected || bAnyUnresolvedDependencies)
 	{
@@ -151,6 +151,77 @@ struct FInternalEntityHandle
 	int32 IndexWithinChunk = INDEX_NONE;
 };
 
+namespace UE::Mass
+{
+	/** 
+	 * Returns a new, monotonically increasing change version. Fragment columns in archetype chunks store the version 
+	 * of their last modification, and the versions are global so that they can be compared across archetypes.
+	 */
+	MASSENTITY_API uint64 GetNextChangeVersion();
+
+	/**
+	 * Returns the version writes done outside of query execution (structural changes, SetFragmentData) get marked with.
+	 * It's newer than any version handed out so far, so the writes get reported to every query's next run, but it 
+	 * doesn't advance the counter, keeping such writes cheap.
+	 */
+	MASSENTITY_API uint64 GetPendingChangeVersion();
+} // namespace UE::Mass
+
+/** 
+ * Initial values of a single fragment type for entities being created in bulk, stored as a contiguous array 
+ * of FragmentType instances, one per entity. See UMassEntitySubsystem::BatchCreateEntities.
+ */
+struct FMassFragmentInitialValues
+{
+	FMassFragmentInitialValues() = default;
+	FMassFragmentInitialValues(const UScriptStruct* InFragmentType, const void* InValues, const int32 InNum)
+		: FragmentType(InFragmentType), Values(InValues), Num(InNum)
+	{}
+
+	template<typename TFragment>
+	static FMassFragmentInitialValues Make(TConstArrayView<TFragment> InValues)
+	{
+		return FMassFragmentInitialValues(TFragment::StaticStruct(), InValues.GetData(), InValues.Num());
+	}
+
+	const UScriptStruct* FragmentType = nullptr;
+	const void* Values = nullptr;
+	int32 Num = 0;
+};
+
+/** Archetype chunk memory pool's statistics, see UMassEntitySubsystem::GetChunkMemoryStats */
+struct FMassChunkMemoryStats
+{
+	/** Number of chunk memory allocations served with pooled memory */
+	int64 NumHits = 0;
+	/** Number of chunk memory allocations that had to be forwarded to the general-purpose allocator */
+	int64 NumMisses = 0;
+	/** Number of pooled pages released back to the general-purpose allocator, either on trimming or due to the pool's size limit */
+	int64 NumReleased = 0;
+	/** Chunk memory currently used by archetypes' chunks */
+	int64 InUseBytes = 0;
+	/** Idle chunk memory held by the pool */
+	int64 PooledBytes = 0;
+	/** The highest InUseBytes + PooledBytes observed */
+	int64 PeakResidentBytes = 0;
+};
+
+/** Describes how densely an archetype's entities are packed in its chunks, see UMassEntitySubsystem::GetArchetypeFragmentationInfo */
+struct FMassArchetypeFragmentationInfo
+{
+	int32 NumEntities = 0;
+	/** Number of entities the archetype's allocated chunks can hold */
+	int32 EntityCapacity = 0;
+	int32 NumChunks = 0;
+	/** Number of chunks that are neither empty nor full. Compaction brings it down to at most 1. */
+	int32 NumPartialChunks = 0;
+	/** Number of chunks that hold no entities but still have their memory allocated */
+	int32 NumEmptyChunks = 0;
+
+	/** @return the occupied to allocated entity slots ratio, 1 for archetypes with no chunks */
+	float GetOccupancy() const { return EntityCapacity > 0 ? float(NumEntities) / float(EntityCapacity) : 1.f; }
+};
+
 typedef TArray<int32, TInlineAllocator<16>> FMassFragmentIndicesMapping;
 typedef TConstArrayView<int32> FMassFragmentIndicesMappingView;
 struct FMassQueryRequirementIndicesMapping
@@ -161,6 +232,8 @@ struct FMassQueryRequirementIndicesMapping
 	FMassFragmentIndicesMapping ChunkFragments;
 	FMassFragmentIndicesMapping ConstSharedFragments;
 	FMassFragmentIndicesMapping SharedFragments;
+	/** Fragments to be tested by the change filter, see FMassEntityQuery::AddChangedFilter */
+	FMassFragmentIndicesMapping ChangedFilterFragments;
 	FORCEINLINE bool IsEmpty() const
 	{
 		return EntityFragments.Num() == 0 || ChunkFragments.Num() == 0;
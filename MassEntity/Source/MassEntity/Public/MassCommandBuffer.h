@@ -9,12 +9,18 @@
 
 #include "MassCommandBuffer.generated.h"
 
+namespace UE::FLWCCommand
+{
+	/** Whether single-entity tag and fragment commands get applied as batched archetype moves, see massentities.CoalesceCommands */
+	MASSENTITY_API extern bool bCoalesceCommands;
+} // UE::FLWCCommand
 
 namespace ECommandBufferOperationType
 {
 	constexpr int None = 1 << 0;
 	constexpr int Add = 1 << 1;
 	constexpr int Remove = 1 << 2;
+	constexpr int Change = 1 << 3;
 };
 
 //@TODO: Consider debug information in case there is an assert when replaying the command buffer
@@ -41,6 +47,18 @@ struct FMassObservedTypeCollection
 		Types.Reset();
 	}
 
+	void Append(FMassObservedTypeCollection&& Other)
+	{
+		for (TPair<const UScriptStruct*, TArray<FMassEntityHandle>>& It : Other.Types)
+		{
+			Types.FindOrAdd(It.Key).Append(MoveTemp(It.Value));
+		}
+		// the cached collection pointer could have been invalidated by the additions
+		LastAddedType = nullptr;
+		LastUsedCollection = nullptr;
+		Other.Reset();
+	}
+
 	const TMap<const UScriptStruct*, TArray<FMassEntityHandle>>& GetTypes() const 
 	{ 
 		return Types; 
@@ -55,6 +73,7 @@ private:
 struct FMassCommandsObservedTypes
 {
 	void Reset();
+	void Append(FMassCommandsObservedTypes&& Other);
 	void FragmentAdded(const UScriptStruct* TypeType, FMassEntityHandle Entity)
 	{
 		check(TypeType);
@@ -65,6 +84,21 @@ struct FMassCommandsObservedTypes
 		check(TypeType);
 		FragmentsToRemove.Add(*TypeType, Entity);
 	}
+	void TagAdded(const UScriptStruct* TypeType, FMassEntityHandle Entity)
+	{
+		check(TypeType);
+		TagsToAdd.Add(*TypeType, Entity);
+	}
+	void TagRemoved(const UScriptStruct* TypeType, FMassEntityHandle Entity)
+	{
+		check(TypeType);
+		TagsToRemove.Add(*TypeType, Entity);
+	}
+	void SharedFragmentChanged(const UScriptStruct* TypeType, FMassEntityHandle Entity)
+	{
+		check(TypeType);
+		SharedFragmentsToChange.Add(*TypeType, Entity);
+	}
 
 	const TMap<const UScriptStruct*, TArray<FMassEntityHandle>>& GetFragmentsToAdd() const
 	{
@@ -76,9 +110,27 @@ struct FMassCommandsObservedTypes
 		return FragmentsToRemove.GetTypes();
 	}
 
+	const TMap<const UScriptStruct*, TArray<FMassEntityHandle>>& GetTagsToAdd() const
+	{
+		return TagsToAdd.GetTypes();
+	}
+
+	const TMap<const UScriptStruct*, TArray<FMassEntityHandle>>& GetTagsToRemove() const
+	{
+		return TagsToRemove.GetTypes();
+	}
+
+	const TMap<const UScriptStruct*, TArray<FMassEntityHandle>>& GetSharedFragmentsToChange() const
+	{
+		return SharedFragmentsToChange.GetTypes();
+	}
+
 protected:
 	FMassObservedTypeCollection FragmentsToAdd;
 	FMassObservedTypeCollection FragmentsToRemove;
+	FMassObservedTypeCollection TagsToAdd;
+	FMassObservedTypeCollection TagsToRemove;
+	FMassObservedTypeCollection SharedFragmentsToChange;
 };
 
 
@@ -220,6 +272,8 @@ struct MASSENTITY_API FCommandAddFragment : public FCommandBufferEntryBase
 		ObservedTypes.FragmentAdded(StructParam, TargetEntity);
 	}
 
+	const UScriptStruct* GetStructParam() const { return StructParam; }
+
 protected:
 	virtual void Execute(UMassEntitySubsystem& System) const override;
 
@@ -314,6 +368,8 @@ struct MASSENTITY_API FCommandRemoveFragment : public FCommandBufferEntryBase
 		ObservedTypes.FragmentRemoved(StructParam, TargetEntity);
 	}
 
+	const UScriptStruct* GetStructParam() const { return StructParam; }
+
 protected:
 	virtual void Execute(UMassEntitySubsystem& System) const override;
 
@@ -396,7 +452,7 @@ struct MASSENTITY_API FCommandAddTag: public FCommandBufferEntryBase
 
 	enum
 	{
-		Type = ECommandBufferOperationType::None
+		Type = ECommandBufferOperationType::Add
 	};
 
 	FCommandAddTag() = default;
@@ -405,6 +461,13 @@ struct MASSENTITY_API FCommandAddTag: public FCommandBufferEntryBase
 		, StructParam(InStruct)
 	{}
 
+	void AppendAffectedEntitesPerType(FMassCommandsObservedTypes& ObservedTypes)
+	{
+		ObservedTypes.TagAdded(StructParam, TargetEntity);
+	}
+
+	const UScriptStruct* GetStructParam() const { return StructParam; }
+
 protected:
 	virtual void Execute(UMassEntitySubsystem& System) const override;
 
@@ -421,7 +484,7 @@ struct MASSENTITY_API FCommandRemoveTag : public FCommandBufferEntryBase
 
 	enum
 	{
-		Type = ECommandBufferOperationType::None
+		Type = ECommandBufferOperationType::Remove
 	};
 
 	FCommandRemoveTag() = default;
@@ -430,6 +493,13 @@ struct MASSENTITY_API FCommandRemoveTag : public FCommandBufferEntryBase
 		, StructParam(InStruct)
 	{}
 
+	void AppendAffectedEntitesPerType(FMassCommandsObservedTypes& ObservedTypes)
+	{
+		ObservedTypes.TagRemoved(StructParam, TargetEntity);
+	}
+
+	const UScriptStruct* GetStructParam() const { return StructParam; }
+
 protected:
 	virtual void Execute(UMassEntitySubsystem& System) const override;
 
@@ -447,7 +517,7 @@ struct MASSENTITY_API FCommandSwapTags : public FCommandBufferEntryBase
 
 	enum
 	{
-		Type = ECommandBufferOperationType::None //ECommandBufferOperationType::Add | ECommandBufferOperationType::Remove
+		Type = ECommandBufferOperationType::Add | ECommandBufferOperationType::Remove
 	};
 
 	FCommandSwapTags() = default;
@@ -460,6 +530,18 @@ struct MASSENTITY_API FCommandSwapTags : public FCommandBufferEntryBase
 		checkf((InNewTagType == nullptr) || InNewTagType->IsChildOf(FMassTag::StaticStruct()), TEXT("FCommandSwapTags works only with tags while '%s' is not one."), *GetPathNameSafe(InNewTagType));
 	}
 
+	void AppendAffectedEntitesPerType(FMassCommandsObservedTypes& ObservedTypes)
+	{
+		if (OldTagType)
+		{
+			ObservedTypes.TagRemoved(OldTagType, TargetEntity);
+		}
+		if (NewTagType)
+		{
+			ObservedTypes.TagAdded(NewTagType, TargetEntity);
+		}
+	}
+
 protected:
 	virtual void Execute(UMassEntitySubsystem& System) const override;
 
@@ -499,6 +581,15 @@ struct MASSENTITY_API FCommandRemoveComposition : public FCommandBufferEntryBase
 				ObservedTypes.FragmentRemoved(StructParam, TargetEntity);
 			}
 		}
+		if (Descriptor.Tags.IsEmpty() == false)
+		{
+			TArray<const UScriptStruct*> Tags;
+			Descriptor.Tags.ExportTypes(Tags);
+			for (const UScriptStruct* StructParam : Tags)
+			{
+				ObservedTypes.TagRemoved(StructParam, TargetEntity);
+			}
+		}
 	}
 
 protected:
@@ -507,6 +598,68 @@ protected:
 	FMassArchetypeCompositionDescriptor Descriptor;
 };
 
+/**
+ * Command replacing the value of a shared fragment an existing entity is using. The entity needs to already have
+ * a shared fragment of the given type.
+ */
+USTRUCT()
+struct MASSENTITY_API FCommandSetSharedFragment : public FCommandBufferEntryBase
+{
+	GENERATED_BODY()
+
+	enum
+	{
+		Type = ECommandBufferOperationType::Change
+	};
+
+	FCommandSetSharedFragment() = default;
+	FCommandSetSharedFragment(const FMassEntityHandle InEntity, const FSharedStruct& InFragment)
+		: FCommandBufferEntryBase(InEntity)
+		, Fragment(InFragment)
+	{}
+
+	void AppendAffectedEntitesPerType(FMassCommandsObservedTypes& ObservedTypes)
+	{
+		ObservedTypes.SharedFragmentChanged(Fragment.GetScriptStruct(), TargetEntity);
+	}
+
+protected:
+	virtual void Execute(UMassEntitySubsystem& System) const override;
+
+	FSharedStruct Fragment;
+};
+
+/**
+ * Command replacing the value of a const shared fragment an existing entity is using. The entity needs to already 
+ * have a const shared fragment of the given type.
+ */
+USTRUCT()
+struct MASSENTITY_API FCommandSetConstSharedFragment : public FCommandBufferEntryBase
+{
+	GENERATED_BODY()
+
+	enum
+	{
+		Type = ECommandBufferOperationType::Change
+	};
+
+	FCommandSetConstSharedFragment() = default;
+	FCommandSetConstSharedFragment(const FMassEntityHandle InEntity, const FConstSharedStruct& InFragment)
+		: FCommandBufferEntryBase(InEntity)
+		, Fragment(InFragment)
+	{}
+
+	void AppendAffectedEntitesPerType(FMassCommandsObservedTypes& ObservedTypes)
+	{
+		ObservedTypes.SharedFragmentChanged(Fragment.GetScriptStruct(), TargetEntity);
+	}
+
+protected:
+	virtual void Execute(UMassEntitySubsystem& System) const override;
+
+	FConstSharedStruct Fragment;
+};
+
 struct MASSENTITY_API FMassCommandBuffer
 {
 public:
@@ -532,7 +685,8 @@ public:
 	{
 		UE_MT_SCOPED_WRITE_ACCESS(PendingCommandsDetector);
 		T& Command = PendingCommands.Emplace_GetRef<T>(Forward<TArgs>(InArgs)...); 
-		if (constexpr bool bIsModifyingComposition = ((T::Type & (ECommandBufferOperationType::Add | ECommandBufferOperationType::Remove)) != 0))
+		++NumCommandsIssued;
+		if (constexpr bool bIsModifyingComposition = ((T::Type & (ECommandBufferOperationType::Add | ECommandBufferOperationType::Remove | ECommandBufferOperationType::Change)) != 0))
 		{	
 			Command.AppendAffectedEntitesPerType(ObservedTypes);
 		}
@@ -568,14 +722,28 @@ public:
 		EmplaceCommand<FCommandRemoveTag>(Entity, T::StaticStruct());
 	}
 
+	/** Makes Entity use Fragment as the value of its shared fragment of Fragment's type */
+	void SetSharedFragment(FMassEntityHandle Entity, const FSharedStruct& Fragment)
+	{
+		EmplaceCommand<FCommandSetSharedFragment>(Entity, Fragment);
+	}
+
+	/** Makes Entity use Fragment as the value of its const shared fragment of Fragment's type */
+	void SetConstSharedFragment(FMassEntityHandle Entity, const FConstSharedStruct& Fragment)
+	{
+		EmplaceCommand<FCommandSetConstSharedFragment>(Entity, Fragment);
+	}
+
 	void DestroyEntity(FMassEntityHandle Entity)
 	{
 		EntitiesToDestroy.Add(Entity);
+		++NumCommandsIssued;
 	}
 
 	void BatchDestroyEntities(const TArray<FMassEntityHandle>& InEntitiesToDestroy)
 	{
 		EntitiesToDestroy.Append(InEntitiesToDestroy);
+		NumCommandsIssued += InEntitiesToDestroy.Num();
 	}
 
 	void ReplayBufferAgainstSystem(UMassEntitySubsystem* System);
@@ -589,9 +757,26 @@ public:
 	 */
 	void MoveAppend(FMassCommandBuffer& InOutOther);
 
+	/**
+	 * Appends the commands from all the passed buffers into this one, in the order the buffers are given. Unlike 
+	 * MoveAppend this function doesn't lock, it's meant to be called by the thread owning this buffer once all the 
+	 * work filling the other buffers has been completed. 
+	 * @param InOutOthers the source buffers. Note that after the call all of them will be emptied.
+	 */
+	void MoveAppendOrdered(TConstArrayView<TSharedPtr<FMassCommandBuffer>> InOutOthers);
+
 	bool HasPendingCommands() const { return PendingCommands.Num() > 0 || EntitiesToDestroy.Num() > 0; }
 
+	/** 
+	 * @return the total number of commands issued with this buffer, including the ones appended via MoveAppend and 
+	 *	MoveAppendOrdered. Never decreases, not even when the commands get replayed, so the difference between two reads 
+	 *	tells how many commands have been issued in between. Used for gathering processor stats.
+	 */
+	int32 GetNumCommandsIssued() const { return NumCommandsIssued; }
+
 private:
+	void MoveAppendInternal(FMassCommandBuffer& InOutOther);
+
 	FInstancedStructStream PendingCommands;
 	UE_MT_DECLARE_RW_ACCESS_DETECTOR(PendingCommandsDetector);
 	FCriticalSection AppendingCommandsCS;
@@ -599,4 +784,6 @@ private:
 	TArray<FMassEntityHandle> EntitiesToDestroy;
 
 	FMassCommandsObservedTypes ObservedTypes;
+
+	int32 NumCommandsIssued = 0;
 };
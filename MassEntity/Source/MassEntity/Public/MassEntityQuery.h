@@ -11,11 +11,20 @@
 
 
 class UMassEntitySubsystem;
+class UMassProcessor;
 struct FMassArchetypeData;
 struct FMassExecutionContext;
 struct FMassFragment;
 struct FArchetypeHandle;
 
+namespace UE::Mass::Private
+{
+	/** Number of job batches, per worker thread, ParallelForEachEntityChunk aims for, see mass.ParallelJobBatchesPerWorker */
+	MASSENTITY_API extern int32 ParallelJobBatchesPerWorker;
+	/** Minimal number of entities ParallelForEachEntityChunk packs into a single batch, see mass.ParallelMinBatchSize */
+	MASSENTITY_API extern int32 ParallelMinBatchSize;
+} // UE::Mass::Private
+
 enum class EMassFragmentAccess : uint8
 {
 	// no binding required
@@ -84,6 +93,27 @@ public:
 };
 
 
+/**
+ * Describes the fragments read and written by a query, or by a set of queries, and allows detecting conflicting data 
+ * access, i.e. one side writing data the other side reads or writes. Const shared fragments are always considered read-only.
+ */
+struct MASSENTITY_API FMassExecutionRequirements
+{
+	void Append(const FMassExecutionRequirements& Other);
+	bool IsEmpty() const;
+
+	/** @return whether running the owners of this and Other concurrently could result in a data race */
+	bool ConflictsWith(const FMassExecutionRequirements& Other) const;
+
+	FMassFragmentBitSet FragmentsRead;
+	FMassFragmentBitSet FragmentsWritten;
+	FMassChunkFragmentBitSet ChunkFragmentsRead;
+	FMassChunkFragmentBitSet ChunkFragmentsWritten;
+	FMassSharedFragmentBitSet SharedFragmentsRead;
+	FMassSharedFragmentBitSet SharedFragmentsWritten;
+};
+
+
 /** 
  *  FMassEntityQuery is a structure that serves two main purposes:
  *  1. Describe properties required of an archetype that's a subject of calculations
@@ -101,6 +131,11 @@ public:
 	FMassEntityQuery();
 	FMassEntityQuery(std::initializer_list<UScriptStruct*> InitList);
 	FMassEntityQuery(TConstArrayView<const UScriptStruct*> InitList);
+	/** 
+	 * Creates a query owned by Owner, registering it so that its requirements get used to infer Owner's execution 
+	 * dependencies. Meant for queries being members of Owner, initialized in Owner's constructor. 
+	 */
+	explicit FMassEntityQuery(UMassProcessor& Owner);
 
 	/** Runs ExecuteFunction on all entities matching Requirements */
 	void ForEachEntityChunk(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& ExecutionContext, const FMassExecuteFunction& ExecuteFunction);
@@ -115,7 +150,7 @@ public:
 
 	/** Will gather all archetypes from InEntitySubsystem matching this->Requirements.
 	 *  Note that no work will be done if the cached data is up to date (as tracked by EntitySubsystemHash and 
-	 *	ArchetypeDataVersion properties). */
+	 *	ArchetypeDataVersion properties), and if only new archetypes have been created since just those get tested. */
 	void CacheArchetypes(UMassEntitySubsystem& InEntitySubsystem);
 
 	FMassEntityQuery& AddRequirement(const UScriptStruct* FragmentType, const EMassFragmentAccess AccessMode, const EMassFragmentPresence Presence = EMassFragmentPresence::All)
@@ -386,9 +421,58 @@ public:
 
 	bool HasArchetypeFilter() const { return bool(ArchetypeCondition); }
 
+	/**
+	 * Adds FragmentType to the query's change filter. With the filter set only the chunks in which at least one of the 
+	 * filtered fragments has changed since this query's previous execution will be processed. A fragment counts as
+	 * changed when it gets bound with ReadWrite access by any query, gets set via the entity subsystem's SetFragmentData 
+	 * functions, or when entities are added to or removed from the chunk. Note that the changes made by this query itself
+	 * are not reported back to it. The filter is applied to FArchetypeChunkCollection-driven execution as well.
+	 */
+	FMassEntityQuery& AddChangedFilter(const UScriptStruct& FragmentType)
+	{
+		ChangedFilterFragments.AddUnique(&FragmentType);
+		DirtyCachedData();
+		return *this;
+	}
+
+	template<typename T>
+	FMassEntityQuery& AddChangedFilter()
+	{
+		static_assert(TIsDerivedFrom<T, FMassFragment>::IsDerived, "Given struct doesn't represent a valid fragment type. Make sure to inherit from FMassFragment or one of its child-types.");
+		return AddChangedFilter(*T::StaticStruct());
+	}
+
+	void ClearChangedFilter() 
+	{ 
+		ChangedFilterFragments.Reset();
+		DirtyCachedData();
+	}
+
+	bool HasChangedFilter() const { return ChangedFilterFragments.Num() > 0; }
+
+	/** Appends the fragments this query reads and writes to OutRequirements */
+	void ExportRequirements(FMassExecutionRequirements& OutRequirements) const;
+
+	/** Controls whether ParallelForEachEntityChunk is allowed to process chunks in parallel. Can also be enabled for all queries with -ParallelMassQueries=1 */
+	void SetParallelExecutionAllowed(const bool bInAllowParallelExecution) { bAllowParallelExecution = bInAllowParallelExecution; }
+	bool IsParallelExecutionAllowed() const { return bAllowParallelExecution; }
+
+	/** 
+	 * Sets the relative cost of processing a single entity by this query, used by ParallelForEachEntityChunk to
+	 * balance the batches of chunks. The more expensive the processing the fewer entities get packed into a batch.
+	 */
+	void SetParallelExecutionCostHint(const float InCostPerEntity) { ParallelExecutionCostHint = FMath::Max(InCostPerEntity, KINDA_SMALL_NUMBER); }
+	float GetParallelExecutionCostHint() const { return ParallelExecutionCostHint; }
+
 protected:
 	void SortRequirements();
 	void ReadCommandlineParams();
+	/** 
+	 * Stores in ExecutionContext the change version of this query's current run along with the one of its previous run.
+	 * All the executions done during a single processor execution count as a single run, see UMassProcessor::CallExecute, 
+	 * otherwise every execution is a run of its own.
+	 */
+	void BeginChangeTracking(FMassExecutionContext& ExecutionContext);
 
 protected:
 	TArray<FMassFragmentRequirement> Requirements;
@@ -424,12 +508,24 @@ private:
 	 */
 	FMassArchetypeConditionFunction ArchetypeCondition;
 
+	/** Fragments the change filter tests, see AddChangedFilter */
+	TArray<const UScriptStruct*> ChangedFilterFragments;
+
+	/** The change version of this query's current (or latest) run */
+	uint64 RunChangeVersion = 0;
+	/** The change version of the run preceding the current one, the change filter reports modifications done after it */
+	uint64 ChangedSinceVersion = 0;
+
 	uint32 EntitySubsystemHash = 0;
 	uint32 ArchetypeDataVersion = 0;
+	/** The number of the entity subsystem's archetypes (see UMassEntitySubsystem::GetNumArchetypes) ValidArchetypes have been gathered from */
+	int32 NumArchetypesCached = 0;
 
 	TArray<FArchetypeHandle> ValidArchetypes;
 	TArray<FMassQueryRequirementIndicesMapping> ArchetypeFragmentMapping;
 
+	float ParallelExecutionCostHint = 1.f;
+
 	bool bAllowParallelExecution = false;
 };
 
@@ -26,6 +26,11 @@ struct FMassProcessingPhaseConfig
 	UPROPERTY(EditAnywhere, Category = Mass, config, NoClear)
 	TSubclassOf<UMassCompositeProcessor> PhaseGroupClass = UMassCompositeProcessor::StaticClass();
 
+	/** 
+	 * Names of processing groups that will be executed off the game thread (via the task graph). Every such group
+	 * records to a dedicated command buffer and waits only for the nodes it depends on, as calculated by the 
+	 * dependency solver. All the buffers get merged in the pipeline order once the whole phase is done.
+	 */
 	UPROPERTY(EditAnywhere, Category = Mass, config, NoClear)
 	TArray<FName> OffGameThreadGroupNames;
 
@@ -63,6 +68,12 @@ public:
 	const FMassProcessingPhaseConfig* GetProcessingPhasesConfig();
 	const FMassProcessingPhaseConfig& GetProcessingPhaseConfig(const EMassProcessingPhase ProcessingPhase) const { check(ProcessingPhase != EMassProcessingPhase::MAX); return ProcessingPhasesConfig[int(ProcessingPhase)]; }
 
+	/** 
+	 * Calculates the chunk memory size to be used by an archetype with the given per-entity memory footprint, 
+	 * following the ChunkMemorySize, TargetEntitiesPerChunk, MinChunkMemorySize and MaxChunkMemorySize settings.
+	 */
+	int32 GetChunkMemorySize(const int32 BytesPerEntity) const;
+
 #if WITH_EDITOR
 	FOnSettingsChange& GetOnSettingsChange() { return OnSettingsChange; }	
 
@@ -85,6 +96,75 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = Mass, Transient)
 	FString DumpDependencyGraphFileName;
 
+	/** The size of archetype chunks' memory, in bytes. Used by all archetypes unless TargetEntitiesPerChunk is set. */
+	UPROPERTY(EditDefaultsOnly, Category = "Mass|Archetypes", config, meta = (ClampMin = 1024))
+	int32 ChunkMemorySize = 64 * 1024;
+
+	/** 
+	 * If greater than 0 every archetype will get its chunk memory size calculated to fit roughly this many entities, 
+	 * rounded up to the power of two and clamped to [MinChunkMemorySize, MaxChunkMemorySize]. This evens out the
+	 * number of entities per chunk between narrow and wide archetypes, which helps parallel processing granularity 
+	 * and reduces the memory wasted by sparsely populated archetypes.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mass|Archetypes", config, meta = (ClampMin = 0))
+	int32 TargetEntitiesPerChunk = 0;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Mass|Archetypes", config, meta = (ClampMin = 1024, EditCondition = "TargetEntitiesPerChunk > 0"))
+	int32 MinChunkMemorySize = 4 * 1024;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Mass|Archetypes", config, meta = (ClampMin = 1024, EditCondition = "TargetEntitiesPerChunk > 0"))
+	int32 MaxChunkMemorySize = 256 * 1024;
+
+	/** 
+	 * If greater than 0 every archetype's fragment column, as well as the entity handle column, will start at an 
+	 * address being a multiple of this value (or of the fragment type's own alignment, whichever is bigger). Set it 
+	 * to the cache line size (64) to let processors use aligned SIMD loads and to make sure a column never shares 
+	 * a cache line with another one, at the cost of up to FragmentColumnAlignment bytes of padding per column. 
+	 * Needs to be a power of two.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mass|Archetypes", config, meta = (ClampMin = 0, ClampMax = 4096))
+	int32 FragmentColumnAlignment = 0;
+
+	/** 
+	 * If set, the memory of emptied archetype chunks is kept in an entity subsystem-wide pool and reused by chunks 
+	 * created later on (in any archetype with the same chunk size), instead of being returned to the general-purpose
+	 * allocator right away. Helps with entity spawn/despawn waves.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mass|Archetypes", config)
+	bool bPoolChunkMemory = true;
+
+	/** 
+	 * The maximum amount of idle chunk memory, in bytes, the chunk pool is allowed to hold on to. Pages freed while 
+	 * the pool is at the limit are released right away.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mass|Archetypes", config, meta = (ClampMin = 0, EditCondition = "bPoolChunkMemory"))
+	int32 MaxPooledChunkMemory = 16 * 1024 * 1024;
+
+	/** 
+	 * UMassEntitySubsystem::DoEntityCompaction only compacts archetypes whose entity occupancy (occupied to allocated 
+	 * entity slots ratio, see FMassArchetypeFragmentationInfo) is below this value. 1 compacts every archetype with 
+	 * more than one partially filled chunk.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mass|Archetypes", config, meta = (ClampMin = 0, ClampMax = 1))
+	float CompactionOccupancyThreshold = 0.9f;
+
+	/** DoEntityCompaction only compacts archetypes with at least this many partially filled chunks */
+	UPROPERTY(EditDefaultsOnly, Category = "Mass|Archetypes", config, meta = (ClampMin = 2))
+	int32 CompactionMinPartialChunks = 2;
+
+	/** If set, DoEntityCompaction compacts the archetypes in parallel, sharing its time budget between the worker threads */
+	UPROPERTY(EditDefaultsOnly, Category = "Mass|Archetypes", config)
+	bool bParallelEntityCompaction = true;
+
+	/** 
+	 * The number of entity handles UMassEntitySubsystem keeps reserved up front for the code running off the game thread,
+	 * see UMassEntitySubsystem::ConcurrentReserveEntities. The pool is refilled by the game thread at the start of every 
+	 * frame. 0, the default, disables concurrent entity reservation, so that projects not using it don't keep the 
+	 * reserved entities around.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = Mass, config, meta = (ClampMin = 0))
+	int32 ConcurrentEntityReservationPoolSize = 0;
+
 	/** Lets users configure processing phases including the composite processor class to be used as a container for the phases' processors. */
 	UPROPERTY(EditDefaultsOnly, Category = Mass, config)
 	FMassProcessingPhaseConfig ProcessingPhasesConfig[(uint8)EMassProcessingPhase::MAX];
@@ -8,7 +8,9 @@
 #include "InstancedStruct.h"
 #include "MassEntityQuery.h"
 #include "StructUtilsTypes.h"
+#include "Containers/StridedView.h"
 #include "MassObserverManager.h"
+#include "MassProcessorStats.h"
 #include "MassEntitySubsystem.generated.h"
 
 
@@ -19,8 +21,11 @@ struct FMassArchetypeData;
 struct FMassCommandBuffer;
 struct FArchetypeChunkCollection;
 struct FMassArchetypeChunk;
+class FMassChunkMemoryPool;
+class FMassEntityReservationPool;
 class FOutputDevice;
 enum class EMassFragmentAccess : uint8;
+enum class EMassArchetypeTransition : uint8;
 
 //@TODO: Comment this guy
 UCLASS()
@@ -29,6 +34,7 @@ class MASSENTITY_API UMassEntitySubsystem : public UWorldSubsystem
 	GENERATED_BODY()
 
 	friend struct FMassEntityQuery;
+	friend struct FMassArchetypeData;
 private:
 	// Index 0 is reserved so we can treat that index as an invalid entity handle
 	constexpr static int32 NumReservedEntities = 1;
@@ -37,11 +43,14 @@ private:
 	{
 		TSharedPtr<FMassArchetypeData> CurrentArchetype;
 		int32 SerialNumber = 0;
+		/** The entity's absolute index within CurrentArchetype (i.e. ChunkIndex * NumEntitiesPerChunk + IndexWithinChunk), maintained by the archetype */
+		int32 AbsoluteIndex = INDEX_NONE;
 
 		void Reset()
 		{
 			CurrentArchetype.Reset();
 			SerialNumber = 0;
+			AbsoluteIndex = INDEX_NONE;
 		}
 
 		bool IsValid() const
@@ -111,10 +120,56 @@ public:
 	static void ForEachArchetypeFragmentType(const FArchetypeHandle Archetype, TFunction< void(const UScriptStruct* /*FragmentType*/)> Function);
 
 	/**
-	 * Go through all archetypes and compact entities
+	 * Go through all archetypes and compact entities. Only the archetypes exceeding the fragmentation thresholds 
+	 * configured in UMassEntitySettings (see CompactionOccupancyThreshold) get compacted, in parallel unless 
+	 * bParallelEntityCompaction is disabled. The next call resumes with the archetypes this call didn't get to.
 	 * @param TimeAllowed to do entity compaction, once it reach that time it will stop and return
+	 * @return whether all the archetypes exceeding the thresholds got fully compacted
 	 */
-	void DoEntityCompaction(const double TimeAllowed);
+	bool DoEntityCompaction(const double TimeAllowed);
+
+	/** @return information on how densely Archetype's entities are packed in its chunks */
+	FMassArchetypeFragmentationInfo GetArchetypeFragmentationInfo(const FArchetypeHandle& Archetype) const;
+
+	/** 
+	 * Releases the idle archetype chunk memory the subsystem keeps around for reuse. The memory needed to get back 
+	 * to the highest chunk memory usage since the previous call is retained. Called automatically by DoEntityCompaction.
+	 */
+	void TrimChunkMemory();
+
+	/** @return the statistics of the pool archetype chunks get their memory from */
+	FMassChunkMemoryStats GetChunkMemoryStats() const;
+
+	/**
+	 * Writes out all the archetypes, along with their shared fragment values, and all the entities' fragments. The 
+	 * columns of fragment types made of numbers, bools, enums and structs of those are streamed out as raw chunk memory,
+	 * as long as the types are plain-old-data or all of their members are UPROPERTYs. Other types get serialized per 
+	 * entity with UScriptStruct::SerializeItem instead, meaning only their UPROPERTYs get stored (a warning gets logged
+	 * for such types with other members).
+	 * Chunk fragments are not stored.
+	 * Note that the raw data is platform-specific, the snapshot is meant to be loaded by the same build on the same platform.
+	 * @see LoadSnapshot
+	 */
+	void SaveSnapshot(FArchive& Ar) const;
+	bool SaveSnapshotToFile(const FString& Filename) const;
+
+	/**
+	 * Creates the entities stored in SnapshotData by SaveSnapshot, in the archetypes matching the stored ones. The 
+	 * entities get new handles and the FMassEntityHandle properties of their fragments get remapped accordingly 
+	 * (or reset if pointing at entities the snapshot doesn't contain), including the ones within arrays, sets and maps.
+	 * Resetting handles within sets and map keys can leave duplicates behind. The handles held by shared fragment values
+	 * don't get remapped. The raw fragment columns get copied straight from SnapshotData into the chunks. No observers 
+	 * get notified, the entities are expected to be fully initialized.
+	 * Shared fragment values created with GetOrCreate(Const)SharedFragment get reused if this subsystem already has
+	 * a value with the same hash.
+	 * @param OutEntityMapping if set gets filled with the new handle of every entity stored in the snapshot
+	 * @return whether the snapshot has been loaded. Snapshots referring to types that are missing or have changed 
+	 *	their layout fail to load without creating any entities.
+	 */
+	bool LoadSnapshot(TConstArrayView<uint8> SnapshotData, TMap<FMassEntityHandle, FMassEntityHandle>* OutEntityMapping = nullptr);
+
+	/** Memory-maps the file if the platform supports it, sparing the intermediate copy of the file's content, and calls LoadSnapshot */
+	bool LoadSnapshotFromFile(const FString& Filename, TMap<FMassEntityHandle, FMassEntityHandle>* OutEntityMapping = nullptr);
 
 	/**
 	 * Creates fully built entity ready to be used by the subsystem
@@ -146,12 +201,15 @@ public:
 		TFunction<void(FEntityCreationContext&)> OnSpawningFinished;
 	};
 
-	/** A version of CreateEntity that's creating a number of entities (Count) at one go
+	/** A version of CreateEntity that's creating a number of entities (Count) at one go. The entity indices get 
+	 *  reserved in bulk and the fragments get initialized column by column, a whole chunk's worth of entities at a time.
 	 *  @param Archetype you want this entity to be
 	 *  @param Count number of entities to create
 	 *  @param OutEntities the newly created entities are appended to given array, i.e. the pre-existing content of OutEntities won't be affected by the call
+	 *  @param InitialValues optional per-fragment arrays of Count values each, copied straight into the new entities' 
+	 *	 fragments (memcpy-ed in case of plain-old-data fragment types). Fragments without initial values get default-initialized.
 	 *  @return a creation context that will notify all the interested observers about newly created fragments once the context is released */
-	TSharedRef<FEntityCreationContext> BatchCreateEntities(const FArchetypeHandle Archetype, const int32 Count, TArray<FMassEntityHandle>& OutEntities);
+	TSharedRef<FEntityCreationContext> BatchCreateEntities(const FArchetypeHandle Archetype, const int32 Count, TArray<FMassEntityHandle>& OutEntities, TConstArrayView<FMassFragmentInitialValues> InitialValues = {});
 
 	/**
 	 * Destroys a fully built entity, use ReleaseReservedEntity if entity was not yet built.
@@ -160,9 +218,37 @@ public:
 
 	/**
 	 * Reserves an entity in the subsystem, the entity is still not ready to be used by the subsystem, need to call BuildEntity()
+	 * @note game thread only, use ConcurrentReserveEntity when running on other threads
 	 * @return FMassEntityHandle id of the reserved entity */
 	FMassEntityHandle ReserveEntity();
 
+	/**
+	 * Thread-safe, lock-free version of ReserveEntity. The handle comes from a pool of entities reserved up front by 
+	 * the game thread (see ReplenishConcurrentReservations) and, like the ones returned by ReserveEntity, needs to be 
+	 * built (or released) on the game thread, preferably via the command buffer (see FBuildEntityFromFragmentInstance(s)
+	 * and FMassCommandBuffer::BuildEntity).
+	 * These two functions and GetNumConcurrentReservationsAvailable are the only entity reservation functions that are
+	 * safe to call off the game thread. Everything else, including building and releasing the reserved entities, is not.
+	 * @note requires UMassEntitySettings::ConcurrentEntityReservationPoolSize to be configured, the pool is empty otherwise
+	 * @return the reserved entity or an invalid handle if the pool has run dry */
+	FMassEntityHandle ConcurrentReserveEntity();
+
+	/**
+	 * Thread-safe, lock-free reservation of Count entities at one go, see ConcurrentReserveEntity.
+	 * @param OutEntities the reserved entities are appended to given array
+	 * @return false if the pool didn't have Count entities available, in which case no entities get reserved */
+	bool ConcurrentReserveEntities(const int32 Count, TArray<FMassEntityHandle>& OutEntities);
+
+	/** @return the number of entities ConcurrentReserveEntities can hand out at the moment. Safe to call from any thread. */
+	int32 GetNumConcurrentReservationsAvailable() const;
+
+	/**
+	 * Tops up the pool of entities handed out by ConcurrentReserveEntities, up to the configured 
+	 * UMassEntitySettings::ConcurrentEntityReservationPoolSize. Called automatically at the start of every frame by 
+	 * UMassProcessingPhaseManager. Game thread only.
+	 * @return the number of entities added to the pool */
+	int32 ReplenishConcurrentReservations();
+
 	/**
 	 * Builds an entity for it to be ready to be used by the subsystem
 	 * @param Entity to build which was retrieved with ReserveEntity() method
@@ -181,7 +267,8 @@ public:
 	void ReleaseReservedEntity(FMassEntityHandle Entity);
 
 	/**
-	 * Destroys all the entity in the provided array of entities
+	 * Destroys all the entity in the provided array of entities. The entities are grouped per archetype and every 
+	 * archetype removes its entities at one go. Invalid and duplicate entities are ignored.
 	 * @param InEntities to destroy
 	 */
 	void BatchDestroyEntities(TConstArrayView<FMassEntityHandle> InEntities);
@@ -204,16 +291,30 @@ public:
 	void RemoveTagFromEntity(FMassEntityHandle Entity, const UScriptStruct* TagType);
 	void SwapTagsForEntity(FMassEntityHandle Entity, const UScriptStruct* FromFragmentType, const UScriptStruct* ToFragmentType);
 
+	/**
+	 * Makes Entity use Fragment as the value of its shared fragment of Fragment's type, moving the entity over to the 
+	 * archetype with the resulting shared fragment values. The entity is required to already have a shared fragment
+	 * of the given type.
+	 * @note the observers of the shared fragment type only get notified when the change comes via FMassCommandBuffer
+	 * @return whether the entity's shared fragment values have changed
+	 */
+	bool SetEntitySharedFragment(FMassEntityHandle Entity, const FSharedStruct& Fragment);
+	/** The const shared fragment counterpart of SetEntitySharedFragment */
+	bool SetEntityConstSharedFragment(FMassEntityHandle Entity, const FConstSharedStruct& Fragment);
+
 
 	/**
 	 * Adds fragments and tags indicated by InOutDescriptor to the Entity. The function also figures out which elements
 	 * in InOutDescriptor are missing from the current composition of the given entity and then returns the resulting 
 	 * delta via InOutDescriptor.
+	 * @note when adding composition to a lot of entities wrap the calls in FMassObserverManager::FScopedCompositionChangeBatching
+	 *	so that the fragment observers get run once per archetype rather than once per entity.
 	 */
 	void AddCompositionToEntity_GetDelta(FMassEntityHandle Entity, FMassArchetypeCompositionDescriptor& InOutDescriptor);
 	void RemoveCompositionFromEntity(FMassEntityHandle Entity, const FMassArchetypeCompositionDescriptor& InDescriptor);
 
 	const FMassArchetypeCompositionDescriptor& GetArchetypeComposition(const FArchetypeHandle& ArchetypeHandle) const;
+	const FMassArchetypeSharedFragmentValues& GetArchetypeSharedFragmentValues(const FArchetypeHandle& ArchetypeHandle) const;
 
 	/** 
 	 * Moves an entity over to a new archetype by copying over fragments common to both archetypes
@@ -222,6 +323,24 @@ public:
 	 */
 	void MoveEntityToAnotherArchetype(FMassEntityHandle Entity, FArchetypeHandle NewArchetypeHandle);
 
+	/**
+	 * Moves all the entities indicated by EntityCollection over to a new archetype by copying over fragments common to 
+	 * both archetypes. The copying is done a whole subchunk at a time, making it a lot cheaper than moving entities one by one.
+	 * @param EntityCollection the entities to move. Note that the collection is no longer valid once the function is done.
+	 * @param NewArchetypeHandle the handle to the new archetype
+	 */
+	void BatchMoveEntitiesToAnotherArchetype(const FArchetypeChunkCollection& EntityCollection, FArchetypeHandle NewArchetypeHandle);
+
+	/** 
+	 * Batched versions of Add/Remove Tag/Fragment functions. All the entities indicated by EntityCollection share the
+	 * same archetype so the destination archetype gets resolved once and the entities are moved over in bulk.
+	 * @note EntityCollection is no longer valid once the function is done.
+	 */
+	void BatchAddTagToEntities(const FArchetypeChunkCollection& EntityCollection, const UScriptStruct* TagType);
+	void BatchRemoveTagFromEntities(const FArchetypeChunkCollection& EntityCollection, const UScriptStruct* TagType);
+	void BatchAddFragmentToEntities(const FArchetypeChunkCollection& EntityCollection, const UScriptStruct* FragmentType);
+	void BatchRemoveFragmentFromEntities(const FArchetypeChunkCollection& EntityCollection, const UScriptStruct* FragmentType);
+
 	/** Copies values from FragmentInstanceList over to Entity's fragment. Caller is responsible for ensuring that 
 	 *  the given entity does have given fragments. Failing this assumption will cause a check-fail.*/
 	void SetEntityFragmentsValues(FMassEntityHandle Entity, TArrayView<const FInstancedStruct> FragmentInstanceList);
@@ -266,6 +385,18 @@ public:
 		return FStructView(FragmentType, static_cast<uint8*>(InternalGetFragmentDataPtr(Entity, FragmentType)));
 	}
 
+	/** 
+	 * Returns a copy of Entity's FragmentType fragment. Unlike GetFragmentDataChecked works for split fragments 
+	 * (see FMassSplitFragment) as well, whose instances don't exist in memory as a whole.
+	 */
+	template <typename FragmentType>
+	FragmentType GetFragmentValueChecked(FMassEntityHandle Entity) const
+	{
+		FragmentType Value;
+		InternalGetFragmentValueChecked(Entity, FragmentType::StaticStruct(), &Value);
+		return Value;
+	}
+
 	uint32 GetArchetypeDataVersion() const { return ArchetypeDataVersion; }
 
 	/**
@@ -339,12 +470,31 @@ public:
 #endif // WITH_MASSENTITY_DEBUG
 
 protected:
-	void GetValidArchetypes(const FMassEntityQuery& Query, TArray<FArchetypeHandle>& OutValidArchetypes);
+	/** 
+	 * Appends the archetypes matching Query to OutValidArchetypes.
+	 * @param FirstArchetypeIndex only archetypes from this index on (in creation order, see AllArchetypes) will be 
+	 *	considered. Used by queries to pick up only the archetypes created since their cached data has been built.
+	 */
+	void GetValidArchetypes(const FMassEntityQuery& Query, TArray<FArchetypeHandle>& OutValidArchetypes, const int32 FirstArchetypeIndex = 0);
+
+	/** @return the number of archetypes created so far. Archetypes are never removed, so it's also the creation index the next archetype will get */
+	int32 GetNumArchetypes() const { return AllArchetypes.Num(); }
 	
 	FArchetypeHandle InternalCreateSiblingArchetype(const TSharedPtr<FMassArchetypeData>& SourceArchetype, const FMassTagBitSet& OverrideTags);
 
+	/** 
+	 *  Fetches the archetype resulting from applying Operation with StructType to SourceArchetype. The result is looked up 
+	 *  in SourceArchetype's transition cache first and only if missing the full CreateArchetype path is taken (and
+	 *  the result cached for subsequent calls).
+	 *  @note it's caller's responsibility to ensure the operation does change the composition, i.e. we're not adding
+	 *   a tag or fragment SourceArchetype already has, or removing one it doesn't.
+	 */
+	TSharedPtr<FMassArchetypeData> InternalGetTransitionArchetype(const TSharedPtr<FMassArchetypeData>& SourceArchetype, const EMassArchetypeTransition Operation, const UScriptStruct* StructType);
+
 private:
 	void InternalBuildEntity(FMassEntityHandle Entity, const FArchetypeHandle Archetype);
+	/** Assigns indices and serial numbers to all of OutEntities, first reusing the freed indices and then growing Entities as a whole */
+	void InternalReserveEntities(TArrayView<FMassEntityHandle> OutEntities);
 	void InternalReleaseEntity(FMassEntityHandle Entity);
 
 	/** 
@@ -352,25 +502,42 @@ private:
 	 */
 	void InternalAddFragmentListToEntityChecked(FMassEntityHandle Entity, const FMassFragmentBitSet& InFragments);
 
+	/** Moves Entity over to the archetype matching its current composition and NewSharedFragmentValues */
+	bool InternalSetEntitySharedFragmentValues(FMassEntityHandle Entity, FMassArchetypeSharedFragmentValues& NewSharedFragmentValues);
+
 	/** 
 	 *  Similar to InternalAddFragmentListToEntity but expects NewFragmentList not overlapping with current entity's
 	 *  fragment list. It's callers responsibility to ensure that's true. Failing this will cause a `check` fail.
 	 */
 	void InternalAddFragmentListToEntity(FMassEntityHandle Entity, const FMassFragmentBitSet& NewFragments);
+
+	/** Moves all entities indicated by EntityCollection to NewArchetype and updates the entities' data accordingly */
+	void InternalBatchMoveEntities(const FArchetypeChunkCollection& EntityCollection, const TSharedPtr<FMassArchetypeData>& NewArchetype);
 	void* InternalGetFragmentDataChecked(FMassEntityHandle Entity, const UScriptStruct* FragmentType) const;
 	void* InternalGetFragmentDataPtr(FMassEntityHandle Entity, const UScriptStruct* FragmentType) const;
+	void InternalGetFragmentValueChecked(FMassEntityHandle Entity, const UScriptStruct* FragmentType, void* OutValue) const;
 
 private:
 	TChunkedArray<FEntityData> Entities;
 	TArray<int32> EntityFreeIndexList;
 
 	TSharedPtr<FMassCommandBuffer> DeferredCommandBuffer;
+	// Shared with all the archetypes, which use it to allocate their chunks' memory
+	TSharedPtr<FMassChunkMemoryPool> ChunkMemoryPool;
+	// Entities reserved up front for ConcurrentReserveEntities
+	TSharedPtr<FMassEntityReservationPool> ReservationPool;
 	std::atomic<int32> SerialNumberGenerator;
 	std::atomic<int32> ProcessingScopeCount;
 
 	// the "version" number increased every time an archetype gets added
 	uint32 ArchetypeDataVersion = 0;
 
+	// the index of the archetype (in AllArchetypes) DoEntityCompaction resumes with
+	int32 CompactionArchetypeCursor = 0;
+
+	// All the archetypes, in creation order. Lets queries update their cached data incrementally, see GetValidArchetypes
+	TArray<TSharedPtr<FMassArchetypeData>> AllArchetypes;
+
 	// Map of hash of sorted fragment list to archetypes with that hash
 	TMap<uint32, TArray<TSharedPtr<FMassArchetypeData>>> FragmentHashToArchetypeMap;
 
@@ -411,7 +578,14 @@ private:
 
 		bool operator==(const UScriptStruct* FragmentType) const { return Requirement.StructType == FragmentType; }
 	};
-	using FFragmentView=TFragmentView<TArrayView<FMassFragment>>;
+	struct FFragmentView : public TFragmentView<TArrayView<FMassFragment>>
+	{
+		using TFragmentView::TFragmentView;
+
+		// For split fragments (see FMassSplitFragment) FragmentView points at the first member's sub-column and every 
+		// following member's sub-column starts SubColumnStride bytes further. 0 for regular fragments.
+		int32 SubColumnStride = 0;
+	};
 	TArray<FFragmentView, TInlineAllocator<8>> FragmentViews;
 
 	using FChunkFragmentView = TFragmentView<FStructView>;
@@ -427,16 +601,26 @@ private:
 	TSharedPtr<FMassCommandBuffer> DeferredCommandBuffer;
 	TArrayView<FMassEntityHandle> EntityListView;
 	
-	/** If set this indicates the exact archetype and its chunks to be processed. 
+	/** If set this indicates the exact archetype and its chunks to be processed. Not owned by the context, the code
+	 *  calling SetChunkCollection is responsible for keeping the collection alive while it's set.
 	 *  @todo this data should live somewhere else, preferably be just a parameter to Query.ForEachEntityChunk function */
-	FArchetypeChunkCollection ChunkCollection;
+	const FArchetypeChunkCollection* ChunkCollection = nullptr;
 	
 	/** @todo rename to "payload" */
 	FInstancedStruct AuxData;
 	float DeltaTimeSeconds = 0.0f;
 	int32 ChunkSerialModificationNumber = -1;
+	/** Change version the fragment columns bound with ReadWrite access get marked with */
+	uint64 ChangeVersion = 0;
+	/** Used by queries' change filters, only chunks with fragments modified after this version will be processed */
+	uint64 ChangedSinceVersion = 0;
+	/** Set by UMassProcessor::CallExecute for the duration of the processor's execution, shared by all the query runs it does */
+	uint64 ExecutionChangeVersion = 0;
 	FMassTagBitSet CurrentArchetypesTagBitSet;
 
+	/** Set only while processor stats are being gathered, see UE::Mass::ProcessorStats. Not owned by the context. */
+	FMassExecutionStatsCounters* StatsCounters = nullptr;
+
 #if WITH_MASSENTITY_DEBUG
 	FString DebugExecutionDescription;
 #endif
@@ -470,9 +654,11 @@ public:
 	 *  immediate commands flushing */
 	void SetFlushDeferredCommands(const bool bNewFlushDeferredCommands) { bFlushDeferredCommands = bNewFlushDeferredCommands; } 
 	void SetDeferredCommandBuffer(const TSharedPtr<FMassCommandBuffer>& InDeferredCommandBuffer) { DeferredCommandBuffer = InDeferredCommandBuffer; }
+	/** Makes the context refer to InChunkCollection, without copying it. InChunkCollection needs to outlive the time it's set for. */
 	void SetChunkCollection(const FArchetypeChunkCollection& InChunkCollection);
-	void SetChunkCollection(FArchetypeChunkCollection&& InChunkCollection);
-	void ClearChunkCollection() { ChunkCollection.Reset(); }
+	/** Referring to a temporary collection would leave ChunkCollection dangling */
+	void SetChunkCollection(FArchetypeChunkCollection&& InChunkCollection) = delete;
+	void ClearChunkCollection() { ChunkCollection = nullptr; }
 	void SetAuxData(const FInstancedStruct& InAuxData) { AuxData = InAuxData; }
 
 	float GetDeltaTimeSeconds() const
@@ -502,6 +688,27 @@ public:
 	void SetCurrentChunkSerialModificationNumber(const int32 SerialModificationNumber) { ChunkSerialModificationNumber = SerialModificationNumber; }
 	int32 GetChunkSerialModificationNumber() const { return ChunkSerialModificationNumber; }
 
+	/** Change tracking, see FMassEntityQuery::AddChangedFilter */
+	void SetChangeVersions(const uint64 InChangeVersion, const uint64 InChangedSinceVersion) { ChangeVersion = InChangeVersion; ChangedSinceVersion = InChangedSinceVersion; }
+	uint64 GetChangeVersion() const { return ChangeVersion; }
+	uint64 GetChangedSinceVersion() const { return ChangedSinceVersion; }
+	void SetExecutionChangeVersion(const uint64 InExecutionChangeVersion) { ExecutionChangeVersion = InExecutionChangeVersion; }
+	uint64 GetExecutionChangeVersion() const { return ExecutionChangeVersion; }
+
+	/** Processor stats gathering, see UMassProcessor::CallExecute */
+	void SetStatsCounters(FMassExecutionStatsCounters* InStatsCounters) { StatsCounters = InStatsCounters; }
+	FMassExecutionStatsCounters* GetStatsCounters() const { return StatsCounters; }
+
+	/** Counts the currently bound chunk towards the processor stats, if those are being gathered */
+	void RecordChunkProcessed() const
+	{
+		if (StatsCounters)
+		{
+			StatsCounters->NumChunks.fetch_add(1, std::memory_order_relaxed);
+			StatsCounters->NumEntities.fetch_add(GetNumEntities(), std::memory_order_relaxed);
+		}
+	}
+
 	template<typename T>
 	T* GetMutableChunkFragmentPtr() const
 	{
@@ -588,6 +795,7 @@ public:
 	template<typename TFragment>
 	TArrayView<TFragment> GetMutableFragmentView()
 	{
+		static_assert(!TIsDerivedFrom<TFragment, FMassSplitFragment>::IsDerived, "Split fragments can't be accessed as arrays of instances, use GetMutableFragmentValues or GetMutableFragmentMemberView");
 		const UScriptStruct* FragmentType = TFragment::StaticStruct();
 		const FFragmentView* View = FragmentViews.FindByPredicate([FragmentType](const FFragmentView& Element) { return Element.Requirement.StructType == FragmentType; });
 		//checkfSlow(View != nullptr, TEXT("Requested fragment type not bound"));
@@ -598,12 +806,58 @@ public:
 	template<typename TFragment>
 	TConstArrayView<TFragment> GetFragmentView() const
 	{
+		static_assert(!TIsDerivedFrom<TFragment, FMassSplitFragment>::IsDerived, "Split fragments can't be accessed as arrays of instances, use GetFragmentValues or GetFragmentMemberView");
 		const UScriptStruct* FragmentType = TFragment::StaticStruct();
 		const FFragmentView* View = FragmentViews.FindByPredicate([FragmentType](const FFragmentView& Element) { return Element.Requirement.StructType == FragmentType; });
 		//checkfSlow(View != nullptr, TEXT("Requested fragment type not bound"));
 		return TConstArrayView<TFragment>((const TFragment*)View->FragmentView.GetData(), View->FragmentView.Num());
 	}
 
+	/** 
+	 * Returns a view of Member of every TFragment instance in the current chunk, e.g. just the locations out of 
+	 * transform fragments. Useful for feeding fragment data to functions operating on TStridedView. For split 
+	 * fragments (see FMassSplitFragment) the resulting view is contiguous.
+	 */
+	template<typename TFragment, typename TMember>
+	TStridedView<TMember> GetMutableFragmentMemberView(TMember TFragment::* Member)
+	{
+		const FFragmentView& View = GetFragmentViewChecked(TFragment::StaticStruct());
+		return View.FragmentView.Num() 
+			? TStridedView<TMember>(GetMemberStride<TFragment, TMember>(View), (TMember*)GetMemberData(View, Member), View.FragmentView.Num()) 
+			: TStridedView<TMember>();
+	}
+
+	template<typename TFragment, typename TMember>
+	TStridedView<const TMember> GetFragmentMemberView(TMember TFragment::* Member) const
+	{
+		const FFragmentView& View = GetFragmentViewChecked(TFragment::StaticStruct());
+		return View.FragmentView.Num() 
+			? TStridedView<const TMember>(GetMemberStride<TFragment, TMember>(View), (const TMember*)GetMemberData(View, Member), View.FragmentView.Num()) 
+			: TStridedView<const TMember>();
+	}
+
+	/** 
+	 * Returns the current chunk's values of given split fragment (see FMassSplitFragment) member as a plain array, 
+	 * e.g. just the X components of a location. Every member's sub-column is aligned as configured with 
+	 * UMassEntitySettings::FragmentColumnAlignment, which makes the data ready for wide SIMD loads. Regular fragments
+	 * consisting of a single value can be accessed this way as well.
+	 */
+	template<typename TFragment, typename TValue>
+	TArrayView<TValue> GetMutableFragmentValues(TValue TFragment::* Member)
+	{
+		static_assert(TIsDerivedFrom<TFragment, FMassSplitFragment>::IsDerived || sizeof(TFragment) == sizeof(TValue), "Only split fragments and fragments consisting of a single value can be accessed as value arrays");
+		const FFragmentView& View = GetFragmentViewChecked(TFragment::StaticStruct());
+		return View.FragmentView.Num() ? TArrayView<TValue>((TValue*)GetMemberData(View, Member), View.FragmentView.Num()) : TArrayView<TValue>();
+	}
+
+	template<typename TFragment, typename TValue>
+	TConstArrayView<TValue> GetFragmentValues(TValue TFragment::* Member) const
+	{
+		static_assert(TIsDerivedFrom<TFragment, FMassSplitFragment>::IsDerived || sizeof(TFragment) == sizeof(TValue), "Only split fragments and fragments consisting of a single value can be accessed as value arrays");
+		const FFragmentView& View = GetFragmentViewChecked(TFragment::StaticStruct());
+		return View.FragmentView.Num() ? TConstArrayView<TValue>((const TValue*)GetMemberData(View, Member), View.FragmentView.Num()) : TConstArrayView<TValue>();
+	}
+
 	TConstArrayView<FMassFragment> GetFragmentFragmentView(const UScriptStruct* FragmentType) const
 	{
 		const FFragmentView* View = FragmentViews.FindByPredicate([FragmentType](const FFragmentView& Element) { return Element.Requirement.StructType == FragmentType; });
@@ -619,7 +873,11 @@ public:
 	}
 
 	/** Sparse chunk related operation */
-	const FArchetypeChunkCollection& GetChunkCollection() const { return ChunkCollection; }
+	const FArchetypeChunkCollection& GetChunkCollection() const 
+	{ 
+		static const FArchetypeChunkCollection EmptyCollection;
+		return ChunkCollection ? *ChunkCollection : EmptyCollection; 
+	}
 
 	const FInstancedStruct& GetAuxData() const { return AuxData; }
 	FInstancedStruct& GetMutableAuxData() { return AuxData; }
@@ -647,6 +905,7 @@ protected:
 		for (FFragmentView& View : FragmentViews)
 		{
 			View.FragmentView = TArrayView<FMassFragment>();
+			View.SubColumnStride = 0;
 		}
 		for (FChunkFragmentView& View : ChunkFragmentViews)
 		{
@@ -661,4 +920,29 @@ protected:
 			View.FragmentView.Reset();
 		}
 	}
+
+	const FFragmentView& GetFragmentViewChecked(const UScriptStruct* FragmentType) const
+	{
+		const FFragmentView* View = FragmentViews.FindByPredicate([FragmentType](const FFragmentView& Element) { return Element.Requirement.StructType == FragmentType; });
+		checkf(View, TEXT("Requested fragment type %s not bound"), *GetNameSafe(FragmentType));
+		return *View;
+	}
+
+	/** @return the address of Member of the first bound TFragment instance, or of the first value in Member's sub-column for split fragments */
+	template<typename TFragment, typename TMember>
+	static uint8* GetMemberData(const FFragmentView& View, TMember TFragment::* Member)
+	{
+		// Member's offset within TFragment, without requiring TFragment to be default-constructible
+		alignas(TFragment) uint8 Storage[sizeof(TFragment)];
+		const int32 MemberOffset = int32(reinterpret_cast<const uint8*>(&(reinterpret_cast<const TFragment*>(Storage)->*Member)) - Storage);
+		uint8* ColumnData = reinterpret_cast<uint8*>(View.FragmentView.GetData());
+		// split fragments' members are all of the same type, so the offset translates directly to the sub-column index
+		return View.SubColumnStride > 0 ? ColumnData + (MemberOffset / int32(sizeof(TMember))) * View.SubColumnStride : ColumnData + MemberOffset;
+	}
+
+	template<typename TFragment, typename TMember>
+	static int32 GetMemberStride(const FFragmentView& View)
+	{
+		return View.SubColumnStride > 0 ? int32(sizeof(TMember)) : int32(sizeof(TFragment));
+	}
 };
@@ -18,6 +18,21 @@ struct FMassFragment
 	FMassFragment() {}
 };
 
+// This is the base class for fragments stored as split, struct-of-arrays columns. Instead of a single column of
+// struct instances every member gets its own contiguous sub-column within the chunk, e.g. a location split into
+// X[], Y[] and Z[], which makes the data ready for wide SIMD loads.
+// Subclasses need to consist solely of UPROPERTY members of a single numeric type. Since the instances don't exist
+// in memory as a whole they can't be accessed by pointer - use FMassExecutionContext::GetMutableFragmentValues
+// or GetMutableFragmentMemberView in processors, UMassEntitySubsystem::GetFragmentValueChecked to read a single
+// entity's value and UMassEntitySubsystem::SetEntityFragmentsValues to write it.
+USTRUCT()
+struct FMassSplitFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	FMassSplitFragment() {}
+};
+
 // This is the base class for types that will only be tested for presence/absence, i.e. Tags.
 // Subclasses should never contain any member properties.
 USTRUCT()
@@ -263,6 +278,34 @@ struct FMassArchetypeSharedFragmentValues
 		return SharedFragments.Add_GetRef(Fragment);
 	}
 
+	/**
+	 * Replaces the const shared fragment of the same type as Fragment. Since the type doesn't change the containers
+	 * remain sorted.
+	 * @return false if there's no const shared fragment of Fragment's type
+	 */
+	bool ReplaceConstSharedFragment(const FConstSharedStruct& Fragment)
+	{
+		FConstSharedStruct* Found = ConstSharedFragments.FindByPredicate([Type = Fragment.GetScriptStruct()](const FConstSharedStruct& Element) { return Element.GetScriptStruct() == Type; });
+		if (Found)
+		{
+			*Found = Fragment;
+			DirtyHashCache();
+		}
+		return Found != nullptr;
+	}
+
+	/** @return false if there's no shared fragment of Fragment's type */
+	bool ReplaceSharedFragment(const FSharedStruct& Fragment)
+	{
+		FSharedStruct* Found = SharedFragments.FindByPredicate([Type = Fragment.GetScriptStruct()](const FSharedStruct& Element) { return Element.GetScriptStruct() == Type; });
+		if (Found)
+		{
+			*Found = Fragment;
+			DirtyHashCache();
+		}
+		return Found != nullptr;
+	}
+
 	FORCEINLINE const TArray<FConstSharedStruct>& GetConstSharedFragments() const
 	{
 		return ConstSharedFragments;
@@ -12,7 +12,8 @@ struct FArchetypeChunkCollection;
 /** 
  * A type that encapsulates logic related to notifying interested parties of entity composition changes. Upon creation it
  * reads information from UMassObserverRegistry and instantiates processors interested in handling given fragment
- * type addition or removal.
+ * type addition or removal. Tags can be observed for addition and removal the same way, while for shared fragments 
+ * the registered "initializers" get notified whenever an entity's shared fragment value changes.
  */
 USTRUCT()
 struct MASSENTITY_API FMassObserverManager
@@ -22,6 +23,9 @@ struct MASSENTITY_API FMassObserverManager
 public:
 	FMassObserverManager();	
 
+	/** Entities per struct type, used to pass the removals notified up front to FScopedCompositionChangeBatching */
+	using FEntitySetPerType = TMap<const UScriptStruct*, TSet<FMassEntityHandle>>;
+
 	DECLARE_MULTICAST_DELEGATE_TwoParams(FOnObservedFragmentTypesChanged, const FMassFragmentBitSet& /*NewObservedAddSet*/, const FMassFragmentBitSet& /*NewObservedRemoveSet*/);
 
 	FOnObservedFragmentTypesChanged& GetOnObservedFragmentTypesChangedDelegate() { return OnObservedFragmentTypesChangedDelegate; }
@@ -29,6 +33,10 @@ public:
 	const FMassFragmentBitSet& GetObservedAddFragmentsBitSet() const { return ObservedAddFragments; }
 	const FMassFragmentBitSet& GetObservedRemoveFragmentsBitSet() const { return ObservedRemoveFragments; }
 
+	const FMassTagBitSet& GetObservedAddTagsBitSet() const { return ObservedAddTags; }
+	const FMassTagBitSet& GetObservedRemoveTagsBitSet() const { return ObservedRemoveTags; }
+	const FMassSharedFragmentBitSet& GetObservedSharedFragmentsBitSet() const { return ObservedSharedFragments; }
+
 	bool HasOnAddedObserversForFragments(const FMassFragmentBitSet& InQueriedBitSet) const { return ObservedAddFragments.HasAny(InQueriedBitSet); }
 	bool HasOnRemovedObserversForFragments(const FMassFragmentBitSet& InQueriedBitSet) const { return ObservedRemoveFragments.HasAny(InQueriedBitSet); }
 
@@ -38,9 +46,57 @@ public:
 	bool OnPreEntitiesDestroyed(const FArchetypeChunkCollection& ChunkCollection);
 	bool OnPreEntitiesDestroyed(FMassProcessingContext& ProcessingContext, const FArchetypeChunkCollection& ChunkCollection);
 
+	/** 
+	 * Notifies the observers of Composition's fragments being added to Entity. While composition change batching is 
+	 * active (see FScopedCompositionChangeBatching) the notification is postponed and sent out along with all the others
+	 * once the batching ends.
+	 * @return whether any observers were interested in the change
+	 */
 	bool OnPostCompositionAdded(const FMassEntityHandle Entity, const FMassArchetypeCompositionDescriptor& Composition);
+	/** 
+	 * Notifies the observers of Composition's fragments being about to be removed from Entity. The observers need to 
+	 * see the data before it's gone so this notification is never postponed, but it flushes the pending, batched 
+	 * notifications first to preserve the order in which the observers see the changes. The fragments whose removal 
+	 * from Entity the owner of the current FScopedCompositionChangeBatching scope has already notified the observers
+	 * of get skipped.
+	 */
 	bool OnPreCompositionRemoved(const FMassEntityHandle Entity, const FMassArchetypeCompositionDescriptor& Composition);
 
+	/** Notifies the observers of Composition's fragments being added to all the entities in ChunkCollection */
+	bool OnPostCompositionAdded(const FArchetypeChunkCollection& ChunkCollection, const FMassArchetypeCompositionDescriptor& Composition);
+	/** Notifies the observers of Composition's fragments being about to be removed from all the entities in ChunkCollection */
+	bool OnPreCompositionRemoved(const FArchetypeChunkCollection& ChunkCollection, const FMassArchetypeCompositionDescriptor& Composition);
+
+	/** 
+	 * While an instance of this type is alive the fragment addition notifications issued for individual entities 
+	 * (like the ones coming from UMassEntitySubsystem::AddCompositionToEntity_GetDelta) are accumulated per fragment 
+	 * type. Once the outermost instance goes away the accumulated entities are grouped per archetype and every observer
+	 * gets run once per fragment type and archetype, over whole chunks, rather than once per entity. 
+	 */
+	struct MASSENTITY_API FScopedCompositionChangeBatching
+	{
+		/** 
+		 * @param InRemovalsNotifiedUpFront if set, the entities per fragment type the caller has already notified the 
+		 *	removal observers of, per archetype, like FMassCommandBuffer::ReplayBufferAgainstSystem does. Every one of 
+		 *	these entity and fragment type pairs gets skipped by the next OnPreCompositionRemoved call covering it, and 
+		 *	removed from the set. All the other removals within the scope get notified as usual.
+		 */
+		explicit FScopedCompositionChangeBatching(FMassObserverManager& InObserverManager, FEntitySetPerType* InRemovalsNotifiedUpFront = nullptr);
+		~FScopedCompositionChangeBatching();
+
+		FScopedCompositionChangeBatching(const FScopedCompositionChangeBatching&) = delete;
+		FScopedCompositionChangeBatching& operator=(const FScopedCompositionChangeBatching&) = delete;
+
+	private:
+		FMassObserverManager& ObserverManager;
+		FEntitySetPerType* const PreviousRemovalsNotifiedUpFront;
+	};
+
+	bool IsBatchingCompositionChanges() const { return CompositionChangeBatchingDepth > 0; }
+
+	/** Sends out all the notifications accumulated while batching composition changes */
+	void FlushPendingCompositionChanges();
+
 	void OnPostFragmentAdded(const UScriptStruct& FragmentType, const FArchetypeChunkCollection& ChunkCollection)
 	{
 		HandleSingleFragmentImpl(FragmentType, ChunkCollection, ObservedAddFragments, OnFragmentAddedObservers);
@@ -51,6 +107,24 @@ public:
 		HandleSingleFragmentImpl(FragmentType, ChunkCollection, ObservedRemoveFragments, OnFragmentRemovedObservers);
 	}
 
+	/** Notifies the observers of TagType having been added to all the entities in ChunkCollection */
+	void OnPostTagAdded(const UScriptStruct& TagType, const FArchetypeChunkCollection& ChunkCollection)
+	{
+		HandleSingleTypeImpl(TagType, ChunkCollection, OnTagAddedObservers);
+	}
+
+	/** Notifies the observers of TagType being about to be removed from all the entities in ChunkCollection */
+	void OnPreTagRemoved(const UScriptStruct& TagType, const FArchetypeChunkCollection& ChunkCollection)
+	{
+		HandleSingleTypeImpl(TagType, ChunkCollection, OnTagRemovedObservers);
+	}
+
+	/** Notifies the observers of all the entities in ChunkCollection having been assigned a new value of SharedFragmentType */
+	void OnPostSharedFragmentChanged(const UScriptStruct& SharedFragmentType, const FArchetypeChunkCollection& ChunkCollection)
+	{
+		HandleSingleTypeImpl(SharedFragmentType, ChunkCollection, OnSharedFragmentChangedObservers);
+	}
+
 protected:
 	friend UMassEntitySubsystem;
 	explicit FMassObserverManager(UMassEntitySubsystem& Owner);
@@ -60,11 +134,26 @@ protected:
 		, const FMassFragmentBitSet& FragmentsBitSet, TMap<const UScriptStruct*, FMassRuntimePipeline>& HandlersContainer);
 	void HandleSingleFragmentImpl(const UScriptStruct& FragmentType, const FArchetypeChunkCollection& ChunkCollection
 		, const FMassFragmentBitSet& FragmentFilterBitSet, TMap<const UScriptStruct*, FMassRuntimePipeline>& HandlersContainer);
+	/** Runs the observers registered in HandlersContainer for Type, if any */
+	void HandleSingleTypeImpl(const UScriptStruct& Type, const FArchetypeChunkCollection& ChunkCollection
+		, TMap<const UScriptStruct*, FMassRuntimePipeline>& HandlersContainer);
 
 	FOnObservedFragmentTypesChanged OnObservedFragmentTypesChangedDelegate;
 
 	FMassFragmentBitSet ObservedAddFragments;
 	FMassFragmentBitSet ObservedRemoveFragments;
+	FMassTagBitSet ObservedAddTags;
+	FMassTagBitSet ObservedRemoveTags;
+	FMassSharedFragmentBitSet ObservedSharedFragments;
+
+	/** The number of FScopedCompositionChangeBatching instances currently alive */
+	int32 CompositionChangeBatchingDepth = 0;
+
+	/** The removals the owner of the innermost FScopedCompositionChangeBatching instance has notified the observers of up front */
+	FEntitySetPerType* RemovalsNotifiedUpFront = nullptr;
+
+	/** Entities that got observed fragments added while batching composition changes, per fragment type */
+	TMap<const UScriptStruct*, TArray<FMassEntityHandle>> PendingAddedFragments;
 
 	UPROPERTY()
 	TMap<const UScriptStruct*, FMassRuntimePipeline> OnFragmentAddedObservers;
@@ -72,6 +161,15 @@ protected:
 	UPROPERTY()
 	TMap<const UScriptStruct*, FMassRuntimePipeline> OnFragmentRemovedObservers;
 
+	UPROPERTY()
+	TMap<const UScriptStruct*, FMassRuntimePipeline> OnTagAddedObservers;
+
+	UPROPERTY()
+	TMap<const UScriptStruct*, FMassRuntimePipeline> OnTagRemovedObservers;
+
+	UPROPERTY()
+	TMap<const UScriptStruct*, FMassRuntimePipeline> OnSharedFragmentChangedObservers;
+
 	/** 
 	 * The owning EntitySubsystem. No need for it to be a UPROPERTY since by design we don't support creation of 
 	 * FMassObserverManager outside of an UMassEntitySubsystem instance 
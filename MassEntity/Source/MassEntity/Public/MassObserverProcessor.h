@@ -25,7 +25,10 @@ protected:
 protected:
 	/** Set in class' constructor and determines for which Fragment type this given UMassObserverProcessor will be used 
 	 *  as the default initializer/deinitializer (as returned by the MassInitializersRegistry). If set to null will
-	 *  require the user to manually add this UMassObserverProcessor as initializer/deinitializer */
+	 *  require the user to manually add this UMassObserverProcessor as initializer/deinitializer.
+	 *  Can also be a tag type, in which case the processor observes the tag's addition/removal, or a shared fragment
+	 *  type, in which case an initializer gets run whenever entities get assigned a new value of the shared fragment 
+	 *  (observing shared fragments' removal is not supported). */
 	UPROPERTY()
 	UScriptStruct* FragmentType;
 };
@@ -7,6 +7,7 @@
 #include "UObject/Object.h"
 #include "Engine/EngineBaseTypes.h"
 #include "MassProcessingTypes.h"
+#include "MassProcessorStats.h"
 #include "MassProcessingPhase.generated.h"
 
 
@@ -116,6 +117,26 @@ public:
 	 */
 	void SetPhaseProcessor(const EMassProcessingPhase Phase, UMassCompositeProcessor* PhaseProcessor);
 
+	/** Processor along with its execution stats and its depth in the phase's processor hierarchy (0 being the phase processor itself) */
+	struct FProcessorStatsEntry
+	{
+		const UMassProcessor* Processor = nullptr;
+		FMassProcessorExecutionStats Stats;
+		int32 Depth = 0;
+	};
+
+	/**
+	 *  Appends to OutStats the execution stats of the given Phase's processor and all of its children, depth first.
+	 *  Note that the stats are only gathered while UE::Mass::ProcessorStats::bEnabled is set (mass.ProcessorStats.Enable).
+	 */
+	void GetProcessorStats(const EMassProcessingPhase Phase, TArray<FProcessorStatsEntry>& OutStats) const;
+
+	/** Resets the execution stats of all the processors hosted by the phases */
+	void ResetProcessorStats();
+
+	/** Prints out the execution stats of all the processors hosted by the phases, sorted by phase and indented by hierarchy */
+	void DebugDumpProcessorStats(FOutputDevice& Ar) const;
+
 protected:
 	virtual void PostInitProperties() override;
 	virtual void BeginDestroy() override;
@@ -13,6 +13,12 @@
 
 struct FMassProcessingPhaseConfig;
 
+namespace FMassTweakables
+{
+	/** Whether the groups listed in OffGameThreadGroupNames get run off the game thread, see mass.ParallelGroups */
+	MASSENTITY_API extern bool bParallelGroups;
+} // FMassTweakables
+
 enum class EProcessorCompletionStatus : uint8
 {
 	Invalid,
@@ -52,13 +58,24 @@ public:
 
 	/** Whether this processor should execute according the CurrentExecutionFlags parameters */
 	bool ShouldExecute(const EProcessorExecutionFlags CurrentExecutionFlags) const { return (GetExecutionFlags() & CurrentExecutionFlags) != EProcessorExecutionFlags::None; }
-	void CallExecute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context);
+	/** 
+	 * Runs Execute, gathering the execution stats on the way if UE::Mass::ProcessorStats::bEnabled is set.
+	 * @param PrerequisitesWaitTimeMs time the processor's task has been waiting on its prerequisites, for stats purposes
+	 */
+	void CallExecute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context, const double PrerequisitesWaitTimeMs = 0.);
 	
 	bool AllowDuplicates() const { return bAllowDuplicates; }
 
 	virtual void DebugOutputDescription(FOutputDevice& Ar, int32 Indent = 0) const;
 	virtual FString GetProcessorName() const { return GetName(); }
 
+	/** 
+	 * @return rolling averages of this processor's execution cost. Note that the stats are updated by the thread 
+	 *	executing the processor, so for consistent results read them while no processing is taking place.
+	 */
+	const FMassProcessorExecutionStats& GetExecutionStats() const { return ExecutionStats; }
+	void ResetExecutionStats() { ExecutionStats.Reset(); }
+
 	//----------------------------------------------------------------------//
 	// Ordering functions 
 	//----------------------------------------------------------------------//
@@ -70,6 +87,12 @@ public:
 
 	TConstArrayView<const int32> GetPrerequisiteIndices() const { return DependencyIndices; }
 
+	/** Appends the data access of all the queries registered via RegisterQuery to OutRequirements */
+	void ExportRequirements(FMassExecutionRequirements& OutRequirements) const;
+
+	/** @return whether any queries have been registered with RegisterQuery, i.e. whether this processor's data access is known */
+	bool HasRegisteredQueries() const { return OwnedQueries.Num() > 0; }
+
 	bool ShouldAutoAddToGlobalList() const { return bAutoRegisterWithProcessingPhases; }
 #if WITH_EDITOR
 	bool ShouldShowUpInSettings() const { return ShouldAutoAddToGlobalList() || bCanShowUpInSettings; }
@@ -86,6 +109,14 @@ public:
 #endif
 	
 protected:
+	/** 
+	 * Registers a query owned by this processor so that its requirements can be used to infer execution dependencies 
+	 * with other processors. Called automatically by the FMassEntityQuery(UMassProcessor&) constructor. Only queries 
+	 * being members of this processor get registered, since OwnedQueries stores raw pointers that need to remain valid 
+	 * for the whole lifetime of the processor.
+	 */
+	void RegisterQuery(FMassEntityQuery& Query);
+
 	virtual void ConfigureQueries() PURE_VIRTUAL(UMassProcessor::ConfigureQueries);
 	virtual void PostInitProperties() override;
 	virtual void Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context) PURE_VIRTUAL(UMassProcessor::Execute);
@@ -125,8 +156,13 @@ protected:
 #endif // WITH_EDITORONLY_DATA
 
 	friend class UMassCompositeProcessor;
+	friend struct FMassEntityQuery;
+	/** Queries registered via RegisterQuery. All of them are members of this processor, thus sharing its lifetime. */
+	TArray<FMassEntityQuery*> OwnedQueries;
 	TArray<int32> DependencyIndices;
 	TArray<int32> TransientDependencyIndices;
+
+	FMassProcessorExecutionStats ExecutionStats;
 };
 
 
@@ -167,6 +203,8 @@ public:
 
 	virtual FString GetProcessorName() const override { return GroupName.ToString(); }
 
+	TConstArrayView<UMassProcessor*> GetChildProcessorsView() const { return ChildPipeline.Processors; }
+
 protected:
 	virtual void ConfigureQueries() override;
 	virtual void Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context) override;
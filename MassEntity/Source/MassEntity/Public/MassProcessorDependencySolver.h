@@ -3,6 +3,7 @@
 #pragma once
 
 #include "MassProcessingTypes.h"
+#include "MassEntityQuery.h"
 
 
 class UMassProcessor;
@@ -32,6 +33,10 @@ private:
 		TArray<int32> TransientDependencies;
 		TArray<FName> ExecuteBefore;
 		TArray<FName> ExecuteAfter;
+		/** Data access of the processor, or of all the processors in the group's subtree */
+		FMassExecutionRequirements Requirements;
+		/** Whether any of the processors represented by this node has registered its queries */
+		bool bHasRequirements = false;
 
 		int32 FindOrAddGroupNodeIndex(const FString& GroupName);
 		int32 FindNodeIndex(FName InNodeName) const;
@@ -76,6 +81,14 @@ protected:
 
 	void AddNode(FName GroupName, UMassProcessor& Processor);
 	void BuildDependencies(FNode& RootNode);
+	void GatherRequirements(FNode& RootNode);
+
+	/**
+	 * Adds dependencies between RootNode's subnodes with conflicting data access (one writing what the other reads or 
+	 * writes) that are not already ordered by the explicitly configured dependencies. The added dependencies always point
+	 * at nodes earlier in SortedNodeIndices so no cycles get introduced.
+	 */
+	void InferDependencies(FNode& RootNode, TConstArrayView<int32> SortedNodeIndices);
 	void Solve(FNode& RootNode, TConstArrayView<const FName> PriorityNodes, TArray<FProcessorDependencySolver::FOrderInfo>& OutResult, int LoggingIndent = 0);
 	void LogNode(const FNode& RootNode, const FNode* ParentNode = nullptr, int Indent = 0);
 	void DumpGraph(FArchive& LogFile) const;
@@ -84,6 +97,8 @@ protected:
 	FNode GroupRootNode;
 	bool bAnyCyclesDetected = false;
 	FString DependencyGraphFileName;
+	/** Pairs of nodes (first needs to execute before second) that got a dependency based on their data access */
+	TArray<TPair<const FNode*, const FNode*>> InferredDependencies;
 
 	friend struct FDumpGraphDependencyUtils;
 };
\ No newline at end of file
@@ -0,0 +1,56 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+namespace UE::Mass::ProcessorStats
+{
+	/** Whether processors gather their execution stats, see mass.ProcessorStats.Enable */
+	MASSENTITY_API extern bool bEnabled;
+	/** Number of most recent executions the processor stats' rolling averages are computed over */
+	MASSENTITY_API extern int32 AveragingWindow;
+} // UE::Mass::ProcessorStats
+
+/**
+ * Counters gathered while a processor executes. Shared by all the execution contexts working on behalf of the
+ * processor, including the copies used by the jobs of FMassEntityQuery::ParallelForEachEntityChunk, hence atomic.
+ */
+struct FMassExecutionStatsCounters
+{
+	std::atomic<int32> NumChunks{0};
+	std::atomic<int32> NumEntities{0};
+};
+
+/** Rolling averages of a single processor's per-execution cost. Gathered only while UE::Mass::ProcessorStats::bEnabled is set. */
+struct MASSENTITY_API FMassProcessorExecutionStats
+{
+	/** Time spent in the processor's Execute function */
+	double AverageWallTimeMs = 0.;
+	/** Time between the processor's task being dispatched and it starting to run, i.e. waiting on prerequisites */
+	double AverageWaitTimeMs = 0.;
+	double AverageEntities = 0.;
+	double AverageChunks = 0.;
+	/** Number of deferred commands the processor issued */
+	double AverageCommands = 0.;
+	double LastWallTimeMs = 0.;
+	double MaxWallTimeMs = 0.;
+	int32 NumExecutions = 0;
+
+	void AddSample(const double WallTimeMs, const double WaitTimeMs, const int32 NumEntities, const int32 NumChunks, const int32 NumCommands)
+	{
+		++NumExecutions;
+		// a regular average until the window fills up, an exponential moving average afterwards
+		const double Weight = 1. / FMath::Min(NumExecutions, FMath::Max(UE::Mass::ProcessorStats::AveragingWindow, 1));
+		AverageWallTimeMs += (WallTimeMs - AverageWallTimeMs) * Weight;
+		AverageWaitTimeMs += (WaitTimeMs - AverageWaitTimeMs) * Weight;
+		AverageEntities += (NumEntities - AverageEntities) * Weight;
+		AverageChunks += (NumChunks - AverageChunks) * Weight;
+		AverageCommands += (NumCommands - AverageCommands) * Weight;
+		LastWallTimeMs = WallTimeMs;
+		MaxWallTimeMs = FMath::Max(MaxWallTimeMs, WallTimeMs);
+	}
+
+	void Reset() { *this = FMassProcessorExecutionStats(); }
+};
@@ -0,0 +1,358 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "MassBenchmark.h"
+#include "MassEntitySubsystem.h"
+#include "MassCommandBuffer.h"
+#include "Engine/World.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Serialization/JsonWriter.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "UObject/UObjectGlobals.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMassBenchmark, Log, All);
+
+namespace UE::Mass::Benchmark::Private
+{
+	/**
+	 * Forwards all the calls to the allocator it replaces, counting the allocations while tracking is on. Installed
+	 * for the duration of RunScenarios only and never deleted, since memory allocated through it can be freed at any
+	 * point later, through any of the two allocators.
+	 */
+	class FAllocationTrackingMalloc : public FMalloc
+	{
+	public:
+		explicit FAllocationTrackingMalloc(FMalloc* InInnerMalloc)
+			: InnerMalloc(InInnerMalloc)
+		{}
+
+		void BeginTracking()
+		{
+			NumAllocations = 0;
+			AllocatedBytes = 0;
+			LiveBytes = 0;
+			PeakLiveBytes = 0;
+			bTracking = true;
+		}
+
+		void EndTracking(FMassBenchmarkResult& OutResult)
+		{
+			bTracking = false;
+			OutResult.bAllocationsTracked = true;
+			OutResult.NumAllocations = NumAllocations.load();
+			OutResult.AllocatedBytes = AllocatedBytes.load();
+			OutResult.PeakMemoryBytes = PeakLiveBytes.load();
+		}
+
+		FMalloc* GetInnerMalloc() const { return InnerMalloc; }
+
+		// FMalloc interface
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			void* Result = InnerMalloc->Malloc(Count, Alignment);
+			if (bTracking)
+			{
+				TrackAllocation(Result, Count);
+			}
+			return Result;
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			void* Result = InnerMalloc->TryMalloc(Count, Alignment);
+			if (bTracking)
+			{
+				TrackAllocation(Result, Count);
+			}
+			return Result;
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			const SIZE_T OriginalSize = bTracking ? GetTrackedSize(Original, 0) : 0;
+			void* Result = InnerMalloc->Realloc(Original, Count, Alignment);
+			if (bTracking)
+			{
+				TrackFree(OriginalSize);
+				TrackAllocation(Result, Count);
+			}
+			return Result;
+		}
+
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			const SIZE_T OriginalSize = bTracking ? GetTrackedSize(Original, 0) : 0;
+			void* Result = InnerMalloc->TryRealloc(Original, Count, Alignment);
+			if (bTracking && (Result || Count == 0))
+			{
+				TrackFree(OriginalSize);
+				TrackAllocation(Result, Count);
+			}
+			return Result;
+		}
+
+		virtual void Free(void* Original) override
+		{
+			if (bTracking)
+			{
+				TrackFree(GetTrackedSize(Original, 0));
+			}
+			InnerMalloc->Free(Original);
+		}
+
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return InnerMalloc->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return InnerMalloc->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { InnerMalloc->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { InnerMalloc->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void InitializeStatsMetadata() override { InnerMalloc->InitializeStatsMetadata(); }
+		virtual bool IsInternallyThreadSafe() const override { return InnerMalloc->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return InnerMalloc->ValidateHeap(); }
+		virtual void UpdateStats() override { InnerMalloc->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { InnerMalloc->GetAllocatorStats(OutStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { InnerMalloc->DumpAllocatorStats(Ar); }
+		virtual const TCHAR* GetDescriptiveName() override { return InnerMalloc->GetDescriptiveName(); }
+		// End of FMalloc interface
+
+	private:
+		SIZE_T GetTrackedSize(void* Ptr, const SIZE_T Fallback) const
+		{
+			SIZE_T Size = Fallback;
+			return (Ptr && InnerMalloc->GetAllocationSize(Ptr, Size)) ? Size : Fallback;
+		}
+
+		void TrackAllocation(void* Ptr, const SIZE_T RequestedSize)
+		{
+			if (Ptr == nullptr)
+			{
+				return;
+			}
+			const int64 Size = int64(GetTrackedSize(Ptr, RequestedSize));
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			AllocatedBytes.fetch_add(Size, std::memory_order_relaxed);
+			const int64 NewLiveBytes = LiveBytes.fetch_add(Size, std::memory_order_relaxed) + Size;
+			int64 Peak = PeakLiveBytes.load(std::memory_order_relaxed);
+			while (NewLiveBytes > Peak && !PeakLiveBytes.compare_exchange_weak(Peak, NewLiveBytes, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		void TrackFree(const SIZE_T Size)
+		{
+			// memory allocated before tracking started can get freed as well. LiveBytes is clamped at zero so that freeing
+			// it doesn't offset the memory allocated by the run, which would make the peak underestimated
+			int64 Live = LiveBytes.load(std::memory_order_relaxed);
+			while (!LiveBytes.compare_exchange_weak(Live, FMath::Max<int64>(Live - int64(Size), 0), std::memory_order_relaxed))
+			{
+			}
+		}
+
+		FMalloc* InnerMalloc = nullptr;
+		std::atomic<bool> bTracking{false};
+		std::atomic<int64> NumAllocations{0};
+		std::atomic<int64> AllocatedBytes{0};
+		std::atomic<int64> LiveBytes{0};
+		std::atomic<int64> PeakLiveBytes{0};
+	};
+
+	FAllocationTrackingMalloc* InstallAllocationTracking()
+	{
+		static FAllocationTrackingMalloc* TrackingMalloc = nullptr;
+		if (TrackingMalloc == nullptr)
+		{
+			TrackingMalloc = new FAllocationTrackingMalloc(GMalloc);
+		}
+		GMalloc = TrackingMalloc;
+		return TrackingMalloc;
+	}
+
+	void UninstallAllocationTracking(FAllocationTrackingMalloc* TrackingMalloc)
+	{
+		check(GMalloc == TrackingMalloc);
+		GMalloc = TrackingMalloc->GetInnerMalloc();
+	}
+
+	UMassEntitySubsystem* CreateEntitySubsystem(UWorld& World)
+	{
+		UMassEntitySubsystem* EntitySubsystem = NewObject<UMassEntitySubsystem>(&World);
+		check(EntitySubsystem);
+		struct FSubsystemCollection_BenchmarkInit : FSubsystemCollectionBase
+		{
+			FSubsystemCollection_BenchmarkInit(){}
+		};
+		FSubsystemCollection_BenchmarkInit Collection;
+		EntitySubsystem->Initialize(Collection);
+		return EntitySubsystem;
+	}
+
+	void DestroyEntitySubsystem(UMassEntitySubsystem* EntitySubsystem)
+	{
+		EntitySubsystem->Deinitialize();
+		EntitySubsystem->MarkAsGarbage();
+		// making sure the next run doesn't start with the previous run's memory still allocated
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	/** 
+	 * @param TrackingMalloc if set the allocations done by the measured part of the scenario get stored in OutResult
+	 * @return number of entities processed
+	 */
+	int32 RunScenario(UWorld& World, const FMassBenchmarkScenario& Scenario, const FMassBenchmarkSettings& Settings, double& OutNanoseconds
+		, FAllocationTrackingMalloc* TrackingMalloc = nullptr, FMassBenchmarkResult* OutResult = nullptr)
+	{
+		UMassEntitySubsystem* EntitySubsystem = CreateEntitySubsystem(World);
+		int32 NumEntities = 0;
+		{
+			FMassBenchmarkEnvironment Environment(*EntitySubsystem, Settings);
+			Scenario.SetUp(Environment);
+
+			if (TrackingMalloc)
+			{
+				TrackingMalloc->BeginTracking();
+			}
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+
+			NumEntities = Scenario.Run(Environment);
+
+			OutNanoseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000000.;
+			if (TrackingMalloc)
+			{
+				check(OutResult);
+				TrackingMalloc->EndTracking(*OutResult);
+			}
+		}
+		DestroyEntitySubsystem(EntitySubsystem);
+		return NumEntities;
+	}
+} // UE::Mass::Benchmark::Private
+
+namespace UE::Mass::Benchmark
+{
+	FMassBenchmarkReport RunScenarios(UWorld& World, const FMassBenchmarkSettings& Settings)
+	{
+		using namespace UE::Mass::Benchmark::Private;
+
+		FMassBenchmarkReport Report;
+		Report.Settings = Settings;
+
+		FAllocationTrackingMalloc* TrackingMalloc = Settings.bTrackAllocations ? InstallAllocationTracking() : nullptr;
+
+		for (const FMassBenchmarkScenario& Scenario : GetScenarios())
+		{
+			if (Settings.ScenarioFilter.Num() && Settings.ScenarioFilter.ContainsByPredicate([&Scenario](const FString& Name) { return Name.Equals(Scenario.Name, ESearchCase::IgnoreCase); }) == false)
+			{
+				continue;
+			}
+
+			UE_LOG(LogMassBenchmark, Display, TEXT("Running %s: %s"), *Scenario.Name, *Scenario.Description);
+
+			FMassBenchmarkResult& Result = Report.Results.AddDefaulted_GetRef();
+			Result.ScenarioName = Scenario.Name;
+			Result.NumIterations = FMath::Max(Settings.NumIterations, 1);
+
+			TArray<double> NsPerEntity;
+			NsPerEntity.Reserve(Result.NumIterations);
+			for (int32 Iteration = 0; Iteration < Settings.NumWarmupIterations + Result.NumIterations; ++Iteration)
+			{
+				double Nanoseconds = 0.;
+				Result.NumEntities = RunScenario(World, Scenario, Settings, Nanoseconds);
+				if (Iteration >= Settings.NumWarmupIterations)
+				{
+					NsPerEntity.Add(Nanoseconds / FMath::Max(Result.NumEntities, 1));
+				}
+			}
+
+			// counting allocations slows them down, so it's done in a separate, unmeasured run
+			if (TrackingMalloc)
+			{
+				double Nanoseconds = 0.;
+				RunScenario(World, Scenario, Settings, Nanoseconds, TrackingMalloc, &Result);
+			}
+
+			NsPerEntity.Sort();
+			Result.MinNsPerEntity = NsPerEntity[0];
+			Result.MaxNsPerEntity = NsPerEntity.Last();
+			Result.MedianNsPerEntity = (NsPerEntity.Num() % 2)
+				? NsPerEntity[NsPerEntity.Num() / 2]
+				: (NsPerEntity[NsPerEntity.Num() / 2 - 1] + NsPerEntity[NsPerEntity.Num() / 2]) * 0.5;
+			double Sum = 0.;
+			for (const double Value : NsPerEntity)
+			{
+				Sum += Value;
+			}
+			Result.MeanNsPerEntity = Sum / NsPerEntity.Num();
+
+			UE_LOG(LogMassBenchmark, Display, TEXT("%s: %d entities, median %.2f ns/entity (min %.2f, max %.2f), %lld allocations, %lld bytes peak")
+				, *Result.ScenarioName, Result.NumEntities, Result.MedianNsPerEntity, Result.MinNsPerEntity, Result.MaxNsPerEntity
+				, Result.NumAllocations, Result.PeakMemoryBytes);
+		}
+
+		if (TrackingMalloc)
+		{
+			UninstallAllocationTracking(TrackingMalloc);
+		}
+
+		return Report;
+	}
+} // UE::Mass::Benchmark
+
+//----------------------------------------------------------------------//
+// FMassBenchmarkReport
+//----------------------------------------------------------------------//
+FString FMassBenchmarkReport::ToJson() const
+{
+	FString Output;
+	TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Output);
+
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("Timestamp"), FDateTime::UtcNow().ToIso8601());
+	Writer->WriteValue(TEXT("BuildConfiguration"), LexToString(FApp::GetBuildConfiguration()));
+	Writer->WriteValue(TEXT("Platform"), FString(FPlatformProperties::IniPlatformName()));
+	Writer->WriteValue(TEXT("NumEntities"), Settings.NumEntities);
+	Writer->WriteValue(TEXT("NumArchetypes"), Settings.NumArchetypes);
+	Writer->WriteValue(TEXT("NumIterations"), Settings.NumIterations);
+	Writer->WriteValue(TEXT("Seed"), Settings.Seed);
+
+	Writer->WriteArrayStart(TEXT("Results"));
+	for (const FMassBenchmarkResult& Result : Results)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("Scenario"), Result.ScenarioName);
+		Writer->WriteValue(TEXT("NumEntities"), Result.NumEntities);
+		Writer->WriteValue(TEXT("NumIterations"), Result.NumIterations);
+		Writer->WriteValue(TEXT("MinNsPerEntity"), Result.MinNsPerEntity);
+		Writer->WriteValue(TEXT("MedianNsPerEntity"), Result.MedianNsPerEntity);
+		Writer->WriteValue(TEXT("MeanNsPerEntity"), Result.MeanNsPerEntity);
+		Writer->WriteValue(TEXT("MaxNsPerEntity"), Result.MaxNsPerEntity);
+		if (Result.bAllocationsTracked)
+		{
+			Writer->WriteValue(TEXT("NumAllocations"), Result.NumAllocations);
+			Writer->WriteValue(TEXT("AllocatedBytes"), Result.AllocatedBytes);
+			Writer->WriteValue(TEXT("PeakMemoryBytes"), Result.PeakMemoryBytes);
+		}
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	return Output;
+}
+
+FString FMassBenchmarkReport::ToCsv() const
+{
+	FString Output = TEXT("Scenario,NumEntities,NumIterations,MinNsPerEntity,MedianNsPerEntity,MeanNsPerEntity,MaxNsPerEntity,NumAllocations,AllocatedBytes,PeakMemoryBytes\n");
+	for (const FMassBenchmarkResult& Result : Results)
+	{
+		Output += FString::Printf(TEXT("%s,%d,%d,%.3f,%.3f,%.3f,%.3f,"), *Result.ScenarioName, Result.NumEntities, Result.NumIterations
+			, Result.MinNsPerEntity, Result.MedianNsPerEntity, Result.MeanNsPerEntity, Result.MaxNsPerEntity);
+		// leaving the allocation columns empty rather than reporting zeros that weren't measured
+		Output += Result.bAllocationsTracked
+			? FString::Printf(TEXT("%lld,%lld,%lld\n"), Result.NumAllocations, Result.AllocatedBytes, Result.PeakMemoryBytes)
+			: FString(TEXT(",,\n"));
+	}
+	return Output;
+}
@@ -0,0 +1,79 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "MassBenchmarkCommandlet.h"
+#include "MassBenchmark.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMassBenchmarkCommandlet, Log, All);
+
+UMassBenchmarkCommandlet::UMassBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int32 UMassBenchmarkCommandlet::Main(const FString& Params)
+{
+	const TCHAR* CmdLine = *Params;
+
+	FMassBenchmarkSettings Settings;
+	FParse::Value(CmdLine, TEXT("Entities="), Settings.NumEntities);
+	FParse::Value(CmdLine, TEXT("Archetypes="), Settings.NumArchetypes);
+	FParse::Value(CmdLine, TEXT("Iterations="), Settings.NumIterations);
+	FParse::Value(CmdLine, TEXT("Warmup="), Settings.NumWarmupIterations);
+	FParse::Value(CmdLine, TEXT("Seed="), Settings.Seed);
+	Settings.bTrackAllocations = FParse::Param(CmdLine, TEXT("NoAllocationTracking")) == false;
+
+	FString ScenarioNames;
+	if (FParse::Value(CmdLine, TEXT("Scenarios="), ScenarioNames, /*bShouldStopOnSeparator=*/false))
+	{
+		ScenarioNames.ParseIntoArray(Settings.ScenarioFilter, TEXT(","));
+	}
+
+	if (Settings.NumEntities <= 0 || Settings.NumIterations <= 0)
+	{
+		UE_LOG(LogMassBenchmarkCommandlet, Error, TEXT("Entities and Iterations need to be positive, got %d and %d"), Settings.NumEntities, Settings.NumIterations);
+		return 1;
+	}
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, /*bInformEngineOfWorld=*/false, TEXT("MassBenchmarkWorld"));
+	check(World);
+
+	const FMassBenchmarkReport Report = UE::Mass::Benchmark::RunScenarios(*World, Settings);
+
+	// CreateWorld adds the world to root
+	World->RemoveFromRoot();
+	World->DestroyWorld(/*bInformEngineOfWorld=*/false);
+
+	if (Report.Results.Num() == 0)
+	{
+		UE_LOG(LogMassBenchmarkCommandlet, Error, TEXT("No scenario matched -Scenarios=%s"), *ScenarioNames);
+		return 1;
+	}
+
+	FString OutputPath;
+	FParse::Value(CmdLine, TEXT("Output="), OutputPath);
+	const bool bCsv = FPaths::GetExtension(OutputPath).Equals(TEXT("csv"), ESearchCase::IgnoreCase);
+	const FString Output = bCsv ? Report.ToCsv() : Report.ToJson();
+
+	if (OutputPath.IsEmpty())
+	{
+		UE_LOG(LogMassBenchmarkCommandlet, Display, TEXT("%s"), *Output);
+	}
+	else if (FFileHelper::SaveStringToFile(Output, *OutputPath))
+	{
+		UE_LOG(LogMassBenchmarkCommandlet, Display, TEXT("Benchmark results saved to %s"), *FPaths::ConvertRelativePathToFull(OutputPath));
+	}
+	else
+	{
+		UE_LOG(LogMassBenchmarkCommandlet, Error, TEXT("Failed to save the benchmark results to %s"), *OutputPath);
+		return 1;
+	}
+
+	return 0;
+}
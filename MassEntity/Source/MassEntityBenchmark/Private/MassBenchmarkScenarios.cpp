@@ -0,0 +1,530 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "MassBenchmark.h"
+#include "MassBenchmarkTypes.h"
+#include "MassEntitySubsystem.h"
+#include "MassCommandBuffer.h"
+#include "MassExecutor.h"
+#include "MassEntityView.h"
+#include "MassEntitySettings.h"
+#include "MassProcessingTypes.h"
+#include "UObject/UObjectIterator.h"
+
+namespace UE::Mass::Benchmark
+{
+	const UScriptStruct* GetArchetypeTag(const int32 TagIndex)
+	{
+		static const UScriptStruct* Tags[NumArchetypeTags] = {
+			FMassBenchmarkTag_0::StaticStruct(), FMassBenchmarkTag_1::StaticStruct(), FMassBenchmarkTag_2::StaticStruct(), FMassBenchmarkTag_3::StaticStruct(),
+			FMassBenchmarkTag_4::StaticStruct(), FMassBenchmarkTag_5::StaticStruct(), FMassBenchmarkTag_6::StaticStruct(), FMassBenchmarkTag_7::StaticStruct()
+		};
+		check(TagIndex >= 0 && TagIndex < NumArchetypeTags);
+		return Tags[TagIndex];
+	}
+} // UE::Mass::Benchmark
+
+namespace UE::Mass::Benchmark::Private
+{
+	FArchetypeHandle CreateMovementArchetype(UMassEntitySubsystem& EntitySubsystem, const int32 TagMask = 0)
+	{
+		TArray<const UScriptStruct*, TInlineAllocator<NumArchetypeTags + 2>> Types = { FMassBenchmarkFragment_Location::StaticStruct(), FMassBenchmarkFragment_Velocity::StaticStruct() };
+		for (int32 TagIndex = 0; TagIndex < NumArchetypeTags; ++TagIndex)
+		{
+			if (TagMask & (1 << TagIndex))
+			{
+				Types.Add(GetArchetypeTag(TagIndex));
+			}
+		}
+		return EntitySubsystem.CreateArchetype(Types);
+	}
+
+	/** Creates Settings.NumEntities entities of a single archetype and shuffles them, so that the scenarios visit them in a random, but reproducible, order */
+	void SetUpShuffledEntities(FMassBenchmarkEnvironment& Environment)
+	{
+		const FArchetypeHandle Archetype = CreateMovementArchetype(Environment.EntitySubsystem);
+		Environment.Archetypes.Add(Archetype);
+		Environment.EntitySubsystem.BatchCreateEntities(Archetype, Environment.Settings.NumEntities, Environment.Entities);
+
+		for (int32 Index = Environment.Entities.Num() - 1; Index > 0; --Index)
+		{
+			Environment.Entities.Swap(Index, Environment.RandomStream.RandRange(0, Index));
+		}
+	}
+
+	void SetUpSpawn(FMassBenchmarkEnvironment& Environment)
+	{
+		Environment.Archetypes.Add(CreateMovementArchetype(Environment.EntitySubsystem));
+		Environment.Entities.Reserve(Environment.Settings.NumEntities);
+	}
+
+	int32 RunSpawn(FMassBenchmarkEnvironment& Environment)
+	{
+		Environment.EntitySubsystem.BatchCreateEntities(Environment.Archetypes[0], Environment.Settings.NumEntities, Environment.Entities);
+		return Environment.Entities.Num();
+	}
+
+	int32 RunSpawnOneByOne(FMassBenchmarkEnvironment& Environment)
+	{
+		for (int32 EntityIndex = 0; EntityIndex < Environment.Settings.NumEntities; ++EntityIndex)
+		{
+			Environment.Entities.Add(Environment.EntitySubsystem.CreateEntity(Environment.Archetypes[0]));
+		}
+		return Environment.Entities.Num();
+	}
+
+	int32 RunTagChurn(FMassBenchmarkEnvironment& Environment)
+	{
+		UMassEntitySubsystem& EntitySubsystem = Environment.EntitySubsystem;
+		const UScriptStruct* Tag = FMassBenchmarkTag_Churn::StaticStruct();
+		for (const FMassEntityHandle& Entity : Environment.Entities)
+		{
+			EntitySubsystem.AddTagToEntity(Entity, Tag);
+		}
+		for (const FMassEntityHandle& Entity : Environment.Entities)
+		{
+			EntitySubsystem.RemoveTagFromEntity(Entity, Tag);
+		}
+		return Environment.Entities.Num();
+	}
+
+	int32 RunFragmentChurn(FMassBenchmarkEnvironment& Environment)
+	{
+		UMassEntitySubsystem& EntitySubsystem = Environment.EntitySubsystem;
+		const UScriptStruct* Fragment = FMassBenchmarkFragment_Churn::StaticStruct();
+		for (const FMassEntityHandle& Entity : Environment.Entities)
+		{
+			EntitySubsystem.AddFragmentToEntity(Entity, Fragment);
+		}
+		for (const FMassEntityHandle& Entity : Environment.Entities)
+		{
+			EntitySubsystem.RemoveFragmentFromEntity(Entity, Fragment);
+		}
+		return Environment.Entities.Num();
+	}
+
+	int32 RunFragmentLookup(FMassBenchmarkEnvironment& Environment)
+	{
+		UMassEntitySubsystem& EntitySubsystem = Environment.EntitySubsystem;
+		for (const FMassEntityHandle& Entity : Environment.Entities)
+		{
+			EntitySubsystem.GetFragmentDataChecked<FMassBenchmarkFragment_Location>(Entity).Value.X += 1.f;
+		}
+		return Environment.Entities.Num();
+	}
+
+	int32 RunEntityViewLookup(FMassBenchmarkEnvironment& Environment)
+	{
+		UMassEntitySubsystem& EntitySubsystem = Environment.EntitySubsystem;
+		for (const FMassEntityHandle& Entity : Environment.Entities)
+		{
+			const FMassEntityView EntityView(EntitySubsystem, Entity);
+			EntityView.GetFragmentData<FMassBenchmarkFragment_Velocity>().Value.X += 1.f;
+		}
+		return Environment.Entities.Num();
+	}
+
+	void SetUpParallelQuery(FMassBenchmarkEnvironment& Environment)
+	{
+		UMassEntitySubsystem& EntitySubsystem = Environment.EntitySubsystem;
+		const int32 NumArchetypes = FMath::Clamp(Environment.Settings.NumArchetypes, 1, 1 << NumArchetypeTags);
+		for (int32 ArchetypeIndex = 0; ArchetypeIndex < NumArchetypes; ++ArchetypeIndex)
+		{
+			Environment.Archetypes.Add(CreateMovementArchetype(EntitySubsystem, ArchetypeIndex));
+		}
+
+		// spreading the entities unevenly, to get partially filled chunks as well
+		for (int32 EntityIndex = 0; EntityIndex < Environment.Settings.NumEntities; ++EntityIndex)
+		{
+			const int32 ArchetypeIndex = Environment.RandomStream.RandHelper(NumArchetypes);
+			EntitySubsystem.CreateEntity(Environment.Archetypes[ArchetypeIndex]);
+		}
+
+		Environment.Processor = NewObject<UMassBenchmarkMovementProcessor>(&EntitySubsystem);
+	}
+
+	int32 RunMovementProcessor(FMassBenchmarkEnvironment& Environment)
+	{
+		FMassProcessingContext ProcessingContext(Environment.EntitySubsystem, /*DeltaSeconds=*/1.f / 30.f);
+		UE::Mass::Executor::Run(*Environment.Processor, ProcessingContext);
+		return CastChecked<UMassBenchmarkMovementProcessor>(Environment.Processor)->NumEntitiesProcessed.load();
+	}
+
+	/** Leaves only a handful of entities in every other chunk, emulating the small tail chunks left behind by entity removal */
+	void SetUpSparseParallelQuery(FMassBenchmarkEnvironment& Environment)
+	{
+		UMassEntitySubsystem& EntitySubsystem = Environment.EntitySubsystem;
+		const FArchetypeHandle Archetype = CreateMovementArchetype(EntitySubsystem);
+		Environment.Archetypes.Add(Archetype);
+
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem.BatchCreateEntities(Archetype, Environment.Settings.NumEntities, Entities);
+		const FMassArchetypeFragmentationInfo FragmentationInfo = EntitySubsystem.GetArchetypeFragmentationInfo(Archetype);
+		const int32 EntitiesPerChunk = FMath::Max(FragmentationInfo.EntityCapacity / FMath::Max(FragmentationInfo.NumChunks, 1), 1);
+
+		TArray<FMassEntityHandle> EntitiesToDestroy;
+		for (int32 EntityIndex = 0; EntityIndex < Entities.Num(); ++EntityIndex)
+		{
+			const bool bDestroy = (EntityIndex / EntitiesPerChunk) % 2 == 1 && (EntityIndex % EntitiesPerChunk) >= 8;
+			(bDestroy ? EntitiesToDestroy : Environment.Entities).Add(Entities[EntityIndex]);
+		}
+		EntitySubsystem.BatchDestroyEntities(EntitiesToDestroy);
+
+		Environment.Processor = NewObject<UMassBenchmarkMovementProcessor>(&EntitySubsystem);
+	}
+
+	int32 RunMovementProcessorPerChunkJobs(FMassBenchmarkEnvironment& Environment)
+	{
+		TGuardValue<int32> MinBatchSizeGuard(UE::Mass::Private::ParallelMinBatchSize, 0);
+		TGuardValue<int32> BatchesPerWorkerGuard(UE::Mass::Private::ParallelJobBatchesPerWorker, 0);
+		return RunMovementProcessor(Environment);
+	}
+
+	/** Creates the entities with the AoS movement fragments, processed sequentially to compare against SetUpSoAMovement */
+	void SetUpAoSMovement(FMassBenchmarkEnvironment& Environment)
+	{
+		const FArchetypeHandle Archetype = CreateMovementArchetype(Environment.EntitySubsystem);
+		Environment.Archetypes.Add(Archetype);
+		Environment.EntitySubsystem.BatchCreateEntities(Archetype, Environment.Settings.NumEntities, Environment.Entities);
+
+		UMassBenchmarkMovementProcessor* Processor = NewObject<UMassBenchmarkMovementProcessor>(&Environment.EntitySubsystem);
+		Processor->bProcessInParallel = false;
+		Environment.Processor = Processor;
+	}
+
+	void SetUpSoAMovement(FMassBenchmarkEnvironment& Environment)
+	{
+		const UScriptStruct* FragmentTypes[] = { FMassBenchmarkFragment_SplitLocation::StaticStruct(), FMassBenchmarkFragment_SplitVelocity::StaticStruct() };
+		const FArchetypeHandle Archetype = Environment.EntitySubsystem.CreateArchetype(FragmentTypes);
+		Environment.Archetypes.Add(Archetype);
+		Environment.EntitySubsystem.BatchCreateEntities(Archetype, Environment.Settings.NumEntities, Environment.Entities);
+
+		Environment.Processor = NewObject<UMassBenchmarkSoAMovementProcessor>(&Environment.EntitySubsystem);
+	}
+
+	int32 RunSoAMovementProcessor(FMassBenchmarkEnvironment& Environment)
+	{
+		FMassProcessingContext ProcessingContext(Environment.EntitySubsystem, /*DeltaSeconds=*/1.f / 30.f);
+		UE::Mass::Executor::Run(*Environment.Processor, ProcessingContext);
+		return CastChecked<UMassBenchmarkSoAMovementProcessor>(Environment.Processor)->NumEntitiesProcessed;
+	}
+
+	/** Creates the entities in an archetype using ChunkSizeKB sized chunks, processed sequentially by the movement processor */
+	void SetUpChunkSizeQuery(FMassBenchmarkEnvironment& Environment, const int32 ChunkSizeKB)
+	{
+		// the chunk size is picked when the archetype gets created, the settings can be restored right away
+		FArchetypeHandle Archetype;
+		{
+			UMassEntitySettings& Settings = *GetMutableDefault<UMassEntitySettings>();
+			TGuardValue<int32> ChunkMemorySizeGuard(Settings.ChunkMemorySize, ChunkSizeKB * 1024);
+			TGuardValue<int32> TargetEntitiesPerChunkGuard(Settings.TargetEntitiesPerChunk, 0);
+			Archetype = CreateMovementArchetype(Environment.EntitySubsystem);
+		}
+
+		Environment.Archetypes.Add(Archetype);
+		Environment.EntitySubsystem.BatchCreateEntities(Archetype, Environment.Settings.NumEntities, Environment.Entities);
+
+		UMassBenchmarkMovementProcessor* Processor = NewObject<UMassBenchmarkMovementProcessor>(&Environment.EntitySubsystem);
+		Processor->bProcessInParallel = false;
+		Environment.Processor = Processor;
+	}
+
+	void SetUpCommandReplay(FMassBenchmarkEnvironment& Environment)
+	{
+		SetUpShuffledEntities(Environment);
+
+		// a mix of commands, changing the entities' composition back and forth
+		Environment.CommandBuffer = MakeShareable(new FMassCommandBuffer());
+		FMassCommandBuffer& CommandBuffer = *Environment.CommandBuffer;
+		for (const FMassEntityHandle& Entity : Environment.Entities)
+		{
+			switch (Environment.RandomStream.RandHelper(3))
+			{
+			case 0:
+				CommandBuffer.AddTag<FMassBenchmarkTag_Churn>(Entity);
+				break;
+			case 1:
+				CommandBuffer.AddFragment<FMassBenchmarkFragment_Churn>(Entity);
+				break;
+			default:
+				CommandBuffer.AddTag<FMassBenchmarkTag_Churn>(Entity);
+				CommandBuffer.RemoveTag<FMassBenchmarkTag_Churn>(Entity);
+				break;
+			}
+		}
+	}
+
+	int32 RunCommandReplay(FMassBenchmarkEnvironment& Environment)
+	{
+		Environment.CommandBuffer->ReplayBufferAgainstSystem(&Environment.EntitySubsystem);
+		return Environment.Entities.Num();
+	}
+
+	/** Fills the command buffer with a tag and a fragment round trip for every entity, with the commands of a kind grouped together */
+	void SetUpCommandRoundTrip(FMassBenchmarkEnvironment& Environment)
+	{
+		SetUpShuffledEntities(Environment);
+
+		Environment.CommandBuffer = MakeShareable(new FMassCommandBuffer());
+		FMassCommandBuffer& CommandBuffer = *Environment.CommandBuffer;
+		for (const FMassEntityHandle& Entity : Environment.Entities)
+		{
+			CommandBuffer.AddTag<FMassBenchmarkTag_Churn>(Entity);
+			CommandBuffer.AddFragment<FMassBenchmarkFragment_Churn>(Entity);
+		}
+		for (const FMassEntityHandle& Entity : Environment.Entities)
+		{
+			CommandBuffer.RemoveTag<FMassBenchmarkTag_Churn>(Entity);
+		}
+		for (const FMassEntityHandle& Entity : Environment.Entities)
+		{
+			CommandBuffer.RemoveFragment<FMassBenchmarkFragment_Churn>(Entity);
+		}
+	}
+
+	/** Replays the environment's command buffer with massentities.CoalesceCommands set to bCoalesce */
+	int32 ReplayCommands(FMassBenchmarkEnvironment& Environment, const bool bCoalesce)
+	{
+		TGuardValue<bool> CoalesceCommandsGuard(UE::FLWCCommand::bCoalesceCommands, bCoalesce);
+		Environment.CommandBuffer->ReplayBufferAgainstSystem(&Environment.EntitySubsystem);
+		return Environment.Entities.Num();
+	}
+
+	int32 RunCommandRoundTrip(FMassBenchmarkEnvironment& Environment)
+	{
+		return ReplayCommands(Environment, /*bCoalesce=*/false);
+	}
+
+	int32 RunCoalescedCommandRoundTrip(FMassBenchmarkEnvironment& Environment)
+	{
+		return ReplayCommands(Environment, /*bCoalesce=*/true);
+	}
+
+	/** Fragment types the archetype caching scenarios compose their archetypes and queries from */
+	TConstArrayView<const UScriptStruct*> GetArchetypeCachingFragmentTypes()
+	{
+		static const UScriptStruct* FragmentTypes[] = {
+			FMassBenchmarkFragment_Location::StaticStruct(), FMassBenchmarkFragment_Velocity::StaticStruct(), FMassBenchmarkFragment_Churn::StaticStruct(), FMassBenchmarkFragment_Observed::StaticStruct(),
+			FMassBenchmarkFragment_SplitLocation::StaticStruct(), FMassBenchmarkFragment_SplitVelocity::StaticStruct()
+		};
+		return FragmentTypes;
+	}
+
+	constexpr int32 NumArchetypeCachingQueries = 500;
+	constexpr int32 NumArchetypeCachingArchetypes = 300;
+
+	/** Creates NumArchetypeCachingQueries queries with random requirements, all of them already caught up with the existing archetypes */
+	void SetUpArchetypeCaching(FMassBenchmarkEnvironment& Environment)
+	{
+		const TConstArrayView<const UScriptStruct*> FragmentTypes = GetArchetypeCachingFragmentTypes();
+		Environment.Queries.AddDefaulted(NumArchetypeCachingQueries);
+		for (FMassEntityQuery& Query : Environment.Queries)
+		{
+			const int32 RequiredIndex = Environment.RandomStream.RandHelper(FragmentTypes.Num());
+			const int32 OptionalIndex = (RequiredIndex + 1 + Environment.RandomStream.RandHelper(FragmentTypes.Num() - 1)) % FragmentTypes.Num();
+			Query.AddRequirement(FragmentTypes[RequiredIndex], EMassFragmentAccess::ReadOnly);
+			Query.AddRequirement(FragmentTypes[OptionalIndex], EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+			Query.AddTagRequirement(*GetArchetypeTag(Environment.RandomStream.RandHelper(NumArchetypeTags)), EMassFragmentPresence::None);
+			Query.CacheArchetypes(Environment.EntitySubsystem);
+		}
+	}
+
+	/** Creates archetypes one by one, with all the queries re-caching after each, like they would every frame */
+	int32 CreateArchetypesAndCacheQueries(FMassBenchmarkEnvironment& Environment, const bool bForceFullRecaching)
+	{
+		const TConstArrayView<const UScriptStruct*> FragmentTypes = GetArchetypeCachingFragmentTypes();
+		for (int32 ArchetypeIndex = 1; ArchetypeIndex <= NumArchetypeCachingArchetypes; ++ArchetypeIndex)
+		{
+			TArray<const UScriptStruct*, TInlineAllocator<16>> Composition;
+			for (int32 Bit = 0; Bit < FragmentTypes.Num(); ++Bit)
+			{
+				if (ArchetypeIndex & (1 << Bit))
+				{
+					Composition.Add(FragmentTypes[Bit]);
+				}
+			}
+			Composition.Add(GetArchetypeTag(ArchetypeIndex % NumArchetypeTags));
+			Environment.EntitySubsystem.CreateArchetype(Composition);
+
+#if WITH_MASSENTITY_DEBUG
+			if (bForceFullRecaching)
+			{
+				Environment.EntitySubsystem.DebugForceArchetypeDataVersionBump();
+			}
+#endif // WITH_MASSENTITY_DEBUG
+			for (FMassEntityQuery& Query : Environment.Queries)
+			{
+				Query.CacheArchetypes(Environment.EntitySubsystem);
+			}
+		}
+		return NumArchetypeCachingQueries * NumArchetypeCachingArchetypes;
+	}
+
+	int32 RunArchetypeCaching(FMassBenchmarkEnvironment& Environment)
+	{
+		return CreateArchetypesAndCacheQueries(Environment, /*bForceFullRecaching=*/false);
+	}
+
+#if WITH_MASSENTITY_DEBUG
+	int32 RunArchetypeFullRecaching(FMassBenchmarkEnvironment& Environment)
+	{
+		return CreateArchetypesAndCacheQueries(Environment, /*bForceFullRecaching=*/true);
+	}
+#endif // WITH_MASSENTITY_DEBUG
+
+	/** The entities destroyed by the destruction scenarios, a random fifth of all the entities */
+	TConstArrayView<FMassEntityHandle> GetEntitiesToDestroy(const FMassBenchmarkEnvironment& Environment)
+	{
+		return MakeArrayView(Environment.Entities.GetData(), Environment.Entities.Num() / 5);
+	}
+
+	int32 RunBatchDestroy(FMassBenchmarkEnvironment& Environment)
+	{
+		const TConstArrayView<FMassEntityHandle> EntitiesToDestroy = GetEntitiesToDestroy(Environment);
+		Environment.EntitySubsystem.BatchDestroyEntities(EntitiesToDestroy);
+		return EntitiesToDestroy.Num();
+	}
+
+	int32 RunDestroyOneByOne(FMassBenchmarkEnvironment& Environment)
+	{
+		const TConstArrayView<FMassEntityHandle> EntitiesToDestroy = GetEntitiesToDestroy(Environment);
+		for (const FMassEntityHandle& Entity : EntitiesToDestroy)
+		{
+			Environment.EntitySubsystem.DestroyEntity(Entity);
+		}
+		return EntitiesToDestroy.Num();
+	}
+
+	void SetUpCompaction(FMassBenchmarkEnvironment& Environment)
+	{
+		SetUpShuffledEntities(Environment);
+
+		// destroying a random half of the entities leaves the chunks fragmented
+		const int32 NumToDestroy = Environment.Entities.Num() / 2;
+		Environment.EntitySubsystem.BatchDestroyEntities(MakeArrayView(Environment.Entities.GetData(), NumToDestroy));
+		Environment.Entities.RemoveAt(0, NumToDestroy);
+	}
+
+	int32 RunCompaction(FMassBenchmarkEnvironment& Environment)
+	{
+		Environment.EntitySubsystem.DoEntityCompaction(/*TimeAllowed=*/TNumericLimits<double>::Max());
+		return Environment.Entities.Num();
+	}
+
+	int32 RunObserverStorm(FMassBenchmarkEnvironment& Environment)
+	{
+		UMassBenchmarkObserver::NumEntitiesProcessed = 0;
+		FMassCommandBuffer& CommandBuffer = Environment.EntitySubsystem.Defer();
+		for (const FMassEntityHandle& Entity : Environment.Entities)
+		{
+			CommandBuffer.AddFragment<FMassBenchmarkFragment_Observed>(Entity);
+		}
+		CommandBuffer.ReplayBufferAgainstSystem(&Environment.EntitySubsystem);
+		ensureMsgf(UMassBenchmarkObserver::NumEntitiesProcessed == Environment.Entities.Num()
+			, TEXT("Expected the observer to process all the %d entities, got %d"), Environment.Entities.Num(), UMassBenchmarkObserver::NumEntitiesProcessed);
+		return Environment.Entities.Num();
+	}
+
+	constexpr int32 NumBitSets = 256;
+	constexpr int32 NumBitSetPasses = 20;
+	/** Where the bit set scenarios store their results, keeping the compiler from optimizing the work away */
+	volatile uint32 BitSetResultSink = 0;
+
+	/**
+	 * Creates NumBitSets random fragment bit sets, composed from all the registered fragment types, so that the bit sets
+	 * span as many words as the archetype compositions and query requirements of an actual project would
+	 */
+	void SetUpBitSets(FMassBenchmarkEnvironment& Environment)
+	{
+		TArray<const UScriptStruct*> FragmentTypes;
+		for (TObjectIterator<UScriptStruct> StructIt; StructIt; ++StructIt)
+		{
+			if (StructIt->IsChildOf(FMassFragment::StaticStruct()))
+			{
+				FragmentTypes.Add(*StructIt);
+			}
+		}
+
+		Environment.FragmentBitSets.SetNum(NumBitSets);
+		for (FMassFragmentBitSet& BitSet : Environment.FragmentBitSets)
+		{
+			// a handful of fragments, like a typical archetype has
+			const int32 NumFragments = Environment.RandomStream.RandRange(1, 8);
+			for (int32 Index = 0; Index < NumFragments; ++Index)
+			{
+				BitSet.Add(*FragmentTypes[Environment.RandomStream.RandHelper(FragmentTypes.Num())]);
+			}
+		}
+	}
+
+	int32 RunBitSetMatching(FMassBenchmarkEnvironment& Environment)
+	{
+		int32 NumMatches = 0;
+		for (int32 Pass = 0; Pass < NumBitSetPasses; ++Pass)
+		{
+			for (const FMassFragmentBitSet& A : Environment.FragmentBitSets)
+			{
+				for (const FMassFragmentBitSet& B : Environment.FragmentBitSets)
+				{
+					NumMatches += A.HasAll(B) ? 1 : 0;
+					NumMatches += A.HasNone(B) ? 1 : 0;
+				}
+			}
+		}
+		BitSetResultSink = uint32(NumMatches);
+		return NumBitSetPasses * NumBitSets * NumBitSets;
+	}
+
+	int32 RunBitSetHashing(FMassBenchmarkEnvironment& Environment)
+	{
+		uint32 Hash = 0;
+		for (int32 Pass = 0; Pass < NumBitSetPasses; ++Pass)
+		{
+			for (const FMassFragmentBitSet& BitSet : Environment.FragmentBitSets)
+			{
+				Hash = HashCombine(Hash, GetTypeHash(BitSet));
+			}
+		}
+		BitSetResultSink = Hash;
+		return NumBitSetPasses * NumBitSets;
+	}
+} // UE::Mass::Benchmark::Private
+
+namespace UE::Mass::Benchmark
+{
+	TConstArrayView<FMassBenchmarkScenario> GetScenarios()
+	{
+		using namespace UE::Mass::Benchmark::Private;
+
+		static const FMassBenchmarkScenario Scenarios[] = {
+			{TEXT("Spawn"), TEXT("Batch-creates NumEntities entities of a single archetype"), &SetUpSpawn, &RunSpawn},
+			{TEXT("SpawnOneByOne"), TEXT("Same as Spawn, creating the entities one at a time"), &SetUpSpawn, &RunSpawnOneByOne},
+			{TEXT("TagChurn"), TEXT("Adds and then removes a tag to every entity, one entity at a time, in random order"), &SetUpShuffledEntities, &RunTagChurn},
+			{TEXT("FragmentChurn"), TEXT("Adds and then removes a fragment to every entity, one entity at a time, in random order"), &SetUpShuffledEntities, &RunFragmentChurn},
+			{TEXT("FragmentLookup"), TEXT("Looks up a fragment of every entity, in random order, with GetFragmentDataChecked"), &SetUpShuffledEntities, &RunFragmentLookup},
+			{TEXT("EntityViewLookup"), TEXT("Looks up a fragment of every entity, in random order, through an FMassEntityView"), &SetUpShuffledEntities, &RunEntityViewLookup},
+			{TEXT("ParallelQuery"), TEXT("Runs a processor updating all the entities, randomly spread over NumArchetypes archetypes, with ParallelForEachEntityChunk"), &SetUpParallelQuery, &RunMovementProcessor},
+			{TEXT("SparseParallelQuery"), TEXT("Runs the ParallelQuery processor over a single archetype with every other chunk holding only a handful of entities, packing the chunks into cost-balanced jobs"), &SetUpSparseParallelQuery, &RunMovementProcessor},
+			{TEXT("SparseParallelQueryPerChunkJobs"), TEXT("Same as SparseParallelQuery, with a job dispatched for every chunk"), &SetUpSparseParallelQuery, &RunMovementProcessorPerChunkJobs},
+			{TEXT("AoSMovement"), TEXT("Runs the movement processor sequentially over entities storing the location and velocity as vectors"), &SetUpAoSMovement, &RunMovementProcessor},
+			{TEXT("SoAMovement"), TEXT("Same as AoSMovement, with location and velocity stored as split fragments and every component integrated with SIMD"), &SetUpSoAMovement, &RunSoAMovementProcessor},
+			{TEXT("ChunkSize16KB"), TEXT("Runs the movement processor sequentially over a single archetype using 16KB chunks"), [](FMassBenchmarkEnvironment& Environment) { SetUpChunkSizeQuery(Environment, 16); }, &RunMovementProcessor},
+			{TEXT("ChunkSize32KB"), TEXT("Same as ChunkSize16KB, with 32KB chunks"), [](FMassBenchmarkEnvironment& Environment) { SetUpChunkSizeQuery(Environment, 32); }, &RunMovementProcessor},
+			{TEXT("ChunkSize64KB"), TEXT("Same as ChunkSize16KB, with 64KB chunks"), [](FMassBenchmarkEnvironment& Environment) { SetUpChunkSizeQuery(Environment, 64); }, &RunMovementProcessor},
+			{TEXT("ChunkSize128KB"), TEXT("Same as ChunkSize16KB, with 128KB chunks"), [](FMassBenchmarkEnvironment& Environment) { SetUpChunkSizeQuery(Environment, 128); }, &RunMovementProcessor},
+			{TEXT("CommandReplay"), TEXT("Replays a command buffer holding a random mix of tag and fragment commands, one or two per entity"), &SetUpCommandReplay, &RunCommandReplay},
+			{TEXT("CommandRoundTrip"), TEXT("Replays a command buffer adding and then removing a tag and a fragment to every entity, one command at a time"), &SetUpCommandRoundTrip, &RunCommandRoundTrip},
+			{TEXT("CoalescedCommandRoundTrip"), TEXT("Same as CommandRoundTrip, with massentities.CoalesceCommands enabled"), &SetUpCommandRoundTrip, &RunCoalescedCommandRoundTrip},
+			{TEXT("BatchDestroy"), TEXT("Batch-destroys a random fifth of the entities of a single archetype"), &SetUpShuffledEntities, &RunBatchDestroy},
+			{TEXT("DestroyOneByOne"), TEXT("Same as BatchDestroy, destroying the entities one at a time"), &SetUpShuffledEntities, &RunDestroyOneByOne},
+			{TEXT("ArchetypeCaching"), TEXT("Creates archetypes one at a time, with a set of queries incrementally caching the new archetypes after each. Normalized per query cache update."), &SetUpArchetypeCaching, &RunArchetypeCaching},
+#if WITH_MASSENTITY_DEBUG
+			{TEXT("ArchetypeFullRecaching"), TEXT("Same as ArchetypeCaching, with the queries re-caching all the archetypes every time"), &SetUpArchetypeCaching, &RunArchetypeFullRecaching},
+#endif // WITH_MASSENTITY_DEBUG
+			{TEXT("Compaction"), TEXT("Compacts the chunks of an archetype a random half of the entities got destroyed from"), &SetUpCompaction, &RunCompaction},
+			{TEXT("ObserverStorm"), TEXT("Adds an observed fragment to every entity via deferred commands, triggering the observer for all of them"), &SetUpShuffledEntities, &RunObserverStorm},
+			{TEXT("BitSetMatching"), TEXT("Tests every pair of a set of random fragment bit sets with HasAll and HasNone, the way queries match archetypes. Normalized per pair of bit sets."), &SetUpBitSets, &RunBitSetMatching},
+			{TEXT("BitSetHashing"), TEXT("Hashes a set of random fragment bit sets. Normalized per bit set."), &SetUpBitSets, &RunBitSetHashing},
+		};
+		return Scenarios;
+	}
+} // UE::Mass::Benchmark
@@ -0,0 +1,125 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "MassBenchmarkTypes.h"
+#include "MassEntitySubsystem.h"
+
+//----------------------------------------------------------------------//
+// UMassBenchmarkMovementProcessor
+//----------------------------------------------------------------------//
+UMassBenchmarkMovementProcessor::UMassBenchmarkMovementProcessor()
+	: EntityQuery(*this)
+{
+#if WITH_EDITORONLY_DATA
+	bCanShowUpInSettings = false;
+#endif // WITH_EDITORONLY_DATA
+	bAutoRegisterWithProcessingPhases = false;
+	ExecutionFlags = int32(EProcessorExecutionFlags::All);
+}
+
+void UMassBenchmarkMovementProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FMassBenchmarkFragment_Location>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FMassBenchmarkFragment_Velocity>(EMassFragmentAccess::ReadOnly);
+}
+
+void UMassBenchmarkMovementProcessor::Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context)
+{
+	NumEntitiesProcessed = 0;
+	const float DeltaTime = Context.GetDeltaTimeSeconds();
+	// ParallelForEachEntityChunk falls back to sequential processing if parallel execution is not allowed
+	EntityQuery.SetParallelExecutionAllowed(bProcessInParallel);
+	EntityQuery.ParallelForEachEntityChunk(EntitySubsystem, Context, [this, DeltaTime](FMassExecutionContext& Context)
+		{
+			const TArrayView<FMassBenchmarkFragment_Location> Locations = Context.GetMutableFragmentView<FMassBenchmarkFragment_Location>();
+			const TConstArrayView<FMassBenchmarkFragment_Velocity> Velocities = Context.GetFragmentView<FMassBenchmarkFragment_Velocity>();
+			for (int32 EntityIndex = 0; EntityIndex < Context.GetNumEntities(); ++EntityIndex)
+			{
+				Locations[EntityIndex].Value += Velocities[EntityIndex].Value * DeltaTime;
+			}
+			NumEntitiesProcessed.fetch_add(Context.GetNumEntities(), std::memory_order_relaxed);
+		});
+}
+
+//----------------------------------------------------------------------//
+// UMassBenchmarkSoAMovementProcessor
+//----------------------------------------------------------------------//
+namespace
+{
+	/** Locations[i] += Velocities[i] * DeltaTime, four values at a time */
+	void IntegrateComponent(const TArrayView<float> Locations, const TConstArrayView<float> Velocities, const float DeltaTime)
+	{
+		check(Locations.Num() == Velocities.Num());
+		const VectorRegister4Float DeltaTimeVector = VectorSetFloat1(DeltaTime);
+		const int32 NumVectorized = Locations.Num() & ~3;
+
+		float* LocationsData = Locations.GetData();
+		const float* VelocitiesData = Velocities.GetData();
+		int32 i = 0;
+		for (; i < NumVectorized; i += 4)
+		{
+			VectorStore(VectorMultiplyAdd(VectorLoad(VelocitiesData + i), DeltaTimeVector, VectorLoad(LocationsData + i)), LocationsData + i);
+		}
+		for (; i < Locations.Num(); ++i)
+		{
+			LocationsData[i] += VelocitiesData[i] * DeltaTime;
+		}
+	}
+}
+
+UMassBenchmarkSoAMovementProcessor::UMassBenchmarkSoAMovementProcessor()
+	: EntityQuery(*this)
+{
+#if WITH_EDITORONLY_DATA
+	bCanShowUpInSettings = false;
+#endif // WITH_EDITORONLY_DATA
+	bAutoRegisterWithProcessingPhases = false;
+	ExecutionFlags = int32(EProcessorExecutionFlags::All);
+}
+
+void UMassBenchmarkSoAMovementProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FMassBenchmarkFragment_SplitLocation>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FMassBenchmarkFragment_SplitVelocity>(EMassFragmentAccess::ReadOnly);
+}
+
+void UMassBenchmarkSoAMovementProcessor::Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context)
+{
+	NumEntitiesProcessed = 0;
+	EntityQuery.ForEachEntityChunk(EntitySubsystem, Context, [this](FMassExecutionContext& Context)
+		{
+			const float DeltaTime = Context.GetDeltaTimeSeconds();
+			IntegrateComponent(Context.GetMutableFragmentValues(&FMassBenchmarkFragment_SplitLocation::X), Context.GetFragmentValues(&FMassBenchmarkFragment_SplitVelocity::X), DeltaTime);
+			IntegrateComponent(Context.GetMutableFragmentValues(&FMassBenchmarkFragment_SplitLocation::Y), Context.GetFragmentValues(&FMassBenchmarkFragment_SplitVelocity::Y), DeltaTime);
+			IntegrateComponent(Context.GetMutableFragmentValues(&FMassBenchmarkFragment_SplitLocation::Z), Context.GetFragmentValues(&FMassBenchmarkFragment_SplitVelocity::Z), DeltaTime);
+			NumEntitiesProcessed += Context.GetNumEntities();
+		});
+}
+
+//----------------------------------------------------------------------//
+// UMassBenchmarkObserver
+//----------------------------------------------------------------------//
+int32 UMassBenchmarkObserver::NumEntitiesProcessed = 0;
+
+UMassBenchmarkObserver::UMassBenchmarkObserver()
+	: EntityQuery(*this)
+{
+	FragmentType = FMassBenchmarkFragment_Observed::StaticStruct();
+	ExecutionFlags = int32(EProcessorExecutionFlags::All);
+}
+
+void UMassBenchmarkObserver::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FMassBenchmarkFragment_Observed>(EMassFragmentAccess::ReadWrite);
+}
+
+void UMassBenchmarkObserver::Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context)
+{
+	EntityQuery.ForEachEntityChunk(EntitySubsystem, Context, [](FMassExecutionContext& Context)
+		{
+			for (FMassBenchmarkFragment_Observed& Observed : Context.GetMutableFragmentView<FMassBenchmarkFragment_Observed>())
+			{
+				Observed.Value = 1;
+			}
+			NumEntitiesProcessed += Context.GetNumEntities();
+		});
+}
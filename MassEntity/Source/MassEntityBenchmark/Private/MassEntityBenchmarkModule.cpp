@@ -0,0 +1,13 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "MassEntityBenchmarkModule.h"
+
+#define LOCTEXT_NAMESPACE "MassBenchmark"
+
+class FMassEntityBenchmarkModule : public IMassEntityBenchmarkModule
+{
+};
+
+IMPLEMENT_MODULE(FMassEntityBenchmarkModule, MassEntityBenchmark)
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,107 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+#include "MassEntityTypes.h"
+#include "MassEntityQuery.h"
+
+class UWorld;
+class UMassEntitySubsystem;
+class UMassProcessor;
+struct FMassCommandBuffer;
+
+/** Parameters shared by all the benchmark scenarios. Using the same values results in the same work being done. */
+struct FMassBenchmarkSettings
+{
+	/** Number of entities every scenario works with */
+	int32 NumEntities = 100000;
+	/** Number of distinct archetypes the entities get spread over by the scenarios involving multiple archetypes */
+	int32 NumArchetypes = 16;
+	/** Number of measured runs of every scenario */
+	int32 NumIterations = 10;
+	/** Number of runs of every scenario done before the measured ones, to warm up the caches and memory pools */
+	int32 NumWarmupIterations = 1;
+	/** Seeds the random stream the scenarios use for picking entities, reset before every run */
+	int32 Seed = 0x4D415353;
+	/** Whether to do an additional run of every scenario counting memory allocations. Requires replacing GMalloc. */
+	bool bTrackAllocations = true;
+	/** Names of the scenarios to run, all of them if empty */
+	TArray<FString> ScenarioFilter;
+};
+
+/** Everything a benchmark scenario run works with. Recreated for every run. */
+struct FMassBenchmarkEnvironment
+{
+	FMassBenchmarkEnvironment(UMassEntitySubsystem& InEntitySubsystem, const FMassBenchmarkSettings& InSettings)
+		: EntitySubsystem(InEntitySubsystem)
+		, Settings(InSettings)
+		, RandomStream(InSettings.Seed)
+	{}
+
+	UMassEntitySubsystem& EntitySubsystem;
+	const FMassBenchmarkSettings& Settings;
+	FRandomStream RandomStream;
+
+	/** Scenario-specific state, set up outside of the measured part */
+	TArray<FMassEntityHandle> Entities;
+	TArray<FArchetypeHandle> Archetypes;
+	TSharedPtr<FMassCommandBuffer> CommandBuffer;
+	UMassProcessor* Processor = nullptr;
+	TArray<FMassEntityQuery> Queries;
+	TArray<FMassFragmentBitSet> FragmentBitSets;
+};
+
+struct FMassBenchmarkScenario
+{
+	FString Name;
+	FString Description;
+	/** Prepares the environment for Run. Not measured. */
+	TFunction<void(FMassBenchmarkEnvironment&)> SetUp;
+	/** The measured part of the scenario. @return the number of entities processed, used to normalize the results */
+	TFunction<int32(FMassBenchmarkEnvironment&)> Run;
+};
+
+struct FMassBenchmarkResult
+{
+	FString ScenarioName;
+	/** Entities processed by a single run, as reported by FMassBenchmarkScenario::Run */
+	int32 NumEntities = 0;
+	int32 NumIterations = 0;
+	double MinNsPerEntity = 0.;
+	double MedianNsPerEntity = 0.;
+	double MeanNsPerEntity = 0.;
+	double MaxNsPerEntity = 0.;
+	/** Whether the allocation stats below have been gathered, see FMassBenchmarkSettings.bTrackAllocations */
+	bool bAllocationsTracked = false;
+	int64 NumAllocations = 0;
+	int64 AllocatedBytes = 0;
+	/** Highest amount of memory allocated and not yet freed at any point of the run, relative to its start */
+	int64 PeakMemoryBytes = 0;
+};
+
+struct MASSENTITYBENCHMARK_API FMassBenchmarkReport
+{
+	FMassBenchmarkSettings Settings;
+	TArray<FMassBenchmarkResult> Results;
+
+	FString ToJson() const;
+	FString ToCsv() const;
+};
+
+namespace UE::Mass::Benchmark
+{
+	/** @return all the available scenarios, in the order they get run */
+	MASSENTITYBENCHMARK_API TConstArrayView<FMassBenchmarkScenario> GetScenarios();
+
+	/**
+	 * Runs the scenarios selected by Settings. Every run uses a freshly created entity subsystem hosted by World.
+	 * @return the report containing the results of every scenario run
+	 */
+	MASSENTITYBENCHMARK_API FMassBenchmarkReport RunScenarios(UWorld& World, const FMassBenchmarkSettings& Settings);
+
+	/** @return one of the tags the scenarios combine to get up to 256 archetypes sharing the same fragments */
+	const UScriptStruct* GetArchetypeTag(const int32 TagIndex);
+	constexpr int32 NumArchetypeTags = 8;
+} // UE::Mass::Benchmark
@@ -0,0 +1,24 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "MassBenchmarkCommandlet.generated.h"
+
+/**
+ * Runs the Mass benchmark scenarios (see UE::Mass::Benchmark::GetScenarios) headless and writes the results out 
+ * for regression tracking. Usage:
+ *	UnrealEditor-Cmd <Project> -run=MassBenchmark [-Output=<file.json|file.csv>] [-Scenarios=Spawn,TagChurn]
+ *		[-Entities=N] [-Archetypes=M] [-Iterations=I] [-Warmup=W] [-Seed=S] [-NoAllocationTracking]
+ * The output format is picked based on the output file's extension, JSON being the default. 
+ * Without -Output the report gets printed to the log.
+ */
+UCLASS()
+class UMassBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	UMassBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,177 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "MassProcessor.h"
+#include "MassObserverProcessor.h"
+#include "MassEntityTypes.h"
+#include "MassEntityQuery.h"
+#include <atomic>
+#include "MassBenchmarkTypes.generated.h"
+
+
+USTRUCT()
+struct FMassBenchmarkFragment_Location : public FMassFragment
+{
+	GENERATED_BODY()
+	FVector3f Value = FVector3f::ZeroVector;
+};
+
+USTRUCT()
+struct FMassBenchmarkFragment_Velocity : public FMassFragment
+{
+	GENERATED_BODY()
+	FVector3f Value = FVector3f::ZeroVector;
+};
+
+/** Location and velocity stored as split, per-component sub-columns and processed by UMassBenchmarkSoAMovementProcessor */
+USTRUCT()
+struct FMassBenchmarkFragment_SplitLocation : public FMassSplitFragment
+{
+	GENERATED_BODY()
+	UPROPERTY()
+	float X = 0.f;
+	UPROPERTY()
+	float Y = 0.f;
+	UPROPERTY()
+	float Z = 0.f;
+};
+
+USTRUCT()
+struct FMassBenchmarkFragment_SplitVelocity : public FMassSplitFragment
+{
+	GENERATED_BODY()
+	UPROPERTY()
+	float X = 0.f;
+	UPROPERTY()
+	float Y = 0.f;
+	UPROPERTY()
+	float Z = 0.f;
+};
+
+/** Added and removed by the fragment churn scenario */
+USTRUCT()
+struct FMassBenchmarkFragment_Churn : public FMassFragment
+{
+	GENERATED_BODY()
+	int32 Value = 0;
+};
+
+/** Observed by UMassBenchmarkObserver */
+USTRUCT()
+struct FMassBenchmarkFragment_Observed : public FMassFragment
+{
+	GENERATED_BODY()
+	int32 Value = 0;
+};
+
+USTRUCT()
+struct FMassBenchmarkTag_Churn : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+/** Tags combined to get distinct archetypes sharing the same fragments, see UE::Mass::Benchmark::GetArchetypeTag */
+USTRUCT()
+struct FMassBenchmarkTag_0 : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+USTRUCT()
+struct FMassBenchmarkTag_1 : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+USTRUCT()
+struct FMassBenchmarkTag_2 : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+USTRUCT()
+struct FMassBenchmarkTag_3 : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+USTRUCT()
+struct FMassBenchmarkTag_4 : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+USTRUCT()
+struct FMassBenchmarkTag_5 : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+USTRUCT()
+struct FMassBenchmarkTag_6 : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+USTRUCT()
+struct FMassBenchmarkTag_7 : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+/** Integrates FMassBenchmarkFragment_Velocity into FMassBenchmarkFragment_Location, processing the chunks in parallel unless configured otherwise */
+UCLASS()
+class UMassBenchmarkMovementProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+public:
+	UMassBenchmarkMovementProcessor();
+
+	/** Number of entities processed during the last Execute call */
+	std::atomic<int32> NumEntitiesProcessed{0};
+
+	/** Whether the chunks get processed with ParallelForEachEntityChunk or sequentially */
+	bool bProcessInParallel = true;
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context) override;
+
+	FMassEntityQuery EntityQuery;
+};
+
+/** Same integration as UMassBenchmarkMovementProcessor, done sequentially on the split fragments' sub-columns, four entities at a time */
+UCLASS()
+class UMassBenchmarkSoAMovementProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+public:
+	UMassBenchmarkSoAMovementProcessor();
+
+	/** Number of entities processed during the last Execute call */
+	int32 NumEntitiesProcessed = 0;
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context) override;
+
+	FMassEntityQuery EntityQuery;
+};
+
+/** Initializes FMassBenchmarkFragment_Observed whenever it gets added to entities */
+UCLASS()
+class UMassBenchmarkObserver : public UMassFragmentInitializer
+{
+	GENERATED_BODY()
+public:
+	UMassBenchmarkObserver();
+
+	static int32 NumEntitiesProcessed;
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context) override;
+
+	FMassEntityQuery EntityQuery;
+};
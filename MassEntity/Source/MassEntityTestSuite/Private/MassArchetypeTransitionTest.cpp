@@ -0,0 +1,149 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "AITestsCommon.h"
+
+#include "MassEntitySubsystem.h"
+#include "MassEntityTestTypes.h"
+
+#define LOCTEXT_NAMESPACE "MassTest"
+
+PRAGMA_DISABLE_OPTIMIZATION
+
+namespace FMassArchetypeTransitionTest
+{
+#if WITH_MASSENTITY_DEBUG
+struct FArchetypeTransition_TagRoundTrip : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const FMassEntityHandle EntityA = EntitySubsystem->CreateEntity(FloatsArchetype);
+		const FMassEntityHandle EntityB = EntitySubsystem->CreateEntity(FloatsArchetype);
+
+		EntitySubsystem->AddTagToEntity(EntityA, FTestTag_A::StaticStruct());
+		const FArchetypeHandle TaggedArchetype = EntitySubsystem->GetArchetypeForEntity(EntityA);
+		AITEST_TRUE("Adding a tag should move the entity to a different archetype", TaggedArchetype != FloatsArchetype);
+
+		EntitySubsystem->RemoveTagFromEntity(EntityA, FTestTag_A::StaticStruct());
+		AITEST_EQUAL("Removing the tag should bring the entity back to the original archetype", EntitySubsystem->GetArchetypeForEntity(EntityA), FloatsArchetype);
+
+		EntitySubsystem->AddTagToEntity(EntityA, FTestTag_A::StaticStruct());
+		EntitySubsystem->AddTagToEntity(EntityB, FTestTag_A::StaticStruct());
+		AITEST_EQUAL("Re-adding the tag should result in the same archetype", EntitySubsystem->GetArchetypeForEntity(EntityA), TaggedArchetype);
+		AITEST_EQUAL("Adding the tag to another entity should result in the same archetype", EntitySubsystem->GetArchetypeForEntity(EntityB), TaggedArchetype);
+		AITEST_EQUAL("The tagged archetype should host both entities", EntitySubsystem->DebugGetArchetypeEntitiesCount(TaggedArchetype), 2);
+		AITEST_EQUAL("The original archetype should now have no entities", EntitySubsystem->DebugGetArchetypeEntitiesCount(FloatsArchetype), 0);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FArchetypeTransition_TagRoundTrip, "System.Mass.Entity.Transition.TagRoundTrip");
+
+struct FArchetypeTransition_FragmentRoundTrip : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const FMassEntityHandle Entity = EntitySubsystem->CreateEntity(FloatsArchetype);
+		EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entity).Value = 7.f;
+
+		for (int32 Iteration = 0; Iteration < 2; ++Iteration)
+		{
+			EntitySubsystem->AddFragmentToEntity(Entity, FTestFragment_Int::StaticStruct());
+			AITEST_EQUAL("Adding Int fragment to a Floats entity should result in FloatsInts archetype", EntitySubsystem->GetArchetypeForEntity(Entity), FloatsIntsArchetype);
+
+			EntitySubsystem->RemoveFragmentFromEntity(Entity, FTestFragment_Int::StaticStruct());
+			AITEST_EQUAL("Removing Int fragment should bring the entity back to Floats archetype", EntitySubsystem->GetArchetypeForEntity(Entity), FloatsArchetype);
+		}
+		AITEST_EQUAL("Float fragment's value should survive the archetype changes", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entity).Value, 7.f);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FArchetypeTransition_FragmentRoundTrip, "System.Mass.Entity.Transition.FragmentRoundTrip");
+
+struct FArchetypeTransition_TagFlip : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		// enough entities to span multiple chunks, with the cached transitions getting reused by all but the first one
+		const int32 Count = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsIntsArchetype) + 3;
+
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem->BatchCreateEntities(FloatsIntsArchetype, Count, Entities);
+
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			EntitySubsystem->AddTagToEntity(Entity, FTestTag_A::StaticStruct());
+		}
+		const FArchetypeHandle TaggedArchetype = EntitySubsystem->GetArchetypeForEntity(Entities[0]);
+		AITEST_EQUAL("All the entities should be in the tagged archetype", EntitySubsystem->DebugGetArchetypeEntitiesCount(TaggedArchetype), Count);
+
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			EntitySubsystem->RemoveTagFromEntity(Entity, FTestTag_A::StaticStruct());
+		}
+		AITEST_EQUAL("All the entities should be back in the original archetype", EntitySubsystem->DebugGetArchetypeEntitiesCount(FloatsIntsArchetype), Count);
+		AITEST_EQUAL("The tagged archetype should have no entities left", EntitySubsystem->DebugGetArchetypeEntitiesCount(TaggedArchetype), 0);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FArchetypeTransition_TagFlip, "System.Mass.Entity.Transition.TagFlip");
+
+struct FArchetypeTransition_BatchMove : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		// enough entities to span multiple chunks
+		const int32 Count = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsArchetype) * 3 + 7;
+
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, Count, Entities);
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value = float(i);
+		}
+
+		// every third entity gets the int fragment added
+		TArray<FMassEntityHandle> EntitiesToMove;
+		for (int32 i = 0; i < Entities.Num(); i += 3)
+		{
+			EntitiesToMove.Add(Entities[i]);
+		}
+		EntitySubsystem->BatchAddFragmentToEntities(FArchetypeChunkCollection(FloatsArchetype, EntitiesToMove, FArchetypeChunkCollection::NoDuplicates), FTestFragment_Int::StaticStruct());
+
+		AITEST_EQUAL("The moved entities should have ended up in FloatsInts archetype", EntitySubsystem->DebugGetArchetypeEntitiesCount(FloatsIntsArchetype), EntitiesToMove.Num());
+		AITEST_EQUAL("The remaining entities should still be in Floats archetype", EntitySubsystem->DebugGetArchetypeEntitiesCount(FloatsArchetype), Count - EntitiesToMove.Num());
+
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			const FArchetypeHandle ExpectedArchetype = (i % 3 == 0) ? FloatsIntsArchetype : FloatsArchetype;
+			AITEST_EQUAL("Every entity should end up in the expected archetype", EntitySubsystem->GetArchetypeForEntity(Entities[i]), ExpectedArchetype);
+			AITEST_EQUAL("Every entity should keep its Float fragment's value", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value, float(i));
+		}
+
+		// and now back, as a whole archetype
+		FArchetypeHandle SourceArchetype = FloatsIntsArchetype;
+		EntitySubsystem->BatchRemoveFragmentFromEntities(FArchetypeChunkCollection(SourceArchetype), FTestFragment_Int::StaticStruct());
+		AITEST_EQUAL("All the entities should be back in Floats archetype", EntitySubsystem->DebugGetArchetypeEntitiesCount(FloatsArchetype), Count);
+		AITEST_EQUAL("FloatsInts archetype should be empty now", EntitySubsystem->DebugGetArchetypeEntitiesCount(FloatsIntsArchetype), 0);
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			AITEST_EQUAL("Every entity should keep its Float fragment's value", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value, float(i));
+		}
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FArchetypeTransition_BatchMove, "System.Mass.Entity.Transition.BatchMove");
+
+#endif // WITH_MASSENTITY_DEBUG
+} // FMassArchetypeTransitionTest
+
+PRAGMA_ENABLE_OPTIMIZATION
+
+#undef LOCTEXT_NAMESPACE
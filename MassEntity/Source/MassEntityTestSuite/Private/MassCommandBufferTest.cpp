@@ -0,0 +1,92 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "AITestsCommon.h"
+
+#include "MassEntitySubsystem.h"
+#include "MassCommandBuffer.h"
+#include "MassEntityTestTypes.h"
+
+#define LOCTEXT_NAMESPACE "MassTest"
+
+PRAGMA_DISABLE_OPTIMIZATION
+
+namespace FMassCommandBufferTest
+{
+#if WITH_MASSENTITY_DEBUG
+struct FCommandBuffer_CoalescedOrdering : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		TGuardValue<bool> CoalesceCommandsGuard(UE::FLWCCommand::bCoalesceCommands, true);
+
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, 4, Entities);
+
+		FMassCommandBuffer& CommandBuffer = EntitySubsystem->Defer();
+		// Entities[0] gets the tag added, removed and added back again - the final state depends on the order
+		CommandBuffer.AddTag<FTestTag_A>(Entities[0]);
+		CommandBuffer.AddTag<FTestTag_A>(Entities[1]);
+		CommandBuffer.RemoveTag<FTestTag_A>(Entities[0]);
+		CommandBuffer.AddFragment<FTestFragment_Int>(Entities[2]);
+		CommandBuffer.AddTag<FTestTag_A>(Entities[0]);
+		// Entities[3] gets a fragment added and removed
+		CommandBuffer.AddFragment<FTestFragment_Int>(Entities[3]);
+		CommandBuffer.RemoveFragment<FTestFragment_Int>(Entities[3]);
+
+		// a command that can't be coalesced needs to observe all the commands issued before it
+		bool bDeferredCommandSawInts = false;
+		CommandBuffer.PushCommand(FDeferredCommand([&bDeferredCommandSawInts, Entity = Entities[2]](UMassEntitySubsystem& System)
+			{
+				bDeferredCommandSawInts = System.GetFragmentDataPtr<FTestFragment_Int>(Entity) != nullptr;
+			}));
+		CommandBuffer.RemoveFragment<FTestFragment_Int>(Entities[2]);
+
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+
+		AITEST_TRUE("Deferred command should see the results of the commands preceding it", bDeferredCommandSawInts);
+
+		const FArchetypeHandle TaggedArchetype = EntitySubsystem->GetArchetypeForEntity(Entities[1]);
+		AITEST_TRUE("Adding a tag should move the entity to a different archetype", TaggedArchetype != FloatsArchetype);
+		AITEST_EQUAL("Add-Remove-Add sequence should leave the entity tagged", EntitySubsystem->GetArchetypeForEntity(Entities[0]), TaggedArchetype);
+		AITEST_EQUAL("Fragment added and then removed after a deferred command should be gone", EntitySubsystem->GetArchetypeForEntity(Entities[2]), FloatsArchetype);
+		AITEST_EQUAL("Fragment added and then removed should be gone", EntitySubsystem->GetArchetypeForEntity(Entities[3]), FloatsArchetype);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FCommandBuffer_CoalescedOrdering, "System.Mass.Entity.CommandBuffer.CoalescedOrdering");
+
+struct FCommandBuffer_CoalescedInvalidEntity : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		TGuardValue<bool> CoalesceCommandsGuard(UE::FLWCCommand::bCoalesceCommands, true);
+
+		const FMassEntityHandle Entity = EntitySubsystem->CreateEntity(FloatsArchetype);
+		const FMassEntityHandle DestroyedEntity = EntitySubsystem->CreateEntity(FloatsArchetype);
+
+		FMassCommandBuffer& CommandBuffer = EntitySubsystem->Defer();
+		CommandBuffer.AddTag<FTestTag_A>(Entity);
+		CommandBuffer.AddTag<FTestTag_A>(DestroyedEntity);
+		CommandBuffer.DestroyEntity(DestroyedEntity);
+
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+
+		AITEST_FALSE("The destroyed entity should no longer be valid", EntitySubsystem->IsEntityValid(DestroyedEntity));
+		AITEST_TRUE("The valid entity should have been moved to the tagged archetype", EntitySubsystem->GetArchetypeForEntity(Entity) != FloatsArchetype);
+		AITEST_EQUAL("Only the valid entity should have been tagged", EntitySubsystem->DebugGetArchetypeEntitiesCount(EntitySubsystem->GetArchetypeForEntity(Entity)), 1);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FCommandBuffer_CoalescedInvalidEntity, "System.Mass.Entity.CommandBuffer.CoalescedInvalidEntity");
+
+#endif // WITH_MASSENTITY_DEBUG
+} // FMassCommandBufferTest
+
+PRAGMA_ENABLE_OPTIMIZATION
+
+#undef LOCTEXT_NAMESPACE
@@ -8,6 +8,7 @@
 #include "MassProcessingTypes.h"
 #include "MassEntityTestTypes.h"
 #include "MassExecutor.h"
+#include "MassEntitySettings.h"
 
 #define LOCTEXT_NAMESPACE "MassTest"
 
@@ -66,6 +67,111 @@ struct FCompositeProcessorTest_MultipleSubProcessors : FEntityTestBase
 };
 IMPLEMENT_AI_INSTANT_TEST(FCompositeProcessorTest_MultipleSubProcessors, "System.Mass.Processor.Composite.MultipleSubProcessors");
 
+const FName OffThreadGroupName = TEXT("OffThread");
+
+template<typename TProcessor>
+UMassProcessor* CreateCommandLogTemplate(UMassEntitySubsystem& EntitySubsystem, const FName GroupName, const bool bWaitForGameThreadExecution = false)
+{
+	TProcessor* Processor = NewObject<TProcessor>(&EntitySubsystem);
+	Processor->GetMutableExecutionOrder().ExecuteInGroup = GroupName;
+	Processor->bWaitForGameThreadExecution = bWaitForGameThreadExecution;
+	return Processor;
+}
+
+/** Creates a composite processor running copies of Templates, sorted the way processing phases do, with OffThreadGroupName's group running off the game thread */
+UMassCompositeProcessor* CreateOffThreadGroupProcessor(UMassEntitySubsystem& EntitySubsystem, const TArray<UMassProcessor*>& Templates)
+{
+	FMassProcessingPhaseConfig PhaseConfig;
+	PhaseConfig.ProcessorCDOs = Templates;
+	PhaseConfig.OffGameThreadGroupNames = { OffThreadGroupName };
+
+	// the off game thread groups get configured from the project settings
+	TGuardValue<TArray<FName>> OffGameThreadGroupNamesGuard(GetMutableDefault<UMassEntitySettings>()->ProcessingPhasesConfig[int(EMassProcessingPhase::PrePhysics)].OffGameThreadGroupNames
+		, PhaseConfig.OffGameThreadGroupNames);
+
+	UMassCompositeProcessor* CompositeProcessor = NewObject<UMassCompositeProcessor>(&EntitySubsystem);
+	CompositeProcessor->CopyAndSort(PhaseConfig);
+	return CompositeProcessor;
+}
+
+/** Appends the class names of all the processors CompositeProcessor runs, including the ones in its groups, in the sequential execution order */
+void GetProcessorNamesInPipelineOrder(const UMassCompositeProcessor& CompositeProcessor, TArray<FName>& OutNames)
+{
+	for (const UMassProcessor* Processor : CompositeProcessor.GetChildProcessorsView())
+	{
+		if (const UMassCompositeProcessor* GroupProcessor = Cast<UMassCompositeProcessor>(Processor))
+		{
+			GetProcessorNamesInPipelineOrder(*GroupProcessor, OutNames);
+		}
+		else
+		{
+			OutNames.Add(Processor->GetClass()->GetFName());
+		}
+	}
+}
+
+struct FCompositeProcessorTest_OffThreadGroupCommandsOrder : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		TGuardValue<bool> ParallelGroupsGuard(FMassTweakables::bParallelGroups, true);
+
+		UMassCompositeProcessor* CompositeProcessor = CreateOffThreadGroupProcessor(*EntitySubsystem, {
+			CreateCommandLogTemplate<UMassTestProcessor_CommandLogA>(*EntitySubsystem, OffThreadGroupName),
+			CreateCommandLogTemplate<UMassTestProcessor_CommandLogB>(*EntitySubsystem, OffThreadGroupName),
+			CreateCommandLogTemplate<UMassTestProcessor_CommandLogC>(*EntitySubsystem, NAME_None),
+			CreateCommandLogTemplate<UMassTestProcessor_CommandLogD>(*EntitySubsystem, NAME_None) });
+
+		TArray<FName> ExpectedCommandLog;
+		GetProcessorNamesInPipelineOrder(*CompositeProcessor, ExpectedCommandLog);
+		AITEST_EQUAL("All the processors should be run by the composite processor", ExpectedCommandLog.Num(), 4);
+		// with the group going first the game thread processors get to issue their commands while the group is still running
+		AITEST_TRUE("The off game thread group should precede the game thread processors in the pipeline"
+			, ExpectedCommandLog.IndexOfByKey(UMassTestProcessor_CommandLogA::StaticClass()->GetFName()) < ExpectedCommandLog.IndexOfByKey(UMassTestProcessor_CommandLogC::StaticClass()->GetFName()));
+
+		// the threads' timing differs from run to run
+		for (int32 RunIndex = 0; RunIndex < 10; ++RunIndex)
+		{
+			UMassTestProcessor_CommandLog::ResetLogs();
+			FMassProcessingContext ProcessingContext(*EntitySubsystem, /*DeltaSeconds=*/0.f);
+			UE::Mass::Executor::Run(*CompositeProcessor, ProcessingContext);
+			AITEST_TRUE("The commands should be replayed in the pipeline order, regardless of the threads the processors ran on"
+				, UMassTestProcessor_CommandLog::CommandLog == ExpectedCommandLog);
+		}
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FCompositeProcessorTest_OffThreadGroupCommandsOrder, "System.Mass.Processor.Composite.OffThreadGroupCommandsOrder");
+
+struct FCompositeProcessorTest_OffThreadGroupDispatch : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		if (FTaskGraphInterface::Get().GetNumWorkerThreads() == 0)
+		{
+			// the group can't run concurrently with the game thread without worker threads
+			return true;
+		}
+		TGuardValue<bool> ParallelGroupsGuard(FMassTweakables::bParallelGroups, true);
+
+		UMassCompositeProcessor* CompositeProcessor = CreateOffThreadGroupProcessor(*EntitySubsystem, {
+			CreateCommandLogTemplate<UMassTestProcessor_CommandLogA>(*EntitySubsystem, OffThreadGroupName, /*bWaitForGameThreadExecution=*/true),
+			CreateCommandLogTemplate<UMassTestProcessor_CommandLogC>(*EntitySubsystem, NAME_None) });
+
+		UMassTestProcessor_CommandLog::ResetLogs();
+		FMassProcessingContext ProcessingContext(*EntitySubsystem, /*DeltaSeconds=*/0.f);
+		UE::Mass::Executor::Run(*CompositeProcessor, ProcessingContext);
+
+		AITEST_EQUAL("The off game thread group should run concurrently with the game thread processors not depending on it"
+			, UMassTestProcessor_CommandLog::NumConcurrentExecutionsObserved.load(), 1);
+		AITEST_EQUAL("The commands of both processors should be replayed", UMassTestProcessor_CommandLog::CommandLog.Num(), 2);
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FCompositeProcessorTest_OffThreadGroupDispatch, "System.Mass.Processor.Composite.OffThreadGroupDispatch");
+
 } // FMassCompositeProcessorTest
 
 PRAGMA_ENABLE_OPTIMIZATION
@@ -70,6 +70,65 @@ struct FTrivialDependency : FDependencySolverBase
 };
 IMPLEMENT_AI_INSTANT_TEST(FTrivialDependency, "System.Mass.Dependencies.Trivial");
 
+struct FInferredDependency : FDependencySolverBase
+{
+	virtual bool SetUp() override
+	{
+		// A writes Floats, B reads Floats, C reads Ints, D reads Floats and writes Ints. No explicit ordering.
+		Processors.Add_GetRef(NewObject<UMassTestProcessor_A>())->TestGetQuery().AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadWrite);
+		Processors.Add_GetRef(NewObject<UMassTestProcessor_B>())->TestGetQuery().AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadOnly);
+		Processors.Add_GetRef(NewObject<UMassTestProcessor_C>())->TestGetQuery().AddRequirement<FTestFragment_Int>(EMassFragmentAccess::ReadOnly);
+		UMassTestProcessorBase* ProcD = Processors.Add_GetRef(NewObject<UMassTestProcessor_D>());
+		ProcD->TestGetQuery().AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadOnly);
+		ProcD->TestGetQuery().AddRequirement<FTestFragment_Int>(EMassFragmentAccess::ReadWrite);
+
+		return true;
+	}
+
+	const FProcessorDependencySolver::FOrderInfo* FindResult(const FName Name) const
+	{
+		return Result.FindByPredicate([Name](const FProcessorDependencySolver::FOrderInfo& Info) { return Info.Name == Name; });
+	}
+
+	int32 FindResultIndex(const FName Name) const
+	{
+		return Result.IndexOfByPredicate([Name](const FProcessorDependencySolver::FOrderInfo& Info) { return Info.Name == Name; });
+	}
+
+	virtual bool InstantTest() override
+	{
+		Solve();
+
+		const FProcessorDependencySolver::FOrderInfo* InfoA = FindResult(GetProcessorName<UMassTestProcessor_A>());
+		const FProcessorDependencySolver::FOrderInfo* InfoB = FindResult(GetProcessorName<UMassTestProcessor_B>());
+		const FProcessorDependencySolver::FOrderInfo* InfoC = FindResult(GetProcessorName<UMassTestProcessor_C>());
+		const FProcessorDependencySolver::FOrderInfo* InfoD = FindResult(GetProcessorName<UMassTestProcessor_D>());
+		AITEST_TRUE("All the processors are expected to be in the results", InfoA && InfoB && InfoC && InfoD);
+		CA_ASSUME(InfoA && InfoB && InfoC && InfoD);
+
+		// A conflicts with both B and D, the solver is free to pick the order but the dependency needs to be there
+		const bool bBAfterA = FindResultIndex(InfoB->Name) > FindResultIndex(InfoA->Name);
+		AITEST_TRUE("A and B need to be ordered since A writes what B reads"
+			, bBAfterA ? InfoB->Dependencies.Contains(InfoA->Name) : InfoA->Dependencies.Contains(InfoB->Name));
+		
+		const bool bDAfterA = FindResultIndex(InfoD->Name) > FindResultIndex(InfoA->Name);
+		AITEST_TRUE("A and D need to be ordered since A writes what D reads"
+			, bDAfterA ? InfoD->Dependencies.Contains(InfoA->Name) : InfoA->Dependencies.Contains(InfoD->Name));
+
+		const bool bDAfterC = FindResultIndex(InfoD->Name) > FindResultIndex(InfoC->Name);
+		AITEST_TRUE("C and D need to be ordered since D writes what C reads"
+			, bDAfterC ? InfoD->Dependencies.Contains(InfoC->Name) : InfoC->Dependencies.Contains(InfoD->Name));
+
+		AITEST_FALSE("B and C access disjoint data and should not depend on each other"
+			, InfoB->Dependencies.Contains(InfoC->Name) || InfoC->Dependencies.Contains(InfoB->Name));
+		AITEST_FALSE("B and D only read the data they share and should not depend on each other"
+			, InfoB->Dependencies.Contains(InfoD->Name) || InfoD->Dependencies.Contains(InfoB->Name));
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FInferredDependency, "System.Mass.Dependencies.Inferred");
+
 
 struct FDeepGroup : FDependencySolverBase
 {
@@ -8,6 +8,9 @@
 #include "MassProcessingTypes.h"
 #include "MassEntityTestTypes.h"
 #include "MassExecutor.h"
+#include "MassEntitySettings.h"
+#include "MassCommandBuffer.h"
+#include "Async/ParallelFor.h"
 
 #define LOCTEXT_NAMESPACE "MassTest"
 
@@ -121,6 +124,45 @@ struct FEntityTest_BatchCreatingSingleEntity : FEntityTestBase
 };
 IMPLEMENT_AI_INSTANT_TEST(FEntityTest_BatchCreatingSingleEntity, "System.Mass.Entity.BatchCreatingSingleEntity");
 
+struct FEntityTest_BatchCreationWithInitialValues : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		// spanning multiple chunks and reusing some of the freed entity indices
+		const int32 Count = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsIntsArchetype) * 5 / 2;
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, 10, Entities);
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			EntitySubsystem->DestroyEntity(Entity);
+		}
+		Entities.Reset();
+
+		TArray<FTestFragment_Float> Floats;
+		Floats.AddDefaulted(Count);
+		for (int32 i = 0; i < Count; ++i)
+		{
+			Floats[i].Value = float(i);
+		}
+		const FMassFragmentInitialValues InitialValues[] = { FMassFragmentInitialValues::Make<FTestFragment_Float>(Floats) };
+		EntitySubsystem->BatchCreateEntities(FloatsIntsArchetype, Count, Entities, InitialValues);
+
+		AITEST_EQUAL("The total number of entities present must match the number requested", EntitySubsystem->DebugGetEntityCount(), Count);
+		TSet<int32> UniqueIndices;
+		for (int32 i = 0; i < Count; ++i)
+		{
+			AITEST_TRUE("Every created entity should be valid", EntitySubsystem->IsEntityValid(Entities[i]));
+			AITEST_EQUAL("Fragments with initial values provided should get the values", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value, float(i));
+			AITEST_EQUAL("Fragments without initial values should get default-initialized", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Int>(Entities[i]).Value, 0);
+			UniqueIndices.Add(Entities[i].Index);
+		}
+		AITEST_EQUAL("Every created entity should get a unique index", UniqueIndices.Num(), Count);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FEntityTest_BatchCreationWithInitialValues, "System.Mass.Entity.BatchCreationWithInitialValues");
 
 struct FEntityTest_EntityCreation : FEntityTestBase
 {
@@ -263,6 +305,59 @@ struct FEntityTest_DestroyEntity : FEntityTestBase
 };
 IMPLEMENT_AI_INSTANT_TEST(FEntityTest_DestroyEntity, "System.Mass.Entity.DestroyEntity");
 
+struct FEntityTest_BatchDestroyEntities : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const int32 Count = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsIntsArchetype) * 3 + 11;
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem->BatchCreateEntities(FloatsIntsArchetype, Count, Entities);
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, 10, Entities);
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value = float(i);
+		}
+
+		// destroying entities of both archetypes, in a scattered order, with a duplicate and a stale handle thrown in
+		TArray<FMassEntityHandle> EntitiesToDestroy;
+		TSet<int32> DestroyedIndices;
+		FRandomStream RandomStream(0xC0FFEE);
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			if (RandomStream.FRand() < 0.6f)
+			{
+				EntitiesToDestroy.Add(Entities[i]);
+				DestroyedIndices.Add(i);
+			}
+		}
+		EntitiesToDestroy.Add(EntitiesToDestroy[0]);
+		const FMassEntityHandle StaleEntity = EntitySubsystem->CreateEntity(IntsArchetype);
+		EntitySubsystem->DestroyEntity(StaleEntity);
+		EntitiesToDestroy.Add(StaleEntity);
+		for (int32 i = EntitiesToDestroy.Num() - 1; i > 0; --i)
+		{
+			EntitiesToDestroy.Swap(i, RandomStream.RandRange(0, i));
+		}
+
+		EntitySubsystem->BatchDestroyEntities(EntitiesToDestroy);
+
+		AITEST_EQUAL("Only the remaining entities should be left", EntitySubsystem->DebugGetEntityCount(), Entities.Num() - DestroyedIndices.Num());
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			const bool bDestroyed = DestroyedIndices.Contains(i);
+			AITEST_EQUAL("Only the requested entities should be destroyed", EntitySubsystem->IsEntityValid(Entities[i]), !bDestroyed);
+			if (!bDestroyed)
+			{
+				AITEST_EQUAL("Remaining entities should keep their data", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value, float(i));
+			}
+		}
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FEntityTest_BatchDestroyEntities, "System.Mass.Entity.BatchDestroyEntities");
+
 struct FEntityTest_EntityReservationAndBuilding : FEntityTestBase
 {
 	virtual bool InstantTest() override
@@ -355,6 +450,334 @@ struct FEntityTest_ReserveAPreviouslyBuiltEntity : FEntityTestBase
 };
 IMPLEMENT_AI_INSTANT_TEST(FEntityTest_ReserveAPreviouslyBuiltEntity, "System.Mass.Entity.ReserveAPreviouslyBuiltEntity");
 
+struct FEntityTest_InArchetypeIndexMaintenance : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const int32 Count = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsArchetype) * 3;
+
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, Count, Entities);
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value = float(i);
+		}
+
+		// swap-removing every third entity, and then compacting, shuffles the remaining entities around
+		TArray<FMassEntityHandle> EntitiesToDestroy;
+		for (int32 i = 0; i < Entities.Num(); i += 3)
+		{
+			EntitiesToDestroy.Add(Entities[i]);
+		}
+		EntitySubsystem->BatchDestroyEntities(EntitiesToDestroy);
+		EntitySubsystem->DoEntityCompaction(/*TimeAllowed=*/1000.);
+
+		// and moving every other remaining entity to another archetype
+		TArray<FMassEntityHandle> EntitiesToMove;
+		for (int32 i = 1; i < Entities.Num(); i += 3)
+		{
+			EntitiesToMove.Add(Entities[i]);
+		}
+		EntitySubsystem->BatchAddFragmentToEntities(FArchetypeChunkCollection(FloatsArchetype, EntitiesToMove, FArchetypeChunkCollection::NoDuplicates), FTestFragment_Int::StaticStruct());
+
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			if (i % 3 == 0)
+			{
+				AITEST_FALSE("Destroyed entities should no longer be valid", EntitySubsystem->IsEntityValid(Entities[i]));
+				continue;
+			}
+			const FArchetypeHandle ExpectedArchetype = (i % 3 == 1) ? FloatsIntsArchetype : FloatsArchetype;
+			AITEST_EQUAL("Every remaining entity should be in the expected archetype", EntitySubsystem->GetArchetypeForEntity(Entities[i]), ExpectedArchetype);
+			AITEST_EQUAL("Every remaining entity should still point at its own data", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value, float(i));
+		}
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FEntityTest_InArchetypeIndexMaintenance, "System.Mass.Entity.InArchetypeIndexMaintenance");
+
+struct FEntityTest_IncrementalCompaction : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const FArchetypeHandle Archetypes[] = { FloatsArchetype, FloatsIntsArchetype };
+
+		TArray<FMassEntityHandle> Entities;
+		for (const FArchetypeHandle& Archetype : Archetypes)
+		{
+			EntitySubsystem->BatchCreateEntities(Archetype, EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(Archetype) * 4, Entities);
+		}
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value = float(i);
+		}
+
+		// leaving every chunk half full
+		TArray<FMassEntityHandle> EntitiesToDestroy;
+		for (int32 i = 0; i < Entities.Num(); i += 2)
+		{
+			EntitiesToDestroy.Add(Entities[i]);
+		}
+		EntitySubsystem->BatchDestroyEntities(EntitiesToDestroy);
+
+		for (const FArchetypeHandle& Archetype : Archetypes)
+		{
+			const FMassArchetypeFragmentationInfo FragmentationInfo = EntitySubsystem->GetArchetypeFragmentationInfo(Archetype);
+			AITEST_EQUAL("All the chunks should be partially filled", FragmentationInfo.NumPartialChunks, 4);
+			AITEST_TRUE("Half of the allocated entity slots should be occupied", FMath::IsNearlyEqual(FragmentationInfo.GetOccupancy(), 0.5f, 0.01f));
+		}
+
+		AITEST_FALSE("Compaction with no time allowed should not be completed", EntitySubsystem->DoEntityCompaction(/*TimeAllowed=*/0.));
+		AITEST_EQUAL("Compaction with no time allowed should not move any entities", EntitySubsystem->GetArchetypeFragmentationInfo(FloatsArchetype).NumPartialChunks, 4);
+
+		AITEST_TRUE("Compaction with enough time should be completed", EntitySubsystem->DoEntityCompaction(/*TimeAllowed=*/1000.));
+		for (const FArchetypeHandle& Archetype : Archetypes)
+		{
+			const FMassArchetypeFragmentationInfo FragmentationInfo = EntitySubsystem->GetArchetypeFragmentationInfo(Archetype);
+			AITEST_TRUE("At most one chunk should remain partially filled", FragmentationInfo.NumPartialChunks <= 1);
+			AITEST_EQUAL("Only the chunks needed to hold the remaining entities should be in use", FragmentationInfo.NumChunks - FragmentationInfo.NumEmptyChunks, 2);
+		}
+		for (int32 i = 1; i < Entities.Num(); i += 2)
+		{
+			AITEST_EQUAL("Every remaining entity should still point at its own data", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value, float(i));
+		}
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FEntityTest_IncrementalCompaction, "System.Mass.Entity.IncrementalCompaction");
+
+struct FEntityTest_ChunkSizePolicy : FExecutionTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const UScriptStruct* NarrowFragments[] = { FTestFragment_Bool::StaticStruct() };
+		const UScriptStruct* WideFragments[] = { FTestFragment_Bool::StaticStruct(), FTestFragment_Float::StaticStruct(), FTestFragment_Int::StaticStruct() };
+		const int32 TargetEntitiesPerChunk = 512;
+
+		UMassEntitySettings& Settings = *GetMutableDefault<UMassEntitySettings>();
+		TGuardValue<int32> ChunkMemorySizeGuard(Settings.ChunkMemorySize, 64 * 1024);
+		TGuardValue<int32> TargetEntitiesPerChunkGuard(Settings.TargetEntitiesPerChunk, TargetEntitiesPerChunk);
+		const FArchetypeHandle NarrowArchetype = EntitySubsystem->CreateArchetype(NarrowFragments);
+		const FArchetypeHandle WideArchetype = EntitySubsystem->CreateArchetype(WideFragments);
+
+		for (const FArchetypeHandle& Archetype : { NarrowArchetype, WideArchetype })
+		{
+			const int32 EntitiesPerChunk = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(Archetype);
+			AITEST_TRUE("Archetypes should fit at least the target number of entities per chunk", EntitiesPerChunk >= TargetEntitiesPerChunk);
+			AITEST_TRUE("Archetypes should not exceed the target number of entities per chunk by more than the power-of-two rounding", EntitiesPerChunk < TargetEntitiesPerChunk * 2);
+		}
+
+		// making sure the resulting layout is sound
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem->BatchCreateEntities(WideArchetype, TargetEntitiesPerChunk * 3, Entities);
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			EntitySubsystem->GetFragmentDataChecked<FTestFragment_Int>(Entities[i]).Value = i;
+			EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value = float(i);
+		}
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			AITEST_EQUAL("Int fragment values should not overlap with other fragments' data", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Int>(Entities[i]).Value, i);
+			AITEST_EQUAL("Float fragment values should not overlap with other fragments' data", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(Entities[i]).Value, float(i));
+		}
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FEntityTest_ChunkSizePolicy, "System.Mass.Entity.ChunkSizePolicy");
+
+struct FEntityTest_ChunkMemoryPool : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const int32 NumChunks = 4;
+		// both archetypes use the default chunk size, so they can share pooled pages
+		const int32 Count = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsArchetype) * NumChunks;
+		const FMassChunkMemoryStats InitialStats = EntitySubsystem->GetChunkMemoryStats();
+
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, Count, Entities);
+		const FMassChunkMemoryStats PopulatedStats = EntitySubsystem->GetChunkMemoryStats();
+		AITEST_EQUAL("Every new chunk should result in a pool miss when the pool is empty", PopulatedStats.NumMisses - InitialStats.NumMisses, int64(NumChunks));
+		const int64 ChunksMemory = PopulatedStats.InUseBytes - InitialStats.InUseBytes;
+		AITEST_TRUE("The chunks memory should be accounted for as in use", ChunksMemory > 0);
+
+		auto DestroyEntities = [this, &Entities]()
+		{
+			for (const FMassEntityHandle& Entity : Entities)
+			{
+				EntitySubsystem->DestroyEntity(Entity);
+			}
+			Entities.Reset();
+		};
+
+		DestroyEntities();
+		const FMassChunkMemoryStats EmptiedStats = EntitySubsystem->GetChunkMemoryStats();
+		AITEST_EQUAL("All the chunk memory should be back in the pool", EmptiedStats.PooledBytes - InitialStats.PooledBytes, ChunksMemory);
+		AITEST_EQUAL("None of the chunk memory should be in use", EmptiedStats.InUseBytes, InitialStats.InUseBytes);
+
+		EntitySubsystem->BatchCreateEntities(IntsArchetype, Count, Entities);
+		const FMassChunkMemoryStats RepopulatedStats = EntitySubsystem->GetChunkMemoryStats();
+		AITEST_TRUE("Chunks created after the pool got populated should reuse pooled memory", RepopulatedStats.NumHits - EmptiedStats.NumHits >= NumChunks);
+		AITEST_EQUAL("Reusing pooled pages should not result in new allocations", RepopulatedStats.NumMisses, EmptiedStats.NumMisses);
+
+		DestroyEntities();
+		// the first trim retains what's needed to get back to the recent high-water mark
+		EntitySubsystem->TrimChunkMemory();
+		AITEST_EQUAL("Trimming should retain the memory used since the last trim", EntitySubsystem->GetChunkMemoryStats().PooledBytes - InitialStats.PooledBytes, ChunksMemory);
+		// while the second one releases memory that stayed unused for a whole trim period
+		EntitySubsystem->TrimChunkMemory();
+		AITEST_EQUAL("Trimming should release the memory that remained idle since the last trim", EntitySubsystem->GetChunkMemoryStats().PooledBytes, int64(0));
+		AITEST_TRUE("Peak resident chunk memory should be tracked", EntitySubsystem->GetChunkMemoryStats().PeakResidentBytes >= ChunksMemory);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FEntityTest_ChunkMemoryPool, "System.Mass.Entity.ChunkMemoryPool");
+
+struct FEntityTest_ColumnAlignment : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		
+		// Float and Int fragments with the entity handle make 16 bytes per entity, which power-of-two chunk sizes 
+		// are a multiple of, so with exact padding calculations there's no space wasted
+		const int32 ExpectedEntitiesPerChunk = GetMutableDefault<UMassEntitySettings>()->GetChunkMemorySize(16) / 16;
+		AITEST_EQUAL("Exact padding calculation should let the entities fill the whole chunk", EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsIntsArchetype), ExpectedEntitiesPerChunk);
+
+		const int32 Alignment = 64;
+		int32& ColumnAlignmentSetting = GetMutableDefault<UMassEntitySettings>()->FragmentColumnAlignment;
+		const int32 PrevColumnAlignment = ColumnAlignmentSetting;
+		ColumnAlignmentSetting = Alignment;
+		const UScriptStruct* FragmentTypes[] = { FTestFragment_Bool::StaticStruct(), FTestFragment_Float::StaticStruct(), FTestFragment_Int::StaticStruct() };
+		const FArchetypeHandle AlignedArchetype = EntitySubsystem->CreateArchetype(FragmentTypes);
+		ColumnAlignmentSetting = PrevColumnAlignment;
+
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem->BatchCreateEntities(AlignedArchetype, EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(AlignedArchetype) * 2 + 1, Entities);
+
+		FMassEntityQuery Query;
+		Query.AddRequirement<FTestFragment_Bool>(EMassFragmentAccess::ReadOnly);
+		Query.AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadOnly);
+		Query.AddRequirement<FTestFragment_Int>(EMassFragmentAccess::ReadOnly);
+		FMassExecutionContext ExecContext;
+		int32 NumMisalignedColumns = 0;
+		int32 NumChunks = 0;
+		Query.ForEachEntityChunk(*EntitySubsystem, ExecContext, [&NumMisalignedColumns, &NumChunks, Alignment](FMassExecutionContext& Context)
+			{
+				++NumChunks;
+				NumMisalignedColumns += IsAligned(Context.GetFragmentView<FTestFragment_Bool>().GetData(), Alignment) ? 0 : 1;
+				NumMisalignedColumns += IsAligned(Context.GetFragmentView<FTestFragment_Float>().GetData(), Alignment) ? 0 : 1;
+				NumMisalignedColumns += IsAligned(Context.GetFragmentView<FTestFragment_Int>().GetData(), Alignment) ? 0 : 1;
+			});
+
+		AITEST_EQUAL("All the chunks should have been processed", NumChunks, 3);
+		AITEST_EQUAL("Every fragment column should be aligned as configured", NumMisalignedColumns, 0);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FEntityTest_ColumnAlignment, "System.Mass.Entity.ColumnAlignment");
+
+struct FEntityTest_ConcurrentReservation : FEntityTestBase
+{
+	static constexpr int32 ConcurrentPoolSize = 256;
+
+	virtual bool SetUp() override
+	{
+		// concurrent reservation is opt-in, and the pool gets created along with the subsystem
+		TGuardValue<int32> PoolSizeGuard(GetMutableDefault<UMassEntitySettings>()->ConcurrentEntityReservationPoolSize, ConcurrentPoolSize);
+		return FEntityTestBase::SetUp();
+	}
+
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const int32 PoolSize = ConcurrentPoolSize;
+
+		const int32 EntityCountBefore = EntitySubsystem->DebugGetEntityCount();
+		AITEST_EQUAL("The pool should get filled up to the configured size", EntitySubsystem->ReplenishConcurrentReservations(), PoolSize);
+		AITEST_EQUAL("All the pooled entities should be available", EntitySubsystem->GetNumConcurrentReservationsAvailable(), PoolSize);
+		AITEST_EQUAL("A full pool should not be topped up", EntitySubsystem->ReplenishConcurrentReservations(), 0);
+
+		// every task reserves a mix of single entities and small batches
+		const int32 NumTasks = 8;
+		const int32 BatchSize = 3;
+		TArray<TArray<FMassEntityHandle>> ReservedPerTask;
+		ReservedPerTask.SetNum(NumTasks);
+		ParallelFor(NumTasks, [this, &ReservedPerTask, PoolSize, NumTasks, BatchSize](const int32 TaskIndex)
+			{
+				TArray<FMassEntityHandle>& Reserved = ReservedPerTask[TaskIndex];
+				const int32 NumToReserve = PoolSize / NumTasks;
+				while (Reserved.Num() + BatchSize <= NumToReserve)
+				{
+					EntitySubsystem->ConcurrentReserveEntities(BatchSize, Reserved);
+				}
+				while (Reserved.Num() < NumToReserve)
+				{
+					Reserved.Add(EntitySubsystem->ConcurrentReserveEntity());
+				}
+			});
+
+		TArray<FMassEntityHandle> Entities;
+		TSet<FMassEntityHandle> UniqueEntities;
+		for (const TArray<FMassEntityHandle>& Reserved : ReservedPerTask)
+		{
+			Entities.Append(Reserved);
+		}
+		int32 NumInvalid = 0;
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			UniqueEntities.Add(Entity);
+			NumInvalid += (EntitySubsystem->IsEntityValid(Entity) && !EntitySubsystem->IsEntityBuilt(Entity)) ? 0 : 1;
+		}
+		AITEST_EQUAL("Every task should get its share of entities", Entities.Num(), (PoolSize / NumTasks) * NumTasks);
+		AITEST_EQUAL("Concurrently reserved entities should be unique", UniqueEntities.Num(), Entities.Num());
+		AITEST_EQUAL("Concurrently reserved entities should be valid but not built", NumInvalid, 0);
+		AITEST_EQUAL("Reserving should consume the pooled entities", EntitySubsystem->GetNumConcurrentReservationsAvailable(), PoolSize - Entities.Num());
+
+		// draining whatever got left due to rounding
+		TArray<FMassEntityHandle> Remainder;
+		const int32 NumRemaining = EntitySubsystem->GetNumConcurrentReservationsAvailable();
+		if (NumRemaining > 0)
+		{
+			AITEST_TRUE("Reserving all the remaining entities should succeed", EntitySubsystem->ConcurrentReserveEntities(NumRemaining, Remainder));
+		}
+		AITEST_FALSE("An empty pool should not hand out entities", EntitySubsystem->ConcurrentReserveEntities(1, Remainder));
+		AITEST_EQUAL("A failed reservation should leave the output untouched", Remainder.Num(), NumRemaining);
+		AITEST_FALSE("An empty pool should result in an invalid handle", EntitySubsystem->ConcurrentReserveEntity().IsSet());
+		Entities.Append(Remainder);
+
+		// the reserved entities get built on the game thread via the command buffer
+		FMassCommandBuffer CommandBuffer;
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			FTestFragment_Int Fragment;
+			Fragment.Value = i;
+			CommandBuffer.PushCommand(FBuildEntityFromFragmentInstances(Entities[i], { FInstancedStruct::Make(Fragment) }));
+		}
+		CommandBuffer.ReplayBufferAgainstSystem(EntitySubsystem);
+
+		int32 NumMismatches = 0;
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			NumMismatches += (EntitySubsystem->IsEntityBuilt(Entities[i]) && EntitySubsystem->GetFragmentDataChecked<FTestFragment_Int>(Entities[i]).Value == i) ? 0 : 1;
+		}
+		AITEST_EQUAL("All the reserved entities should have been built with the given fragment values", NumMismatches, 0);
+		AITEST_EQUAL("All the pooled entities should be accounted for", EntitySubsystem->DebugGetEntityCount(), EntityCountBefore + PoolSize);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FEntityTest_ConcurrentReservation, "System.Mass.Entity.ConcurrentReservation");
+
 #endif // WITH_MASSENTITY_DEBUG
 
 } // FMassEntityTestTest
@@ -0,0 +1,232 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "AITestsCommon.h"
+
+#include "MassEntitySubsystem.h"
+#include "MassProcessingTypes.h"
+#include "MassEntityTestTypes.h"
+#include "MassExecutor.h"
+
+#define LOCTEXT_NAMESPACE "MassTest"
+
+PRAGMA_DISABLE_OPTIMIZATION
+
+namespace FMassFragmentViewTest
+{
+#if WITH_MASSENTITY_DEBUG
+
+struct FMovementTestBase : FExecutionTestBase
+{
+	FArchetypeHandle AoSArchetype;
+	FArchetypeHandle SoAArchetype;
+
+	virtual bool SetUp() override
+	{
+		FExecutionTestBase::SetUp();
+		check(EntitySubsystem);
+
+		const UScriptStruct* AoSFragments[] = { FTestFragment_Location::StaticStruct(), FTestFragment_Velocity::StaticStruct() };
+		const UScriptStruct* SoAFragments[] = { FTestFragment_SplitLocation::StaticStruct(), FTestFragment_SplitVelocity::StaticStruct() };
+		AoSArchetype = EntitySubsystem->CreateArchetype(AoSFragments);
+		SoAArchetype = EntitySubsystem->CreateArchetype(SoAFragments);
+
+		return true;
+	}
+
+	static FVector3f GetTestVelocity(const int32 Index)
+	{
+		return FVector3f(float(Index % 7), float(Index % 11) * -0.5f, float(Index % 13) * 0.25f);
+	}
+
+	void CreateAoSEntities(const int32 Count, TArray<FMassEntityHandle>& OutEntities)
+	{
+		// BatchCreateEntities appends to OutEntities
+		const int32 FirstIndex = OutEntities.Num();
+		EntitySubsystem->BatchCreateEntities(AoSArchetype, Count, OutEntities);
+		for (int32 i = 0; i < Count; ++i)
+		{
+			EntitySubsystem->GetFragmentDataChecked<FTestFragment_Velocity>(OutEntities[FirstIndex + i]).Value = GetTestVelocity(i);
+		}
+	}
+
+	void CreateSoAEntities(const int32 Count, TArray<FMassEntityHandle>& OutEntities)
+	{
+		const int32 FirstIndex = OutEntities.Num();
+		EntitySubsystem->BatchCreateEntities(SoAArchetype, Count, OutEntities);
+		for (int32 i = 0; i < Count; ++i)
+		{
+			EntitySubsystem->SetEntityFragmentsValues(OutEntities[FirstIndex + i], { FInstancedStruct::Make(MakeSplitVelocity(GetTestVelocity(i))) });
+		}
+	}
+
+	static FTestFragment_SplitVelocity MakeSplitVelocity(const FVector3f& Velocity)
+	{
+		FTestFragment_SplitVelocity Fragment;
+		Fragment.X = Velocity.X;
+		Fragment.Y = Velocity.Y;
+		Fragment.Z = Velocity.Z;
+		return Fragment;
+	}
+
+	FVector3f GetSplitLocation(const FMassEntityHandle Entity) const
+	{
+		const FTestFragment_SplitLocation Location = EntitySubsystem->GetFragmentValueChecked<FTestFragment_SplitLocation>(Entity);
+		return FVector3f(Location.X, Location.Y, Location.Z);
+	}
+
+	FVector3f GetSplitVelocity(const FMassEntityHandle Entity) const
+	{
+		const FTestFragment_SplitVelocity Velocity = EntitySubsystem->GetFragmentValueChecked<FTestFragment_SplitVelocity>(Entity);
+		return FVector3f(Velocity.X, Velocity.Y, Velocity.Z);
+	}
+};
+
+struct FFragmentView_MemberView : FMovementTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		TArray<FMassEntityHandle> Entities;
+		CreateAoSEntities(EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(AoSArchetype) + 3, Entities);
+
+		FMassEntityQuery Query;
+		Query.AddRequirement<FTestFragment_Location>(EMassFragmentAccess::ReadWrite);
+		Query.AddRequirement<FTestFragment_Velocity>(EMassFragmentAccess::ReadOnly);
+		FMassExecutionContext ExecContext;
+		int32 NumMismatches = 0;
+		Query.ForEachEntityChunk(*EntitySubsystem, ExecContext, [&NumMismatches](FMassExecutionContext& Context)
+			{
+				const TConstArrayView<FTestFragment_Velocity> Velocities = Context.GetFragmentView<FTestFragment_Velocity>();
+				const TStridedView<const FVector3f> VelocityValues = Context.GetFragmentMemberView(&FTestFragment_Velocity::Value);
+				NumMismatches += (VelocityValues.Num() == Velocities.Num()) ? 0 : 1;
+
+				int32 Index = 0;
+				for (const FVector3f& Velocity : VelocityValues)
+				{
+					NumMismatches += (Velocity == Velocities[Index++].Value) ? 0 : 1;
+				}
+
+				// writing via the member view
+				const TStridedView<FVector3f> Locations = Context.GetMutableFragmentMemberView(&FTestFragment_Location::Value);
+				for (int32 i = 0; i < Locations.Num(); ++i)
+				{
+					Locations[i] = VelocityValues[i];
+				}
+			});
+
+		AITEST_EQUAL("Member view should reflect the fragments' member values", NumMismatches, 0);
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			AITEST_TRUE("Values written via the member view should be stored in the fragments", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Location>(Entities[i]).Value == GetTestVelocity(i));
+		}
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FFragmentView_MemberView, "System.Mass.FragmentView.MemberView");
+
+struct FFragmentView_SoAMovement : FMovementTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		// an entity count that's not a multiple of the SIMD width, to exercise the scalar remainder path as well
+		const int32 Count = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(SoAArchetype) * 2 + 3;
+		const float DeltaSeconds = 0.5f;
+		const int32 NumSteps = 3;
+
+		TArray<FMassEntityHandle> AoSEntities;
+		TArray<FMassEntityHandle> SoAEntities;
+		CreateAoSEntities(Count, AoSEntities);
+		CreateSoAEntities(Count, SoAEntities);
+
+		UMassTestProcessor_AoSMovement* AoSProcessor = NewObject<UMassTestProcessor_AoSMovement>(EntitySubsystem);
+		UMassTestProcessor_SoAMovement* SoAProcessor = NewObject<UMassTestProcessor_SoAMovement>(EntitySubsystem);
+		for (int32 Step = 0; Step < NumSteps; ++Step)
+		{
+			FMassProcessingContext ProcessingContext(*EntitySubsystem, DeltaSeconds);
+			UE::Mass::Executor::Run(*AoSProcessor, ProcessingContext);
+			UE::Mass::Executor::Run(*SoAProcessor, ProcessingContext);
+		}
+
+		for (int32 i = 0; i < Count; ++i)
+		{
+			const FVector3f AoSLocation = EntitySubsystem->GetFragmentDataChecked<FTestFragment_Location>(AoSEntities[i]).Value;
+			const FVector3f SoALocation = GetSplitLocation(SoAEntities[i]);
+			AITEST_TRUE("SoA integration results should match the AoS ones", SoALocation.Equals(AoSLocation, KINDA_SMALL_NUMBER));
+			AITEST_TRUE("Locations should have been integrated", SoALocation.Equals(GetTestVelocity(i) * DeltaSeconds * NumSteps, KINDA_SMALL_NUMBER));
+		}
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FFragmentView_SoAMovement, "System.Mass.FragmentView.SoAMovement");
+
+struct FFragmentView_SplitLayout : FMovementTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const int32 NumEntitiesPerChunk = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(SoAArchetype);
+		const int32 Count = NumEntitiesPerChunk * 3;
+
+		TArray<FMassEntityHandle> Entities;
+		CreateSoAEntities(Count, Entities);
+
+		FMassEntityQuery Query;
+		Query.AddRequirement<FTestFragment_SplitVelocity>(EMassFragmentAccess::ReadOnly);
+		FMassExecutionContext ExecContext;
+		int32 NumMismatches = 0;
+		Query.ForEachEntityChunk(*EntitySubsystem, ExecContext, [&NumMismatches](FMassExecutionContext& Context)
+			{
+				const TConstArrayView<float> X = Context.GetFragmentValues(&FTestFragment_SplitVelocity::X);
+				const TConstArrayView<float> Y = Context.GetFragmentValues(&FTestFragment_SplitVelocity::Y);
+				const TStridedView<const float> Z = Context.GetFragmentMemberView(&FTestFragment_SplitVelocity::Z);
+				// every member gets its own sub-column, laid out one after another
+				NumMismatches += (Y.GetData() >= X.GetData() + X.Num()) ? 0 : 1;
+				NumMismatches += (&Z[0] >= Y.GetData() + Y.Num() && Z.GetStride() == sizeof(float)) ? 0 : 1;
+				NumMismatches += (X.Num() == Context.GetNumEntities() && Y.Num() == X.Num() && Z.Num() == X.Num()) ? 0 : 1;
+			});
+		AITEST_EQUAL("Split fragment members should be stored in contiguous sub-columns", NumMismatches, 0);
+
+		// removing entities, which swaps the trailing ones in their place
+		TArray<FMassEntityHandle> EntitiesToDestroy;
+		for (int32 i = 0; i < Count; i += 3)
+		{
+			EntitiesToDestroy.Add(Entities[i]);
+		}
+		EntitySubsystem->BatchDestroyEntities(EntitiesToDestroy);
+		EntitySubsystem->DestroyEntity(Entities[1]);
+
+		// moving entities to another archetype, one by one and in bulk
+		EntitySubsystem->AddFragmentToEntity(Entities[2], FTestFragment_Float::StaticStruct());
+		TArray<FMassEntityHandle> EntitiesToMove;
+		for (int32 i = 4; i < Count; i += 3)
+		{
+			EntitiesToMove.Add(Entities[i]);
+		}
+		EntitySubsystem->BatchAddFragmentToEntities(FArchetypeChunkCollection(SoAArchetype, EntitiesToMove, FArchetypeChunkCollection::NoDuplicates), FTestFragment_Int::StaticStruct());
+		EntitySubsystem->DoEntityCompaction(/*TimeAllowed=*/1000.);
+
+		for (int32 i = 2; i < Count; ++i)
+		{
+			if (i % 3 != 0)
+			{
+				AITEST_TRUE("Split fragment values should survive removals, moves and compaction", GetSplitVelocity(Entities[i]).Equals(GetTestVelocity(i)));
+				AITEST_TRUE("Split fragments should get default-initialized", GetSplitLocation(Entities[i]).IsZero());
+			}
+		}
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FFragmentView_SplitLayout, "System.Mass.FragmentView.SplitLayout");
+
+#endif // WITH_MASSENTITY_DEBUG
+} // FMassFragmentViewTest
+
+PRAGMA_ENABLE_OPTIMIZATION
+
+#undef LOCTEXT_NAMESPACE
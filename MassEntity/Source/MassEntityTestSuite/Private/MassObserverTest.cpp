@@ -0,0 +1,375 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "AITestsCommon.h"
+
+#include "MassEntitySubsystem.h"
+#include "MassObserverManager.h"
+#include "MassCommandBuffer.h"
+#include "MassEntityTestTypes.h"
+
+#define LOCTEXT_NAMESPACE "MassTest"
+
+PRAGMA_DISABLE_OPTIMIZATION
+
+namespace FMassObserverTest
+{
+#if WITH_MASSENTITY_DEBUG
+
+struct FObserverTestBase : FEntityTestBase
+{
+	TArray<FMassEntityHandle> Entities;
+
+	virtual bool SetUp() override
+	{
+		FEntityTestBase::SetUp();
+		check(EntitySubsystem);
+
+		// spanning multiple chunks so that the batched notifications get split into multiple chunks as well
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsArchetype) * 2 + 3, Entities);
+		UMassTestFragmentInitializer_Observed::Counters.Reset();
+		UMassTestFragmentDeinitializer_Observed::Counters.Reset();
+		UMassTestTagInitializer_Observed::Counters.Reset();
+		UMassTestTagDeinitializer_Observed::Counters.Reset();
+		UMassTestSharedFragmentObserver::Counters.Reset();
+		UMassTestSharedFragmentObserver::LastSeenValue = 0;
+
+		return true;
+	}
+
+	void AddObservedFragment(const FMassEntityHandle Entity)
+	{
+		FMassArchetypeCompositionDescriptor Descriptor;
+		Descriptor.Fragments.Add<FTestFragment_Observed>();
+		EntitySubsystem->AddCompositionToEntity_GetDelta(Entity, Descriptor);
+	}
+
+	int32 CountObservedEntities() const
+	{
+		int32 NumObserved = 0;
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			const FTestFragment_Observed* Observed = EntitySubsystem->GetFragmentDataPtr<FTestFragment_Observed>(Entity);
+			NumObserved += (Observed && Observed->Value == 1) ? 1 : 0;
+		}
+		return NumObserved;
+	}
+};
+
+struct FObserverTest_PerEntityCompositionAdded : FObserverTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			AddObservedFragment(Entity);
+		}
+
+		AITEST_EQUAL("Without batching the observer should run once per entity", UMassTestFragmentInitializer_Observed::Counters.NumChunksProcessed, Entities.Num());
+		AITEST_EQUAL("Every entity should have been observed exactly once", CountObservedEntities(), Entities.Num());
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FObserverTest_PerEntityCompositionAdded, "System.Mass.Observer.PerEntityCompositionAdded");
+
+struct FObserverTest_BatchedCompositionAdded : FObserverTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		{
+			FMassObserverManager::FScopedCompositionChangeBatching OuterBatching(EntitySubsystem->GetObserverManager());
+			{
+				// nested scopes only flush with the outermost one
+				FMassObserverManager::FScopedCompositionChangeBatching InnerBatching(EntitySubsystem->GetObserverManager());
+				for (const FMassEntityHandle& Entity : Entities)
+				{
+					AddObservedFragment(Entity);
+				}
+			}
+			AITEST_EQUAL("Observers should not get run while batching", UMassTestFragmentInitializer_Observed::Counters.NumEntitiesProcessed, 0);
+
+			// destroyed entities are expected to get skipped
+			EntitySubsystem->DestroyEntity(Entities.Pop());
+		}
+
+		const int32 NumChunks = EntitySubsystem->GetArchetypeFragmentationInfo(EntitySubsystem->GetArchetypeForEntity(Entities[0])).NumChunks;
+		AITEST_EQUAL("Batched observer should run once per chunk", UMassTestFragmentInitializer_Observed::Counters.NumChunksProcessed, NumChunks);
+		AITEST_EQUAL("Batched observer should process all the remaining entities", UMassTestFragmentInitializer_Observed::Counters.NumEntitiesProcessed, Entities.Num());
+		AITEST_EQUAL("Every entity should have been observed exactly once", CountObservedEntities(), Entities.Num());
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FObserverTest_BatchedCompositionAdded, "System.Mass.Observer.BatchedCompositionAdded");
+
+struct FObserverTest_BatchedAddThenRemove : FObserverTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		{
+			FMassObserverManager::FScopedCompositionChangeBatching Batching(EntitySubsystem->GetObserverManager());
+			for (const FMassEntityHandle& Entity : Entities)
+			{
+				AddObservedFragment(Entity);
+			}
+
+			// entities that lose the fragment before the batch gets flushed are not reported
+			FMassArchetypeCompositionDescriptor Descriptor;
+			Descriptor.Fragments.Add<FTestFragment_Observed>();
+			EntitySubsystem->RemoveCompositionFromEntity(Entities[0], Descriptor);
+		}
+
+		AITEST_EQUAL("Entities that lost the observed fragment should have been skipped", UMassTestFragmentInitializer_Observed::Counters.NumEntitiesProcessed, Entities.Num() - 1);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FObserverTest_BatchedAddThenRemove, "System.Mass.Observer.BatchedAddThenRemove");
+
+struct FObserverTest_DeferredCompositionAdded : FObserverTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			EntitySubsystem->Defer().PushCommand(FDeferredCommand([this, Entity](UMassEntitySubsystem&)
+				{
+					AddObservedFragment(Entity);
+				}));
+		}
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+
+		const int32 NumChunks = EntitySubsystem->GetArchetypeFragmentationInfo(EntitySubsystem->GetArchetypeForEntity(Entities[0])).NumChunks;
+		AITEST_EQUAL("Composition changes done by deferred commands should get observed once per chunk", UMassTestFragmentInitializer_Observed::Counters.NumChunksProcessed, NumChunks);
+		AITEST_EQUAL("Every entity should have been observed exactly once", CountObservedEntities(), Entities.Num());
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FObserverTest_DeferredCompositionAdded, "System.Mass.Observer.DeferredCompositionAdded");
+
+struct FObserverTest_DeferredCompositionRemoved : FObserverTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		const UScriptStruct* FragmentTypes[] = { FTestFragment_Float::StaticStruct(), FTestFragment_ObservedRemoval::StaticStruct() };
+		const FArchetypeHandle Archetype = EntitySubsystem->CreateArchetype(FragmentTypes);
+		TArray<FMassEntityHandle> ObservedEntities;
+		EntitySubsystem->BatchCreateEntities(Archetype, EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(Archetype) * 2 + 3, ObservedEntities);
+		const int32 NumChunks = EntitySubsystem->GetArchetypeFragmentationInfo(Archetype).NumChunks;
+
+		FMassArchetypeCompositionDescriptor Descriptor;
+		Descriptor.Fragments.Add<FTestFragment_ObservedRemoval>();
+		for (const FMassEntityHandle& Entity : ObservedEntities)
+		{
+			EntitySubsystem->Defer().PushCommand(FCommandRemoveComposition(Entity, Descriptor));
+		}
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+
+		AITEST_EQUAL("Removal observers should run once per chunk, before the commands get executed", UMassTestFragmentDeinitializer_Observed::Counters.NumChunksProcessed, NumChunks);
+		AITEST_EQUAL("Every entity should have been observed exactly once", UMassTestFragmentDeinitializer_Observed::Counters.NumEntitiesProcessed, ObservedEntities.Num());
+		AITEST_EQUAL("The fragment should have been removed", EntitySubsystem->GetArchetypeForEntity(ObservedEntities[0]), FloatsArchetype);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FObserverTest_DeferredCompositionRemoved, "System.Mass.Observer.DeferredCompositionRemoved");
+
+struct FObserverTest_DeferredLambdaCompositionRemoved : FObserverTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		const UScriptStruct* FragmentTypes[] = { FTestFragment_Float::StaticStruct(), FTestFragment_ObservedRemoval::StaticStruct() };
+		const FArchetypeHandle Archetype = EntitySubsystem->CreateArchetype(FragmentTypes);
+		TArray<FMassEntityHandle> ObservedEntities;
+		EntitySubsystem->BatchCreateEntities(Archetype, 3, ObservedEntities);
+
+		// the removal done by the lambda never gets recorded by the buffer, so it has to be observed when executed
+		FMassArchetypeCompositionDescriptor Descriptor;
+		Descriptor.Fragments.Add<FTestFragment_ObservedRemoval>();
+		for (const FMassEntityHandle& Entity : ObservedEntities)
+		{
+			EntitySubsystem->Defer().PushCommand(FDeferredCommand([Entity, Descriptor](UMassEntitySubsystem& System)
+				{
+					System.RemoveCompositionFromEntity(Entity, Descriptor);
+				}));
+		}
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+
+		AITEST_EQUAL("Removals done by deferred commands should still get observed", UMassTestFragmentDeinitializer_Observed::Counters.NumEntitiesProcessed, ObservedEntities.Num());
+		AITEST_EQUAL("The fragment should have been removed", EntitySubsystem->GetArchetypeForEntity(ObservedEntities[0]), FloatsArchetype);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FObserverTest_DeferredLambdaCompositionRemoved, "System.Mass.Observer.DeferredLambdaCompositionRemoved");
+
+struct FObserverTest_DeferredTagChanges : FObserverTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			EntitySubsystem->Defer().AddTag<FTestTag_Observed>(Entity);
+		}
+		AITEST_EQUAL("Tag observers should not get run before the commands get flushed", UMassTestTagInitializer_Observed::Counters.NumEntitiesProcessed, 0);
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+
+		const FArchetypeHandle TaggedArchetype = EntitySubsystem->GetArchetypeForEntity(Entities[0]);
+		const int32 NumChunks = EntitySubsystem->GetArchetypeFragmentationInfo(TaggedArchetype).NumChunks;
+		AITEST_EQUAL("Tag addition observer should run once per chunk", UMassTestTagInitializer_Observed::Counters.NumChunksProcessed, NumChunks);
+		AITEST_EQUAL("Tag addition observer should process all the tagged entities", UMassTestTagInitializer_Observed::Counters.NumEntitiesProcessed, Entities.Num());
+		AITEST_EQUAL("Tag removal observer should not run when tags get added", UMassTestTagDeinitializer_Observed::Counters.NumEntitiesProcessed, 0);
+
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			EntitySubsystem->Defer().RemoveTag<FTestTag_Observed>(Entity);
+		}
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+
+		AITEST_EQUAL("Tag removal observer should run once per chunk", UMassTestTagDeinitializer_Observed::Counters.NumChunksProcessed, NumChunks);
+		AITEST_EQUAL("Tag removal observer should process all the entities, while they still have the tag", UMassTestTagDeinitializer_Observed::Counters.NumEntitiesProcessed, Entities.Num());
+		AITEST_EQUAL("Tag should have been removed", EntitySubsystem->GetArchetypeForEntity(Entities[0]), FloatsArchetype);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FObserverTest_DeferredTagChanges, "System.Mass.Observer.DeferredTagChanges");
+
+struct FObserverTest_DeferredTagNoOpChanges : FObserverTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		// the tag gets added and removed by the same buffer, so the entities never end up with it
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			EntitySubsystem->Defer().AddTag<FTestTag_Observed>(Entity);
+			EntitySubsystem->Defer().RemoveTag<FTestTag_Observed>(Entity);
+		}
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+
+		AITEST_EQUAL("The entities should end up without the tag", EntitySubsystem->GetArchetypeForEntity(Entities[0]), FloatsArchetype);
+		AITEST_EQUAL("Tag addition observer should not run for tags that are gone by the time the commands got executed", UMassTestTagInitializer_Observed::Counters.NumEntitiesProcessed, 0);
+		AITEST_EQUAL("Tag removal observer should not run for entities that didn't have the tag", UMassTestTagDeinitializer_Observed::Counters.NumEntitiesProcessed, 0);
+
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			EntitySubsystem->Defer().AddTag<FTestTag_Observed>(Entity);
+		}
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+		UMassTestTagInitializer_Observed::Counters.Reset();
+
+		// adding the tag again doesn't change anything
+		for (const FMassEntityHandle& Entity : Entities)
+		{
+			EntitySubsystem->Defer().AddTag<FTestTag_Observed>(Entity);
+		}
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+
+		AITEST_EQUAL("Tag addition observer should not run for entities that already had the tag", UMassTestTagInitializer_Observed::Counters.NumEntitiesProcessed, 0);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FObserverTest_DeferredTagNoOpChanges, "System.Mass.Observer.DeferredTagNoOpChanges");
+
+struct FObserverTest_DeferredSharedFragmentChange : FObserverTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		FTestSharedFragment_Observed OldValue;
+		OldValue.Value = 1;
+		FTestSharedFragment_Observed NewValue;
+		NewValue.Value = 2;
+		const FConstSharedStruct OldFragment = EntitySubsystem->GetOrCreateConstSharedFragment(/*Hash=*/OldValue.Value, OldValue);
+		const FConstSharedStruct NewFragment = EntitySubsystem->GetOrCreateConstSharedFragment(/*Hash=*/NewValue.Value, NewValue);
+
+		FMassArchetypeCompositionDescriptor Composition;
+		Composition.Fragments.Add<FTestFragment_Float>();
+		Composition.SharedFragments.Add<FTestSharedFragment_Observed>();
+		FMassArchetypeSharedFragmentValues SharedFragmentValues;
+		SharedFragmentValues.AddConstSharedFragment(OldFragment);
+		SharedFragmentValues.Sort();
+		const FArchetypeHandle OldArchetype = EntitySubsystem->CreateArchetype(Composition, SharedFragmentValues);
+
+		TArray<FMassEntityHandle> SharingEntities;
+		EntitySubsystem->BatchCreateEntities(OldArchetype, EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(OldArchetype) + 3, SharingEntities);
+
+		for (const FMassEntityHandle& Entity : SharingEntities)
+		{
+			EntitySubsystem->Defer().SetConstSharedFragment(Entity, NewFragment);
+		}
+		AITEST_EQUAL("Shared fragment observers should not get run before the commands get flushed", UMassTestSharedFragmentObserver::Counters.NumEntitiesProcessed, 0);
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+
+		const FArchetypeHandle NewArchetype = EntitySubsystem->GetArchetypeForEntity(SharingEntities[0]);
+		AITEST_TRUE("Changing the shared fragment value should move the entities to a different archetype", NewArchetype != OldArchetype);
+		AITEST_EQUAL("Shared fragment observer should run once per chunk", UMassTestSharedFragmentObserver::Counters.NumChunksProcessed, EntitySubsystem->GetArchetypeFragmentationInfo(NewArchetype).NumChunks);
+		AITEST_EQUAL("Shared fragment observer should process all the changed entities", UMassTestSharedFragmentObserver::Counters.NumEntitiesProcessed, SharingEntities.Num());
+		AITEST_EQUAL("Shared fragment observer should see the new value", UMassTestSharedFragmentObserver::LastSeenValue, NewValue.Value);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FObserverTest_DeferredSharedFragmentChange, "System.Mass.Observer.DeferredSharedFragmentChange");
+
+struct FObserverTest_DeferredSharedFragmentSameValue : FObserverTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		FTestSharedFragment_Observed Value;
+		Value.Value = 1;
+		const FConstSharedStruct Fragment = EntitySubsystem->GetOrCreateConstSharedFragment(/*Hash=*/Value.Value, Value);
+
+		FMassArchetypeCompositionDescriptor Composition;
+		Composition.Fragments.Add<FTestFragment_Float>();
+		Composition.SharedFragments.Add<FTestSharedFragment_Observed>();
+		FMassArchetypeSharedFragmentValues SharedFragmentValues;
+		SharedFragmentValues.AddConstSharedFragment(Fragment);
+		SharedFragmentValues.Sort();
+		const FArchetypeHandle Archetype = EntitySubsystem->CreateArchetype(Composition, SharedFragmentValues);
+
+		TArray<FMassEntityHandle> SharingEntities;
+		EntitySubsystem->BatchCreateEntities(Archetype, 3, SharingEntities);
+
+		for (const FMassEntityHandle& Entity : SharingEntities)
+		{
+			EntitySubsystem->Defer().SetConstSharedFragment(Entity, Fragment);
+		}
+		EntitySubsystem->Defer().ReplayBufferAgainstSystem(EntitySubsystem);
+
+		AITEST_EQUAL("The entities should stay in their archetype", EntitySubsystem->GetArchetypeForEntity(SharingEntities[0]), Archetype);
+		AITEST_EQUAL("Shared fragment observer should not run when the value didn't change", UMassTestSharedFragmentObserver::Counters.NumEntitiesProcessed, 0);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FObserverTest_DeferredSharedFragmentSameValue, "System.Mass.Observer.DeferredSharedFragmentSameValue");
+
+#endif // WITH_MASSENTITY_DEBUG
+} // FMassObserverTest
+
+PRAGMA_ENABLE_OPTIMIZATION
+
+#undef LOCTEXT_NAMESPACE
@@ -8,6 +8,7 @@
 #include "MassProcessingTypes.h"
 #include "MassEntityTestTypes.h"
 #include "MassExecutor.h"
+#include "MassCommandBuffer.h"
 
 #define LOCTEXT_NAMESPACE "MassTest"
 
@@ -116,6 +117,52 @@ struct FProcessorTest_Requirements : FEntityTestBase
 };
 IMPLEMENT_AI_INSTANT_TEST(FProcessorTest_Requirements, "System.Mass.Processor.Requirements");
 
+#if WITH_MASSENTITY_DEBUG
+struct FProcessorTest_ExecutionStats : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		TGuardValue<bool> StatsEnabledGuard(UE::Mass::ProcessorStats::bEnabled, true);
+
+		TArray<FMassEntityHandle> EntitiesCreated;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsArchetype) * 2 + 3, EntitiesCreated);
+		const int32 NumChunks = EntitySubsystem->GetArchetypeFragmentationInfo(FloatsArchetype).NumChunks;
+
+		UMassTestProcessor_Floats* Processor = NewObject<UMassTestProcessor_Floats>(EntitySubsystem);
+		Processor->ExecutionFunction = [Processor](UMassEntitySubsystem& InEntitySubsystem, FMassExecutionContext& Context) {
+			Processor->TestGetQuery().ForEachEntityChunk(InEntitySubsystem, Context, [](FMassExecutionContext& Context)
+				{
+					Context.Defer().AddTag<FTestTag_A>(Context.GetEntity(0));
+				});
+		};
+
+		FMassProcessingContext ProcessingContext(*EntitySubsystem, /*DeltaSeconds=*/0.f);
+		// not flushing the commands so that the entities stay put between the runs
+		ProcessingContext.bFlushCommandBuffer = false;
+		UE::Mass::Executor::Run(*Processor, ProcessingContext);
+		UE::Mass::Executor::Run(*Processor, ProcessingContext);
+
+		const FMassProcessorExecutionStats& Stats = Processor->GetExecutionStats();
+		AITEST_EQUAL("Stats should have been gathered for every execution", Stats.NumExecutions, 2);
+		AITEST_EQUAL("All the matching chunks should have been counted", FMath::RoundToInt(Stats.AverageChunks), NumChunks);
+		AITEST_EQUAL("All the matching entities should have been counted", FMath::RoundToInt(Stats.AverageEntities), EntitiesCreated.Num());
+		AITEST_EQUAL("Every deferred command should have been counted", FMath::RoundToInt(Stats.AverageCommands), NumChunks);
+
+		Processor->ResetExecutionStats();
+		{
+			TGuardValue<bool> StatsDisabledGuard(UE::Mass::ProcessorStats::bEnabled, false);
+			UE::Mass::Executor::Run(*Processor, ProcessingContext);
+		}
+		AITEST_EQUAL("No stats should be gathered while disabled", Processor->GetExecutionStats().NumExecutions, 0);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FProcessorTest_ExecutionStats, "System.Mass.Processor.ExecutionStats");
+#endif // WITH_MASSENTITY_DEBUG
+
 
 } // FMassProcessorTestTest
 
@@ -8,6 +8,7 @@
 #include "MassProcessingTypes.h"
 #include "MassEntityTestTypes.h"
 #include "MassExecutor.h"
+#include "MassCommandBuffer.h"
 
 #define LOCTEXT_NAMESPACE "MassTest"
 
@@ -246,6 +247,91 @@ struct FQueryTest_ExecuteSparse : FEntityTestBase
 };
 IMPLEMENT_AI_INSTANT_TEST(FQueryTest_ExecuteSparse, "System.Mass.Query.ExecuteSparse");
 
+struct FQueryTest_ParallelExecuteSparse : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		// spanning multiple chunks so that the sparse collection results in multiple parallel jobs
+		const int32 NumToCreate = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsArchetype) * 4 + 3;
+		TArray<FMassEntityHandle> AllEntitiesCreated;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, NumToCreate, AllEntitiesCreated);
+
+		TArray<FMassEntityHandle> EntitiesToProcess;
+		for (int32 i = 0; i < AllEntitiesCreated.Num(); i += 3)
+		{
+			EntitiesToProcess.Add(AllEntitiesCreated[i]);
+		}
+
+		std::atomic<int32> TotalProcessed{0};
+		const FArchetypeChunkCollection ChunkCollection(FloatsArchetype, EntitiesToProcess, FArchetypeChunkCollection::NoDuplicates);
+		FMassExecutionContext ExecContext;
+		ExecContext.SetChunkCollection(ChunkCollection);
+		FMassEntityQuery Query;
+		Query.AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadWrite);
+		Query.SetParallelExecutionAllowed(true);
+		Query.ParallelForEachEntityChunk(*EntitySubsystem, ExecContext, [&TotalProcessed](FMassExecutionContext& Context)
+			{
+				TotalProcessed += Context.GetNumEntities();
+				for (FTestFragment_Float& Float : Context.GetMutableFragmentView<FTestFragment_Float>())
+				{
+					Float.Value = 13.f;
+				}
+			});
+		ExecContext.ClearChunkCollection();
+
+		AITEST_EQUAL("Only the entities in the chunk collection should get processed", TotalProcessed.load(), EntitiesToProcess.Num());
+		int32 NumMismatches = 0;
+		for (int32 i = 0; i < AllEntitiesCreated.Num(); ++i)
+		{
+			const float ExpectedValue = (i % 3 == 0) ? 13.f : 0.f;
+			NumMismatches += (EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(AllEntitiesCreated[i]).Value == ExpectedValue) ? 0 : 1;
+		}
+		AITEST_EQUAL("Only the entities in the chunk collection should have been modified", NumMismatches, 0);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FQueryTest_ParallelExecuteSparse, "System.Mass.Query.ParallelExecuteSparse");
+
+struct FQueryTest_FullArchetypeChunkCollection : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const int32 EntitiesPerChunk = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsArchetype);
+
+		// the full-archetype collection is expected to list every chunk, in order
+		auto IsFullCollectionValid = [this]()
+		{
+			const int32 NumChunks = EntitySubsystem->GetArchetypeFragmentationInfo(FloatsArchetype).NumChunks;
+			const FArchetypeChunkCollection FullCollection(FloatsArchetype);
+			bool bValid = (FullCollection.GetChunks().Num() == NumChunks);
+			for (int32 ChunkIndex = 0; bValid && ChunkIndex < NumChunks; ++ChunkIndex)
+			{
+				bValid = (FullCollection.GetChunks()[ChunkIndex] == FArchetypeChunkCollection::FChunkInfo(ChunkIndex));
+			}
+			return bValid;
+		};
+
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, EntitiesPerChunk * 3, Entities);
+		AITEST_TRUE("Full archetype collection should cover all the chunks", IsFullCollectionValid());
+
+		// emptying the last chunk gets it removed
+		EntitySubsystem->BatchDestroyEntities(MakeArrayView(&Entities[EntitiesPerChunk * 2], EntitiesPerChunk));
+		AITEST_EQUAL("Emptied trailing chunk should have been removed", EntitySubsystem->GetArchetypeFragmentationInfo(FloatsArchetype).NumChunks, 2);
+		AITEST_TRUE("Full archetype collection should follow chunk removal", IsFullCollectionValid());
+
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, EntitiesPerChunk * 2, Entities);
+		AITEST_EQUAL("New chunks should have been added", EntitySubsystem->GetArchetypeFragmentationInfo(FloatsArchetype).NumChunks, 4);
+		AITEST_TRUE("Full archetype collection should follow chunk addition", IsFullCollectionValid());
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FQueryTest_FullArchetypeChunkCollection, "System.Mass.Query.FullArchetypeChunkCollection");
+
 
 struct FQueryTest_TagPresent : FEntityTestBase
 {
@@ -543,6 +629,335 @@ struct FQueryTest_AnyTag : FEntityTestBase
 };
 IMPLEMENT_AI_INSTANT_TEST(FQueryTest_AnyTag, "System.Mass.Query.AnyTag");
 
+struct FQueryTest_IncrementalArchetypeCaching : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		FMassEntityQuery Query;
+		Query.AddRequirement<FTestFragment_Int>(EMassFragmentAccess::ReadOnly);
+		Query.AddTagRequirement<FTestTag_A>(EMassFragmentPresence::None);
+		Query.CacheArchetypes(*EntitySubsystem);
+		const int32 NumInitiallyMatched = Query.GetArchetypes().Num();
+
+		const FArchetypeHandle IntBArchetype = EntitySubsystem->CreateArchetype({ FTestFragment_Int::StaticStruct(), FTestTag_B::StaticStruct() });
+		EntitySubsystem->CreateArchetype({ FTestFragment_Int::StaticStruct(), FTestTag_A::StaticStruct() });
+		EntitySubsystem->CreateArchetype({ FTestFragment_Bool::StaticStruct() });
+		Query.CacheArchetypes(*EntitySubsystem);
+
+		AITEST_EQUAL("Only the matching new archetype should get added", Query.GetArchetypes().Num(), NumInitiallyMatched + 1);
+		AITEST_TRUE("IntBArchetype should be amongst the matched archetypes", Query.GetArchetypes().Find(IntBArchetype) != INDEX_NONE);
+
+		// the new archetype's requirements mapping needs to be in place as well
+		const FMassEntityHandle Entity = EntitySubsystem->CreateEntity(IntBArchetype);
+		EntitySubsystem->GetFragmentDataChecked<FTestFragment_Int>(Entity).Value = 7;
+		int32 Sum = 0;
+		FMassExecutionContext ExecContext;
+		Query.ForEachEntityChunk(*EntitySubsystem, ExecContext, [&Sum](FMassExecutionContext& Context)
+			{
+				for (const FTestFragment_Int& Fragment : Context.GetFragmentView<FTestFragment_Int>())
+				{
+					Sum += Fragment.Value;
+				}
+			});
+		AITEST_EQUAL("The query should process the new archetype's entities", Sum, 7);
+
+		// a freshly created query needs to gather the very same archetypes
+		FMassEntityQuery FreshQuery;
+		FreshQuery.AddRequirement<FTestFragment_Int>(EMassFragmentAccess::ReadOnly);
+		FreshQuery.AddTagRequirement<FTestTag_A>(EMassFragmentPresence::None);
+		FreshQuery.CacheArchetypes(*EntitySubsystem);
+		AITEST_EQUAL("Incremental caching should match the full one", Query.GetArchetypes().Num(), FreshQuery.GetArchetypes().Num());
+		for (const FArchetypeHandle& Archetype : FreshQuery.GetArchetypes())
+		{
+			AITEST_TRUE("Every archetype matched by the full caching should be matched by the incremental one", Query.GetArchetypes().Find(Archetype) != INDEX_NONE);
+		}
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FQueryTest_IncrementalArchetypeCaching, "System.Mass.Query.IncrementalArchetypeCaching");
+
+#if WITH_MASSENTITY_DEBUG
+struct FQueryTest_ChangedFilter : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const int32 EntitiesPerChunk = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsArchetype);
+		// spanning exactly 3 chunks
+		TArray<FMassEntityHandle> EntitiesCreated;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, EntitiesPerChunk * 3, EntitiesCreated);
+
+		int32 TotalProcessed = 0;
+		FMassExecutionContext ExecContext;
+		FMassEntityQuery ChangedQuery;
+		ChangedQuery.AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadOnly);
+		ChangedQuery.AddChangedFilter<FTestFragment_Float>();
+		auto CountEntities = [&TotalProcessed](FMassExecutionContext& Context)
+		{
+			TotalProcessed += Context.GetNumEntities();
+		};
+
+		ChangedQuery.ForEachEntityChunk(*EntitySubsystem, ExecContext, CountEntities);
+		AITEST_EQUAL("Newly created entities should be reported as changed", TotalProcessed, EntitiesPerChunk * 3);
+
+		TotalProcessed = 0;
+		ChangedQuery.ForEachEntityChunk(*EntitySubsystem, ExecContext, CountEntities);
+		AITEST_EQUAL("Nothing has changed since the last run", TotalProcessed, 0);
+
+		// read-only access doesn't count as a change
+		FMassEntityQuery ReaderQuery;
+		ReaderQuery.AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadOnly);
+		ReaderQuery.ForEachEntityChunk(*EntitySubsystem, ExecContext, [](FMassExecutionContext&) {});
+		TotalProcessed = 0;
+		ChangedQuery.ForEachEntityChunk(*EntitySubsystem, ExecContext, CountEntities);
+		AITEST_EQUAL("Read-only access should not mark the chunks as changed", TotalProcessed, 0);
+
+		// writing to the middle chunk only
+		FMassEntityQuery WriterQuery;
+		WriterQuery.AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadWrite);
+		WriterQuery.ForEachEntityChunk(FArchetypeChunkCollection(FloatsArchetype, MakeArrayView(&EntitiesCreated[EntitiesPerChunk], 1), FArchetypeChunkCollection::NoDuplicates)
+			, *EntitySubsystem, ExecContext, [](FMassExecutionContext& Context)
+			{
+				Context.GetMutableFragmentView<FTestFragment_Float>()[0].Value = 1.f;
+			});
+		TotalProcessed = 0;
+		ChangedQuery.ForEachEntityChunk(*EntitySubsystem, ExecContext, CountEntities);
+		AITEST_EQUAL("Only the chunk written to should be processed", TotalProcessed, EntitiesPerChunk);
+
+		// structural changes count as modifications as well
+		EntitySubsystem->DestroyEntity(EntitiesCreated.Last());
+		TotalProcessed = 0;
+		ChangedQuery.ForEachEntityChunk(*EntitySubsystem, ExecContext, CountEntities);
+		AITEST_EQUAL("Only the chunk an entity has been removed from should be processed", TotalProcessed, EntitiesPerChunk - 1);
+
+		// the query's own writes should not be reported back to it
+		FMassEntityQuery ChangingQuery;
+		ChangingQuery.AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadWrite);
+		ChangingQuery.AddChangedFilter<FTestFragment_Float>();
+		ChangingQuery.ForEachEntityChunk(*EntitySubsystem, ExecContext, [](FMassExecutionContext&) {});
+		TotalProcessed = 0;
+		ChangingQuery.ForEachEntityChunk(*EntitySubsystem, ExecContext, CountEntities);
+		AITEST_EQUAL("Query's own writes should not be reported to it", TotalProcessed, 0);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FQueryTest_ChangedFilter, "System.Mass.Query.ChangedFilter");
+
+struct FQueryTest_ChangedFilterMultipleRunsPerExecution : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const int32 EntitiesPerChunk = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsArchetype);
+		TArray<FMassEntityHandle> EntitiesCreated;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, EntitiesPerChunk * 3, EntitiesCreated);
+
+		FMassEntityQuery ChangedQuery;
+		ChangedQuery.AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadOnly);
+		ChangedQuery.AddChangedFilter<FTestFragment_Float>();
+
+		// the processor runs the query twice per execution, both runs should see the changes done before the execution
+		int32 ProcessedPerRun[2] = { 0, 0 };
+		UMassTestProcessorBase* Processor = NewObject<UMassTestProcessorBase>(EntitySubsystem);
+		Processor->ExecutionFunction = [&ChangedQuery, &ProcessedPerRun](UMassEntitySubsystem& InEntitySubsystem, FMassExecutionContext& Context)
+			{
+				for (int32& Processed : ProcessedPerRun)
+				{
+					Processed = 0;
+					ChangedQuery.ForEachEntityChunk(InEntitySubsystem, Context, [&Processed](FMassExecutionContext& ChunkContext)
+						{
+							Processed += ChunkContext.GetNumEntities();
+						});
+				}
+			};
+
+		FMassProcessingContext ProcessingContext(*EntitySubsystem, /*DeltaSeconds=*/0.f);
+		UE::Mass::Executor::Run(*Processor, ProcessingContext);
+		AITEST_EQUAL("The first run should see the newly created entities", ProcessedPerRun[0], EntitiesPerChunk * 3);
+		AITEST_EQUAL("The second run of the same execution should see the newly created entities as well", ProcessedPerRun[1], EntitiesPerChunk * 3);
+
+		EntitySubsystem->DestroyEntity(EntitiesCreated.Last());
+		UE::Mass::Executor::Run(*Processor, ProcessingContext);
+		AITEST_EQUAL("Only the chunk an entity has been removed from should be processed", ProcessedPerRun[0], EntitiesPerChunk - 1);
+		AITEST_EQUAL("The second run should see the same changes", ProcessedPerRun[1], EntitiesPerChunk - 1);
+
+		UE::Mass::Executor::Run(*Processor, ProcessingContext);
+		AITEST_EQUAL("Nothing has changed since the previous execution", ProcessedPerRun[0] + ProcessedPerRun[1], 0);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FQueryTest_ChangedFilterMultipleRunsPerExecution, "System.Mass.Query.ChangedFilterMultipleRunsPerExecution");
+
+struct FQueryTest_ParallelDeferredCommands : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		// enough entities to span multiple chunks, and as such multiple parallel jobs
+		const int32 NumToCreate = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsArchetype) * 8 + 3;
+		TArray<FMassEntityHandle> EntitiesCreated;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, NumToCreate, EntitiesCreated);
+
+		TArray<FMassEntityHandle> ReplayedEntities;
+		FMassExecutionContext ExecContext;
+		ExecContext.SetDeferredCommandBuffer(MakeShareable(new FMassCommandBuffer()));
+		FMassEntityQuery Query({ FTestFragment_Float::StaticStruct() });
+		Query.ParallelForEachEntityChunk(*EntitySubsystem, ExecContext, [&ReplayedEntities](FMassExecutionContext& Context)
+			{
+				for (int32 i = 0; i < Context.GetNumEntities(); ++i)
+				{
+					const FMassEntityHandle Entity = Context.GetEntity(i);
+					Context.Defer().AddTag<FTestTag_A>(Entity);
+					Context.Defer().PushCommand(FDeferredCommand([&ReplayedEntities, Entity](UMassEntitySubsystem&)
+						{
+							ReplayedEntities.Add(Entity);
+						}));
+				}
+			});
+
+		AITEST_EQUAL("All the deferred commands should have been replayed", ReplayedEntities.Num(), NumToCreate);
+		AITEST_TRUE("Commands should be replayed in the same order sequential processing would issue them", ReplayedEntities == EntitiesCreated);
+		AITEST_EQUAL("All the entities should have been moved out of the original archetype", EntitySubsystem->DebugGetArchetypeEntitiesCount(FloatsArchetype), 0);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FQueryTest_ParallelDeferredCommands, "System.Mass.Query.ParallelDeferredCommands");
+
+struct FQueryTest_ParallelScheduling : FEntityTestBase
+{
+	int32 RunQuery(FMassEntityQuery& Query)
+	{
+		std::atomic<int32> Processed{0};
+		FMassExecutionContext ExecContext;
+		Query.ParallelForEachEntityChunk(*EntitySubsystem, ExecContext, [&Processed](FMassExecutionContext& Context)
+			{
+				Processed += Context.GetNumEntities();
+			});
+		return Processed;
+	}
+
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const int32 PerChunk = EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(FloatsArchetype);
+
+		TArray<FMassEntityHandle> Entities;
+		EntitySubsystem->BatchCreateEntities(FloatsArchetype, PerChunk * 6 + 3, Entities);
+
+		// leave only a handful of entities in every other chunk to emulate the small tail chunks left behind by entity removal
+		TArray<FMassEntityHandle> EntitiesToDestroy;
+		for (int32 i = 0; i < Entities.Num(); ++i)
+		{
+			if ((i / PerChunk) % 2 == 1 && (i % PerChunk) >= 8)
+			{
+				EntitiesToDestroy.Add(Entities[i]);
+			}
+		}
+		EntitySubsystem->BatchDestroyEntities(EntitiesToDestroy);
+		const int32 NumEntities = EntitySubsystem->DebugGetArchetypeEntitiesCount(FloatsArchetype);
+
+		FMassEntityQuery Query({ FTestFragment_Float::StaticStruct() });
+		Query.SetParallelExecutionAllowed(true);
+
+		int32 ProcessedPerChunk = 0;
+		{
+			TGuardValue<int32> MinBatchSizeGuard(UE::Mass::Private::ParallelMinBatchSize, 0);
+			TGuardValue<int32> BatchesPerWorkerGuard(UE::Mass::Private::ParallelJobBatchesPerWorker, 0);
+			ProcessedPerChunk = RunQuery(Query);
+		}
+		// forcing multiple entities per batch, with the batches spanning multiple chunks
+		int32 ProcessedBatched = 0;
+		{
+			TGuardValue<int32> MinBatchSizeGuard(UE::Mass::Private::ParallelMinBatchSize, PerChunk / 2);
+			ProcessedBatched = RunQuery(Query);
+		}
+
+		AITEST_EQUAL("One job per chunk should process all the entities", ProcessedPerChunk, NumEntities);
+		AITEST_EQUAL("Batched execution should process all the entities", ProcessedBatched, NumEntities);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FQueryTest_ParallelScheduling, "System.Mass.Query.ParallelScheduling");
+
+struct FQueryTest_IncrementalArchetypeCaching : FEntityTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+		const int32 NumQueries = 20;
+		const int32 NumArchetypes = 40;
+
+		const UScriptStruct* FragmentTypes[] = { FTestFragment_Float::StaticStruct(), FTestFragment_Int::StaticStruct(), FTestFragment_Bool::StaticStruct()
+			, FTestFragment_Location::StaticStruct(), FTestFragment_Velocity::StaticStruct(), FTestFragment_SplitLocation::StaticStruct() };
+		const UScriptStruct* TagTypes[] = { FTestTag_A::StaticStruct(), FTestTag_B::StaticStruct(), FTestTag_C::StaticStruct(), FTestTag_D::StaticStruct() };
+		const int32 NumFragmentTypes = UE_ARRAY_COUNT(FragmentTypes);
+
+		int32 NumMatched[2] = { 0, 0 };
+		for (int32 Mode = 0; Mode < 2; ++Mode)
+		{
+			// every mode gets a fresh entity subsystem
+			SetUp();
+
+			FRandomStream RandomStream(NumQueries);
+			TArray<FMassEntityQuery> Queries;
+			Queries.AddDefaulted(NumQueries);
+			for (FMassEntityQuery& Query : Queries)
+			{
+				const int32 RequiredIndex = RandomStream.RandHelper(NumFragmentTypes);
+				const int32 OptionalIndex = (RequiredIndex + 1 + RandomStream.RandHelper(NumFragmentTypes - 1)) % NumFragmentTypes;
+				Query.AddRequirement(FragmentTypes[RequiredIndex], EMassFragmentAccess::ReadOnly);
+				Query.AddRequirement(FragmentTypes[OptionalIndex], EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+				Query.AddTagRequirement(*TagTypes[RandomStream.RandHelper(UE_ARRAY_COUNT(TagTypes))], EMassFragmentPresence::None);
+				Query.CacheArchetypes(*EntitySubsystem);
+			}
+
+			// creating archetypes one by one, with all the queries re-caching after each, like they would every frame
+			for (int32 ArchetypeIndex = 1; ArchetypeIndex <= NumArchetypes; ++ArchetypeIndex)
+			{
+				TArray<const UScriptStruct*> Composition;
+				for (int32 Bit = 0; Bit < NumFragmentTypes; ++Bit)
+				{
+					if (ArchetypeIndex & (1 << Bit))
+					{
+						Composition.Add(FragmentTypes[Bit]);
+					}
+				}
+				Composition.Add(TagTypes[ArchetypeIndex % UE_ARRAY_COUNT(TagTypes)]);
+				EntitySubsystem->CreateArchetype(Composition);
+
+				if (Mode == 0)
+				{
+					// forcing the full re-caching as the reference
+					EntitySubsystem->DebugForceArchetypeDataVersionBump();
+				}
+				for (FMassEntityQuery& Query : Queries)
+				{
+					Query.CacheArchetypes(*EntitySubsystem);
+				}
+			}
+
+			for (const FMassEntityQuery& Query : Queries)
+			{
+				NumMatched[Mode] += Query.GetArchetypes().Num();
+			}
+		}
+
+		AITEST_TRUE("Some archetypes should have been matched", NumMatched[0] > 0);
+		AITEST_EQUAL("Incremental caching should match the same archetypes as full re-caching", NumMatched[1], NumMatched[0]);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FQueryTest_IncrementalArchetypeCaching, "System.Mass.Query.IncrementalArchetypeCaching");
+#endif // WITH_MASSENTITY_DEBUG
+
 } // FMassQueryTest
 
 PRAGMA_ENABLE_OPTIMIZATION
@@ -0,0 +1,160 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "AITestsCommon.h"
+
+#include "MassEntitySubsystem.h"
+#include "MassEntityTestTypes.h"
+#include "Serialization/MemoryWriter.h"
+
+#define LOCTEXT_NAMESPACE "MassTest"
+
+PRAGMA_DISABLE_OPTIMIZATION
+
+namespace FMassSnapshotTest
+{
+#if WITH_MASSENTITY_DEBUG
+
+struct FSnapshotTestBase : FExecutionTestBase
+{
+	FMassArchetypeCompositionDescriptor Composition;
+	FTestSharedFragment_Snapshot SharedValue;
+	TArray<FMassEntityHandle> SourceEntities;
+	TArray<uint8> SnapshotData;
+
+	virtual bool SetUp() override
+	{
+		FExecutionTestBase::SetUp();
+		check(EntitySubsystem);
+
+		// not plain-old-data due to the default member initializers, but all the members are UPROPERTYs so still stored as raw memory
+		Composition.Fragments.Add<FTestFragment_Float>();
+		Composition.Fragments.Add<FTestFragment_Int>();
+		Composition.Fragments.Add<FTestFragment_EntityRef>();
+		Composition.Tags.Add<FTestTag_A>();
+		Composition.SharedFragments.Add<FTestSharedFragment_Snapshot>();
+		SharedValue.Value = 7;
+
+		FMassArchetypeSharedFragmentValues SharedFragmentValues;
+		SharedFragmentValues.AddConstSharedFragment(EntitySubsystem->GetOrCreateConstSharedFragment(/*Hash=*/SharedValue.Value, SharedValue));
+		SharedFragmentValues.Sort();
+		const FArchetypeHandle Archetype = EntitySubsystem->CreateArchetype(Composition, SharedFragmentValues);
+
+		// spanning multiple chunks, with some gaps left by the destroyed entities
+		EntitySubsystem->BatchCreateEntities(Archetype, EntitySubsystem->DebugGetArchetypeEntitiesCountPerChunk(Archetype) * 2 + 5, SourceEntities);
+		EntitySubsystem->DestroyEntity(SourceEntities[3]);
+		SourceEntities.RemoveAt(3);
+
+		for (int32 i = 0; i < SourceEntities.Num(); ++i)
+		{
+			EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(SourceEntities[i]).Value = float(i) + 0.5f;
+			EntitySubsystem->GetFragmentDataChecked<FTestFragment_Int>(SourceEntities[i]).Value = i;
+			FTestFragment_EntityRef& EntityRef = EntitySubsystem->GetFragmentDataChecked<FTestFragment_EntityRef>(SourceEntities[i]);
+			EntityRef.Entity = SourceEntities[(i + 1) % SourceEntities.Num()];
+			EntityRef.Entities = { SourceEntities[0], FMassEntityHandle(TNumericLimits<int32>::Max(), 1) };
+		}
+
+		FMemoryWriter Writer(SnapshotData);
+		EntitySubsystem->SaveSnapshot(Writer);
+
+		// the snapshot gets loaded into a new subsystem
+		FExecutionTestBase::SetUp();
+		check(EntitySubsystem);
+
+		return true;
+	}
+};
+
+struct FSnapshotTest_RoundTrip : FSnapshotTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		// a value with the same hash registered up front should get reused by the loaded entities
+		FMassArchetypeSharedFragmentValues SharedFragmentValues;
+		SharedFragmentValues.AddConstSharedFragment(EntitySubsystem->GetOrCreateConstSharedFragment(/*Hash=*/SharedValue.Value, SharedValue));
+		SharedFragmentValues.Sort();
+		const FArchetypeHandle ExpectedArchetype = EntitySubsystem->CreateArchetype(Composition, SharedFragmentValues);
+
+		TMap<FMassEntityHandle, FMassEntityHandle> EntityMapping;
+		AITEST_TRUE("The snapshot should load", EntitySubsystem->LoadSnapshot(SnapshotData, &EntityMapping));
+		AITEST_EQUAL("All the entities should have been loaded", EntitySubsystem->DebugGetEntityCount(), SourceEntities.Num());
+		AITEST_EQUAL("Every stored entity should have been mapped", EntityMapping.Num(), SourceEntities.Num());
+
+		for (int32 i = 0; i < SourceEntities.Num(); ++i)
+		{
+			const FMassEntityHandle* Entity = EntityMapping.Find(SourceEntities[i]);
+			AITEST_NOT_NULL("Every stored entity should have been mapped", Entity);
+			AITEST_TRUE("The loaded entities should be valid", EntitySubsystem->IsEntityValid(*Entity));
+			AITEST_TRUE("The loaded entities should reuse the existing archetype", EntitySubsystem->GetArchetypeForEntity(*Entity) == ExpectedArchetype);
+			AITEST_EQUAL("Raw float fragment values should be restored", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Float>(*Entity).Value, float(i) + 0.5f);
+			AITEST_EQUAL("Raw int fragment values should be restored", EntitySubsystem->GetFragmentDataChecked<FTestFragment_Int>(*Entity).Value, i);
+
+			const FTestFragment_EntityRef& EntityRef = EntitySubsystem->GetFragmentDataChecked<FTestFragment_EntityRef>(*Entity);
+			AITEST_TRUE("Entity handles should be remapped", EntityRef.Entity == EntityMapping.FindChecked(SourceEntities[(i + 1) % SourceEntities.Num()]));
+			AITEST_EQUAL("Entity handle arrays should be restored", EntityRef.Entities.Num(), 2);
+			AITEST_TRUE("Entity handles within arrays should be remapped", EntityRef.Entities[0] == EntityMapping.FindChecked(SourceEntities[0]));
+			AITEST_FALSE("Entity handles pointing outside of the snapshot should be reset", EntityRef.Entities[1].IsSet());
+		}
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FSnapshotTest_RoundTrip, "System.Mass.Snapshot.RoundTrip");
+
+struct FSnapshotTest_Truncated : FSnapshotTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		const int32 NumArchetypes = EntitySubsystem->DebugGetArchetypesCount();
+		SnapshotData.SetNum(SnapshotData.Num() - 1);
+		GetTestRunner().AddExpectedError(TEXT("the snapshot data is corrupted or incomplete"), EAutomationExpectedErrorFlags::Contains, 1);
+		AITEST_FALSE("A truncated snapshot should fail to load", EntitySubsystem->LoadSnapshot(SnapshotData));
+		AITEST_EQUAL("No entities should have been created", EntitySubsystem->DebugGetEntityCount(), 0);
+		AITEST_EQUAL("No archetypes should have been created", EntitySubsystem->DebugGetArchetypesCount(), NumArchetypes);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FSnapshotTest_Truncated, "System.Mass.Snapshot.Truncated");
+
+struct FSnapshotTest_NativeMembers : FExecutionTestBase
+{
+	virtual bool InstantTest() override
+	{
+		CA_ASSUME(EntitySubsystem);
+
+		const UScriptStruct* FragmentTypes[] = { FTestFragment_NativeArray::StaticStruct() };
+		const FArchetypeHandle Archetype = EntitySubsystem->CreateArchetype(FragmentTypes);
+		const FMassEntityHandle SourceEntity = EntitySubsystem->CreateEntity(Archetype);
+		FTestFragment_NativeArray& SourceFragment = EntitySubsystem->GetFragmentDataChecked<FTestFragment_NativeArray>(SourceEntity);
+		SourceFragment.Value = 3;
+		SourceFragment.NativeValues = { 1, 2, 3 };
+
+		TArray<uint8> SnapshotData;
+		FMemoryWriter Writer(SnapshotData);
+		GetTestRunner().AddExpectedError(TEXT("has members that are not UPROPERTYs"), EAutomationExpectedErrorFlags::Contains, 1);
+		EntitySubsystem->SaveSnapshot(Writer);
+
+		// loading into the same subsystem, a raw copy would make both entities share the array's allocation
+		TMap<FMassEntityHandle, FMassEntityHandle> EntityMapping;
+		AITEST_TRUE("The snapshot should load", EntitySubsystem->LoadSnapshot(SnapshotData, &EntityMapping));
+		const FTestFragment_NativeArray& LoadedFragment = EntitySubsystem->GetFragmentDataChecked<FTestFragment_NativeArray>(EntityMapping.FindChecked(SourceEntity));
+		AITEST_EQUAL("The UPROPERTY should be restored", LoadedFragment.Value, 3);
+		AITEST_EQUAL("The native array should not be stored", LoadedFragment.NativeValues.Num(), 0);
+		AITEST_EQUAL("The source entity's array should be intact", EntitySubsystem->GetFragmentDataChecked<FTestFragment_NativeArray>(SourceEntity).NativeValues.Num(), 3);
+
+		return true;
+	}
+};
+IMPLEMENT_AI_INSTANT_TEST(FSnapshotTest_NativeMembers, "System.Mass.Snapshot.NativeMembers");
+
+#endif // WITH_MASSENTITY_DEBUG
+} // FMassSnapshotTest
+
+PRAGMA_ENABLE_OPTIMIZATION
+
+#undef LOCTEXT_NAMESPACE
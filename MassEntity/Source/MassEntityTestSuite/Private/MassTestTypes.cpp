@@ -3,7 +3,140 @@
 #include "MassEntityTestTypes.h"
 #include "MassEntitySubsystem.h"
 #include "MassExecutor.h"
+#include "MassObserverRegistry.h"
 #include "Engine/World.h"
+//----------------------------------------------------------------------//
+// UMassTestObserverBase
+//----------------------------------------------------------------------//
+UMassTestObserverBase::UMassTestObserverBase()
+	: EntityQuery(*this)
+{
+	ExecutionFlags = int32(EProcessorExecutionFlags::All);
+}
+
+void UMassTestObserverBase::Register()
+{
+	check(FragmentType);
+	if (bObservesRemoval)
+	{
+		UMassObserverRegistry::GetMutable().RegisterFragmentDeinitializer(*FragmentType, GetClass());
+	}
+	else
+	{
+		UMassObserverRegistry::GetMutable().RegisterFragmentInitializer(*FragmentType, GetClass());
+	}
+}
+
+void UMassTestObserverBase::Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context)
+{
+	check(ObservedCounters);
+	EntityQuery.ForEachEntityChunk(EntitySubsystem, Context, [this](FMassExecutionContext& Context)
+		{
+			++ObservedCounters->NumChunksProcessed;
+			ObservedCounters->NumEntitiesProcessed += Context.GetNumEntities();
+			ProcessChunk(Context);
+		});
+}
+
+//----------------------------------------------------------------------//
+// UMassTestFragmentInitializer_Observed
+//----------------------------------------------------------------------//
+FMassTestObserverCounters UMassTestFragmentInitializer_Observed::Counters;
+
+UMassTestFragmentInitializer_Observed::UMassTestFragmentInitializer_Observed()
+{
+	FragmentType = FTestFragment_Observed::StaticStruct();
+	ObservedCounters = &Counters;
+}
+
+void UMassTestFragmentInitializer_Observed::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTestFragment_Observed>(EMassFragmentAccess::ReadWrite);
+}
+
+void UMassTestFragmentInitializer_Observed::ProcessChunk(FMassExecutionContext& Context)
+{
+	for (FTestFragment_Observed& Observed : Context.GetMutableFragmentView<FTestFragment_Observed>())
+	{
+		++Observed.Value;
+	}
+}
+
+//----------------------------------------------------------------------//
+// UMassTestFragmentDeinitializer_Observed
+//----------------------------------------------------------------------//
+FMassTestObserverCounters UMassTestFragmentDeinitializer_Observed::Counters;
+
+UMassTestFragmentDeinitializer_Observed::UMassTestFragmentDeinitializer_Observed()
+{
+	FragmentType = FTestFragment_ObservedRemoval::StaticStruct();
+	ObservedCounters = &Counters;
+	bObservesRemoval = true;
+}
+
+void UMassTestFragmentDeinitializer_Observed::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTestFragment_ObservedRemoval>(EMassFragmentAccess::ReadOnly);
+}
+
+//----------------------------------------------------------------------//
+// UMassTestTagInitializer_Observed
+//----------------------------------------------------------------------//
+FMassTestObserverCounters UMassTestTagInitializer_Observed::Counters;
+
+UMassTestTagInitializer_Observed::UMassTestTagInitializer_Observed()
+{
+	FragmentType = FTestTag_Observed::StaticStruct();
+	ObservedCounters = &Counters;
+}
+
+void UMassTestTagInitializer_Observed::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddTagRequirement<FTestTag_Observed>(EMassFragmentPresence::All);
+}
+
+//----------------------------------------------------------------------//
+// UMassTestTagDeinitializer_Observed
+//----------------------------------------------------------------------//
+FMassTestObserverCounters UMassTestTagDeinitializer_Observed::Counters;
+
+UMassTestTagDeinitializer_Observed::UMassTestTagDeinitializer_Observed()
+{
+	FragmentType = FTestTag_Observed::StaticStruct();
+	ObservedCounters = &Counters;
+	bObservesRemoval = true;
+}
+
+void UMassTestTagDeinitializer_Observed::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddTagRequirement<FTestTag_Observed>(EMassFragmentPresence::All);
+}
+
+//----------------------------------------------------------------------//
+// UMassTestSharedFragmentObserver
+//----------------------------------------------------------------------//
+FMassTestObserverCounters UMassTestSharedFragmentObserver::Counters;
+int32 UMassTestSharedFragmentObserver::LastSeenValue = 0;
+
+UMassTestSharedFragmentObserver::UMassTestSharedFragmentObserver()
+{
+	FragmentType = FTestSharedFragment_Observed::StaticStruct();
+	ObservedCounters = &Counters;
+}
+
+void UMassTestSharedFragmentObserver::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddConstSharedRequirement<FTestSharedFragment_Observed>();
+}
+
+void UMassTestSharedFragmentObserver::ProcessChunk(FMassExecutionContext& Context)
+{
+	LastSeenValue = Context.GetConstSharedFragment<FTestSharedFragment_Observed>().Value;
+}
+
 namespace FTestHelpers
 {
 	UWorld* GetWorld()
@@ -60,6 +193,7 @@ bool FEntityTestBase::SetUp()
 // Processors 
 //----------------------------------------------------------------------//
 UMassTestProcessorBase::UMassTestProcessorBase()
+	: EntityQuery(*this)
 {
 #if WITH_EDITORONLY_DATA
 	bCanShowUpInSettings = false;
@@ -94,4 +228,104 @@ UMassTestProcessor_FloatsInts::UMassTestProcessor_FloatsInts()
 		EntityQuery.AddRequirement<FTestFragment_Float>(EMassFragmentAccess::ReadWrite);
 		EntityQuery.AddRequirement<FTestFragment_Int>(EMassFragmentAccess::ReadWrite);
 	};
-}
\ No newline at end of file
+}
+
+void UMassTestProcessor_AoSMovement::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTestFragment_Location>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FTestFragment_Velocity>(EMassFragmentAccess::ReadOnly);
+}
+
+void UMassTestProcessor_AoSMovement::Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context)
+{
+	EntityQuery.ForEachEntityChunk(EntitySubsystem, Context, [](FMassExecutionContext& Context)
+		{
+			const float DeltaTime = Context.GetDeltaTimeSeconds();
+			const TArrayView<FTestFragment_Location> Locations = Context.GetMutableFragmentView<FTestFragment_Location>();
+			const TConstArrayView<FTestFragment_Velocity> Velocities = Context.GetFragmentView<FTestFragment_Velocity>();
+			for (int32 i = 0; i < Context.GetNumEntities(); ++i)
+			{
+				Locations[i].Value += Velocities[i].Value * DeltaTime;
+			}
+		});
+}
+
+namespace
+{
+	/** Locations[i] += Velocities[i] * DeltaTime, four values at a time */
+	void IntegrateComponent(const TArrayView<float> Locations, const TConstArrayView<float> Velocities, const float DeltaTime)
+	{
+		check(Locations.Num() == Velocities.Num());
+		const VectorRegister4Float DeltaTimeVector = VectorSetFloat1(DeltaTime);
+		const int32 NumVectorized = Locations.Num() & ~3;
+
+		float* LocationsData = Locations.GetData();
+		const float* VelocitiesData = Velocities.GetData();
+		int32 i = 0;
+		for (; i < NumVectorized; i += 4)
+		{
+			VectorStore(VectorMultiplyAdd(VectorLoad(VelocitiesData + i), DeltaTimeVector, VectorLoad(LocationsData + i)), LocationsData + i);
+		}
+		for (; i < Locations.Num(); ++i)
+		{
+			LocationsData[i] += VelocitiesData[i] * DeltaTime;
+		}
+	}
+}
+
+void UMassTestProcessor_SoAMovement::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTestFragment_SplitLocation>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FTestFragment_SplitVelocity>(EMassFragmentAccess::ReadOnly);
+}
+
+void UMassTestProcessor_SoAMovement::Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context)
+{
+	EntityQuery.ForEachEntityChunk(EntitySubsystem, Context, [](FMassExecutionContext& Context)
+		{
+			const float DeltaTime = Context.GetDeltaTimeSeconds();
+			IntegrateComponent(Context.GetMutableFragmentValues(&FTestFragment_SplitLocation::X), Context.GetFragmentValues(&FTestFragment_SplitVelocity::X), DeltaTime);
+			IntegrateComponent(Context.GetMutableFragmentValues(&FTestFragment_SplitLocation::Y), Context.GetFragmentValues(&FTestFragment_SplitVelocity::Y), DeltaTime);
+			IntegrateComponent(Context.GetMutableFragmentValues(&FTestFragment_SplitLocation::Z), Context.GetFragmentValues(&FTestFragment_SplitVelocity::Z), DeltaTime);
+		});
+}
+
+//----------------------------------------------------------------------//
+// UMassTestProcessor_CommandLog
+//----------------------------------------------------------------------//
+TArray<FName> UMassTestProcessor_CommandLog::CommandLog;
+std::atomic<int32> UMassTestProcessor_CommandLog::NumGameThreadExecutions{0};
+std::atomic<int32> UMassTestProcessor_CommandLog::NumConcurrentExecutionsObserved{0};
+
+void UMassTestProcessor_CommandLog::ResetLogs()
+{
+	CommandLog.Reset();
+	NumGameThreadExecutions = 0;
+	NumConcurrentExecutionsObserved = 0;
+}
+
+void UMassTestProcessor_CommandLog::Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context)
+{
+	if (bWaitForGameThreadExecution)
+	{
+		// giving up eventually, so that a processor blocking the game thread fails the test rather than hangs it
+		const double TimeLimit = FPlatformTime::Seconds() + 2.;
+		while (NumGameThreadExecutions.load() == 0 && FPlatformTime::Seconds() < TimeLimit)
+		{
+			FPlatformProcess::Yield();
+		}
+		if (NumGameThreadExecutions.load() > 0)
+		{
+			++NumConcurrentExecutionsObserved;
+		}
+	}
+	else if (IsInGameThread())
+	{
+		++NumGameThreadExecutions;
+	}
+
+	Context.Defer().PushCommand(FDeferredCommand([ProcessorName = GetClass()->GetFName()](UMassEntitySubsystem& System)
+		{
+			CommandLog.Add(ProcessorName);
+		}));
+}
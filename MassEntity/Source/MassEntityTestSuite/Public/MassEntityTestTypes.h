@@ -3,6 +3,7 @@
 #pragma once
 
 #include "MassProcessor.h"
+#include "MassObserverProcessor.h"
 #include "MassEntityTypes.h"
 #include "MassEntitySubsystem.h"
 #include "AITestsCommon.h"
@@ -16,6 +17,7 @@ USTRUCT()
 struct FTestFragment_Float : public FMassFragment
 {
 	GENERATED_BODY()
+	UPROPERTY()
 	float Value = 0;
 };
 
@@ -23,6 +25,7 @@ USTRUCT()
 struct FTestFragment_Int : public FMassFragment
 {
 	GENERATED_BODY()
+	UPROPERTY()
 	int32 Value = 0;
 };
 
@@ -33,6 +36,110 @@ struct FTestFragment_Bool : public FMassFragment
 	bool bValue = false;
 };
 
+USTRUCT()
+struct FTestFragment_Location : public FMassFragment
+{
+	GENERATED_BODY()
+	FVector3f Value = FVector3f::ZeroVector;
+};
+
+USTRUCT()
+struct FTestFragment_Velocity : public FMassFragment
+{
+	GENERATED_BODY()
+	FVector3f Value = FVector3f::ZeroVector;
+};
+
+/** Location stored as split, per-component sub-columns, resulting in SoA data layout */
+USTRUCT()
+struct FTestFragment_SplitLocation : public FMassSplitFragment
+{
+	GENERATED_BODY()
+	UPROPERTY()
+	float X = 0.f;
+	UPROPERTY()
+	float Y = 0.f;
+	UPROPERTY()
+	float Z = 0.f;
+};
+
+USTRUCT()
+struct FTestFragment_SplitVelocity : public FMassSplitFragment
+{
+	GENERATED_BODY()
+	UPROPERTY()
+	float X = 0.f;
+	UPROPERTY()
+	float Y = 0.f;
+	UPROPERTY()
+	float Z = 0.f;
+};
+
+/** Only used by the observer tests, UMassTestFragmentInitializer_Observed gets run whenever it's added to an entity */
+USTRUCT()
+struct FTestFragment_Observed : public FMassFragment
+{
+	GENERATED_BODY()
+	int32 Value = 0;
+};
+
+/** Only used by the observer tests, UMassTestFragmentDeinitializer_Observed gets run whenever it's about to be removed from an entity */
+USTRUCT()
+struct FTestFragment_ObservedRemoval : public FMassFragment
+{
+	GENERATED_BODY()
+	int32 Value = 0;
+};
+
+/** Only used by the observer tests, gets observed for addition and removal */
+USTRUCT()
+struct FTestTag_Observed : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+/** Only used by the observer tests, UMassTestSharedFragmentObserver gets run whenever entities get a new value of it */
+USTRUCT()
+struct FTestSharedFragment_Observed : public FMassSharedFragment
+{
+	GENERATED_BODY()
+	int32 Value = 0;
+};
+
+/** Only used by the snapshot tests, the handles get remapped when a snapshot gets loaded */
+USTRUCT()
+struct FTestFragment_EntityRef : public FMassFragment
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FMassEntityHandle Entity;
+
+	UPROPERTY()
+	TArray<FMassEntityHandle> Entities;
+};
+
+/** Only used by the snapshot tests, only Value gets stored since the native array can't be stored as raw memory */
+USTRUCT()
+struct FTestFragment_NativeArray : public FMassFragment
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Value = 0;
+
+	TArray<int32> NativeValues;
+};
+
+USTRUCT()
+struct FTestSharedFragment_Snapshot : public FMassSharedFragment
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Value = 0;
+};
+
 /** @todo rename to FTestTag */
 USTRUCT()
 struct FTestFragment_Tag : public FMassTag
@@ -154,6 +261,192 @@ public:
 	UMassTestProcessor_FloatsInts();
 };
 
+/** Integrates FTestFragment_Velocity into FTestFragment_Location, one entity at a time */
+UCLASS()
+class UMassTestProcessor_AoSMovement : public UMassTestProcessorBase
+{
+	GENERATED_BODY()
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context) override;
+};
+
+/**
+ * Issues a deferred command appending the processor's class name to CommandLog, to test the order in which composite 
+ * processors merge the commands of their child nodes. With bWaitForGameThreadExecution set it first waits for another 
+ * processor to get executed on the game thread, to test whether the processor runs concurrently with it.
+ */
+UCLASS(abstract)
+class UMassTestProcessor_CommandLog : public UMassTestProcessorBase
+{
+	GENERATED_BODY()
+public:
+	static void ResetLogs();
+
+	/** Class names of the processors, in the order their commands got replayed */
+	static TArray<FName> CommandLog;
+	/** Number of executions on the game thread of the processors not waiting for one */
+	static std::atomic<int32> NumGameThreadExecutions;
+	/** Number of the waiting processors that saw a game thread execution while they were running */
+	static std::atomic<int32> NumConcurrentExecutionsObserved;
+
+	UPROPERTY()
+	bool bWaitForGameThreadExecution = false;
+
+protected:
+	virtual void Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context) override;
+};
+
+UCLASS()
+class UMassTestProcessor_CommandLogA : public UMassTestProcessor_CommandLog
+{
+	GENERATED_BODY()
+};
+
+UCLASS()
+class UMassTestProcessor_CommandLogB : public UMassTestProcessor_CommandLog
+{
+	GENERATED_BODY()
+};
+
+UCLASS()
+class UMassTestProcessor_CommandLogC : public UMassTestProcessor_CommandLog
+{
+	GENERATED_BODY()
+};
+
+UCLASS()
+class UMassTestProcessor_CommandLogD : public UMassTestProcessor_CommandLog
+{
+	GENERATED_BODY()
+};
+
+/** 
+ * Integrates FTestFragment_SplitVelocity into FTestFragment_SplitLocation. Every component is stored in a separate, 
+ * contiguous sub-column so the integration is done for four entities at a time with SIMD instructions.
+ */
+UCLASS()
+class UMassTestProcessor_SoAMovement : public UMassTestProcessorBase
+{
+	GENERATED_BODY()
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context) override;
+};
+
+/** The chunks and entities a UMassTestObserverBase subclass got run for */
+struct FMassTestObserverCounters
+{
+	int32 NumChunksProcessed = 0;
+	int32 NumEntitiesProcessed = 0;
+
+	void Reset()
+	{
+		NumChunksProcessed = 0;
+		NumEntitiesProcessed = 0;
+	}
+};
+
+/**
+ * Base of the observers used by the observer tests. Counts the chunks and entities it gets run for whenever FragmentType
+ * gets added to entities or, with bObservesRemoval set, is about to be removed from them.
+ */
+UCLASS(abstract)
+class UMassTestObserverBase : public UMassObserverProcessor
+{
+	GENERATED_BODY()
+public:
+	UMassTestObserverBase();
+
+protected:
+	virtual void Register() override;
+	virtual void Execute(UMassEntitySubsystem& EntitySubsystem, FMassExecutionContext& Context) override;
+
+	/** Called for every chunk the observer gets run for, after it has been counted */
+	virtual void ProcessChunk(FMassExecutionContext& Context) {}
+
+	FMassEntityQuery EntityQuery;
+
+	/** Set by the subclasses, points to their static counters */
+	FMassTestObserverCounters* ObservedCounters = nullptr;
+
+	bool bObservesRemoval = false;
+};
+
+/** Counts the chunks and entities it gets run for whenever FTestFragment_Observed gets added to entities, and increments their values */
+UCLASS()
+class UMassTestFragmentInitializer_Observed : public UMassTestObserverBase
+{
+	GENERATED_BODY()
+public:
+	UMassTestFragmentInitializer_Observed();
+
+	static FMassTestObserverCounters Counters;
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void ProcessChunk(FMassExecutionContext& Context) override;
+};
+
+/** Counts the chunks and entities it gets run for whenever FTestFragment_ObservedRemoval is about to be removed from entities */
+UCLASS()
+class UMassTestFragmentDeinitializer_Observed : public UMassTestObserverBase
+{
+	GENERATED_BODY()
+public:
+	UMassTestFragmentDeinitializer_Observed();
+
+	static FMassTestObserverCounters Counters;
+
+protected:
+	virtual void ConfigureQueries() override;
+};
+
+/** Counts the chunks and entities it gets run for whenever FTestTag_Observed gets added to entities */
+UCLASS()
+class UMassTestTagInitializer_Observed : public UMassTestObserverBase
+{
+	GENERATED_BODY()
+public:
+	UMassTestTagInitializer_Observed();
+
+	static FMassTestObserverCounters Counters;
+
+protected:
+	virtual void ConfigureQueries() override;
+};
+
+/** Counts the chunks and entities it gets run for whenever FTestTag_Observed is about to be removed from entities */
+UCLASS()
+class UMassTestTagDeinitializer_Observed : public UMassTestObserverBase
+{
+	GENERATED_BODY()
+public:
+	UMassTestTagDeinitializer_Observed();
+
+	static FMassTestObserverCounters Counters;
+
+protected:
+	virtual void ConfigureQueries() override;
+};
+
+/** Counts the chunks and entities it gets run for whenever entities get a new FTestSharedFragment_Observed value */
+UCLASS()
+class UMassTestSharedFragmentObserver : public UMassTestObserverBase
+{
+	GENERATED_BODY()
+public:
+	UMassTestSharedFragmentObserver();
+
+	static FMassTestObserverCounters Counters;
+	/** The shared fragment value seen in the last processed chunk */
+	static int32 LastSeenValue;
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void ProcessChunk(FMassExecutionContext& Context) override;
+};
+
 struct FExecutionTestBase : FAITestBase
 {
 	UMassEntitySubsystem* EntitySubsystem = nullptr;
@@ -4,6 +4,7 @@
 
 #include "UObject/Class.h"
 #include "Containers/BitArray.h"
+#include "Math/VectorRegister.h"
 #include "InstancedStruct.h"
 #include "StructUtilsTypes.h"
 #include "WordIterator.h"
@@ -102,43 +103,55 @@ private:
 			return *this;
 		}
 
-		FORCEINLINE bool HasAll(const TBitArray<>& Other) const
+		/**
+		 * The bitwise queries below process the bits 128 at a time with SIMD for as long as both bit arrays have full 
+		 * 128-bit blocks, and 64 bits at a time for the remainder. The bits past an array's Num() are treated as 0.
+		 * Note that the default TBitArray allocator keeps the first 128 bits inline, so the common case of fewer than 
+		 * 128 struct types being tracked doesn't touch the heap at all.
+		 */
+		FORCEINLINE bool HasAll(const FBitArrayExt& Other) const
 		{
-			FConstWordIterator ThisIterator(*this);
-			FConstWordIterator OtherIterator(Other);
-
-			while (ThisIterator || OtherIterator)
+			const int32 NumBlocks = GetNumCommonBlocks(Other);
+			for (int32 BlockIndex = 0; BlockIndex < NumBlocks; ++BlockIndex)
 			{
-				const uint32 A = ThisIterator ? ThisIterator.GetWord() : 0;
-				const uint32 B = OtherIterator ? OtherIterator.GetWord() : 0;
-				if ((A & B) != B)
+				// (~A & B) holds the bits of B missing from A
+				if (!IsZero(VectorIntAndNot(LoadBlock(BlockIndex), Other.LoadBlock(BlockIndex))))
 				{
 					return false;
 				}
+			}
 
-				++ThisIterator;
-				++OtherIterator;
+			const int32 OtherNumWords = Other.GetNumWords64();
+			for (int32 WordIndex = NumBlocks * WordsPerBlock; WordIndex < OtherNumWords; ++WordIndex)
+			{
+				const uint64 B = Other.GetWord64(WordIndex);
+				if ((GetWord64(WordIndex) & B) != B)
+				{
+					return false;
+				}
 			}
 
 			return true;
 		}
 
-		FORCEINLINE bool HasAny(const TBitArray<>& Other) const
+		FORCEINLINE bool HasAny(const FBitArrayExt& Other) const
 		{
-			FConstWordIterator ThisIterator(*this);
-			FConstWordIterator OtherIterator(Other);
-
-			while (ThisIterator || OtherIterator)
+			const int32 NumBlocks = GetNumCommonBlocks(Other);
+			for (int32 BlockIndex = 0; BlockIndex < NumBlocks; ++BlockIndex)
 			{
-				const uint32 A = ThisIterator ? ThisIterator.GetWord() : 0;
-				const uint32 B = OtherIterator ? OtherIterator.GetWord() : 0;
-				if ((A & B) != 0)
+				if (!IsZero(VectorIntAnd(LoadBlock(BlockIndex), Other.LoadBlock(BlockIndex))))
 				{
 					return true;
 				}
+			}
 
-				++ThisIterator;
-				++OtherIterator;
+			const int32 NumWords = FMath::Min(GetNumWords64(), Other.GetNumWords64());
+			for (int32 WordIndex = NumBlocks * WordsPerBlock; WordIndex < NumWords; ++WordIndex)
+			{
+				if ((GetWord64(WordIndex) & Other.GetWord64(WordIndex)) != 0)
+				{
+					return true;
+				}
 			}
 
 			return false;
@@ -146,14 +159,49 @@ private:
 
 		FORCEINLINE bool IsEmpty() const
 		{
-			FConstWordIterator Iterator(*this);
+			const int32 NumBlocks = Num() / NumBitsPerBlock;
+			for (int32 BlockIndex = 0; BlockIndex < NumBlocks; ++BlockIndex)
+			{
+				if (!IsZero(LoadBlock(BlockIndex)))
+				{
+					return false;
+				}
+			}
 
-			while (Iterator && Iterator.GetWord() == 0)
+			const int32 NumWords = GetNumWords64();
+			for (int32 WordIndex = NumBlocks * WordsPerBlock; WordIndex < NumWords; ++WordIndex)
 			{
-				++Iterator;
+				if (GetWord64(WordIndex) != 0)
+				{
+					return false;
+				}
 			}
 
-			return !Iterator;
+			return true;
+		}
+
+		/** @return whether both bit arrays have the same bits set, regardless of their Num() */
+		FORCEINLINE bool IsEquivalent(const FBitArrayExt& Other) const
+		{
+			const int32 NumBlocks = GetNumCommonBlocks(Other);
+			for (int32 BlockIndex = 0; BlockIndex < NumBlocks; ++BlockIndex)
+			{
+				if (!IsZero(VectorIntXor(LoadBlock(BlockIndex), Other.LoadBlock(BlockIndex))))
+				{
+					return false;
+				}
+			}
+
+			const int32 NumWords = FMath::Max(GetNumWords64(), Other.GetNumWords64());
+			for (int32 WordIndex = NumBlocks * WordsPerBlock; WordIndex < NumWords; ++WordIndex)
+			{
+				if (GetWord64(WordIndex) != Other.GetWord64(WordIndex))
+				{
+					return false;
+				}
+			}
+
+			return true;
 		}
 
 		FORCEINLINE void operator-=(const TBitArray<>& Other)
@@ -172,22 +220,17 @@ private:
 
 		FORCEINLINE friend uint32 GetTypeHash(const FBitArrayExt& Instance)
 		{
-			FConstWordIterator Iterator(Instance);
+			// trailing 0-words are skipped so that equivalent bit arrays (see IsEquivalent) hash the same regardless of their Num()
+			int32 NumWords = Instance.GetNumWords64();
+			while (NumWords > 0 && Instance.GetWord64(NumWords - 1) == 0)
+			{
+				--NumWords;
+			}
+
 			uint32 Hash = 0;
-			uint32 TrailingZeroHash = 0;
-			while (Iterator)
+			for (int32 WordIndex = 0; WordIndex < NumWords; ++WordIndex)
 			{
-				const uint32 Word = Iterator.GetWord();
-				if (Word)
-				{
-					Hash = HashCombine(TrailingZeroHash ? TrailingZeroHash : Hash, Word);
-					TrailingZeroHash = 0;
-				}
-				else // potentially a trailing 0-word
-				{
-					TrailingZeroHash = HashCombine(TrailingZeroHash ? TrailingZeroHash : Hash, Word);
-				}
-				++Iterator;
+				Hash = HashCombine(Hash, GetTypeHash(Instance.GetWord64(WordIndex)));
 			}
 			return Hash;
 		}
@@ -215,6 +258,48 @@ private:
 		}
 
 	protected:
+		static constexpr int32 NumBitsPerBlock = 128;
+		static constexpr int32 WordsPerBlock = NumBitsPerBlock / 64;
+
+		FORCEINLINE int32 GetNumWords64() const
+		{
+			return FMath::DivideAndRoundUp(Num(), 64);
+		}
+
+		/** @return the number of 128-bit blocks fully within both this and Other */
+		FORCEINLINE int32 GetNumCommonBlocks(const FBitArrayExt& Other) const
+		{
+			return FMath::Min(Num(), Other.Num()) / NumBitsPerBlock;
+		}
+
+		/** Loads the BlockIndex-th 128 bits. Expects the whole block to be within Num(). */
+		FORCEINLINE VectorRegister4Int LoadBlock(const int32 BlockIndex) const
+		{
+			checkSlow((BlockIndex + 1) * NumBitsPerBlock <= Num());
+			return VectorIntLoad(GetData() + BlockIndex * (NumBitsPerBlock / NumBitsPerDWORD));
+		}
+
+		FORCEINLINE static bool IsZero(const VectorRegister4Int& Vector)
+		{
+			return VectorMaskBits(VectorCastIntToFloat(VectorIntCompareEQ(Vector, GlobalVectorConstants::IntZero))) == 0xF;
+		}
+
+		/** @return the WordIndex-th 64 bits, with the bits past Num() set to 0 */
+		FORCEINLINE uint64 GetWord64(const int32 WordIndex) const
+		{
+			const int32 FirstBitIndex = WordIndex * 64;
+			const int32 NumValidBits = Num() - FirstBitIndex;
+			if (NumValidBits <= 0)
+			{
+				return 0;
+			}
+
+			// the storage is made of 32-bit words, reading the upper half only if it's in use
+			const uint32* Data = GetData() + WordIndex * 2;
+			const uint64 Word = NumValidBits > NumBitsPerDWORD ? (uint64(Data[0]) | (uint64(Data[1]) << 32)) : uint64(Data[0]);
+			return NumValidBits >= 64 ? Word : (Word & ((uint64(1) << NumValidBits) - 1));
+		}
+
 		/**
 		 * duplication of TBitArray::SetBitNoCheck needed since it's private but it's the performant way of setting bits
 		 * when we know the index is valid.
@@ -420,7 +505,7 @@ public:
 
 	FORCEINLINE bool IsEquivalent(const TScriptStructTypeBitSet<TBaseStruct>& Other) const
 	{
-		return StructTypesBitArray.CompareSetBits(Other.StructTypesBitArray, /*bMissingBitValue=*/false);
+		return StructTypesBitArray.IsEquivalent(Other.StructTypesBitArray);
 	}
 
 	FORCEINLINE bool HasAll(const TScriptStructTypeBitSet& Other) const
@@ -38,8 +38,82 @@ struct FTestStructBitSet : public TScriptStructTypeBitSet<FTestStructSimple>
 	{
 		return Index >= 0 && Index < DebugGetStructTypesBitArray().Num() && DebugGetStructTypesBitArray()[Index];
 	}
+
+	const TBitArray<>& GetBitArray() const { return DebugGetStructTypesBitArray(); }
 };
 
+/** Straightforward implementations of the bit set queries, used as reference for the optimized ones */
+namespace Reference
+{
+	bool TestBit(const TBitArray<>& Bits, const int32 Index)
+	{
+		return Index < Bits.Num() && Bits[Index];
+	}
+
+	bool HasAll(const TBitArray<>& A, const TBitArray<>& B)
+	{
+		for (int32 Index = 0; Index < B.Num(); ++Index)
+		{
+			if (B[Index] && !TestBit(A, Index))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool HasAny(const TBitArray<>& A, const TBitArray<>& B)
+	{
+		for (int32 Index = 0; Index < B.Num(); ++Index)
+		{
+			if (B[Index] && TestBit(A, Index))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool IsEquivalent(const TBitArray<>& A, const TBitArray<>& B)
+	{
+		for (int32 Index = 0; Index < FMath::Max(A.Num(), B.Num()); ++Index)
+		{
+			if (TestBit(A, Index) != TestBit(B, Index))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+/** Fills OutBitSets with random bit sets of random lengths, spanning multiple 128-bit blocks to test both the SIMD and the 64-bit word paths. */
+void MakeRandomBitSets(FRandomStream& RandomStream, TArray<FTestStructBitSet>& OutBitSets)
+{
+	constexpr int32 NumBitSets = 200;
+	constexpr int32 MaxBits = 300;
+	constexpr float Density = 0.05f;
+
+	OutBitSets.SetNum(NumBitSets);
+	for (FTestStructBitSet& BitSet : OutBitSets)
+	{
+		const int32 NumBits = RandomStream.RandRange(0, MaxBits);
+		for (int32 Index = 0; Index < NumBits; ++Index)
+		{
+			if (RandomStream.FRand() < Density)
+			{
+				BitSet.AddBit(Index);
+			}
+		}
+		// some trailing 0-bits, the way removing types leaves them behind
+		if (NumBits > 0 && RandomStream.FRand() < 0.25f)
+		{
+			BitSet.AddBit(NumBits - 1);
+			BitSet.RemoveBit(NumBits - 1);
+		}
+	}
+}
+
 struct FStructUtilsTest_BitSetEquivalence : FAITestBase
 {
 	virtual bool InstantTest() override
@@ -243,6 +317,41 @@ struct FStructUtilsTest_BitSetHash : FAITestBase
 
 IMPLEMENT_AI_INSTANT_TEST(FStructUtilsTest_BitSetHash, "System.StructUtils.BitSet.Hash");
 
+struct FStructUtilsTest_BitSetRandomized : FAITestBase
+{
+	virtual bool InstantTest() override
+	{
+		FRandomStream RandomStream(0x5EED);
+		TArray<FTestStructBitSet> BitSets;
+		MakeRandomBitSets(RandomStream, BitSets);
+
+		for (const FTestStructBitSet& A : BitSets)
+		{
+			AITEST_EQUAL("IsEmpty should match the reference", A.IsEmpty(), !Reference::HasAny(A.GetBitArray(), A.GetBitArray()));
+			for (const FTestStructBitSet& B : BitSets)
+			{
+				AITEST_EQUAL("HasAll should match the reference", A.HasAll(B), Reference::HasAll(A.GetBitArray(), B.GetBitArray()));
+				AITEST_EQUAL("HasAny should match the reference", A.HasAny(B), Reference::HasAny(A.GetBitArray(), B.GetBitArray()));
+				AITEST_EQUAL("HasNone should match the reference", A.HasNone(B), !Reference::HasAny(A.GetBitArray(), B.GetBitArray()));
+				const bool bEquivalent = Reference::IsEquivalent(A.GetBitArray(), B.GetBitArray());
+				AITEST_EQUAL("IsEquivalent should match the reference", A.IsEquivalent(B), bEquivalent);
+				if (bEquivalent)
+				{
+					AITEST_EQUAL("Equivalent bit sets should have identical hashes", GetTypeHash(A), GetTypeHash(B));
+				}
+			}
+
+			// the union contains both sets, regardless of their lengths
+			const FTestStructBitSet Union = A + BitSets[0];
+			AITEST_TRUE("The union should contain both sets", Union.HasAll(A) && Union.HasAll(BitSets[0]));
+		}
+
+		return true;
+	}
+};
+
+IMPLEMENT_AI_INSTANT_TEST(FStructUtilsTest_BitSetRandomized, "System.StructUtils.BitSet.Randomized");
+
 } // namespace FScriptStructTypeBitSetTests
 
 #undef LOCTEXT_NAMESPACE